@@ -0,0 +1,45 @@
+#
+# lz4
+#
+# The lz4 captures are optional: without the library, they're just not
+# supported. LZ4_FOUND tells if it was found or is being built.
+#
+option(USE_BUNDLED_LZ4 "Enable building of the bundled lz4" ${USE_BUNDLED_DEPS})
+
+if(LZ4_INCLUDE)
+	# we already have lz4
+	set(LZ4_FOUND ON)
+elseif(NOT USE_BUNDLED_LZ4)
+	find_path(LZ4_INCLUDE lz4frame.h)
+	find_library(LZ4_LIB NAMES liblz4.a lz4)
+	if(LZ4_INCLUDE AND LZ4_LIB)
+		message(STATUS "Found lz4: include: ${LZ4_INCLUDE}, lib: ${LZ4_LIB}")
+		set(LZ4_FOUND ON)
+	else()
+		message(WARNING "Couldn't find system lz4, lz4 compressed captures won't be supported")
+		set(LZ4_FOUND OFF)
+	endif()
+else()
+	set(LZ4_SRC "${PROJECT_BINARY_DIR}/lz4-prefix/src/lz4")
+	set(LZ4_INCLUDE "${LZ4_SRC}/lib")
+	set(LZ4_LIB "${LZ4_SRC}/lib/liblz4.a")
+	set(LZ4_FOUND ON)
+	if(NOT TARGET lz4)
+		message(STATUS "Using bundled lz4 in '${LZ4_SRC}'")
+		ExternalProject_Add(lz4
+			PREFIX "${PROJECT_BINARY_DIR}/lz4-prefix"
+			URL "https://github.com/lz4/lz4/archive/v1.9.4.tar.gz"
+			URL_HASH "SHA256=0b0e3aa07c8c063ddf40b082bdf7e37a1562bda40a0ff5272957f3e987e0e54b"
+			CONFIGURE_COMMAND ""
+			BUILD_COMMAND ${CMD_MAKE} -C lib liblz4.a "CFLAGS=-O3 -fPIC"
+			BUILD_IN_SOURCE 1
+			BUILD_BYPRODUCTS ${LZ4_LIB}
+			INSTALL_COMMAND "")
+		install(FILES "${LZ4_LIB}" DESTINATION "${CMAKE_INSTALL_LIBDIR}/${LIBS_PACKAGE_NAME}"
+				COMPONENT "libs-deps")
+	endif()
+endif()
+
+if(LZ4_FOUND)
+	include_directories(${LZ4_INCLUDE})
+endif()
@@ -0,0 +1,45 @@
+#
+# zstd
+#
+# The zstd captures are optional: without the library, they're just not
+# supported. ZSTD_FOUND tells if it was found or is being built.
+#
+option(USE_BUNDLED_ZSTD "Enable building of the bundled zstd" ${USE_BUNDLED_DEPS})
+
+if(ZSTD_INCLUDE)
+	# we already have zstd
+	set(ZSTD_FOUND ON)
+elseif(NOT USE_BUNDLED_ZSTD)
+	find_path(ZSTD_INCLUDE zstd.h)
+	find_library(ZSTD_LIB NAMES libzstd.a zstd)
+	if(ZSTD_INCLUDE AND ZSTD_LIB)
+		message(STATUS "Found zstd: include: ${ZSTD_INCLUDE}, lib: ${ZSTD_LIB}")
+		set(ZSTD_FOUND ON)
+	else()
+		message(WARNING "Couldn't find system zstd, zstd compressed captures won't be supported")
+		set(ZSTD_FOUND OFF)
+	endif()
+else()
+	set(ZSTD_SRC "${PROJECT_BINARY_DIR}/zstd-prefix/src/zstd")
+	set(ZSTD_INCLUDE "${ZSTD_SRC}/lib")
+	set(ZSTD_LIB "${ZSTD_SRC}/lib/libzstd.a")
+	set(ZSTD_FOUND ON)
+	if(NOT TARGET zstd)
+		message(STATUS "Using bundled zstd in '${ZSTD_SRC}'")
+		ExternalProject_Add(zstd
+			PREFIX "${PROJECT_BINARY_DIR}/zstd-prefix"
+			URL "https://github.com/facebook/zstd/releases/download/v1.5.5/zstd-1.5.5.tar.gz"
+			URL_HASH "SHA256=9c4396cc829cfae319a6e2615202e82aad41372073482fce286fac78646d3ee4"
+			CONFIGURE_COMMAND ""
+			BUILD_COMMAND ${CMD_MAKE} -C lib libzstd.a "CFLAGS=-O3 -fPIC"
+			BUILD_IN_SOURCE 1
+			BUILD_BYPRODUCTS ${ZSTD_LIB}
+			INSTALL_COMMAND "")
+		install(FILES "${ZSTD_LIB}" DESTINATION "${CMAKE_INSTALL_LIBDIR}/${LIBS_PACKAGE_NAME}"
+				COMPONENT "libs-deps")
+	endif()
+endif()
+
+if(ZSTD_FOUND)
+	include_directories(${ZSTD_INCLUDE})
+endif()
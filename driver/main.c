@@ -39,6 +39,7 @@ or GPL2.txt for full copies of the license.
 #endif
 #include <linux/vmalloc.h>
 #include <linux/wait.h>
+#include <linux/poll.h>
 #include <linux/tracepoint.h>
 #include <linux/cpu.h>
 #include <linux/jiffies.h>
@@ -143,6 +144,14 @@ static int ppm_open(struct inode *inode, struct file *filp);
 static int ppm_release(struct inode *inode, struct file *filp);
 static long ppm_ioctl(struct file *f, unsigned int cmd, unsigned long arg);
 static int ppm_mmap(struct file *filp, struct vm_area_struct *vma);
+#ifdef PPM_RING_POLL
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(4, 16, 0))
+typedef __poll_t ppm_poll_t;
+#else
+typedef unsigned int ppm_poll_t;
+#endif
+static ppm_poll_t ppm_poll(struct file *filp, poll_table *wait);
+#endif
 static int record_event_consumer(struct ppm_consumer_t *consumer,
                                  enum ppm_event_type event_type,
                                  enum syscall_flags drop_flags,
@@ -237,6 +246,9 @@ static const struct file_operations g_ppm_fops = {
 	.open = ppm_open,
 	.release = ppm_release,
 	.mmap = ppm_mmap,
+#ifdef PPM_RING_POLL
+	.poll = ppm_poll,
+#endif
 	.unlocked_ioctl = ppm_ioctl,
 	.owner = THIS_MODULE,
 };
@@ -1687,6 +1699,65 @@ cleanup_ioctl_nolock:
 	return ret;
 }
 
+#ifdef PPM_RING_POLL
+/*
+ * Report the ring as readable when it holds more than
+ * PPM_RING_WAKEUP_THRESHOLD_B bytes. Otherwise, the consumer is woken up
+ * by record_event_consumer() when an event brings it over the threshold,
+ * so that a slow producer doesn't wake it up for every event.
+ */
+static ppm_poll_t ppm_poll(struct file *filp, poll_table *wait)
+{
+	ppm_poll_t mask = 0;
+	struct task_struct *consumer_id = filp->private_data;
+	struct ppm_consumer_t *consumer = NULL;
+	struct ppm_ring_buffer_context *ring;
+	int ring_no = iminor(filp->f_path.dentry->d_inode);
+	u32 head;
+	u32 ttail;
+	u32 usedspace;
+
+	mutex_lock(&g_consumer_mutex);
+
+	consumer = ppm_find_consumer(consumer_id);
+	if (!consumer) {
+		pr_err("poll: unknown consumer %p\n", consumer_id);
+		mask = POLLERR;
+		goto cleanup_poll;
+	}
+
+	ring = per_cpu_ptr(consumer->ring_buffers, ring_no);
+	if (!ring || !ring->info) {
+		ASSERT(false);
+		mask = POLLERR;
+		goto cleanup_poll;
+	}
+
+	poll_wait(filp, &ring->wait, wait);
+
+	head = ring->info->head;
+	ttail = ring->info->tail;
+	if (head >= ttail)
+		usedspace = head - ttail;
+	else
+		usedspace = RING_BUF_SIZE + head - ttail;
+
+	if (usedspace > PPM_RING_WAKEUP_THRESHOLD_B)
+		mask |= POLLIN | POLLRDNORM;
+
+cleanup_poll:
+	mutex_unlock(&g_consumer_mutex);
+	return mask;
+}
+
+static void ppm_ring_wakeup(struct irq_work *work)
+{
+	struct ppm_ring_buffer_context *ring = container_of(work, struct ppm_ring_buffer_context, wakeup_work);
+
+	wake_up_interruptible(&ring->wait);
+}
+#endif /* PPM_RING_POLL */
+
 static int ppm_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	int ret;
@@ -2611,6 +2682,19 @@ static int record_event_consumer_for(struct task_struct* task,
 		ring_info->head = next;
 
 		++ring->nevents;
+
+#ifdef PPM_RING_POLL
+		/*
+		 * Wake up the consumer if it's waiting in poll() and the ring
+		 * is now over the wakeup threshold (see ppm_poll()). We may be
+		 * in the middle of a context switch, so the wakeup is deferred
+		 * to an irq_work. There's no full barrier here, so a wakeup can
+		 * be missed: the consumer then just waits for its poll() timeout.
+		 */
+		if (usedspace + event_size > PPM_RING_WAKEUP_THRESHOLD_B &&
+		    waitqueue_active(&ring->wait))
+			irq_work_queue(&ring->wakeup_work);
+#endif
 	} else {
 		if (cbres == PPM_SUCCESS) {
 			ASSERT(freespace < sizeof(struct ppm_evt_hdr) + args.arg_data_offset);
@@ -3056,6 +3140,12 @@ static int init_ring_buffer(struct ppm_ring_buffer_context *ring)
 	reset_ring_buffer(ring);
 	atomic_set(&ring->preempt_count, 0);
 
+#ifdef PPM_RING_POLL
+	init_waitqueue_head(&ring->wait);
+	init_irq_work(&ring->wakeup_work, ppm_ring_wakeup);
+	ring->wakeup_ready = true;
+#endif
+
 	pr_info("CPU buffer initialized, size=%d\n", RING_BUF_SIZE);
 
 	return 1;
@@ -3067,6 +3157,17 @@ init_ring_err:
 
 static void free_ring_buffer(struct ppm_ring_buffer_context *ring)
 {
+#ifdef PPM_RING_POLL
+	/*
+	 * A wakeup could still be pending. The rings of the CPUs that were
+	 * never brought up, or whose initialization failed, have no irq_work.
+	 */
+	if (ring->wakeup_ready) {
+		irq_work_sync(&ring->wakeup_work);
+		ring->wakeup_ready = false;
+	}
+#endif
+
 	if (ring->info) {
 		vfree(ring->info);
 		ring->info = NULL;
@@ -31,6 +31,15 @@ static __always_inline uint32_t maps__get_snaplen()
 	return g_settings.snaplen;
 }
 
+static __always_inline u64 maps__get_ringbuf_submit_flags()
+{
+	/* Without flags the kernel notifies userspace only when it has already
+	 * consumed all the previous events, so we don't pay for a wakeup for
+	 * every event.
+	 */
+	return g_settings.ringbuf_wakeup ? 0 : BPF_RB_NO_WAKEUP;
+}
+
 /*=============================== SETTINGS ===========================*/
 
 /*=============================== SYSCALL-64 INTERESTING TABLE ===========================*/
@@ -168,10 +168,10 @@ static __always_inline void auxmap__submit_event(struct auxiliary_map *auxmap)
 		return;
 	}
 
-	/* `BPF_RB_NO_WAKEUP` means that we don't send to userspace a notification
-	 *  when a new event is in the buffer.
+	/* Unless userspace waits on the ringbufs, `BPF_RB_NO_WAKEUP` means that
+	 * we don't send to userspace a notification when a new event is in the buffer.
 	 */
-	int err = bpf_ringbuf_output(rb, auxmap->data, auxmap->payload_pos, BPF_RB_NO_WAKEUP);
+	int err = bpf_ringbuf_output(rb, auxmap->data, auxmap->payload_pos, maps__get_ringbuf_submit_flags());
 	if(err)
 	{
 		counter->n_drops_buffer++;
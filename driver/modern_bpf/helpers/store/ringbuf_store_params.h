@@ -135,14 +135,14 @@ static __always_inline void ringbuf__store_event_header(struct ringbuf_struct *r
  * @brief This method states that the collection of the event is
  * terminated.
  *
- * `BPF_RB_NO_WAKEUP` option allow to not notify the userspace
- * when a new event is submitted.
+ * Unless userspace waits on the ringbufs, `BPF_RB_NO_WAKEUP` option
+ * allow to not notify the userspace when a new event is submitted.
  *
  * @param ringbuf pointer to the `ringbuf_struct`.
  */
 static __always_inline void ringbuf__submit_event(struct ringbuf_struct *ringbuf)
 {
-	bpf_ringbuf_submit(ringbuf->data, BPF_RB_NO_WAKEUP);
+	bpf_ringbuf_submit(ringbuf->data, maps__get_ringbuf_submit_flags());
 }
 
 /////////////////////////////////
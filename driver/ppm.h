@@ -24,6 +24,25 @@ or GPL2.txt for full copies of the license.
 #define ASSERT(expr)
 #endif /* _DEBUG */
 
+#include <linux/version.h>
+#include <linux/wait.h>
+
+/*
+ * Consumers can poll() the ring buffers instead of sleeping when they are
+ * empty: see ppm_poll()
+ */
+#if (LINUX_VERSION_CODE >= KERNEL_VERSION(3, 5, 0))
+#include <linux/irq_work.h>
+#define PPM_RING_POLL
+#endif
+
+/*
+ * A polling consumer is woken up only when its ring holds more than this
+ * many bytes, or when its poll() times out. This is BUFFER_EMPTY_THRESHOLD_B
+ * in libscap: below it, the consumer considers the ring empty and waits.
+ */
+#define PPM_RING_WAKEUP_THRESHOLD_B 20000
+
 #endif /* UDIG */
 
 #define RW_SNAPLEN_EVENT 4096
@@ -58,6 +77,11 @@ struct ppm_ring_buffer_context {
 	atomic_t preempt_count;
 #endif
 	char *str_storage;	/* String storage. Size is one page. */
+#ifdef PPM_RING_POLL
+	wait_queue_head_t wait;		/* Consumers poll()ing the ring. */
+	struct irq_work wakeup_work;	/* Wakes up `wait` outside of the tracepoint context. */
+	bool wakeup_ready;		/* `wait` and `wakeup_work` are initialized. */
+#endif
 };
 
 #ifndef UDIG
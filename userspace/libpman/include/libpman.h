@@ -155,6 +155,21 @@ extern "C"
 	 */
 	int pman_finalize_ringbuf_array_after_loading(void);
 
+	/**
+	 * @brief Choose how `pman_consume_one_from_buffers` walks the ringbufs:
+	 * - `false` (default): round-robin, returning the first event found.
+	 * - `true`: return the events in timestamp order across all the ringbufs.
+	 * The producer positions of all the ringbufs are read together and
+	 * all the events written before that point are returned ordered, like
+	 * the kmod and bpf engines do. The events returned remain valid until the
+	 * next call.
+	 *
+	 * Must be set before starting to consume events.
+	 *
+	 * @param ordered `true` to enable the ordered consumption.
+	 */
+	void pman_set_ordered_consumption(bool ordered);
+
 	/**
 	 * @brief Search for one event to read in all the ringbufs.
 	 *
@@ -166,6 +181,37 @@ extern "C"
 	 */
 	int pman_consume_one_from_buffers(void** event_ptr, uint16_t* cpu_id);
 
+	/**
+	 * @brief Search for up to `max_events` events to read in all the ringbufs.
+	 * All the events returned remain valid until the next call to this
+	 * function or to `pman_consume_one_from_buffers`.
+	 *
+	 * Batches are available only with the ordered consumption (see
+	 * `pman_set_ordered_consumption`), otherwise at most one event is returned.
+	 *
+	 * @param event_ptrs array of `max_events` pointers filled with the events found.
+	 * @param cpu_ids array of `max_events` elements filled with the id of the CPU
+	 * on which every event was found.
+	 * @param max_events size of the two arrays.
+	 * @param n_events returns the number of events found.
+	 * @return `0` if at least one event is found otherwise returns `-1`
+	 */
+	int pman_consume_batch_from_buffers(void** event_ptrs, uint16_t* cpu_ids, uint32_t max_events, uint32_t* n_events);
+
+	/**
+	 * @brief Block until an event is pushed into one of the ringbufs, or
+	 * until `timeout_ms` milliseconds have passed. Call it only when the
+	 * consume functions don't find any event: all the events previously
+	 * returned are invalidated.
+	 *
+	 * The BPF programs notify userspace only if `pman_set_ringbuf_wakeup`
+	 * was enabled, otherwise this function always waits for the timeout.
+	 *
+	 * @param timeout_ms maximum time to wait in milliseconds.
+	 * @return `0` on success (also on timeout), `errno` in case of error.
+	 */
+	int pman_wait_for_data(int timeout_ms);
+
 	/////////////////////////////
 	// CAPTURE (EXCHANGE VALUES WITH BPF SIDE)
 	/////////////////////////////
@@ -214,6 +260,16 @@ extern "C"
 	 */
 	void pman_set_snaplen(uint32_t desired_snaplen);
 
+	/**
+	 * @brief Ask the BPF programs to notify userspace when they push an
+	 * event into a ringbuf that was fully consumed, so that it can be
+	 * waited for with `pman_wait_for_data`. Disabled by default: the
+	 * notification has a cost for the producer.
+	 *
+	 * @param wakeup `true` to enable the notifications.
+	 */
+	void pman_set_ringbuf_wakeup(bool wakeup);
+
 	/**
 	 * @brief Get API version to check it a runtime.
 	 *
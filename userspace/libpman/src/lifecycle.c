@@ -50,6 +50,24 @@ void pman_close_probe()
 		free(g_state.prod_pos);
 	}
 
+	if(g_state.heads)
+	{
+		free(g_state.heads);
+		g_state.heads = NULL;
+	}
+
+	if(g_state.heap)
+	{
+		free(g_state.heap);
+		g_state.heap = NULL;
+	}
+
+	if(g_state.release_list)
+	{
+		free(g_state.release_list);
+		g_state.release_list = NULL;
+	}
+
 	if(!g_state.skel)
 	{
 		bpf_probe__destroy(g_state.skel);
@@ -66,6 +66,11 @@ void pman_set_snaplen(uint32_t desired_snaplen)
 	g_state.skel->bss->g_settings.snaplen = desired_snaplen;
 }
 
+void pman_set_ringbuf_wakeup(bool wakeup)
+{
+	g_state.skel->bss->g_settings.ringbuf_wakeup = wakeup;
+}
+
 #ifdef TEST_HELPERS
 void pman_mark_single_64bit_syscall_as_interesting(int intersting_syscall_id)
 {
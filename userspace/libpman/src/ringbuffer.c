@@ -22,8 +22,10 @@ limitations under the License.
 #include <stdint.h>
 #include <stdbool.h>
 #include <sys/mman.h>
+#include <sys/epoll.h>
 
 #include "ringbuffer_definitions.h"
+#include <ppm_events_public.h>
 
 /* This must be done to please the verifier! At load-time, the verifier must know the
  * size of a map inside the array.
@@ -72,9 +74,26 @@ static int allocate_consumer_producer_positions()
 		pman_print_error("failed to alloc memory for cons_pos and prod_pos");
 		return errno;
 	}
+
+	/* Used only by the ordered consumer. */
+	g_state.heap_size = 0;
+	g_state.n_release = 0;
+	g_state.heads = (struct ringbuf_head *)calloc(g_state.n_cpus, sizeof(struct ringbuf_head));
+	g_state.heap = (struct ringbuf_heap_entry *)calloc(g_state.n_cpus, sizeof(struct ringbuf_heap_entry));
+	g_state.release_list = (int *)calloc(g_state.n_cpus, sizeof(int));
+	if(g_state.heads == NULL || g_state.heap == NULL || g_state.release_list == NULL)
+	{
+		pman_print_error("failed to alloc memory for the ringbuf heads and heap");
+		return errno;
+	}
 	return 0;
 }
 
+void pman_set_ordered_consumption(bool ordered)
+{
+	g_state.ordered_consumption = ordered;
+}
+
 int pman_prepare_ringbuf_array_before_loading()
 {
 	int err;
@@ -273,7 +292,285 @@ static int ringbuf__consume_one_event(struct ring_buffer *rb, void **event_ptr,
 	return -1;
 }
 
+/* Ordered consumption.
+ *
+ * Like the kmod and bpf engines do with their per-CPU buffers, we take a
+ * snapshot of the producer position of every ringbuf and we return all the
+ * samples written before it in timestamp order. When all the ringbufs are
+ * drained up to the snapshot we take a new one.
+ *
+ * The head sample of every ringbuf is cached in `g_state.heads` and the
+ * ringbufs with a head are kept in a min-heap keyed on the head timestamp
+ * (ties broken on the CPU id), so returning an event costs O(log(n_cpus))
+ * instead of a scan over all the ringbufs.
+ *
+ * `g_state.cons_pos` is only our local consumer position: the space of the
+ * samples we returned is given back to the producer at the beginning of the
+ * next call, when the caller is done with them.
+ */
+
+static inline uint64_t ringbuf__head_ts(int ring_id)
+{
+	return ((struct ppm_evt_hdr *)g_state.heads[ring_id].sample)->ts;
+}
+
+static inline bool ringbuf__heap_less(const struct ringbuf_heap_entry *a, const struct ringbuf_heap_entry *b)
+{
+	return a->ts < b->ts || (a->ts == b->ts && a->ring < b->ring);
+}
+
+static void ringbuf__heap_sift_down(int pos)
+{
+	struct ringbuf_heap_entry entry = g_state.heap[pos];
+	int child;
+
+	while((child = 2 * pos + 1) < g_state.heap_size)
+	{
+		if(child + 1 < g_state.heap_size && ringbuf__heap_less(&g_state.heap[child + 1], &g_state.heap[child]))
+		{
+			child++;
+		}
+
+		if(!ringbuf__heap_less(&g_state.heap[child], &entry))
+		{
+			break;
+		}
+
+		g_state.heap[pos] = g_state.heap[child];
+		pos = child;
+	}
+	g_state.heap[pos] = entry;
+}
+
+static inline void ringbuf__set_cons_pos(int ring_id, unsigned long pos)
+{
+	g_state.cons_pos[ring_id] = pos;
+	if(!g_state.heads[ring_id].release_pending)
+	{
+		g_state.heads[ring_id].release_pending = true;
+		g_state.release_list[g_state.n_release++] = ring_id;
+	}
+}
+
+/* Give back to the producers the space of all the samples we consumed. */
+static void ringbuf__release_consumed(struct ring_buffer *rb)
+{
+	int i;
+
+	for(i = 0; i < g_state.n_release; i++)
+	{
+		int ring_id = g_state.release_list[i];
+
+		g_state.heads[ring_id].release_pending = false;
+		smp_store_release(rb->rings[ring_id].consumer_pos, g_state.cons_pos[ring_id]);
+	}
+	g_state.n_release = 0;
+}
+
+/* Cache in `g_state.heads` the first committed sample of the ringbuf that
+ * comes before the producer position snapshot, skipping the discarded ones.
+ * Return `true` if a sample was found.
+ */
+static bool ringbuf__peek_head(struct ring *r, int ring_id)
+{
+	struct ringbuf_head *head = &g_state.heads[ring_id];
+	unsigned long pos = g_state.cons_pos[ring_id];
+	int *len_ptr, len;
+
+	head->sample = NULL;
+
+	while(pos < g_state.prod_pos[ring_id])
+	{
+		len_ptr = r->data + (pos & r->mask);
+		len = smp_load_acquire(len_ptr);
+
+		/* Sample not committed yet, we will see it with the next snapshot. */
+		if(len & BPF_RINGBUF_BUSY_BIT)
+		{
+			break;
+		}
+
+		if((len & BPF_RINGBUF_DISCARD_BIT) == 0)
+		{
+			head->sample = (void *)len_ptr + BPF_RINGBUF_HDR_SZ;
+			head->next_pos = pos + roundup_len(len);
+			break;
+		}
+
+		pos += roundup_len(len);
+	}
+
+	if(pos != g_state.cons_pos[ring_id])
+	{
+		ringbuf__set_cons_pos(ring_id, pos);
+	}
+
+	return head->sample != NULL;
+}
+
+static void ringbuf__take_snapshot(struct ring_buffer *rb)
+{
+	int i;
+
+	g_state.heap_size = 0;
+
+	for(i = 0; i < rb->ring_cnt; i++)
+	{
+		struct ring *r = &rb->rings[i];
+
+		g_state.prod_pos[i] = smp_load_acquire(r->producer_pos);
+		if(ringbuf__peek_head(r, i))
+		{
+			g_state.heap[g_state.heap_size].ts = ringbuf__head_ts(i);
+			g_state.heap[g_state.heap_size].ring = i;
+			g_state.heap_size++;
+		}
+	}
+
+	for(i = g_state.heap_size / 2 - 1; i >= 0; i--)
+	{
+		ringbuf__heap_sift_down(i);
+	}
+}
+
+/* Return the oldest sample among all the ringbufs, and move its ringbuf to
+ * the next sample. Return NULL if all the ringbufs are drained up to the
+ * snapshot.
+ */
+static void *ringbuf__pop_oldest(struct ring_buffer *rb, uint16_t *cpu_id)
+{
+	void *sample;
+	int ring_id;
+
+	if(g_state.heap_size == 0)
+	{
+		return NULL;
+	}
+
+	ring_id = g_state.heap[0].ring;
+	sample = g_state.heads[ring_id].sample;
+	*cpu_id = ring_id;
+
+	ringbuf__set_cons_pos(ring_id, g_state.heads[ring_id].next_pos);
+	if(ringbuf__peek_head(&rb->rings[ring_id], ring_id))
+	{
+		g_state.heap[0].ts = ringbuf__head_ts(ring_id);
+	}
+	else
+	{
+		g_state.heap[0] = g_state.heap[--g_state.heap_size];
+	}
+	ringbuf__heap_sift_down(0);
+
+	return sample;
+}
+
+/* return 0 if a valid event is found, otherwise -1.*/
+static int ringbuf__consume_ordered_event(struct ring_buffer *rb, void **event_ptr, uint16_t *cpu_id)
+{
+	ringbuf__release_consumed(rb);
+
+	if(g_state.heap_size == 0)
+	{
+		ringbuf__take_snapshot(rb);
+	}
+
+	*event_ptr = ringbuf__pop_oldest(rb, cpu_id);
+	if(*event_ptr == NULL)
+	{
+		*cpu_id = -1;
+		return -1;
+	}
+	return 0;
+}
+
+/* return 0 if at least one valid event is found, otherwise -1.*/
+static int ringbuf__consume_ordered_batch(struct ring_buffer *rb, void **event_ptrs, uint16_t *cpu_ids, uint32_t max_events, uint32_t *n_events)
+{
+	uint32_t n = 0;
+
+	ringbuf__release_consumed(rb);
+
+	while(n < max_events)
+	{
+		if(g_state.heap_size == 0)
+		{
+			/* Nothing is released until the next call, so we can
+			 * safely take a new snapshot in the middle of a batch.
+			 */
+			ringbuf__take_snapshot(rb);
+		}
+
+		event_ptrs[n] = ringbuf__pop_oldest(rb, &cpu_ids[n]);
+		if(event_ptrs[n] == NULL)
+		{
+			break;
+		}
+		n++;
+	}
+
+	*n_events = n;
+	return n > 0 ? 0 : -1;
+}
+
 int pman_consume_one_from_buffers(void **event_ptr, uint16_t *cpu_id)
 {
+	if(g_state.ordered_consumption)
+	{
+		return ringbuf__consume_ordered_event(g_state.rb_manager, event_ptr, cpu_id);
+	}
 	return ringbuf__consume_one_event(g_state.rb_manager, event_ptr, cpu_id);
-}
\ No newline at end of file
+}
+
+int pman_consume_batch_from_buffers(void **event_ptrs, uint16_t *cpu_ids, uint32_t max_events, uint32_t *n_events)
+{
+	if(g_state.ordered_consumption)
+	{
+		return ringbuf__consume_ordered_batch(g_state.rb_manager, event_ptrs, cpu_ids, max_events, n_events);
+	}
+
+	/* The round-robin consumer gives the space of a sample back to the
+	 * producer as soon as it returns it, so it can't return batches.
+	 */
+	*n_events = 0;
+	if(max_events == 0 || ringbuf__consume_one_event(g_state.rb_manager, &event_ptrs[0], &cpu_ids[0]))
+	{
+		return -1;
+	}
+	*n_events = 1;
+	return 0;
+}
+
+int pman_wait_for_data(int timeout_ms)
+{
+	struct ring_buffer *rb = g_state.rb_manager;
+	struct epoll_event event;
+	int i;
+
+	/* The kernel notifies us only for the events pushed into a ringbuf we
+	 * have fully consumed, so give back all the space we consumed...
+	 */
+	if(g_state.ordered_consumption)
+	{
+		ringbuf__release_consumed(rb);
+	}
+
+	/* ...and check that no event arrived before we did it, since its
+	 * notification could have been skipped.
+	 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for(i = 0; i < rb->ring_cnt; i++)
+	{
+		if(smp_load_acquire(rb->rings[i].producer_pos) != g_state.cons_pos[i])
+		{
+			return 0;
+		}
+	}
+
+	if(epoll_wait(ring_buffer__epoll_fd(rb), &event, 1, timeout_ms) < 0 && errno != EINTR)
+	{
+		pman_print_error("failed to wait on the ringbuffers");
+		return errno;
+	}
+	return 0;
+}
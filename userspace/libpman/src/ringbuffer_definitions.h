@@ -41,6 +41,25 @@ struct ring_buffer
 	int ring_cnt;
 };
 
+/* Used by the ordered consumer: the first committed sample of a ringbuf
+ * that we have not consumed yet, and the consumer position right after it.
+ */
+struct ringbuf_head
+{
+	void *sample;
+	unsigned long next_pos;
+	bool release_pending; /* the ringbuf is in `g_state.release_list`. */
+};
+
+/* Used by the ordered consumer: the ringbufs with a cached head are kept in
+ * a min-heap keyed on the timestamp of the head sample.
+ */
+struct ringbuf_heap_entry
+{
+	uint64_t ts;
+	int ring;
+};
+
 static inline int roundup_len(uint32_t len)
 {
 	/* clear out top 2 bits (discard and busy, if set) */
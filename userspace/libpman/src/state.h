@@ -22,9 +22,13 @@ limitations under the License.
 #include <shared_definitions/struct_definitions.h>
 #include <bpf_probe.skel.h>
 #include <unistd.h>
+#include <stdbool.h>
 
 #define MAX_ERROR_MESSAGE_LEN 100
 
+struct ringbuf_head;
+struct ringbuf_heap_entry;
+
 struct internal_state
 {
 	struct bpf_probe* skel;		/* bpf skeleton with all programs and maps. */
@@ -33,6 +37,12 @@ struct internal_state
 	int ringbuf_pos;		/* actual ringbuf we are considering. */
 	unsigned long* cons_pos;	/* every ringbuf has a consumer position. */
 	unsigned long* prod_pos;	/* every ringbuf has a producer position. */
+	bool ordered_consumption;	/* consume the events in timestamp order across all the ringbufs. */
+	struct ringbuf_head* heads;	/* ordered consumption: cached head sample of every ringbuf. */
+	struct ringbuf_heap_entry* heap; /* ordered consumption: min-heap of the ringbufs with a cached head. */
+	int heap_size;			/* ordered consumption: number of ringbufs in the heap. */
+	int* release_list;		/* ordered consumption: ringbufs whose consumer position must be released. */
+	int n_release;			/* ordered consumption: number of ringbufs in `release_list`. */
 	int32_t inner_ringbuf_map_fd;	/* inner map used to configure the ringbuf array before loading phase. */
 };
 
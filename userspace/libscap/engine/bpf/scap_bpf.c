@@ -1496,6 +1496,18 @@ int32_t scap_bpf_load(
 		int pmu_fd;
 		struct scap_device *dev;
 
+		//
+		// To poll() the buffers, the kernel must wake us up as soon as
+		// they hold more than what refill_read_buffers() considers empty,
+		// instead of when half of the buffer is full. Waking up on every
+		// event would make a slow producer wake us up for each of them.
+		//
+		if(handle->m_dev_set.m_poll_wait)
+		{
+			attr.watermark = 1;
+			attr.wakeup_watermark = BUFFER_EMPTY_THRESHOLD_B;
+		}
+
 		/* Begin StackRox */
 		if(hotplug_enabled == 1 && j > 0)
 		/* End StackRox */
@@ -1700,6 +1712,11 @@ static int32_t next(struct scap_engine_handle engine, OUT scap_evt** pevent, OUT
 	return ringbuffer_next(&engine.m_handle->m_dev_set, pevent, pcpuid);
 }
 
+static int32_t next_batch(struct scap_engine_handle engine, OUT scap_batch_entry* entries, uint32_t max_events, OUT uint32_t* nevents)
+{
+	return ringbuffer_next_batch(&engine.m_handle->m_dev_set, entries, max_events, nevents);
+}
+
 static int32_t unsupported_config(struct scap_engine_handle engine, const char* msg)
 {
 	struct bpf_engine* handle = engine.m_handle;
@@ -1793,6 +1810,7 @@ static int32_t init(scap_t* handle, scap_open_args *open_args)
 	{
 		return rc;
 	}
+	engine.m_handle->m_dev_set.m_poll_wait = (open_args->wait_mode == SCAP_WAIT_POLL);
 
 	rc = scap_bpf_load(engine.m_handle, bpf_probe, &handle->m_api_version, &handle->m_schema_version);
 	if(rc != SCAP_SUCCESS)
@@ -1841,6 +1859,7 @@ const struct scap_vtable scap_bpf_engine = {
 	.free_handle = free_handle,
 	.close = scap_bpf_close,
 	.next = next,
+	.next_batch = next_batch,
 	.start_capture = scap_bpf_start_capture,
 	.stop_capture = scap_bpf_stop_capture,
 	.configure = configure,
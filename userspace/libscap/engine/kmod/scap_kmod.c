@@ -108,6 +108,7 @@ int32_t scap_kmod_init(scap_t *handle, scap_open_args *oargs)
 	{
 		return rc;
 	}
+	handle->m_engine.m_handle->m_dev_set.m_poll_wait = (oargs->wait_mode == SCAP_WAIT_POLL);
 	fill_syscalls_of_interest(&oargs->ppm_sc_of_interest, &handle->syscalls_of_interest);
 
 	//
@@ -282,6 +283,11 @@ int32_t scap_kmod_next(struct scap_engine_handle engine, OUT scap_evt** pevent,
 	return ringbuffer_next(&engine.m_handle->m_dev_set, pevent, pcpuid);
 }
 
+int32_t scap_kmod_next_batch(struct scap_engine_handle engine, OUT scap_batch_entry* entries, uint32_t max_events, OUT uint32_t* nevents)
+{
+	return ringbuffer_next_batch(&engine.m_handle->m_dev_set, entries, max_events, nevents);
+}
+
 uint32_t scap_kmod_get_n_devs(struct scap_engine_handle engine)
 {
 	return engine.m_handle->m_dev_set.m_ndevs;
@@ -836,6 +842,7 @@ struct scap_vtable scap_kmod_engine = {
 	.free_handle = free_handle,
 	.close = scap_kmod_close,
 	.next = scap_kmod_next,
+	.next_batch = scap_kmod_next_batch,
 	.start_capture = scap_kmod_start_capture,
 	.stop_capture = scap_kmod_stop_capture,
 	.configure = configure,
@@ -18,6 +18,7 @@ limitations under the License.
 #include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <libpman.h>
 
 #include "modern_bpf.h"
@@ -43,15 +44,75 @@ static struct modern_bpf_engine* scap_modern_bpf_alloc_engine(scap_t* main_handl
 
 static void scap_modern_bpf_free_engine(struct scap_engine_handle engine)
 {
+	free(engine.m_handle->m_batch_evts);
+	free(engine.m_handle->m_batch_cpuids);
 	free(engine.m_handle);
 }
 
+/* When the ringbufs are empty, wait for the probe to notify us that new
+ * events are available. Return `true` if it's worth trying again to read them.
+ */
+static bool scap_modern_bpf_wait_for_data(struct modern_bpf_engine* handle)
+{
+	return handle->m_epoll_wait && pman_wait_for_data(BUFFER_EMPTY_WAIT_TIME_US_MAX / 1000) == 0;
+}
+
 static int32_t scap_modern_bpf_next(struct scap_engine_handle engine, OUT scap_evt** pevent, OUT uint16_t* pcpuid)
 {
-	if(pman_consume_one_from_buffers((void**)pevent, pcpuid))
+	if(pman_consume_one_from_buffers((void**)pevent, pcpuid) == 0)
+	{
+		return SCAP_SUCCESS;
+	}
+
+	if(scap_modern_bpf_wait_for_data(engine.m_handle) &&
+	   pman_consume_one_from_buffers((void**)pevent, pcpuid) == 0)
+	{
+		return SCAP_SUCCESS;
+	}
+	return SCAP_TIMEOUT;
+}
+
+static int32_t scap_modern_bpf_next_batch(struct scap_engine_handle engine, OUT scap_batch_entry* entries, uint32_t max_events, OUT uint32_t* nevents)
+{
+	struct modern_bpf_engine* handle = engine.m_handle;
+	uint32_t j;
+
+	/* libpman wants two plain arrays, all the events of a batch must come
+	 * from a single call to keep them valid.
+	 */
+	if(max_events > handle->m_batch_size)
+	{
+		void** evts = realloc(handle->m_batch_evts, max_events * sizeof(void*));
+		if(evts == NULL)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error allocating the batch of %u events", max_events);
+			return SCAP_FAILURE;
+		}
+		handle->m_batch_evts = evts;
+
+		uint16_t* cpuids = realloc(handle->m_batch_cpuids, max_events * sizeof(uint16_t));
+		if(cpuids == NULL)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error allocating the batch of %u events", max_events);
+			return SCAP_FAILURE;
+		}
+		handle->m_batch_cpuids = cpuids;
+		handle->m_batch_size = max_events;
+	}
+
+	if(pman_consume_batch_from_buffers(handle->m_batch_evts, handle->m_batch_cpuids, max_events, nevents) &&
+	   (!scap_modern_bpf_wait_for_data(handle) ||
+	    pman_consume_batch_from_buffers(handle->m_batch_evts, handle->m_batch_cpuids, max_events, nevents)))
 	{
 		return SCAP_TIMEOUT;
 	}
+
+	for(j = 0; j < *nevents; j++)
+	{
+		entries[j].evt = handle->m_batch_evts[j];
+		entries[j].cpuid = handle->m_batch_cpuids[j];
+		entries[j].dump_flags = 0;
+	}
 	return SCAP_SUCCESS;
 }
 
@@ -92,6 +153,9 @@ int32_t scap_modern_bpf_init(scap_t* handle, scap_open_args* open_args)
 	/* Return the number of system available CPUs, not online CPUs. */
 	engine.m_handle->m_num_cpus = pman_get_cpus_number();
 
+	/* Like the other drivers, return the events in timestamp order across CPUs. */
+	pman_set_ordered_consumption(true);
+
 	/* Load and attach */
 	ret = pman_open_probe();
 	ret = ret ?: pman_prepare_ringbuf_array_before_loading();
@@ -106,6 +170,10 @@ int32_t scap_modern_bpf_init(scap_t* handle, scap_open_args* open_args)
 		return ret;
 	}
 
+	/* Let the probe notify us when we wait for new events. */
+	engine.m_handle->m_epoll_wait = (open_args->wait_mode == SCAP_WAIT_POLL);
+	pman_set_ringbuf_wakeup(engine.m_handle->m_epoll_wait);
+
 	handle->m_api_version = pman_get_probe_api_ver();
 	handle->m_schema_version = pman_get_probe_schema_ver();
 
@@ -165,6 +233,7 @@ struct scap_vtable scap_modern_bpf_vtable = {
 	.free_handle = scap_modern_bpf_free_engine,
 	.close = scap_modern_bpf_close,
 	.next = scap_modern_bpf_next,
+	.next_batch = scap_modern_bpf_next_batch,
 	.start_capture = scap_modern_bpf_start_capture,
 	.stop_capture = scap_modern_bpf_stop_capture,
 	.configure = scap_modern_bpf_configure,
@@ -27,6 +27,10 @@ struct modern_bpf_engine
 	bool m_syscalls_of_interest[SYSCALL_TABLE_SIZE];
 	size_t m_num_cpus;
 	char* m_lasterr;
+	bool m_epoll_wait;	 /* wait on the ringbufs when they are empty, see SCAP_WAIT_POLL. */
+	void** m_batch_evts;	 /* events returned by libpman for a `next_batch` call. */
+	uint16_t* m_batch_cpuids; /* CPU ids of the events in `m_batch_evts`. */
+	uint32_t m_batch_size;	 /* size of the two arrays above. */
 };
 
 #define SCAP_HANDLE_T struct modern_bpf_engine
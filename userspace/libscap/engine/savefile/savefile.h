@@ -18,16 +18,26 @@ limitations under the License.
 
 #include <stdint.h>
 #include <stddef.h>
-#include "scap_reader.h"
-#include "scap_savefile.h"
 
+// before scap_reader.h, which pulls in the default from scap_open.h
 #define SCAP_HANDLE_T struct savefile_engine
 
+#include "scap_reader.h"
+#include "scap_savefile.h"
+
 typedef struct _scap_machine_info scap_machine_info;
 struct scap_proclist;
 struct scap_addrlist;
 struct scap_userlist;
 
+//
+// Size of the buffer holding the events returned by a single
+// next_batch call
+//
+#define SAVEFILE_BATCH_BUF_SIZE (1 << 20)
+
+struct savefile_chunks;
+
 struct savefile_engine
 {
 	char* m_lasterr;
@@ -37,5 +47,21 @@ struct savefile_engine
 	char* m_reader_evt_buf;
 	size_t m_reader_evt_buf_size;
 	uint32_t m_last_evt_dump_flags;
+	char* m_batch_buf;
+	uint32_t m_chunk_threads;
+	struct savefile_chunks* m_chunks; ///< The event chunks of captures written with scap_dump_open_chunked, NULL until one is found
+	bool m_evtmask_supported; ///< The event mask can be set, see scap_open_args.savefile_eventmask
+	bool m_evtmask_enabled; ///< If true, only the events set in m_evtmask are returned
+	uint8_t m_evtmask[EVC_EVTYPES_LEN];
+	uint64_t m_seek_ts; ///< If not zero, the events before this timestamp are skipped, see scap_seek_ts
 };
 
+//
+// Event chunks, see scap_savefile_chunks.c
+//
+int32_t savefile_chunks_init(struct savefile_engine* handle);
+int32_t savefile_chunks_get_reader(struct savefile_engine* handle, bool may_load, scap_reader_t** r);
+int32_t savefile_chunks_seek_ts(struct savefile_engine* handle, uint64_t ts);
+void savefile_chunks_reset(struct savefile_engine* handle);
+void savefile_chunks_close(struct savefile_engine* handle);
+
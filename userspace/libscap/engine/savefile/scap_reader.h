@@ -23,6 +23,7 @@ limitations under the License.
 #include <stdlib.h>
 #include "scap_assert.h"
 #include "scap_zlib.h"
+#include "scap.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,6 +48,16 @@ typedef struct scap_reader
      */
     int (*read)(struct scap_reader *r, void* buf, uint32_t len);
 
+    /**
+     * @brief Optional, NULL if not supported. Returns a pointer to the
+     * next len bytes of data and moves past them, without copying them.
+     * The data stays valid until the reader is closed, and may be
+     * read-only: callers that patch it must copy it first. Returns NULL
+     * if less than len bytes are left. A reader may unset read_ptr
+     * while it is being read, so check it before each call.
+     */
+    void* (*read_ptr)(struct scap_reader *r, uint32_t len);
+
     /**
      * @brief Returns the current offset in the data being read.
      * On error, returns a negative value and error() can be used to
@@ -98,6 +109,33 @@ scap_reader_t *scap_reader_open_gzfile(gzFile file);
  */
 scap_reader_t *scap_reader_open_buffered(scap_reader_t* reader, uint32_t bufsize, bool own_reader);
 
+/**
+ * @brief Opens a reader over len bytes of memory, which must stay valid
+ * until the reader is closed. read_ptr() hands out pointers into buf.
+ */
+scap_reader_t *scap_reader_open_memory(void* buf, uint64_t len);
+
+#ifndef _WIN32
+/**
+ * @brief Opens a reader that maps the whole file in memory, read-only,
+ * starting to read from the current position of fd, and hands out
+ * pointers into the mapping with read_ptr(). If the file grows past the
+ * mapping while being read, the reader falls back to buffered reads of
+ * fd and unsets read_ptr. Returns NULL if fd is not a regular file or
+ * can't be mapped. On success, the reader takes ownership of fd.
+ */
+scap_reader_t *scap_reader_open_mmap(int fd);
+
+/**
+ * @brief Opens a reader that decompresses the stream of fd, whose first
+ * head_len bytes have already been read from fd into head. Seeking is
+ * supported only from the start or the current position, and backwards
+ * only if fd can be rewound. On success, the reader takes ownership of
+ * fd. On failure, returns NULL and fills error.
+ */
+scap_reader_t *scap_reader_open_decompress(int fd, compression_mode compress, const uint8_t* head, uint32_t head_len, char* error);
+#endif
+
 
 #ifdef __cplusplus
 }
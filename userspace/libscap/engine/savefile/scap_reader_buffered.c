@@ -95,6 +95,7 @@ static int64_t buffered_seek(scap_reader_t *r, int64_t offset, int whence)
     }
     h->m_buffer_off = 0;
     h->m_buffer_len = 0;
+    h->m_has_err = false;
     h->m_offset = h->m_reader->seek(h->m_reader, offset, whence);
     return h->m_offset;
 }
@@ -137,6 +138,7 @@ scap_reader_t *scap_reader_open_buffered(scap_reader_t* reader, uint32_t bufsize
     scap_reader_t* r = (scap_reader_t *) malloc (sizeof (scap_reader_t));
     r->handle = h;
     r->read = &buffered_read;
+    r->read_ptr = NULL;
     r->offset = &buffered_offset;
     r->tell = &buffered_tell;
     r->seek = &buffered_seek;
@@ -0,0 +1,305 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "scap_reader.h"
+#include "scap_compress.h"
+#include "../common/strlcpy.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define DECOMPRESS_IN_SIZE (128 * 1024)
+#define DECOMPRESS_OUT_SIZE (256 * 1024)
+
+typedef struct reader_handle
+{
+    int m_fd; ///< The compressed file
+    off_t m_start; ///< The position of the compressed stream in the file
+    compression_mode m_compress;
+    scap_decompressor* m_decompressor;
+    uint8_t* m_in; ///< Compressed data read from the file
+    size_t m_in_pos;
+    size_t m_in_len;
+    uint8_t* m_out; ///< Decompressed data not returned yet
+    size_t m_out_pos;
+    size_t m_out_len;
+    int64_t m_out_base; ///< The uncompressed position of m_out[0]
+    int64_t m_consumed; ///< The compressed bytes decompressed so far
+    bool m_eof;
+    int m_errno; ///< The error number of the last failed operation
+    char m_lasterr[SCAP_LASTERR_SIZE];
+} reader_handle_t;
+
+static void set_error(reader_handle_t* h, int errnum, const char* msg)
+{
+    h->m_errno = errnum;
+    strlcpy(h->m_lasterr, msg, sizeof(h->m_lasterr));
+}
+
+//
+// Replace the decompressed data that has been returned with new one.
+// Returns false at the end of the file or on error.
+//
+static bool fill(reader_handle_t* h)
+{
+    h->m_out_base += (int64_t) h->m_out_len;
+    h->m_out_pos = 0;
+    h->m_out_len = 0;
+
+    while (h->m_out_len == 0)
+    {
+        if (h->m_in_pos == h->m_in_len && !h->m_eof)
+        {
+            ssize_t n = read(h->m_fd, h->m_in, DECOMPRESS_IN_SIZE);
+            if (n < 0)
+            {
+                set_error(h, errno, strerror(errno));
+                return false;
+            }
+            if (n == 0)
+            {
+                // The decompressor may still hold data of the last frame
+                h->m_eof = true;
+            }
+            h->m_in_pos = 0;
+            h->m_in_len = (size_t) n;
+        }
+
+        size_t srclen = h->m_in_len - h->m_in_pos;
+        size_t dstlen = DECOMPRESS_OUT_SIZE;
+        if (scap_decompressor_run(h->m_decompressor, h->m_out, &dstlen, h->m_in + h->m_in_pos, &srclen, h->m_lasterr) != SCAP_SUCCESS)
+        {
+            h->m_errno = EIO;
+            return false;
+        }
+
+        h->m_in_pos += srclen;
+        h->m_consumed += (int64_t) srclen;
+        h->m_out_len = dstlen;
+
+        // At the end of the file, keep going until the decompressor
+        // has nothing left to return. A clean end is only between
+        // frames, otherwise the file has been truncated.
+        if (dstlen == 0 && srclen == 0 && h->m_eof)
+        {
+            if (scap_decompressor_in_frame(h->m_decompressor))
+            {
+                snprintf(h->m_lasterr, sizeof(h->m_lasterr), "truncated %s stream: the file ends in the middle of a frame",
+                         scap_compression_name(h->m_compress));
+                h->m_errno = EIO;
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int decompress_read(scap_reader_t *r, void* buf, uint32_t len)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    uint8_t* dst = (uint8_t*) buf;
+    uint32_t done = 0;
+
+    while (done < len)
+    {
+        if (h->m_out_pos == h->m_out_len && !fill(h))
+        {
+            if (h->m_errno != 0 && done == 0)
+            {
+                return -1;
+            }
+            break;
+        }
+
+        size_t n = h->m_out_len - h->m_out_pos;
+        if (n > len - done)
+        {
+            n = len - done;
+        }
+        memcpy(dst + done, h->m_out + h->m_out_pos, n);
+        h->m_out_pos += n;
+        done += (uint32_t) n;
+    }
+
+    return (int) done;
+}
+
+static int64_t decompress_offset(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    return (int64_t) h->m_start + h->m_consumed;
+}
+
+static int64_t decompress_tell(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    return h->m_out_base + (int64_t) h->m_out_pos;
+}
+
+//
+// Restart decompressing from the beginning of the stream
+//
+static bool rewind_stream(reader_handle_t* h)
+{
+    if (lseek(h->m_fd, h->m_start, SEEK_SET) < 0)
+    {
+        set_error(h, errno, strerror(errno));
+        return false;
+    }
+
+    if (scap_decompressor_reset(h->m_decompressor, h->m_lasterr) != SCAP_SUCCESS)
+    {
+        h->m_errno = EIO;
+        return false;
+    }
+
+    h->m_in_pos = 0;
+    h->m_in_len = 0;
+    h->m_out_pos = 0;
+    h->m_out_len = 0;
+    h->m_out_base = 0;
+    h->m_consumed = 0;
+    h->m_eof = false;
+    return true;
+}
+
+//
+// Only SEEK_SET and SEEK_CUR are supported, since the uncompressed size
+// isn't known. Seeking backwards past the data decompressed last means
+// decompressing again from the start.
+//
+static int64_t decompress_seek(scap_reader_t *r, int64_t offset, int whence)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int64_t target;
+
+    switch (whence)
+    {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = h->m_out_base + (int64_t) h->m_out_pos + offset;
+            break;
+        default:
+            set_error(h, EINVAL, "seeking from the end of a compressed file is not supported");
+            return -1;
+    }
+
+    if (target < 0)
+    {
+        set_error(h, EINVAL, strerror(EINVAL));
+        return -1;
+    }
+
+    h->m_errno = 0;
+    if (target < h->m_out_base && !rewind_stream(h))
+    {
+        return -1;
+    }
+
+    while (target > h->m_out_base + (int64_t) h->m_out_len)
+    {
+        h->m_out_pos = h->m_out_len;
+        if (!fill(h))
+        {
+            if (h->m_errno == 0)
+            {
+                set_error(h, EINVAL, "seeking past the end of a compressed file");
+            }
+            return -1;
+        }
+    }
+
+    h->m_out_pos = (size_t) (target - h->m_out_base);
+    return target;
+}
+
+static const char* decompress_error(scap_reader_t *r, int *errnum)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    *errnum = h->m_errno;
+    return h->m_errno ? h->m_lasterr : "";
+}
+
+static int decompress_close(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int res = close(h->m_fd);
+    scap_decompressor_close(h->m_decompressor);
+    free(h->m_in);
+    free(h->m_out);
+    free(h);
+    free(r);
+    return res;
+}
+
+scap_reader_t *scap_reader_open_decompress(int fd, compression_mode compress, const uint8_t* head, uint32_t head_len, char* error)
+{
+    // A stream that can't be rewound, like a pipe, can still be read
+    // once from the start
+    off_t start = lseek(fd, 0, SEEK_CUR);
+    start = start < (off_t) head_len ? 0 : start - (off_t) head_len;
+
+    ASSERT(head_len <= DECOMPRESS_IN_SIZE);
+    scap_decompressor* d = scap_decompressor_open(compress, error);
+    if (d == NULL)
+    {
+        return NULL;
+    }
+
+    reader_handle_t* h = (reader_handle_t *) calloc (1, sizeof (reader_handle_t));
+    scap_reader_t* r = (scap_reader_t *) malloc (sizeof (scap_reader_t));
+    uint8_t* in = (uint8_t *) malloc (DECOMPRESS_IN_SIZE);
+    uint8_t* out = (uint8_t *) malloc (DECOMPRESS_OUT_SIZE);
+    if (h == NULL || r == NULL || in == NULL || out == NULL)
+    {
+        snprintf(error, SCAP_LASTERR_SIZE, "error allocating the %s reader", scap_compression_name(compress));
+        scap_decompressor_close(d);
+        free(h);
+        free(r);
+        free(in);
+        free(out);
+        return NULL;
+    }
+
+    h->m_fd = fd;
+    h->m_start = start;
+    h->m_compress = compress;
+    h->m_decompressor = d;
+    h->m_in = in;
+    h->m_out = out;
+    memcpy(h->m_in, head, head_len);
+    h->m_in_len = head_len;
+
+    r->handle = h;
+    r->read = &decompress_read;
+    r->read_ptr = NULL;
+    r->offset = &decompress_offset;
+    r->tell = &decompress_tell;
+    r->seek = &decompress_seek;
+    r->error = &decompress_error;
+    r->close = &decompress_close;
+    return r;
+}
@@ -0,0 +1,129 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "scap_reader.h"
+#include <string.h>
+#include <errno.h>
+
+typedef struct reader_handle
+{
+    uint8_t* m_data; ///< The data being read, not owned by the reader
+    int64_t m_size;
+    int64_t m_off; ///< The cursor position in the data
+    int m_errno; ///< The error number of the last failed operation
+} reader_handle_t;
+
+static int memory_read(scap_reader_t *r, void* buf, uint32_t len)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int64_t avail = h->m_size - h->m_off;
+    uint32_t size = (int64_t) len < avail ? len : (uint32_t) avail;
+    memcpy(buf, h->m_data + h->m_off, size);
+    h->m_off += size;
+    return (int) size;
+}
+
+static void* memory_read_ptr(scap_reader_t *r, uint32_t len)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if ((int64_t) len > h->m_size - h->m_off)
+    {
+        return NULL;
+    }
+    void* res = h->m_data + h->m_off;
+    h->m_off += len;
+    return res;
+}
+
+static int64_t memory_tell(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    return ((reader_handle_t*)r->handle)->m_off;
+}
+
+static int64_t memory_seek(scap_reader_t *r, int64_t offset, int whence)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int64_t off;
+    switch (whence)
+    {
+        case SEEK_SET:
+            off = offset;
+            break;
+        case SEEK_CUR:
+            off = h->m_off + offset;
+            break;
+        case SEEK_END:
+            off = h->m_size + offset;
+            break;
+        default:
+            h->m_errno = EINVAL;
+            return -1;
+    }
+    if (off < 0 || off > h->m_size)
+    {
+        h->m_errno = EINVAL;
+        return -1;
+    }
+    h->m_off = off;
+    return off;
+}
+
+static const char* memory_error(scap_reader_t *r, int *errnum)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    *errnum = h->m_errno;
+    return h->m_errno ? strerror(h->m_errno) : "";
+}
+
+static int memory_close(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    free(r->handle);
+    free(r);
+    return 0;
+}
+
+scap_reader_t *scap_reader_open_memory(void* buf, uint64_t len)
+{
+    reader_handle_t* h = (reader_handle_t *) calloc (1, sizeof (reader_handle_t));
+    scap_reader_t* r = (scap_reader_t *) malloc (sizeof (scap_reader_t));
+    if (h == NULL || r == NULL)
+    {
+        free(h);
+        free(r);
+        return NULL;
+    }
+
+    h->m_data = (uint8_t*) buf;
+    h->m_size = (int64_t) len;
+    h->m_off = 0;
+
+    r->handle = h;
+    r->read = &memory_read;
+    r->read_ptr = &memory_read_ptr;
+    r->offset = &memory_tell;
+    r->tell = &memory_tell;
+    r->seek = &memory_seek;
+    r->error = &memory_error;
+    r->close = &memory_close;
+    return r;
+}
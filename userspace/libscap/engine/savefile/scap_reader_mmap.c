@@ -0,0 +1,435 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "scap_reader.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//
+// The file is checked not to be truncated once per this many bytes read,
+// since touching a page past its end would raise SIGBUS
+//
+#define MMAP_CHECK_SIZE (1024 * 1024)
+#define MMAP_TAIL_BUF_SIZE (64 * 1024)
+
+typedef struct fd_handle
+{
+    int m_fd; ///< Not owned, closed by the mmap reader
+    int m_errno; ///< The error number of the last failed operation
+} fd_handle_t;
+
+typedef struct reader_handle
+{
+    int m_fd; ///< The mapped file
+    uint8_t* m_data; ///< The whole file, mapped in memory
+    int64_t m_size; ///< The size of the mapping
+    int64_t m_off; ///< The cursor position in the mapping
+    int64_t m_checked; ///< The file is known to be at least this large
+    scap_reader_t* m_tail; ///< Reads the whole file once it grew past the mapping
+    uint8_t* m_straddle; ///< The data that straddled the end of the mapping
+    int m_errno; ///< The error number of the last failed operation
+} reader_handle_t;
+
+//
+// A plain reader over the file descriptor, used through a buffered
+// reader when the file grows after it has been mapped
+//
+static int fd_read(scap_reader_t *r, void* buf, uint32_t len)
+{
+    ASSERT(r != NULL);
+    fd_handle_t* h = (fd_handle_t*) r->handle;
+    uint8_t* dst = (uint8_t*) buf;
+    uint32_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = read(h->m_fd, dst + done, len - done);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            h->m_errno = errno;
+            return done == 0 ? -1 : (int) done;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        done += (uint32_t) n;
+    }
+    return (int) done;
+}
+
+static int64_t fd_tell(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    fd_handle_t* h = (fd_handle_t*) r->handle;
+    off_t res = lseek(h->m_fd, 0, SEEK_CUR);
+    if (res < 0)
+    {
+        h->m_errno = errno;
+    }
+    return (int64_t) res;
+}
+
+static int64_t fd_seek(scap_reader_t *r, int64_t offset, int whence)
+{
+    ASSERT(r != NULL);
+    fd_handle_t* h = (fd_handle_t*) r->handle;
+    off_t res = lseek(h->m_fd, (off_t) offset, whence);
+    h->m_errno = res < 0 ? errno : 0;
+    return (int64_t) res;
+}
+
+static const char* fd_error(scap_reader_t *r, int *errnum)
+{
+    ASSERT(r != NULL);
+    fd_handle_t* h = (fd_handle_t*) r->handle;
+    *errnum = h->m_errno;
+    return h->m_errno ? strerror(h->m_errno) : "";
+}
+
+static int fd_close(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    free(r->handle);
+    free(r);
+    return 0;
+}
+
+static scap_reader_t* fd_open(int fd)
+{
+    fd_handle_t* h = (fd_handle_t *) calloc (1, sizeof (fd_handle_t));
+    scap_reader_t* r = (scap_reader_t *) malloc (sizeof (scap_reader_t));
+    if (h == NULL || r == NULL)
+    {
+        free(h);
+        free(r);
+        return NULL;
+    }
+
+    h->m_fd = fd;
+
+    r->handle = h;
+    r->read = &fd_read;
+    r->read_ptr = NULL;
+    r->offset = &fd_tell;
+    r->tell = &fd_tell;
+    r->seek = &fd_seek;
+    r->error = &fd_error;
+    r->close = &fd_close;
+    return r;
+}
+
+//
+// Makes sure that the file still backs the mapping up to end, so that
+// reading it can't raise SIGBUS, and tells if it grew past the mapping.
+// This only narrows the window for a concurrent truncation, which
+// nothing can close with a mapped file.
+//
+static bool mmap_check(reader_handle_t* h, int64_t end, bool* grown)
+{
+    struct stat st;
+    if (fstat(h->m_fd, &st) != 0)
+    {
+        h->m_errno = errno;
+        return false;
+    }
+
+    if ((int64_t) st.st_size < h->m_size)
+    {
+        // truncated under us: the mapping can't be read anymore
+        h->m_errno = EIO;
+        return false;
+    }
+
+    h->m_checked = end + MMAP_CHECK_SIZE < h->m_size ? end + MMAP_CHECK_SIZE : h->m_size;
+    *grown = (int64_t) st.st_size > h->m_size;
+    return true;
+}
+
+//
+// Once the file grew past the mapping, everything is read through a
+// buffered reader over the file descriptor, and the events can't be
+// returned in place anymore. The data of the mapping stays valid.
+//
+static bool mmap_start_tail(scap_reader_t *r)
+{
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    scap_reader_t* fdr = fd_open(h->m_fd);
+    if (fdr == NULL)
+    {
+        h->m_errno = ENOMEM;
+        return false;
+    }
+
+    scap_reader_t* tail = scap_reader_open_buffered(fdr, MMAP_TAIL_BUF_SIZE, true);
+    if (tail == NULL)
+    {
+        fdr->close(fdr);
+        h->m_errno = ENOMEM;
+        return false;
+    }
+
+    if (tail->seek(tail, h->m_off, SEEK_SET) != h->m_off)
+    {
+        tail->error(tail, &h->m_errno);
+        tail->close(tail);
+        return false;
+    }
+
+    h->m_tail = tail;
+    r->read_ptr = NULL;
+    return true;
+}
+
+static int mmap_read(scap_reader_t *r, void* buf, uint32_t len)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if (h->m_tail != NULL)
+    {
+        return h->m_tail->read(h->m_tail, buf, len);
+    }
+
+    int64_t end = h->m_off + (int64_t) len;
+    bool grown = false;
+    if (end > h->m_checked && !mmap_check(h, end, &grown))
+    {
+        return -1;
+    }
+
+    int64_t avail = h->m_size - h->m_off;
+    uint32_t size = (int64_t) len < avail ? len : (uint32_t) avail;
+    memcpy(buf, h->m_data + h->m_off, size);
+    h->m_off += size;
+    if (size == len || !grown || !mmap_start_tail(r))
+    {
+        return (int) size;
+    }
+
+    int res = h->m_tail->read(h->m_tail, (uint8_t*) buf + size, len - size);
+    return res < 0 ? (int) size : (int) size + res;
+}
+
+static void* mmap_read_ptr(scap_reader_t *r, uint32_t len)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    int64_t end = h->m_off + (int64_t) len;
+    bool grown = false;
+    if (end > h->m_checked && !mmap_check(h, end, &grown))
+    {
+        return NULL;
+    }
+
+    if (end <= h->m_size)
+    {
+        void* res = h->m_data + h->m_off;
+        h->m_off = end;
+        return res;
+    }
+
+    if (!grown)
+    {
+        return NULL;
+    }
+
+    //
+    // The data straddles the end of the mapping. This can only happen
+    // once, since read_ptr is unset from now on, and the copy is kept
+    // until the reader is closed like the mapping is.
+    //
+    ASSERT(h->m_straddle == NULL);
+    h->m_straddle = (uint8_t*) malloc(len);
+    if (h->m_straddle == NULL)
+    {
+        h->m_errno = ENOMEM;
+        return NULL;
+    }
+
+    int64_t avail = h->m_size - h->m_off;
+    memcpy(h->m_straddle, h->m_data + h->m_off, (size_t) avail);
+    h->m_off = h->m_size;
+    if (!mmap_start_tail(r) ||
+        h->m_tail->read(h->m_tail, h->m_straddle + avail, len - (uint32_t) avail) != (int) (len - (uint32_t) avail))
+    {
+        return NULL;
+    }
+    return h->m_straddle;
+}
+
+static int64_t mmap_offset(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if (h->m_tail != NULL)
+    {
+        return h->m_tail->offset(h->m_tail);
+    }
+    return h->m_off;
+}
+
+static int64_t mmap_tell(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if (h->m_tail != NULL)
+    {
+        return h->m_tail->tell(h->m_tail);
+    }
+    return h->m_off;
+}
+
+static int64_t mmap_seek(scap_reader_t *r, int64_t offset, int whence)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if (h->m_tail != NULL)
+    {
+        return h->m_tail->seek(h->m_tail, offset, whence);
+    }
+
+    int64_t off;
+    switch (whence)
+    {
+        case SEEK_SET:
+            off = offset;
+            break;
+        case SEEK_CUR:
+            off = h->m_off + offset;
+            break;
+        case SEEK_END:
+            off = h->m_size + offset;
+            break;
+        default:
+            h->m_errno = EINVAL;
+            return -1;
+    }
+    if (off < 0)
+    {
+        h->m_errno = EINVAL;
+        return -1;
+    }
+    if (off > h->m_size)
+    {
+        bool grown = false;
+        if (!mmap_check(h, off, &grown) || !grown || !mmap_start_tail(r))
+        {
+            h->m_errno = h->m_errno ? h->m_errno : EINVAL;
+            return -1;
+        }
+        return h->m_tail->seek(h->m_tail, off, SEEK_SET);
+    }
+    // a failed seek, like the one probing for a chunk index, doesn't
+    // make the reads that follow fail
+    h->m_errno = 0;
+    h->m_off = off;
+    return off;
+}
+
+static const char* mmap_error(scap_reader_t *r, int *errnum)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if (h->m_tail != NULL && h->m_errno == 0)
+    {
+        return h->m_tail->error(h->m_tail, errnum);
+    }
+    *errnum = h->m_errno;
+    return h->m_errno ? strerror(h->m_errno) : "";
+}
+
+static int mmap_close(scap_reader_t *r)
+{
+    ASSERT(r != NULL);
+    reader_handle_t* h = (reader_handle_t*) r->handle;
+    if (h->m_tail != NULL)
+    {
+        h->m_tail->close(h->m_tail);
+    }
+    free(h->m_straddle);
+    munmap(h->m_data, (size_t) h->m_size);
+    int res = close(h->m_fd);
+    free(h);
+    free(r);
+    return res;
+}
+
+scap_reader_t *scap_reader_open_mmap(int fd)
+{
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+    {
+        return NULL;
+    }
+
+    // The capture starts at the current position of the file, like
+    // it would for a gzFile opened on it
+    off_t start = lseek(fd, 0, SEEK_CUR);
+    if (start < 0 || start >= st.st_size || (uint64_t) st.st_size > SIZE_MAX)
+    {
+        return NULL;
+    }
+
+    // A read-only mapping, which doesn't count against the commit
+    // limit. The events are handed out in place, and the consumers
+    // that patch them must copy them first.
+    uint8_t* data = (uint8_t*) mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    // The file is read once from start to end: have the kernel read
+    // ahead aggressively and drop the pages behind us
+    madvise(data, (size_t) st.st_size, MADV_SEQUENTIAL);
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    reader_handle_t* h = (reader_handle_t *) calloc (1, sizeof (reader_handle_t));
+    scap_reader_t* r = (scap_reader_t *) malloc (sizeof (scap_reader_t));
+    if (h == NULL || r == NULL)
+    {
+        free(h);
+        free(r);
+        munmap(data, (size_t) st.st_size);
+        return NULL;
+    }
+
+    h->m_fd = fd;
+    h->m_data = data;
+    h->m_size = (int64_t) st.st_size;
+    h->m_off = (int64_t) start;
+    h->m_checked = h->m_off;
+
+    r->handle = h;
+    r->read = &mmap_read;
+    r->read_ptr = &mmap_read_ptr;
+    r->offset = &mmap_offset;
+    r->tell = &mmap_tell;
+    r->seek = &mmap_seek;
+    r->error = &mmap_error;
+    r->close = &mmap_close;
+    return r;
+}
@@ -21,6 +21,9 @@ limitations under the License.
 
 #ifndef _WIN32
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
 #include <sys/uio.h>
 #else
 struct iovec {
@@ -34,6 +37,7 @@ struct iovec {
 #include "scap-int.h"
 #include "scap_savefile.h"
 #include "scap_reader.h"
+#include "scap_compress.h"
 #include "../noop/noop.h"
 
 //
@@ -1734,6 +1738,7 @@ static int32_t scap_read_init(struct savefile_engine *handle, scap_reader_t* r,
 		case EVF_BLOCK_TYPE_V2:
 		case EV_BLOCK_TYPE_V2_LARGE:
 		case EVF_BLOCK_TYPE_V2_LARGE:
+		case EVC_BLOCK_TYPE:
 			//
 			// We're done with the metadata headers.
 			//
@@ -1804,15 +1809,24 @@ static int32_t scap_read_init(struct savefile_engine *handle, scap_reader_t* r,
 }
 
 //
-// Read an event from disk
+// Read an event from disk into buf. If buf is too small for the event,
+// the block header is pushed back, the needed size is returned in
+// *pneeded and SCAP_INPUT_TOO_SMALL is returned.
+// On success, *pneeded is the number of bytes of buf used by the event.
+// If may_load_chunk is false, SCAP_INPUT_TOO_SMALL is also returned, with
+// *pneeded set to 0, at the end of an event chunk, since the events
+// returned so far point into it.
 //
-static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_t *pcpuid)
+static int32_t read_event(struct savefile_engine* handle, char* buf, size_t buf_size, scap_evt **pevent, uint16_t *pcpuid, uint32_t *pdump_flags, size_t *pneeded, bool may_load_chunk)
 {
-	struct savefile_engine* handle = engine.m_handle;
 	block_header bh;
 	size_t readsize;
 	uint32_t readlen;
 	size_t hdr_len;
+	size_t needed;
+	bool convert_v1;
+	char* evbuf;
+	int32_t res;
 	scap_reader_t* r = handle->m_reader;
 
 	ASSERT(r != NULL);
@@ -1823,6 +1837,19 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 	//
 	while(true)
 	{
+		//
+		// Events in chunks are read from the decompressed chunk
+		//
+		if(handle->m_chunks != NULL)
+		{
+			res = savefile_chunks_get_reader(handle, may_load_chunk, &r);
+			if(res != SCAP_SUCCESS)
+			{
+				*pneeded = 0;
+				return res;
+			}
+		}
+
 		//
 		// Read the block header
 		//
@@ -1855,6 +1882,20 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 			}
 		}
 
+		if(r == handle->m_reader && (bh.block_type == EVC_BLOCK_TYPE || bh.block_type == EVCI_BLOCK_TYPE))
+		{
+			//
+			// The events continue in chunks, have them read
+			// starting from this block
+			//
+			if(handle->m_chunks == NULL && (res = savefile_chunks_init(handle)) != SCAP_SUCCESS)
+			{
+				return res;
+			}
+			handle->m_use_last_block_header = true;
+			continue;
+		}
+
 		if(bh.block_type != EV_BLOCK_TYPE &&
 		   bh.block_type != EV_BLOCK_TYPE_V2 &&
 		   bh.block_type != EV_BLOCK_TYPE_V2_LARGE &&
@@ -1895,36 +1936,64 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 					 READER_BUF_SIZE);
 				return SCAP_FAILURE;
 			}
-		} else if (readlen > handle->m_reader_evt_buf_size) {
-			// Try to allocate a buffer large enough
-			char *tmp = realloc(handle->m_reader_evt_buf, readlen);
-			if (!tmp) {
-				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "event block length %u greater than read buffer size %zu",
-					 readlen,
-					 handle->m_reader_evt_buf_size);
+		}
+
+		convert_v1 = (bh.block_type != EV_BLOCK_TYPE_V2 &&
+			      bh.block_type != EV_BLOCK_TYPE_V2_LARGE &&
+			      bh.block_type != EVF_BLOCK_TYPE_V2 &&
+			      bh.block_type != EVF_BLOCK_TYPE_V2_LARGE);
+
+		if(r->read_ptr != NULL && !convert_v1)
+		{
+			//
+			// The reader can give us the event in place, no need
+			// to copy it
+			//
+			evbuf = (char*)r->read_ptr(r, readlen);
+			if(evbuf == NULL)
+			{
+				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error reading from file: truncated event block (%u bytes)", readlen);
 				return SCAP_FAILURE;
 			}
-			handle->m_reader_evt_buf = tmp;
-			handle->m_reader_evt_buf_size = readlen;
+			needed = 0;
 		}
+		else
+		{
+			//
+			// Old captures are converted in place, which needs 4 more bytes
+			//
+			needed = readlen;
+			if(convert_v1)
+			{
+				needed += sizeof(uint32_t);
+			}
 
-		readsize = r->read(r, handle->m_reader_evt_buf, readlen);
-		CHECK_READ_SIZE(readsize, readlen);
+			if(needed > buf_size)
+			{
+				handle->m_use_last_block_header = true;
+				*pneeded = needed;
+				return SCAP_INPUT_TOO_SMALL;
+			}
+
+			readsize = r->read(r, buf, readlen);
+			CHECK_READ_SIZE(readsize, readlen);
+			evbuf = buf;
+		}
 
 		//
 		// EVF_BLOCK_TYPE has 32 bits of flags
 		//
-		*pcpuid = *(uint16_t *)handle->m_reader_evt_buf;
+		*pcpuid = *(uint16_t *)evbuf;
 
 		if(bh.block_type == EVF_BLOCK_TYPE || bh.block_type == EVF_BLOCK_TYPE_V2 || bh.block_type == EVF_BLOCK_TYPE_V2_LARGE)
 		{
-			handle->m_last_evt_dump_flags = *(uint32_t*)(handle->m_reader_evt_buf + sizeof(uint16_t));
-			*pevent = (struct ppm_evt_hdr *)(handle->m_reader_evt_buf + sizeof(uint16_t) + sizeof(uint32_t));
+			*pdump_flags = *(uint32_t*)(evbuf + sizeof(uint16_t));
+			*pevent = (struct ppm_evt_hdr *)(evbuf + sizeof(uint16_t) + sizeof(uint32_t));
 		}
 		else
 		{
-			handle->m_last_evt_dump_flags = 0;
-			*pevent = (struct ppm_evt_hdr *)(handle->m_reader_evt_buf + sizeof(uint16_t));
+			*pdump_flags = 0;
+			*pevent = (struct ppm_evt_hdr *)(evbuf + sizeof(uint16_t));
 		}
 
 		if((*pevent)->type >= PPM_EVENT_MAX)
@@ -1936,10 +2005,22 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 			continue;
 		}
 
-		if(bh.block_type != EV_BLOCK_TYPE_V2 &&
-		   bh.block_type != EV_BLOCK_TYPE_V2_LARGE &&
-		   bh.block_type != EVF_BLOCK_TYPE_V2 &&
-		   bh.block_type != EVF_BLOCK_TYPE_V2_LARGE)
+		if(handle->m_evtmask_enabled &&
+		   !(handle->m_evtmask[(*pevent)->type / 8] & (1 << ((*pevent)->type % 8))))
+		{
+			continue;
+		}
+
+		if(handle->m_seek_ts != 0)
+		{
+			if((*pevent)->ts < handle->m_seek_ts)
+			{
+				continue;
+			}
+			handle->m_seek_ts = 0;
+		}
+
+		if(convert_v1)
 		{
 			//
 			// We're reading an old capture whose events don't have nparams in the header.
@@ -1955,7 +2036,7 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 
 			memmove((char *)*pevent + sizeof(struct ppm_evt_hdr),
 				(char *)*pevent + sizeof(struct ppm_evt_hdr) - sizeof(uint32_t),
-				readlen - ((char *)*pevent - handle->m_reader_evt_buf) - (sizeof(struct ppm_evt_hdr) - sizeof(uint32_t)));
+				readlen - ((char *)*pevent - buf) - (sizeof(struct ppm_evt_hdr) - sizeof(uint32_t)));
 			(*pevent)->len += sizeof(uint32_t);
 
 			// In old captures, the length of PPME_NOTIFICATION_E and PPME_INFRASTRUCTURE_EVENT_E
@@ -2009,9 +2090,100 @@ static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_
 		break;
 	}
 
+	*pneeded = needed;
 	return SCAP_SUCCESS;
 }
 
+static int32_t next(struct scap_engine_handle engine, scap_evt **pevent, uint16_t *pcpuid)
+{
+	struct savefile_engine* handle = engine.m_handle;
+	size_t needed;
+	int32_t res;
+
+	ASSERT(handle->m_reader != NULL);
+
+	res = read_event(handle, handle->m_reader_evt_buf, handle->m_reader_evt_buf_size, pevent, pcpuid, &handle->m_last_evt_dump_flags, &needed, true);
+	if(res == SCAP_INPUT_TOO_SMALL)
+	{
+		// Try to allocate a buffer large enough
+		char *tmp = realloc(handle->m_reader_evt_buf, needed);
+		if (!tmp) {
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "event block length %zu greater than read buffer size %zu",
+				 needed,
+				 handle->m_reader_evt_buf_size);
+			return SCAP_FAILURE;
+		}
+		handle->m_reader_evt_buf = tmp;
+		handle->m_reader_evt_buf_size = needed;
+
+		res = read_event(handle, handle->m_reader_evt_buf, handle->m_reader_evt_buf_size, pevent, pcpuid, &handle->m_last_evt_dump_flags, &needed, true);
+	}
+
+	return res;
+}
+
+//
+// Read several events from disk into the batch buffer, so that they all
+// stay valid until the next call
+//
+static int32_t next_batch(struct scap_engine_handle engine, scap_batch_entry *entries, uint32_t max_events, uint32_t *nevents)
+{
+	struct savefile_engine* handle = engine.m_handle;
+	size_t offset = 0;
+	size_t needed;
+	uint32_t n = 0;
+	int32_t res = SCAP_SUCCESS;
+
+	ASSERT(handle->m_reader != NULL);
+
+	if(handle->m_batch_buf == NULL)
+	{
+		handle->m_batch_buf = (char*)malloc(SAVEFILE_BATCH_BUF_SIZE);
+		if(handle->m_batch_buf == NULL)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error allocating the batch buffer");
+			return SCAP_FAILURE;
+		}
+	}
+
+	while(n < max_events)
+	{
+		res = read_event(handle, handle->m_batch_buf + offset, SAVEFILE_BATCH_BUF_SIZE - offset,
+				 &entries[n].evt, &entries[n].cpuid, &entries[n].dump_flags, &needed, n == 0);
+		if(res != SCAP_SUCCESS)
+		{
+			break;
+		}
+		offset += needed;
+		n++;
+	}
+
+	if(res == SCAP_INPUT_TOO_SMALL)
+	{
+		if(n > 0)
+		{
+			// the event is left for the next batch
+			res = SCAP_SUCCESS;
+		}
+		else
+		{
+			// a single event larger than the whole batch buffer
+			res = next(engine, &entries[0].evt, &entries[0].cpuid);
+			entries[0].dump_flags = handle->m_last_evt_dump_flags;
+			n = (res == SCAP_SUCCESS) ? 1 : 0;
+		}
+	}
+
+	if(n > 0)
+	{
+		handle->m_last_evt_dump_flags = entries[n - 1].dump_flags;
+	}
+
+	*nevents = n;
+	return res;
+}
+
+
 uint64_t scap_savefile_ftell(struct scap_engine_handle engine)
 {
 	scap_reader_t* reader = engine.m_handle->m_reader;
@@ -2021,9 +2193,59 @@ uint64_t scap_savefile_ftell(struct scap_engine_handle engine)
 void scap_savefile_fseek(struct scap_engine_handle engine, uint64_t off)
 {
 	scap_reader_t* reader = engine.m_handle->m_reader;
+	savefile_chunks_reset(engine.m_handle);
+	engine.m_handle->m_seek_ts = 0;
 	reader->seek(reader, off, SEEK_SET);
 }
 
+static int32_t scap_savefile_seek_ts(struct scap_engine_handle engine, uint64_t ts)
+{
+	return savefile_chunks_seek_ts(engine.m_handle, ts);
+}
+
+static int32_t configure(struct scap_engine_handle engine, enum scap_setting setting, unsigned long arg1, unsigned long arg2)
+{
+	struct savefile_engine* handle = engine.m_handle;
+
+	if(setting != SCAP_EVENTMASK || !handle->m_evtmask_supported)
+	{
+		return noop_configure(engine, setting, arg1, arg2);
+	}
+
+	switch(arg1)
+	{
+	case SCAP_EVENTMASK_ZERO:
+		memset(handle->m_evtmask, 0, sizeof(handle->m_evtmask));
+		handle->m_evtmask_enabled = true;
+		return SCAP_SUCCESS;
+	case SCAP_EVENTMASK_SET:
+	case SCAP_EVENTMASK_UNSET:
+		if(arg2 >= PPM_EVENT_MAX)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "invalid event type %lu", arg2);
+			return SCAP_FAILURE;
+		}
+		if(!handle->m_evtmask_enabled)
+		{
+			// all the events were enabled so far
+			memset(handle->m_evtmask, 0xff, sizeof(handle->m_evtmask));
+			handle->m_evtmask_enabled = true;
+		}
+		if(arg1 == SCAP_EVENTMASK_SET)
+		{
+			handle->m_evtmask[arg2 / 8] |= 1 << (arg2 % 8);
+		}
+		else
+		{
+			handle->m_evtmask[arg2 / 8] &= ~(1 << (arg2 % 8));
+		}
+		return SCAP_SUCCESS;
+	default:
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "invalid eventmask operation %lu", arg1);
+		return SCAP_FAILURE;
+	}
+}
+
 static bool match(struct scap_open_args* args)
 {
 	return args->mode == SCAP_MODE_CAPTURE;
@@ -2040,50 +2262,148 @@ static struct savefile_engine* alloc_handle(struct scap* main_handle, char* last
 
 }
 
-static int32_t init(struct scap* main_handle, struct scap_open_args* args)
+#ifndef _WIN32
+//
+// Uncompressed captures stored in regular files are mapped in memory,
+// so that the events can be returned without copying them. The lz4 and
+// zstd captures are recognized by their magic number and decompressed
+// while being read. Everything else, gzip included, is left to the
+// gzFile reader, and *reader is left NULL.
+//
+// The magic number is read, not peeked at, since pipes can't do that.
+// A file that can't be rewound after that is read through the
+// decompressing reader whatever its compression, gzip or none included,
+// starting from the bytes already read.
+//
+static int32_t open_fd_reader(struct scap_open_args* args, scap_reader_t** reader, char* error)
 {
-	gzFile gzfile;
-	int res;
-	struct savefile_engine *handle = main_handle->m_engine.m_handle;
+	uint8_t magic[4];
+	uint32_t magic_len = 0;
+	ssize_t n;
+	off_t pos;
+	int fd = args->fd;
+	compression_mode compress;
+
+	*reader = NULL;
 
-	if(args->fd != 0)
+	if(fd == 0)
 	{
-		gzfile = gzdopen(args->fd, "rb");
+		fd = open(args->fname, O_RDONLY);
+		if(fd < 0)
+		{
+			return SCAP_SUCCESS;
+		}
 	}
-	else
+
+	pos = lseek(fd, 0, SEEK_CUR);
+	while(magic_len < sizeof(magic))
 	{
-		gzfile = gzopen(args->fname, "rb");
+		n = read(fd, magic + magic_len, sizeof(magic) - magic_len);
+		if(n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(n <= 0)
+		{
+			break;
+		}
+		magic_len += (uint32_t)n;
 	}
 
-	if(gzfile == NULL)
+	compress = scap_compression_from_magic(magic, magic_len);
+	if(pos < 0 || compress == SCAP_COMPRESSION_LZ4 || compress == SCAP_COMPRESSION_ZSTD)
 	{
-		if(args->fd != 0)
+		*reader = scap_reader_open_decompress(fd, compress, magic, magic_len, error);
+		if(*reader == NULL)
 		{
-			snprintf(main_handle->m_lasterr, SCAP_LASTERR_SIZE, "can't open fd %d", args->fd);
+			if(args->fd == 0)
+			{
+				close(fd);
+			}
+			return SCAP_FAILURE;
 		}
-		else
+		return SCAP_SUCCESS;
+	}
+
+	if(lseek(fd, pos, SEEK_SET) != pos)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "can't rewind fd %d: %s", fd, strerror(errno));
+		if(args->fd == 0)
 		{
-			snprintf(main_handle->m_lasterr, SCAP_LASTERR_SIZE, "can't open file %s", args->fname);
+			close(fd);
 		}
 		return SCAP_FAILURE;
 	}
 
-	scap_reader_t* reader = scap_reader_open_gzfile(gzfile);
-	if(!reader)
+	if(compress == SCAP_COMPRESSION_NONE)
+	{
+		*reader = scap_reader_open_mmap(fd);
+	}
+
+	if(*reader == NULL && args->fd == 0)
+	{
+		close(fd);
+	}
+
+	return SCAP_SUCCESS;
+}
+#endif
+
+static int32_t init(struct scap* main_handle, struct scap_open_args* args)
+{
+	gzFile gzfile;
+	int res;
+	struct savefile_engine *handle = main_handle->m_engine.m_handle;
+	scap_reader_t* reader = NULL;
+
+#ifndef _WIN32
+	if(open_fd_reader(args, &reader, main_handle->m_lasterr) != SCAP_SUCCESS)
 	{
-		gzclose(gzfile);
 		return SCAP_FAILURE;
 	}
+#endif
 
-	if (args->fbuffer_size > 0)
+	if(reader == NULL)
 	{
-		scap_reader_t* buffered_reader = scap_reader_open_buffered(reader, args->fbuffer_size, true);
-		if(!buffered_reader)
+		if(args->fd != 0)
+		{
+			gzfile = gzdopen(args->fd, "rb");
+		}
+		else
+		{
+			gzfile = gzopen(args->fname, "rb");
+		}
+
+		if(gzfile == NULL)
+		{
+			if(args->fd != 0)
+			{
+				snprintf(main_handle->m_lasterr, SCAP_LASTERR_SIZE, "can't open fd %d", args->fd);
+			}
+			else
+			{
+				snprintf(main_handle->m_lasterr, SCAP_LASTERR_SIZE, "can't open file %s", args->fname);
+			}
+			return SCAP_FAILURE;
+		}
+
+		reader = scap_reader_open_gzfile(gzfile);
+		if(!reader)
 		{
-			reader->close(reader);
+			gzclose(gzfile);
 			return SCAP_FAILURE;
 		}
-		reader = buffered_reader;
+
+		if (args->fbuffer_size > 0)
+		{
+			scap_reader_t* buffered_reader = scap_reader_open_buffered(reader, args->fbuffer_size, true);
+			if(!buffered_reader)
+			{
+				reader->close(reader);
+				return SCAP_FAILURE;
+			}
+			reader = buffered_reader;
+		}
 	}
 
 	//
@@ -2121,6 +2441,21 @@ static int32_t init(struct scap* main_handle, struct scap_open_args* args)
 	handle->m_reader_evt_buf_size = READER_BUF_SIZE;
 	handle->m_reader = reader;
 
+	//
+	// Captures written in chunks are set up right away, to find their
+	// index before the first event is read
+	//
+	handle->m_chunk_threads = args->chunk_threads;
+	handle->m_evtmask_supported = args->savefile_eventmask;
+	if(handle->m_use_last_block_header && handle->m_last_block_header.block_type == EVC_BLOCK_TYPE)
+	{
+		res = savefile_chunks_init(handle);
+		if(res != SCAP_SUCCESS)
+		{
+			return res;
+		}
+	}
+
 	if(!args->import_users)
 	{
 		if(main_handle->m_userlist != NULL)
@@ -2141,6 +2476,10 @@ static void free_handle(struct scap_engine_handle engine)
 static int32_t scap_savefile_close(struct scap_engine_handle engine)
 {
 	struct savefile_engine* handle = engine.m_handle;
+
+	// stop the chunk workers before unmapping the file under them
+	savefile_chunks_close(handle);
+
 	if (handle->m_reader)
 	{
 		handle->m_reader->close(handle->m_reader);
@@ -2153,6 +2492,12 @@ static int32_t scap_savefile_close(struct scap_engine_handle engine)
 		handle->m_reader_evt_buf = NULL;
 	}
 
+	if(handle->m_batch_buf)
+	{
+		free(handle->m_batch_buf);
+		handle->m_batch_buf = NULL;
+	}
+
 	return SCAP_SUCCESS;
 }
 
@@ -2161,6 +2506,9 @@ static int32_t scap_savefile_restart_capture(scap_t* handle)
 	struct savefile_engine *engine = handle->m_engine.m_handle;
 	int32_t res;
 
+	savefile_chunks_reset(engine);
+	engine->m_seek_ts = 0;
+
 	if((res = scap_read_init(
 		engine,
 		engine->m_reader,
@@ -2194,6 +2542,7 @@ static struct scap_savefile_vtable savefile_ops = {
 	.restart_capture = scap_savefile_restart_capture,
 	.get_readfile_offset = get_readfile_offset,
 	.get_event_dump_flags = get_event_dump_flags,
+	.seek_ts = scap_savefile_seek_ts,
 };
 
 struct scap_vtable scap_savefile_engine = {
@@ -2207,9 +2556,10 @@ struct scap_vtable scap_savefile_engine = {
 	.free_handle = free_handle,
 	.close = scap_savefile_close,
 	.next = next,
+	.next_batch = next_batch,
 	.start_capture = noop_start_capture,
 	.stop_capture = noop_stop_capture,
-	.configure = noop_configure,
+	.configure = configure,
 	.get_stats = noop_get_stats,
 	.get_n_tracepoint_hit = noop_get_n_tracepoint_hit,
 	.get_n_devs = noop_get_n_devs,
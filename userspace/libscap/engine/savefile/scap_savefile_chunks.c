@@ -0,0 +1,819 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//
+// Reading of the event chunks written by scap_dump_open_chunked.
+//
+// The chunks met in the file are queued in a ring and decompressed, either
+// by the thread reading the events or by a pool of threads working ahead of
+// it. The events of the chunk at the head of the ring are then read through
+// a memory reader, like they would from the file. If the file ends with a
+// chunk index, it is used to seek by timestamp and to skip the chunks that
+// don't contain any of the events in the event mask.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#include "savefile.h"
+#include "scap-int.h"
+#include "scap_compress.h"
+#include "../common/strlcpy.h"
+
+#define CHUNKS_MAX_THREADS 64
+
+typedef struct savefile_chunk
+{
+	event_chunk_header m_hdr;
+	uint8_t* m_payload; ///< Points to m_payload_buf, or to the file data if the reader supports read_ptr
+	uint8_t* m_payload_buf;
+	uint32_t m_payload_buf_size;
+	uint8_t* m_data; ///< The event blocks, either the payload itself or m_data_buf
+	uint8_t* m_data_buf;
+	uint32_t m_data_buf_size;
+	bool m_ready; ///< The chunk has been decompressed, successfully or not
+	int32_t m_res;
+	char m_lasterr[SCAP_LASTERR_SIZE];
+} savefile_chunk;
+
+struct savefile_chunks
+{
+	//
+	// The chunk index, if the file has one. index_distance is replaced
+	// by the position of the chunk in the file.
+	//
+	event_chunk_index_entry* m_index;
+	uint8_t* m_index_evtypes;
+	uint32_t m_index_evtypes_len;
+	uint32_t m_nchunks;
+	uint64_t m_index_pos;
+
+	//
+	// The chunks in [m_head, m_tail) have been read from the file, and the
+	// ones in [m_next_work, m_tail) are still to be decompressed. m_head
+	// is the one whose events are being read through m_reader, if any.
+	//
+	savefile_chunk* m_ring;
+	uint32_t m_ring_size;
+	uint64_t m_head;
+	uint64_t m_tail;
+	uint64_t m_next_work;
+	scap_reader_t* m_reader;
+
+	// A block header read from the file while reading chunks ahead
+	bool m_has_pending_bh;
+	block_header m_pending_bh;
+
+	uint32_t m_nthreads;
+#ifndef _WIN32
+	pthread_t* m_threads;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_work_cond;
+	pthread_cond_t m_done_cond;
+	bool m_stop;
+#endif
+};
+
+static inline void chunks_lock(struct savefile_chunks* c)
+{
+#ifndef _WIN32
+	if(c->m_nthreads > 0)
+	{
+		pthread_mutex_lock(&c->m_mutex);
+	}
+#endif
+}
+
+static inline void chunks_unlock(struct savefile_chunks* c)
+{
+#ifndef _WIN32
+	if(c->m_nthreads > 0)
+	{
+		pthread_mutex_unlock(&c->m_mutex);
+	}
+#endif
+}
+
+//
+// Decompress the payload of a chunk
+//
+static void decompress_chunk(savefile_chunk* chunk)
+{
+	chunk->m_res = SCAP_SUCCESS;
+
+	switch(chunk->m_hdr.compression)
+	{
+	case SCAP_COMPRESSION_NONE:
+		if(chunk->m_hdr.payload_len != chunk->m_hdr.raw_len)
+		{
+			snprintf(chunk->m_lasterr, SCAP_LASTERR_SIZE, "corrupted event chunk: payload length %u, raw length %u",
+				 chunk->m_hdr.payload_len, chunk->m_hdr.raw_len);
+			chunk->m_res = SCAP_FAILURE;
+			return;
+		}
+		chunk->m_data = chunk->m_payload;
+		return;
+	case SCAP_COMPRESSION_GZIP:
+	case SCAP_COMPRESSION_LZ4:
+	case SCAP_COMPRESSION_ZSTD:
+	{
+		if(chunk->m_hdr.raw_len > chunk->m_data_buf_size)
+		{
+			uint8_t* buf = (uint8_t*)realloc(chunk->m_data_buf, chunk->m_hdr.raw_len);
+			if(buf == NULL)
+			{
+				snprintf(chunk->m_lasterr, SCAP_LASTERR_SIZE, "error allocating %u bytes for an event chunk", chunk->m_hdr.raw_len);
+				chunk->m_res = SCAP_FAILURE;
+				return;
+			}
+			chunk->m_data_buf = buf;
+			chunk->m_data_buf_size = chunk->m_hdr.raw_len;
+		}
+
+		// fails with SCAP_NOT_SUPPORTED if the compression hasn't been built in
+		chunk->m_res = scap_decompress_buffer((compression_mode)chunk->m_hdr.compression, chunk->m_data_buf, chunk->m_hdr.raw_len,
+						      chunk->m_payload, chunk->m_hdr.payload_len, chunk->m_lasterr);
+		if(chunk->m_res != SCAP_SUCCESS)
+		{
+			return;
+		}
+		chunk->m_data = chunk->m_data_buf;
+		return;
+	}
+	default:
+		snprintf(chunk->m_lasterr, SCAP_LASTERR_SIZE, "unsupported event chunk compression %u", chunk->m_hdr.compression);
+		chunk->m_res = SCAP_NOT_SUPPORTED;
+		return;
+	}
+}
+
+#ifndef _WIN32
+static void* chunk_worker(void* arg)
+{
+	struct savefile_chunks* c = (struct savefile_chunks*)arg;
+
+	pthread_mutex_lock(&c->m_mutex);
+	while(!c->m_stop)
+	{
+		if(c->m_next_work == c->m_tail)
+		{
+			pthread_cond_wait(&c->m_work_cond, &c->m_mutex);
+			continue;
+		}
+
+		savefile_chunk* chunk = &c->m_ring[c->m_next_work % c->m_ring_size];
+		c->m_next_work++;
+		pthread_mutex_unlock(&c->m_mutex);
+
+		decompress_chunk(chunk);
+
+		pthread_mutex_lock(&c->m_mutex);
+		chunk->m_ready = true;
+		pthread_cond_broadcast(&c->m_done_cond);
+	}
+	pthread_mutex_unlock(&c->m_mutex);
+
+	return NULL;
+}
+#endif
+
+//
+// Wait until the workers are done with all the chunks that were queued
+//
+static void wait_workers(struct savefile_chunks* c)
+{
+#ifndef _WIN32
+	if(c->m_nthreads == 0)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&c->m_mutex);
+	// nobody will pick up the chunks not taken yet
+	c->m_tail = c->m_next_work;
+	uint64_t j;
+	for(j = c->m_head; j < c->m_tail; j++)
+	{
+		while(!c->m_ring[j % c->m_ring_size].m_ready)
+		{
+			pthread_cond_wait(&c->m_done_cond, &c->m_mutex);
+		}
+	}
+	pthread_mutex_unlock(&c->m_mutex);
+#endif
+}
+
+//
+// Find the index entry of the chunk starting at pos, if any
+//
+static event_chunk_index_entry* find_index_entry(struct savefile_chunks* c, uint64_t pos)
+{
+	uint32_t lo = 0;
+	uint32_t hi = c->m_nchunks;
+
+	while(lo < hi)
+	{
+		uint32_t mid = lo + (hi - lo) / 2;
+		if(c->m_index[mid].index_distance < pos)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	if(lo < c->m_nchunks && c->m_index[lo].index_distance == pos)
+	{
+		return &c->m_index[lo];
+	}
+	return NULL;
+}
+
+//
+// Return true if none of the events of the chunk can be returned
+//
+static bool skip_chunk(struct savefile_engine* handle, uint64_t pos, event_chunk_header* hdr)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+
+	if(hdr->nevents == 0 || (handle->m_seek_ts != 0 && hdr->last_ts < handle->m_seek_ts))
+	{
+		return true;
+	}
+
+	if(!handle->m_evtmask_enabled)
+	{
+		return false;
+	}
+
+	event_chunk_index_entry* entry = find_index_entry(c, pos);
+	if(entry == NULL)
+	{
+		return false;
+	}
+
+	const uint8_t* evtypes = c->m_index_evtypes + (size_t)(entry - c->m_index) * c->m_index_evtypes_len;
+	uint32_t len = c->m_index_evtypes_len < EVC_EVTYPES_LEN ? c->m_index_evtypes_len : EVC_EVTYPES_LEN;
+	uint32_t j;
+	for(j = 0; j < len; j++)
+	{
+		if(evtypes[j] & handle->m_evtmask[j])
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//
+// Read the chunk whose block header has just been read from the file and
+// queue it for decompression. The ring must not be full.
+//
+static int32_t queue_chunk(struct savefile_engine* handle, block_header* bh)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+	scap_reader_t* r = handle->m_reader;
+	event_chunk_header hdr;
+	uint64_t pos = (uint64_t)r->tell(r) - sizeof(block_header);
+	uint32_t body_len;
+	int readsize;
+
+	ASSERT(c->m_tail - c->m_head < c->m_ring_size);
+
+	if(bh->block_total_length < sizeof(block_header) + sizeof(event_chunk_header) + 4)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "event chunk block length too short %u", bh->block_total_length);
+		return SCAP_FAILURE;
+	}
+
+	readsize = r->read(r, &hdr, sizeof(hdr));
+	CHECK_READ_SIZE(readsize, sizeof(hdr));
+
+	// The payload, the padding and the trailer
+	body_len = bh->block_total_length - sizeof(block_header) - sizeof(event_chunk_header);
+	if(hdr.payload_len > body_len - 4)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "corrupted event chunk: payload length %u, block length %u",
+			 hdr.payload_len, bh->block_total_length);
+		return SCAP_FAILURE;
+	}
+
+	if(skip_chunk(handle, pos, &hdr))
+	{
+		if(r->seek(r, (int64_t)(pos + bh->block_total_length), SEEK_SET) < 0)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "corrupted input file. Can't skip event chunk of size %u.", bh->block_total_length);
+			return SCAP_FAILURE;
+		}
+		return SCAP_SUCCESS;
+	}
+
+	savefile_chunk* chunk = &c->m_ring[c->m_tail % c->m_ring_size];
+	if(r->read_ptr != NULL)
+	{
+		chunk->m_payload = (uint8_t*)r->read_ptr(r, body_len);
+		if(chunk->m_payload == NULL)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error reading from file: truncated event chunk (%u bytes)", body_len);
+			return SCAP_FAILURE;
+		}
+	}
+	else
+	{
+		if(body_len > chunk->m_payload_buf_size)
+		{
+			uint8_t* buf = (uint8_t*)realloc(chunk->m_payload_buf, body_len);
+			if(buf == NULL)
+			{
+				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error allocating %u bytes for an event chunk", body_len);
+				return SCAP_FAILURE;
+			}
+			chunk->m_payload_buf = buf;
+			chunk->m_payload_buf_size = body_len;
+		}
+
+		readsize = r->read(r, chunk->m_payload_buf, body_len);
+		CHECK_READ_SIZE(readsize, body_len);
+		chunk->m_payload = chunk->m_payload_buf;
+	}
+
+	chunk->m_hdr = hdr;
+	chunk->m_ready = false;
+
+	chunks_lock(c);
+	c->m_tail++;
+#ifndef _WIN32
+	if(c->m_nthreads > 0)
+	{
+		pthread_cond_signal(&c->m_work_cond);
+	}
+#endif
+	chunks_unlock(c);
+
+	return SCAP_SUCCESS;
+}
+
+//
+// Read from the file the chunks that fit in the ring, stopping at the
+// first block that is not a chunk
+//
+static int32_t read_ahead(struct savefile_engine* handle)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+	scap_reader_t* r = handle->m_reader;
+	block_header bh;
+	int32_t res;
+	int readsize;
+
+	while(!c->m_has_pending_bh && c->m_tail - c->m_head < c->m_ring_size)
+	{
+		if(handle->m_use_last_block_header)
+		{
+			bh = handle->m_last_block_header;
+			handle->m_use_last_block_header = false;
+		}
+		else
+		{
+			readsize = r->read(r, &bh, sizeof(bh));
+			if(readsize == 0)
+			{
+				break;
+			}
+			CHECK_READ_SIZE(readsize, sizeof(bh));
+		}
+
+		if(bh.block_type == EVC_BLOCK_TYPE)
+		{
+			if((res = queue_chunk(handle, &bh)) != SCAP_SUCCESS)
+			{
+				return res;
+			}
+		}
+		else if(bh.block_type == EVCI_BLOCK_TYPE)
+		{
+			if(bh.block_total_length < sizeof(bh) + 4 ||
+			   r->seek(r, r->tell(r) + bh.block_total_length - sizeof(bh), SEEK_SET) < 0)
+			{
+				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "corrupted input file. Can't skip event chunk index of size %u.", bh.block_total_length);
+				return SCAP_FAILURE;
+			}
+		}
+		else
+		{
+			c->m_pending_bh = bh;
+			c->m_has_pending_bh = true;
+		}
+	}
+
+	return SCAP_SUCCESS;
+}
+
+//
+// Wait for the chunk at the head of the ring to be decompressed, doing it
+// here if no worker has picked it up yet
+//
+static int32_t take_head(struct savefile_engine* handle)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+	savefile_chunk* chunk = &c->m_ring[c->m_head % c->m_ring_size];
+	bool decompress = false;
+
+	chunks_lock(c);
+	if(c->m_next_work == c->m_head)
+	{
+		c->m_next_work++;
+		decompress = true;
+	}
+#ifndef _WIN32
+	else
+	{
+		while(!chunk->m_ready)
+		{
+			pthread_cond_wait(&c->m_done_cond, &c->m_mutex);
+		}
+	}
+#endif
+	chunks_unlock(c);
+
+	if(decompress)
+	{
+		decompress_chunk(chunk);
+		chunk->m_ready = true;
+	}
+
+	if(chunk->m_res != SCAP_SUCCESS)
+	{
+		strlcpy(handle->m_lasterr, chunk->m_lasterr, SCAP_LASTERR_SIZE);
+		return chunk->m_res;
+	}
+
+	c->m_reader = scap_reader_open_memory(chunk->m_data, chunk->m_hdr.raw_len);
+	if(c->m_reader == NULL)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error allocating the event chunk reader");
+		return SCAP_FAILURE;
+	}
+
+	return SCAP_SUCCESS;
+}
+
+//
+// Return in *r the reader of the next event block: the current chunk until
+// it's over, then the next chunk or, if the file doesn't continue with a
+// chunk, the file itself. If may_load is false and the current chunk is
+// over, SCAP_INPUT_TOO_SMALL is returned instead, since moving to the next
+// chunk invalidates the events of the current one.
+//
+int32_t savefile_chunks_get_reader(struct savefile_engine* handle, bool may_load, scap_reader_t** r)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+	int32_t res;
+
+	if(c->m_reader != NULL)
+	{
+		if(handle->m_use_last_block_header ||
+		   c->m_reader->tell(c->m_reader) < (int64_t)c->m_ring[c->m_head % c->m_ring_size].m_hdr.raw_len)
+		{
+			*r = c->m_reader;
+			return SCAP_SUCCESS;
+		}
+
+		if(!may_load)
+		{
+			return SCAP_INPUT_TOO_SMALL;
+		}
+
+		c->m_reader->close(c->m_reader);
+		c->m_reader = NULL;
+		c->m_head++;
+	}
+
+	if((res = read_ahead(handle)) != SCAP_SUCCESS)
+	{
+		return res;
+	}
+
+	if(c->m_head < c->m_tail)
+	{
+		if((res = take_head(handle)) != SCAP_SUCCESS)
+		{
+			return res;
+		}
+		*r = c->m_reader;
+		return SCAP_SUCCESS;
+	}
+
+	if(c->m_has_pending_bh)
+	{
+		handle->m_last_block_header = c->m_pending_bh;
+		handle->m_use_last_block_header = true;
+		c->m_has_pending_bh = false;
+	}
+
+	*r = handle->m_reader;
+	return SCAP_SUCCESS;
+}
+
+//
+// Load the chunk index from the end of the file. The header of the first
+// chunk has just been read and the file position is restored when done.
+// A missing or invalid index isn't an error, the file just can't be
+// seeked by timestamp.
+//
+static int32_t load_index(struct savefile_engine* handle)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+	scap_reader_t* r = handle->m_reader;
+	int64_t start = r->tell(r);
+	uint64_t first_pos = (uint64_t)start - sizeof(block_header);
+	event_chunk_index_header ih;
+	block_header bh;
+	uint32_t bt;
+	uint32_t j;
+
+	if(start < 0)
+	{
+		return SCAP_SUCCESS;
+	}
+
+	if(r->seek(r, -4, SEEK_END) < 0 ||
+	   r->read(r, &bt, sizeof(bt)) != sizeof(bt))
+	{
+		goto done;
+	}
+
+	c->m_index_pos = (uint64_t)r->tell(r) - bt;
+	if(bt < sizeof(bh) + sizeof(ih) + 4 || c->m_index_pos < first_pos ||
+	   r->seek(r, (int64_t)c->m_index_pos, SEEK_SET) < 0 ||
+	   r->read(r, &bh, sizeof(bh)) != sizeof(bh) ||
+	   bh.block_type != EVCI_BLOCK_TYPE || bh.block_total_length != bt ||
+	   r->read(r, &ih, sizeof(ih)) != sizeof(ih) ||
+	   (uint64_t)ih.nchunks * (sizeof(event_chunk_index_entry) + ih.evtypes_len) > bt - sizeof(bh) - sizeof(ih) - 4)
+	{
+		goto done;
+	}
+
+	c->m_index = (event_chunk_index_entry*)malloc(ih.nchunks * sizeof(event_chunk_index_entry) + 1);
+	c->m_index_evtypes = (uint8_t*)malloc((size_t)ih.nchunks * ih.evtypes_len + 1);
+	if(c->m_index == NULL || c->m_index_evtypes == NULL)
+	{
+		goto done;
+	}
+
+	for(j = 0; j < ih.nchunks; j++)
+	{
+		event_chunk_index_entry* entry = &c->m_index[j];
+		if(r->read(r, entry, sizeof(*entry)) != sizeof(*entry) ||
+		   r->read(r, c->m_index_evtypes + (size_t)j * ih.evtypes_len, ih.evtypes_len) != (int)ih.evtypes_len ||
+		   entry->index_distance > c->m_index_pos - first_pos)
+		{
+			goto done;
+		}
+
+		entry->index_distance = c->m_index_pos - entry->index_distance;
+		if(j > 0 && entry->index_distance <= c->m_index[j - 1].index_distance)
+		{
+			goto done;
+		}
+	}
+
+	// The index must describe the chunks of this capture
+	if(ih.nchunks > 0 && c->m_index[0].index_distance != first_pos)
+	{
+		goto done;
+	}
+
+	c->m_nchunks = ih.nchunks;
+	c->m_index_evtypes_len = ih.evtypes_len;
+
+done:
+	if(c->m_nchunks == 0)
+	{
+		free(c->m_index);
+		free(c->m_index_evtypes);
+		c->m_index = NULL;
+		c->m_index_evtypes = NULL;
+	}
+
+	if(r->seek(r, start, SEEK_SET) != start)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error seeking back after reading the event chunk index");
+		return SCAP_FAILURE;
+	}
+
+	return SCAP_SUCCESS;
+}
+
+//
+// Set up the reading of the chunks, called when the first chunk is found
+//
+int32_t savefile_chunks_init(struct savefile_engine* handle)
+{
+	uint32_t nthreads = 0;
+	uint32_t ring_size;
+	savefile_chunk* ring;
+
+	struct savefile_chunks* c = (struct savefile_chunks*)calloc(1, sizeof(struct savefile_chunks));
+	if(c == NULL)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error allocating the event chunks state");
+		return SCAP_FAILURE;
+	}
+	handle->m_chunks = c;
+
+#ifndef _WIN32
+	nthreads = handle->m_chunk_threads < CHUNKS_MAX_THREADS ? handle->m_chunk_threads : CHUNKS_MAX_THREADS;
+#endif
+
+	//
+	// Without workers, a chunk is read only when the previous one is
+	// over. Otherwise, keep enough of them in flight to have all the
+	// workers busy while the events of one are read.
+	//
+	// The ring and the workers are only stored in the state once they
+	// are all set up, since savefile_chunks_close() tears down what the
+	// state holds if the opening fails halfway.
+	//
+	ring_size = nthreads == 0 ? 1 : 2 * nthreads;
+	ring = (savefile_chunk*)calloc(ring_size, sizeof(savefile_chunk));
+	if(ring == NULL)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error allocating the event chunks ring");
+		return SCAP_FAILURE;
+	}
+
+	if(load_index(handle) != SCAP_SUCCESS)
+	{
+		free(ring);
+		return SCAP_FAILURE;
+	}
+
+	c->m_ring = ring;
+	c->m_ring_size = ring_size;
+
+#ifndef _WIN32
+	if(nthreads > 0)
+	{
+		uint32_t j;
+
+		c->m_threads = (pthread_t*)calloc(nthreads, sizeof(pthread_t));
+		if(c->m_threads == NULL)
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error allocating the event chunk workers");
+			return SCAP_FAILURE;
+		}
+
+		pthread_mutex_init(&c->m_mutex, NULL);
+		pthread_cond_init(&c->m_work_cond, NULL);
+		pthread_cond_init(&c->m_done_cond, NULL);
+
+		for(j = 0; j < nthreads; j++)
+		{
+			if(pthread_create(&c->m_threads[j], NULL, chunk_worker, c) != 0)
+			{
+				break;
+			}
+		}
+
+		if(j == 0)
+		{
+			// decompress on the reading thread, but keep reading ahead
+			pthread_mutex_destroy(&c->m_mutex);
+			pthread_cond_destroy(&c->m_work_cond);
+			pthread_cond_destroy(&c->m_done_cond);
+		}
+		c->m_nthreads = j;
+	}
+#endif
+
+	return SCAP_SUCCESS;
+}
+
+//
+// Drop the chunks read so far, before moving to another position
+//
+void savefile_chunks_reset(struct savefile_engine* handle)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+
+	if(c == NULL)
+	{
+		return;
+	}
+
+	wait_workers(c);
+
+	if(c->m_reader != NULL)
+	{
+		c->m_reader->close(c->m_reader);
+		c->m_reader = NULL;
+	}
+
+	c->m_head = c->m_tail = c->m_next_work = 0;
+	c->m_has_pending_bh = false;
+}
+
+int32_t savefile_chunks_seek_ts(struct savefile_engine* handle, uint64_t ts)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+	uint64_t pos;
+	uint32_t j;
+
+	if(c == NULL || c->m_nchunks == 0)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "seeking by timestamp requires a capture with a chunk index");
+		return SCAP_NOT_SUPPORTED;
+	}
+
+	savefile_chunks_reset(handle);
+
+	pos = c->m_index_pos;
+	for(j = 0; j < c->m_nchunks; j++)
+	{
+		if(c->m_index[j].last_ts >= ts)
+		{
+			pos = c->m_index[j].index_distance;
+			break;
+		}
+	}
+
+	if(handle->m_reader->seek(handle->m_reader, (int64_t)pos, SEEK_SET) < 0)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error seeking to offset %" PRIu64, pos);
+		return SCAP_FAILURE;
+	}
+
+	handle->m_use_last_block_header = false;
+	handle->m_seek_ts = ts;
+	return SCAP_SUCCESS;
+}
+
+void savefile_chunks_close(struct savefile_engine* handle)
+{
+	struct savefile_chunks* c = handle->m_chunks;
+	uint32_t j;
+
+	if(c == NULL)
+	{
+		return;
+	}
+
+#ifndef _WIN32
+	if(c->m_nthreads > 0)
+	{
+		pthread_mutex_lock(&c->m_mutex);
+		c->m_stop = true;
+		pthread_cond_broadcast(&c->m_work_cond);
+		pthread_mutex_unlock(&c->m_mutex);
+
+		for(j = 0; j < c->m_nthreads; j++)
+		{
+			pthread_join(c->m_threads[j], NULL);
+		}
+
+		pthread_mutex_destroy(&c->m_mutex);
+		pthread_cond_destroy(&c->m_work_cond);
+		pthread_cond_destroy(&c->m_done_cond);
+	}
+	free(c->m_threads);
+#endif
+
+	if(c->m_reader != NULL)
+	{
+		c->m_reader->close(c->m_reader);
+	}
+
+	for(j = 0; j < c->m_ring_size; j++)
+	{
+		free(c->m_ring[j].m_payload_buf);
+		free(c->m_ring[j].m_data_buf);
+	}
+	free(c->m_ring);
+	free(c->m_index);
+	free(c->m_index_evtypes);
+	free(c);
+	handle->m_chunks = NULL;
+}
@@ -67,6 +67,25 @@ static int32_t next(struct scap_engine_handle handle, scap_evt** pevent, uint16_
 	return SCAP_SUCCESS;
 }
 
+static int32_t next_batch(struct scap_engine_handle handle, scap_batch_entry* entries, uint32_t max_events, uint32_t* nevents)
+{
+	test_input_engine *engine = handle.m_handle;
+	scap_test_input_data *data = engine->m_data;
+	uint32_t n = 0;
+
+	while(n < max_events && engine->m_event_index < data->event_count)
+	{
+		entries[n].evt = data->events[engine->m_event_index];
+		entries[n].cpuid = 0;
+		entries[n].dump_flags = 0;
+		engine->m_event_index++;
+		n++;
+	}
+
+	*nevents = n;
+	return (n < max_events) ? SCAP_EOF : SCAP_SUCCESS;
+}
+
 
 static int32_t get_threadinfos(struct scap_engine_handle handle, uint64_t *n, const scap_threadinfo **tinfos)
 {
@@ -120,6 +139,7 @@ const struct scap_vtable scap_test_input_engine = {
 	.free_handle = noop_free_handle,
 	.close = noop_close_engine,
 	.next = next,
+	.next_batch = next_batch,
 	.start_capture = noop_start_capture,
 	.stop_capture = noop_stop_capture,
 	.configure = noop_configure,
@@ -750,6 +750,11 @@ static int32_t next(struct scap_engine_handle engine, OUT scap_evt** pevent, OUT
 	return ringbuffer_next(&engine.m_handle->m_dev_set, pevent, pcpuid);
 }
 
+static int32_t next_batch(struct scap_engine_handle engine, OUT scap_batch_entry* entries, uint32_t max_events, OUT uint32_t* nevents)
+{
+	return ringbuffer_next_batch(&engine.m_handle->m_dev_set, entries, max_events, nevents);
+}
+
 //
 // Return the number of dropped events for the given handle
 //
@@ -964,6 +969,7 @@ struct scap_vtable scap_udig_engine = {
 	.free_handle = free_handle,
 	.close = close_engine,
 	.next = next,
+	.next_batch = next_batch,
 	.start_capture = start_capture,
 	.stop_capture = stop_capture,
 	.configure = configure,
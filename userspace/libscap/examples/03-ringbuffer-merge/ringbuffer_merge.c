@@ -0,0 +1,224 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//
+// Micro-benchmark of the per-CPU ring buffer merge done by ringbuffer_next().
+// Every device is backed by a plain memory buffer pre-filled with events
+// with interleaved timestamps, so what we measure is only the cost of picking
+// the next event, compared against the linear scan over all the devices.
+//
+// Usage: scap-ringbuffer-merge [total_events]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+#include <scap.h>
+#include "scap-int.h"
+
+// m_buffer_size is the producer position, m_bufinfo_size the consumer one
+static inline void bench_get_buf_pointers(scap_device* dev, uint64_t* phead, uint64_t* ptail, uint64_t* pread_size)
+{
+	*phead = dev->m_buffer_size;
+	*ptail = dev->m_bufinfo_size;
+	*pread_size = *phead - *ptail;
+}
+
+static inline void bench_advance_tail(scap_device* dev)
+{
+	dev->m_bufinfo_size += dev->m_lastreadsize;
+	dev->m_lastreadsize = 0;
+}
+
+static inline int32_t bench_readbuf(scap_device* dev, char** buf, uint32_t* len)
+{
+	uint64_t head, tail, read_size;
+	bench_get_buf_pointers(dev, &head, &tail, &read_size);
+	dev->m_lastreadsize = (uint32_t)read_size;
+	*buf = dev->m_buffer + tail;
+	*len = (uint32_t)read_size;
+	return SCAP_SUCCESS;
+}
+
+#define GET_BUF_POINTERS bench_get_buf_pointers
+#define ADVANCE_TAIL bench_advance_tail
+#define READBUF bench_readbuf
+
+#include "ringbuffer/ringbuffer.h"
+
+//
+// The merge as it was done before the device heap: scan all the devices
+// looking for the lowest timestamp
+//
+static inline int32_t linear_scan_next(struct scap_device_set *devset, scap_evt** pevent, uint16_t* pcpuid)
+{
+	uint32_t j;
+	uint64_t max_ts = 0xffffffffffffffffLL;
+	scap_evt* pe = NULL;
+
+	*pcpuid = 65535;
+
+	for(j = 0; j < devset->m_ndevs; j++)
+	{
+		scap_device* dev = &(devset->m_devs[j]);
+
+		if(dev->m_sn_len == 0)
+		{
+			if(dev->m_lastreadsize > 0)
+			{
+				ADVANCE_TAIL(dev);
+			}
+			continue;
+		}
+
+		pe = NEXT_EVENT(dev);
+		if(pe->ts < max_ts)
+		{
+			*pevent = pe;
+			*pcpuid = j;
+			max_ts = pe->ts;
+		}
+	}
+
+	if(*pcpuid != 65535)
+	{
+		ADVANCE_TO_EVT(&devset->m_devs[*pcpuid], (*pevent));
+		return SCAP_SUCCESS;
+	}
+
+	return refill_read_buffers(devset);
+}
+
+typedef int32_t (*next_fn)(struct scap_device_set*, scap_evt**, uint16_t*);
+
+static char* g_storage;
+
+static void fill_devices(struct scap_device_set* devset, uint64_t evts_per_dev)
+{
+	uint64_t seed = 42;
+	uint32_t j;
+
+	for(j = 0; j < devset->m_ndevs; j++)
+	{
+		scap_device* dev = &devset->m_devs[j];
+		uint64_t ts = 0;
+		uint64_t i;
+
+		dev->m_buffer = g_storage + j * evts_per_dev * sizeof(scap_evt);
+		dev->m_buffer_size = (uint32_t)(evts_per_dev * sizeof(scap_evt));
+		dev->m_bufinfo_size = 0;
+		dev->m_lastreadsize = 0;
+		dev->m_sn_len = 0;
+
+		for(i = 0; i < evts_per_dev; i++)
+		{
+			scap_evt* evt = (scap_evt*)(dev->m_buffer + i * sizeof(scap_evt));
+
+			seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			ts += 1 + (seed >> 33) % (2 * devset->m_ndevs);
+			evt->ts = ts;
+			evt->tid = j;
+			evt->len = sizeof(scap_evt);
+			evt->type = PPME_GENERIC_E;
+			evt->nparams = 0;
+		}
+	}
+	devset->m_heap_size = 0;
+}
+
+static double run(struct scap_device_set* devset, next_fn next, uint64_t nevts)
+{
+	struct timespec start, end;
+	uint64_t consumed = 0;
+	uint64_t last_ts = 0;
+	scap_evt* evt;
+	uint16_t cpuid;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while(consumed < nevts)
+	{
+		int32_t res = next(devset, &evt, &cpuid);
+		if(res == SCAP_TIMEOUT)
+		{
+			continue;
+		}
+		if(res != SCAP_SUCCESS || evt->ts < last_ts)
+		{
+			fprintf(stderr, "merge error after %lu events\n", (unsigned long)consumed);
+			exit(EXIT_FAILURE);
+		}
+		last_ts = evt->ts;
+		consumed++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return nevts / ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+}
+
+int main(int argc, char** argv)
+{
+	static const uint32_t ncpus[] = {1, 2, 4, 8, 16, 32, 64, 128, 192, 256};
+	uint64_t total = argc > 1 ? strtoull(argv[1], NULL, 10) : 8 * 1000 * 1000;
+	char lasterr[SCAP_LASTERR_SIZE];
+	uint32_t k;
+
+	g_storage = malloc(total * sizeof(scap_evt));
+	if(g_storage == NULL)
+	{
+		fprintf(stderr, "cannot allocate %lu events\n", (unsigned long)total);
+		return EXIT_FAILURE;
+	}
+
+	printf("%8s %16s %16s %8s\n", "ncpus", "linear evt/s", "heap evt/s", "speedup");
+
+	for(k = 0; k < sizeof(ncpus) / sizeof(ncpus[0]); k++)
+	{
+		struct scap_device_set devset;
+		uint64_t evts_per_dev = total / ncpus[k];
+		uint64_t nevts = evts_per_dev * ncpus[k];
+		double linear, heap;
+		uint32_t j;
+
+		if(devset_init(&devset, ncpus[k], lasterr) != SCAP_SUCCESS)
+		{
+			fprintf(stderr, "%s\n", lasterr);
+			return EXIT_FAILURE;
+		}
+
+		fill_devices(&devset, evts_per_dev);
+		linear = run(&devset, linear_scan_next, nevts);
+
+		fill_devices(&devset, evts_per_dev);
+		heap = run(&devset, ringbuffer_next, nevts);
+
+		printf("%8u %16.0f %16.0f %7.2fx\n", ncpus[k], linear, heap, heap / linear);
+
+		// the buffers are not mmapped, don't let devset_free() unmap them
+		for(j = 0; j < devset.m_ndevs; j++)
+		{
+			devset.m_devs[j].m_buffer = MAP_FAILED;
+			devset.m_devs[j].m_bufinfo = MAP_FAILED;
+		}
+		devset_free(&devset);
+	}
+
+	free(g_storage);
+	return EXIT_SUCCESS;
+}
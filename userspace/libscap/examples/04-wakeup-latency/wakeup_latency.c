@@ -0,0 +1,228 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//
+// Latency vs CPU benchmark of the ways a live capture waits for events
+// when the buffers are empty (see scap_wait_mode_t).
+//
+// A generator thread issues short bursts of syscalls separated by idle
+// periods, which is the worst case for the sleeping wait: the first events
+// of a burst wait for the current sleep to expire. For every event of the
+// generator we measure the delivery latency (the time we get it from
+// scap_next() minus its timestamp), and we report the CPU time used by the
+// consuming thread.
+//
+// Usage: scap-wakeup-latency [--bpf <probe> | --modern_bpf] [--poll]
+//                            [--seconds <n>] [--idle_ms <n>] [--burst <n>]
+//
+// Needs the kernel module (or the requested bpf probe) to be available.
+//
+
+#define _GNU_SOURCE
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include <scap.h>
+
+#define MAX_SAMPLES (1 << 20)
+
+static volatile bool g_stop = false;
+static volatile int64_t g_generator_tid = -1;
+static int g_idle_ms = 100;
+static int g_burst = 10;
+
+static uint64_t now_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct rusage usage;
+	getrusage(RUSAGE_THREAD, &usage);
+	return ((uint64_t)usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL +
+	       ((uint64_t)usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+static void* generator(void* arg)
+{
+	struct timespec idle = {g_idle_ms / 1000, (g_idle_ms % 1000) * 1000000L};
+
+	g_generator_tid = syscall(SYS_gettid);
+
+	while(!g_stop)
+	{
+		for(int i = 0; i < g_burst; i++)
+		{
+			// a cheap syscall, captured by every driver
+			close(-1);
+		}
+		nanosleep(&idle, NULL);
+	}
+	return NULL;
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+	uint64_t x = *(const uint64_t*)a;
+	uint64_t y = *(const uint64_t*)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv)
+{
+	scap_open_args args = {.mode = SCAP_MODE_LIVE};
+	char error[SCAP_LASTERR_SIZE];
+	int32_t res;
+	int seconds = 10;
+	scap_t* h;
+	pthread_t thread;
+	uint64_t* samples;
+	uint64_t nsamples = 0;
+	uint64_t sum = 0;
+	uint64_t start_ns, end_ns, start_cpu, end_cpu;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--bpf") && i + 1 < argc)
+		{
+			args.bpf_probe = argv[++i];
+		}
+#ifdef HAS_ENGINE_MODERN_BPF
+		else if(!strcmp(argv[i], "--modern_bpf"))
+		{
+			args.mode = SCAP_MODE_MODERN_BPF;
+		}
+#endif
+		else if(!strcmp(argv[i], "--poll"))
+		{
+			args.wait_mode = SCAP_WAIT_POLL;
+		}
+		else if(!strcmp(argv[i], "--seconds") && i + 1 < argc)
+		{
+			seconds = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "--idle_ms") && i + 1 < argc)
+		{
+			g_idle_ms = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "--burst") && i + 1 < argc)
+		{
+			g_burst = atoi(argv[++i]);
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--bpf <probe> | --modern_bpf] [--poll] [--seconds <n>] [--idle_ms <n>] [--burst <n>]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	for(int j = 0; j < PPM_SC_MAX; j++)
+	{
+		args.ppm_sc_of_interest.ppm_sc[j] = 1;
+	}
+
+	samples = malloc(MAX_SAMPLES * sizeof(uint64_t));
+	if(samples == NULL)
+	{
+		fprintf(stderr, "cannot allocate the samples\n");
+		return EXIT_FAILURE;
+	}
+
+	h = scap_open(args, error, &res);
+	if(h == NULL || res != SCAP_SUCCESS)
+	{
+		fprintf(stderr, "%s (%d)\n", error, res);
+		return EXIT_FAILURE;
+	}
+
+	if(pthread_create(&thread, NULL, generator, NULL) != 0)
+	{
+		fprintf(stderr, "cannot start the generator thread\n");
+		return EXIT_FAILURE;
+	}
+
+	start_ns = now_ns(CLOCK_MONOTONIC);
+	start_cpu = thread_cpu_ns();
+	end_ns = start_ns + (uint64_t)seconds * 1000000000ULL;
+
+	while(now_ns(CLOCK_MONOTONIC) < end_ns)
+	{
+		scap_evt* ev;
+		uint16_t cpuid;
+
+		res = scap_next(h, &ev, &cpuid);
+		if(res == SCAP_TIMEOUT || res == SCAP_FILTERED_EVENT)
+		{
+			continue;
+		}
+		else if(res != SCAP_SUCCESS)
+		{
+			fprintf(stderr, "%s (%d)\n", scap_getlasterr(h), res);
+			break;
+		}
+
+		if(ev->tid == (uint64_t)g_generator_tid && nsamples < MAX_SAMPLES)
+		{
+			uint64_t now = now_ns(CLOCK_REALTIME);
+			samples[nsamples++] = now > ev->ts ? now - ev->ts : 0;
+		}
+	}
+
+	end_cpu = thread_cpu_ns();
+	end_ns = now_ns(CLOCK_MONOTONIC);
+
+	g_stop = true;
+	pthread_join(thread, NULL);
+	scap_close(h);
+
+	if(nsamples == 0)
+	{
+		fprintf(stderr, "no events from the generator thread\n");
+		free(samples);
+		return EXIT_FAILURE;
+	}
+
+	qsort(samples, nsamples, sizeof(uint64_t), cmp_u64);
+	for(uint64_t i = 0; i < nsamples; i++)
+	{
+		sum += samples[i];
+	}
+
+	printf("wait mode: %s, bursts of %d syscalls every %d ms\n",
+	       args.wait_mode == SCAP_WAIT_POLL ? "poll" : "sleep", g_burst, g_idle_ms);
+	printf("events: %" PRIu64 "\n", nsamples);
+	printf("latency (us): mean %.1f, p50 %.1f, p99 %.1f, max %.1f\n",
+	       (double)sum / nsamples / 1000,
+	       (double)samples[nsamples / 2] / 1000,
+	       (double)samples[nsamples * 99 / 100] / 1000,
+	       (double)samples[nsamples - 1] / 1000);
+	printf("consumer CPU: %.2f%%\n", 100.0 * (end_cpu - start_cpu) / (end_ns - start_ns));
+
+	free(samples);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,281 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+//
+// Write and read throughput of the trace file compressions available in
+// this build (see scap_compression_supported()).
+//
+// The events of a sample capture are loaded in memory, then written to a
+// temporary file with each compression, plain and chunked, and read back.
+// For each run we report the write and read throughput in MB/s of
+// uncompressed event data, and the compression ratio against the size of
+// the uncompressed file.
+//
+// Usage: scap-dump-compression <capture.scap> [--chunk_size <bytes>] [--tmp <path>]
+//
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <scap.h>
+
+typedef struct sample
+{
+	scap_evt** events;
+	uint16_t* cpuids;
+	uint64_t count;
+	uint64_t bytes; ///< The total length of the events
+} sample;
+
+static uint64_t now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static double mb_per_s(uint64_t bytes, uint64_t ns)
+{
+	return ns ? (double)bytes / (1024 * 1024) / ((double)ns / 1000000000) : 0;
+}
+
+static scap_t* open_capture(const char* fname)
+{
+	scap_open_args args = {.mode = SCAP_MODE_CAPTURE};
+	char error[SCAP_LASTERR_SIZE];
+	int32_t res;
+
+	args.fname = fname;
+	scap_t* h = scap_open(args, error, &res);
+	if(h == NULL)
+	{
+		fprintf(stderr, "can't open %s: %s (%d)\n", fname, error, res);
+	}
+	return h;
+}
+
+static int load_sample(scap_t* h, sample* s)
+{
+	uint64_t size = 0;
+	scap_evt* evt;
+	uint16_t cpuid;
+	int32_t res;
+
+	while((res = scap_next(h, &evt, &cpuid)) == SCAP_SUCCESS || res == SCAP_TIMEOUT)
+	{
+		if(res == SCAP_TIMEOUT)
+		{
+			continue;
+		}
+
+		if(s->count == size)
+		{
+			size = size ? size * 2 : 1024;
+			s->events = (scap_evt**)realloc(s->events, size * sizeof(scap_evt*));
+			s->cpuids = (uint16_t*)realloc(s->cpuids, size * sizeof(uint16_t));
+			if(s->events == NULL || s->cpuids == NULL)
+			{
+				fprintf(stderr, "cannot allocate the sample\n");
+				return -1;
+			}
+		}
+
+		s->events[s->count] = (scap_evt*)malloc(evt->len);
+		if(s->events[s->count] == NULL)
+		{
+			fprintf(stderr, "cannot allocate the sample\n");
+			return -1;
+		}
+		memcpy(s->events[s->count], evt, evt->len);
+		s->cpuids[s->count] = cpuid;
+		s->bytes += evt->len;
+		s->count++;
+	}
+
+	if(res != SCAP_EOF)
+	{
+		fprintf(stderr, "error reading the sample: %s (%d)\n", scap_getlasterr(h), res);
+		return -1;
+	}
+
+	return 0;
+}
+
+//
+// Write the sample with the given compression and read it back.
+// Returns the size of the written file, or -1 on error.
+//
+static int64_t run(scap_t* h, const sample* s, const char* tmp, compression_mode compress, uint32_t chunk_size,
+		   uint64_t* write_ns, uint64_t* read_ns)
+{
+	scap_dumper_t* d;
+	struct stat st;
+	uint64_t j;
+
+	uint64_t start = now_ns();
+	if(chunk_size)
+	{
+		d = scap_dump_open_chunked(h, tmp, compress, chunk_size, true);
+	}
+	else
+	{
+		d = scap_dump_open(h, tmp, compress, true);
+	}
+	if(d == NULL)
+	{
+		fprintf(stderr, "can't open %s for writing: %s\n", tmp, scap_getlasterr(h));
+		return -1;
+	}
+
+	for(j = 0; j < s->count; j++)
+	{
+		if(scap_dump(h, d, s->events[j], s->cpuids[j], 0) != SCAP_SUCCESS)
+		{
+			fprintf(stderr, "error writing %s: %s\n", tmp, scap_getlasterr(h));
+			scap_dump_close(d);
+			return -1;
+		}
+	}
+	scap_dump_close(d);
+	*write_ns = now_ns() - start;
+
+	if(stat(tmp, &st) != 0)
+	{
+		fprintf(stderr, "can't stat %s\n", tmp);
+		return -1;
+	}
+
+	start = now_ns();
+	scap_t* r = open_capture(tmp);
+	if(r == NULL)
+	{
+		return -1;
+	}
+
+	scap_evt* evt;
+	uint16_t cpuid;
+	int32_t res;
+	uint64_t n = 0;
+	while((res = scap_next(r, &evt, &cpuid)) == SCAP_SUCCESS)
+	{
+		n++;
+	}
+	*read_ns = now_ns() - start;
+	scap_close(r);
+
+	if(res != SCAP_EOF || n != s->count)
+	{
+		fprintf(stderr, "read %" PRIu64 " events of %" PRIu64 " back (%d)\n", n, s->count, res);
+		return -1;
+	}
+
+	return (int64_t)st.st_size;
+}
+
+int main(int argc, char** argv)
+{
+	compression_mode modes[] = {SCAP_COMPRESSION_NONE, SCAP_COMPRESSION_GZIP, SCAP_COMPRESSION_LZ4, SCAP_COMPRESSION_ZSTD};
+	const char* names[] = {"none", "gzip", "lz4", "zstd"};
+	const char* tmp = "/tmp/scap-dump-compression.scap";
+	const char* fname = NULL;
+	uint32_t chunk_size = 4 * 1024 * 1024;
+	sample s = {0};
+	int64_t plain_size = 0;
+	int i;
+
+	for(i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--chunk_size") && i + 1 < argc)
+		{
+			chunk_size = (uint32_t)strtoul(argv[++i], NULL, 10);
+		}
+		else if(!strcmp(argv[i], "--tmp") && i + 1 < argc)
+		{
+			tmp = argv[++i];
+		}
+		else if(fname == NULL && argv[i][0] != '-')
+		{
+			fname = argv[i];
+		}
+		else
+		{
+			fname = NULL;
+			break;
+		}
+	}
+
+	if(fname == NULL || chunk_size == 0)
+	{
+		fprintf(stderr, "usage: %s <capture.scap> [--chunk_size <bytes>] [--tmp <path>]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	scap_t* h = open_capture(fname);
+	if(h == NULL || load_sample(h, &s) != 0)
+	{
+		return EXIT_FAILURE;
+	}
+
+	printf("%" PRIu64 " events, %.1f MB\n", s.count, (double)s.bytes / (1024 * 1024));
+	printf("%-6s %-8s %12s %12s %8s\n", "mode", "layout", "write MB/s", "read MB/s", "ratio");
+
+	for(uint32_t chunked = 0; chunked < 2; chunked++)
+	{
+		for(i = 0; i < (int)(sizeof(modes) / sizeof(modes[0])); i++)
+		{
+			uint64_t write_ns;
+			uint64_t read_ns;
+
+			if(!scap_compression_supported(modes[i]))
+			{
+				printf("%-6s %-8s %12s\n", names[i], chunked ? "chunked" : "stream", "not built in");
+				continue;
+			}
+
+			int64_t size = run(h, &s, tmp, modes[i], chunked ? chunk_size : 0, &write_ns, &read_ns);
+			if(size < 0)
+			{
+				unlink(tmp);
+				return EXIT_FAILURE;
+			}
+
+			if(!chunked && modes[i] == SCAP_COMPRESSION_NONE)
+			{
+				plain_size = size;
+			}
+
+			printf("%-6s %-8s %12.1f %12.1f %8.2f\n", names[i], chunked ? "chunked" : "stream",
+			       mb_per_s(s.bytes, write_ns), mb_per_s(s.bytes, read_ns),
+			       size ? (double)plain_size / size : 0);
+		}
+	}
+
+	unlink(tmp);
+	scap_close(h);
+	for(uint64_t j = 0; j < s.count; j++)
+	{
+		free(s.events[j]);
+	}
+	free(s.events);
+	free(s.cpuids);
+	return EXIT_SUCCESS;
+}
@@ -26,6 +26,16 @@ int32_t devset_init(struct scap_device_set *devset, size_t num_devs, char *laste
 		return SCAP_FAILURE;
 	}
 
+	devset->m_heap = (struct scap_device_heap_entry*) calloc(sizeof(struct scap_device_heap_entry), devset->m_ndevs);
+	if(!devset->m_heap)
+	{
+		free(devset->m_devs);
+		devset->m_devs = NULL;
+		strlcpy(lasterr, "error allocating the device merge heap", SCAP_LASTERR_SIZE);
+		return SCAP_FAILURE;
+	}
+	devset->m_heap_size = 0;
+
 	for(size_t j = 0; j < num_devs; ++j)
 	{
 		devset->m_devs[j].m_buffer = MAP_FAILED;
@@ -37,6 +47,8 @@ int32_t devset_init(struct scap_device_set *devset, size_t num_devs, char *laste
 		devset->m_devs[j].m_sn_len = 0;
 	}
 	devset->m_buffer_empty_wait_time_us = BUFFER_EMPTY_WAIT_TIME_US_START;
+	devset->m_poll_wait = false;
+	devset->m_pollfds = NULL;
 	devset->m_lasterr = lasterr;
 
 	return SCAP_SUCCESS;
@@ -76,4 +88,6 @@ void devset_free(struct scap_device_set *devset)
 		}
 	}
 	free(devset->m_devs);
+	free(devset->m_heap);
+	free(devset->m_pollfds);
 }
@@ -19,9 +19,11 @@ limitations under the License.
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 struct ppm_ring_buffer_info;
 struct udig_ring_buffer_status;
+struct pollfd;
 
 //
 // The device descriptor
@@ -47,13 +49,35 @@ typedef struct scap_device
 	};
 } scap_device;
 
+//
+// An entry of the device merge heap: the timestamp of the event
+// at the head of the device and the index of the device in the set
+//
+struct scap_device_heap_entry
+{
+	uint64_t m_ts;
+	uint32_t m_dev;
+};
+
 struct scap_device_set
 {
 	scap_device* m_devs;
 	uint32_t m_ndevs;
+	struct scap_device_heap_entry* m_heap; // Min-heap of the devices with data left, see ringbuffer_next()
+	uint32_t m_heap_size;
 	uint64_t m_buffer_empty_wait_time_us;
+	bool m_poll_wait; // When the buffers are empty, poll() the device fds instead of sleeping, see SCAP_WAIT_POLL
+	struct pollfd* m_pollfds; // Allocated on the first poll()
 	char* m_lasterr;
 };
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 int32_t devset_init(struct scap_device_set *devset, size_t num_devs, char *lasterr);
 void devset_free(struct scap_device_set *devset);
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,6 +18,12 @@ limitations under the License.
 #include <stdio.h>
 #include <stdint.h>
 
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#endif
+
 #include "devset.h"
 #include "../../../driver/ppm_ringbuffer.h"
 #include "barrier.h"
@@ -133,6 +139,177 @@ static inline bool are_buffers_empty(struct scap_device_set *devset)
 	return true;
 }
 
+#ifndef NEXT_EVENT
+#define NEXT_EVENT ringbuffer_next_event
+static inline scap_evt* ringbuffer_next_event(scap_device* dev)
+{
+	return (scap_evt*)dev->m_sn_next_event;
+}
+#endif
+
+#ifndef ADVANCE_TO_EVT
+#define ADVANCE_TO_EVT ringbuffer_advance_to_evt
+static inline void ringbuffer_advance_to_evt(scap_device* dev, scap_evt *event)
+{
+	ASSERT(dev->m_sn_len >= event->len);
+	dev->m_sn_len -= event->len;
+	dev->m_sn_next_event += event->len;
+}
+#endif
+
+//
+// The devices that still have events to serve are kept in a binary min-heap
+// (devset->m_heap) keyed on the timestamp of their head event. Ties are broken
+// on the device index, so the events come out in exactly the same order as a
+// linear scan over all the devices would return them. Only the device we just
+// served an event from has to be moved in the heap, so picking the next event
+// costs O(log(ndevs)) instead of O(ndevs).
+//
+static inline bool ringbuffer_heap_less(const struct scap_device_heap_entry* a, const struct scap_device_heap_entry* b)
+{
+	return a->m_ts < b->m_ts || (a->m_ts == b->m_ts && a->m_dev < b->m_dev);
+}
+
+static inline void ringbuffer_heap_sift_down(struct scap_device_set *devset, uint32_t pos)
+{
+	struct scap_device_heap_entry* heap = devset->m_heap;
+	uint32_t size = devset->m_heap_size;
+	struct scap_device_heap_entry entry = heap[pos];
+
+	while(true)
+	{
+		uint32_t child = 2 * pos + 1;
+		if(child >= size)
+		{
+			break;
+		}
+
+		if(child + 1 < size && ringbuffer_heap_less(&heap[child + 1], &heap[child]))
+		{
+			child++;
+		}
+
+		if(!ringbuffer_heap_less(&heap[child], &entry))
+		{
+			break;
+		}
+
+		heap[pos] = heap[child];
+		pos = child;
+	}
+
+	heap[pos] = entry;
+}
+
+static inline void ringbuffer_heap_pop(struct scap_device_set *devset)
+{
+	ASSERT(devset->m_heap_size > 0);
+
+	devset->m_heap_size--;
+	if(devset->m_heap_size > 0)
+	{
+		devset->m_heap[0] = devset->m_heap[devset->m_heap_size];
+		ringbuffer_heap_sift_down(devset, 0);
+	}
+}
+
+static inline void ringbuffer_heap_build(struct scap_device_set *devset)
+{
+	uint32_t j;
+
+	devset->m_heap_size = 0;
+
+	for(j = 0; j < devset->m_ndevs; j++)
+	{
+		scap_device* dev = &devset->m_devs[j];
+
+		if(dev->m_sn_len == 0)
+		{
+			continue;
+		}
+
+		devset->m_heap[devset->m_heap_size].m_ts = NEXT_EVENT(dev)->ts;
+		devset->m_heap[devset->m_heap_size].m_dev = j;
+		devset->m_heap_size++;
+	}
+
+	for(j = devset->m_heap_size / 2; j > 0; j--)
+	{
+		ringbuffer_heap_sift_down(devset, j - 1);
+	}
+}
+
+#ifndef _WIN32
+//
+// Block until a device signals new data, for at most
+// BUFFER_EMPTY_WAIT_TIME_US_MAX. Return false (and stop trying) if the
+// devices can't be polled, so that the caller falls back to sleeping.
+//
+static inline bool ringbuffer_poll_wait(struct scap_device_set *devset)
+{
+	uint32_t j;
+	int ret;
+
+	if(devset->m_pollfds == NULL)
+	{
+		devset->m_pollfds = (struct pollfd*)calloc(devset->m_ndevs, sizeof(struct pollfd));
+		if(devset->m_pollfds == NULL)
+		{
+			devset->m_poll_wait = false;
+			return false;
+		}
+	}
+
+	//
+	// The devices are never writable: we ask for POLLOUT only to spot
+	// the ones without poll() support (e.g. an older kernel module),
+	// which are always reported as readable and writable
+	//
+	for(j = 0; j < devset->m_ndevs; j++)
+	{
+		devset->m_pollfds[j].fd = devset->m_devs[j].m_fd;
+		devset->m_pollfds[j].events = POLLIN | POLLOUT;
+		devset->m_pollfds[j].revents = 0;
+	}
+
+	ret = poll(devset->m_pollfds, devset->m_ndevs, BUFFER_EMPTY_WAIT_TIME_US_MAX / 1000);
+	if(ret < 0)
+	{
+		if(errno == EINTR)
+		{
+			return true;
+		}
+		devset->m_poll_wait = false;
+		return false;
+	}
+
+	for(j = 0; j < devset->m_ndevs && ret > 0; j++)
+	{
+		if(devset->m_pollfds[j].revents & (POLLOUT | POLLNVAL))
+		{
+			devset->m_poll_wait = false;
+			return false;
+		}
+	}
+
+	return true;
+}
+#endif
+
+static inline void ringbuffer_wait_for_data(struct scap_device_set *devset)
+{
+#ifndef _WIN32
+	if(devset->m_poll_wait && ringbuffer_poll_wait(devset))
+	{
+		return;
+	}
+#endif
+
+	sleep_ms(devset->m_buffer_empty_wait_time_us / 1000);
+	devset->m_buffer_empty_wait_time_us = MIN(devset->m_buffer_empty_wait_time_us * 2,
+						  BUFFER_EMPTY_WAIT_TIME_US_MAX);
+}
+
 static inline int32_t refill_read_buffers(struct scap_device_set *devset)
 {
 	uint32_t j;
@@ -140,9 +317,7 @@ static inline int32_t refill_read_buffers(struct scap_device_set *devset)
 
 	if(are_buffers_empty(devset))
 	{
-		sleep_ms(devset->m_buffer_empty_wait_time_us / 1000);
-		devset->m_buffer_empty_wait_time_us = MIN(devset->m_buffer_empty_wait_time_us * 2,
-							  BUFFER_EMPTY_WAIT_TIME_US_MAX);
+		ringbuffer_wait_for_data(devset);
 	}
 	else
 	{
@@ -163,10 +338,13 @@ static inline int32_t refill_read_buffers(struct scap_device_set *devset)
 
 		if(res != SCAP_SUCCESS)
 		{
+			devset->m_heap_size = 0;
 			return res;
 		}
 	}
 
+	ringbuffer_heap_build(devset);
+
 	//
 	// Note: we might return a spurious timeout here in case the previous loop extracted valid data to parse.
 	//       It's ok, since this is rare and the caller will just call us again after receiving a
@@ -175,97 +353,117 @@ static inline int32_t refill_read_buffers(struct scap_device_set *devset)
 	return SCAP_TIMEOUT;
 }
 
-#ifndef NEXT_EVENT
-#define NEXT_EVENT ringbuffer_next_event
-static inline scap_evt* ringbuffer_next_event(scap_device* dev)
-{
-	return (scap_evt*)dev->m_sn_next_event;
-}
-#endif
-
-#ifndef ADVANCE_TO_EVT
-#define ADVANCE_TO_EVT ringbuffer_advance_to_evt
-static inline void ringbuffer_advance_to_evt(scap_device* dev, scap_evt *event)
-{
-	ASSERT(dev->m_sn_len >= event->len);
-	dev->m_sn_len -= event->len;
-	dev->m_sn_next_event += event->len;
-}
-#endif
-
 static inline int32_t ringbuffer_next(struct scap_device_set *devset, OUT scap_evt** pevent, OUT uint16_t* pcpuid)
 {
 	uint32_t j;
-	uint64_t max_ts = 0xffffffffffffffffLL;
 	scap_evt* pe = NULL;
 	uint32_t ndevs = devset->m_ndevs;
 
 	*pcpuid = 65535;
 
-	for(j = 0; j < ndevs; j++)
+	while(devset->m_heap_size > 0)
 	{
-		scap_device* dev = &(devset->m_devs[j]);
+		struct scap_device_heap_entry* top = &devset->m_heap[0];
+		scap_device* dev = &(devset->m_devs[top->m_dev]);
 
 		if(dev->m_sn_len == 0)
 		{
 			//
-			// If we don't have data from this ring, but we are
-			// still occupying, free the resources for the
-			// producer rather than sitting on them.
+			// This device was drained by the previous call (or its
+			// buffer was flushed): now that the caller is done with
+			// the last event we served from it, free the resources
+			// for the producer rather than sitting on them.
 			//
 			if(dev->m_lastreadsize > 0)
 			{
 				ADVANCE_TAIL(dev);
 			}
 
+			ringbuffer_heap_pop(devset);
 			continue;
 		}
 
-		pe = NEXT_EVENT(dev);
-
 		//
-		// We want to consume the event with the lowest timestamp
+		// The top of the heap holds the event with the lowest timestamp
 		//
-		if(pe->ts < max_ts)
+		pe = NEXT_EVENT(dev);
+		if(pe->len > dev->m_sn_len)
 		{
-			if(pe->len > dev->m_sn_len)
-			{
-				snprintf(devset->m_lasterr, SCAP_LASTERR_SIZE, "scap_next buffer corruption");
-
-				//
-				// if you get the following assertion, first recompile the driver and libscap
-				//
-				ASSERT(false);
-				return SCAP_FAILURE;
-			}
+			snprintf(devset->m_lasterr, SCAP_LASTERR_SIZE, "scap_next buffer corruption");
 
-			*pevent = pe;
-			*pcpuid = j;
-			max_ts = pe->ts;
+			//
+			// if you get the following assertion, first recompile the driver and libscap
+			//
+			ASSERT(false);
+			return SCAP_FAILURE;
 		}
-	}
 
-	//
-	// Check which buffer has been picked
-	//
-	if(*pcpuid != 65535)
-	{
-		struct scap_device *dev = &devset->m_devs[*pcpuid];
+		*pevent = pe;
+		*pcpuid = top->m_dev;
 
 		//
 		// Update the pointers.
 		//
-		ADVANCE_TO_EVT(dev, (*pevent));
+		ADVANCE_TO_EVT(dev, pe);
+
+		//
+		// If the device ran out of data we leave it on top of the heap,
+		// the next call will release it and pop it.
+		//
+		if(dev->m_sn_len > 0)
+		{
+			top->m_ts = NEXT_EVENT(dev)->ts;
+			ringbuffer_heap_sift_down(devset, 0);
+		}
+
 		return SCAP_SUCCESS;
 	}
-	else
+
+	//
+	// All the buffers have been consumed. Make sure we are not sitting on
+	// any of them, then check if there's enough data to keep going or
+	// if we should wait.
+	//
+	for(j = 0; j < ndevs; j++)
 	{
-		//
-		// All the buffers have been consumed. Check if there's enough data to keep going or
-		// if we should wait.
-		//
-		return refill_read_buffers(devset);
+		scap_device* dev = &(devset->m_devs[j]);
+
+		if(dev->m_sn_len == 0 && dev->m_lastreadsize > 0)
+		{
+			ADVANCE_TAIL(dev);
+		}
 	}
+
+	return refill_read_buffers(devset);
+}
+
+//
+// Return up to max_events events, in the same order as ringbuffer_next().
+// The batch stops when a device runs out of data: releasing it to the
+// producer would invalidate the events we already stored in the batch.
+//
+static inline int32_t ringbuffer_next_batch(struct scap_device_set *devset, OUT scap_batch_entry* entries, uint32_t max_events, OUT uint32_t* nevents)
+{
+	int32_t res;
+	uint32_t n = 0;
+
+	*nevents = 0;
+
+	do
+	{
+		entries[n].dump_flags = 0;
+		res = ringbuffer_next(devset, &entries[n].evt, &entries[n].cpuid);
+		if(res != SCAP_SUCCESS)
+		{
+			break;
+		}
+		n++;
+	} while(n < max_events &&
+		devset->m_heap_size > 0 &&
+		devset->m_devs[devset->m_heap[0].m_dev].m_sn_len > 0);
+
+	*nevents = n;
+	return res;
 }
 
 static inline uint64_t ringbuffer_get_max_buf_used(struct scap_device_set *devset)
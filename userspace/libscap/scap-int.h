@@ -110,6 +110,10 @@ struct scap
 	// matching an entry in m_suppressed_comms.
 	uint64_t m_num_suppressed_evts;
 
+	// The result that cut the last batch short in scap_next_batch(),
+	// returned by the next call
+	int32_t m_next_batch_res;
+
 	bool syscalls_of_interest[SYSCALL_TABLE_SIZE];
 
 	// API version supported by the driver
@@ -140,6 +144,10 @@ struct scap_dumper
 	uint8_t* m_targetbuf;
 	uint8_t* m_targetbufcurpos;
 	uint8_t* m_targetbufend;
+	struct scap_dump_chunker* m_chunker; ///< Only set for the dumpers opened with scap_dump_open_chunked
+	struct scap_compressor* m_compressor; ///< Only set for the lz4 and zstd compressed files
+	struct scap_dump_async* m_async; ///< Only set after scap_dump_set_async
+	char m_lasterr[SCAP_LASTERR_SIZE]; ///< Why the last event chunk couldn't be written, empty if it could
 };
 
 struct scap_ns_socket_list
@@ -191,6 +199,8 @@ void scap_fd_free_proc_fd_table(scap_t* handle, scap_threadinfo* pi);
 uint32_t scap_fd_info_len(scap_fdinfo* fdi);
 // Write the given fd info to disk
 int32_t scap_fd_write_to_disk(scap_t* handle, scap_fdinfo* fdi, scap_dumper_t* dumper, uint32_t len);
+// Write data to the file of a dumper, compressing it if needed, bypassing the async writer
+int scap_dump_file_write(scap_dumper_t *d, const void* buf, unsigned len);
 // Add the file descriptor info pointed by fdi to the fd table for process pi.
 // Note: silently skips if fdi->type is SCAP_FD_UNKNOWN.
 int32_t scap_add_fd_to_proc_table(scap_t* handle, scap_threadinfo* pi, scap_fdinfo* fdi, char *error);
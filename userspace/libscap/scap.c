@@ -89,7 +89,8 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 			   bool import_users,
 			   const char *bpf_probe,
 			   const char **suppressed_comms,
-			   interesting_ppm_sc_set *ppm_sc_of_interest)
+			   interesting_ppm_sc_set *ppm_sc_of_interest,
+			   scap_wait_mode_t wait_mode)
 {
 	snprintf(error, SCAP_LASTERR_SIZE, "live capture not supported on %s", PLATFORM_NAME);
 	*rc = SCAP_NOT_SUPPORTED;
@@ -117,7 +118,8 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 			   bool import_users,
 			   const char *bpf_probe,
 			   const char **suppressed_comms,
-			   interesting_ppm_sc_set *ppm_sc_of_interest)
+			   interesting_ppm_sc_set *ppm_sc_of_interest,
+			   scap_wait_mode_t wait_mode)
 {
 	char filename[SCAP_MAX_PATH_SIZE];
 	scap_t* handle = NULL;
@@ -127,6 +129,7 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 	oargs.proc_callback_context = proc_callback_context;
 	oargs.import_users = import_users;
 	oargs.bpf_probe = bpf_probe;
+	oargs.wait_mode = wait_mode;
 	memcpy(&oargs.suppressed_comms, suppressed_comms, sizeof(*suppressed_comms));
 
 	if(!ppm_sc_of_interest)
@@ -238,6 +241,7 @@ scap_t* scap_open_live_int(char *error, int32_t *rc,
 	handle->m_num_suppressed_comms = 0;
 	handle->m_suppressed_tids = NULL;
 	handle->m_num_suppressed_evts = 0;
+	handle->m_next_batch_res = SCAP_SUCCESS;
 
 	if ((*rc = copy_comms(handle, suppressed_comms)) != SCAP_SUCCESS)
 	{
@@ -400,6 +404,7 @@ scap_t* scap_open_udig_int(char *error, int32_t *rc,
 	handle->m_num_suppressed_comms = 0;
 	handle->m_suppressed_tids = NULL;
 	handle->m_num_suppressed_evts = 0;
+	handle->m_next_batch_res = SCAP_SUCCESS;
 
 #ifdef _WIN32
 	handle->m_whh = scap_windows_hal_open(error);
@@ -503,6 +508,7 @@ scap_t* scap_open_test_input_int(char *error, int32_t *rc, scap_open_args *args)
 	handle->m_num_suppressed_comms = 0;
 	handle->m_suppressed_tids = NULL;
 	handle->m_num_suppressed_evts = 0;
+	handle->m_next_batch_res = SCAP_SUCCESS;
 
 	handle->m_proclist.m_main_handle = handle;
 	handle->m_proclist.m_proc_callback = args->proc_callback;
@@ -592,6 +598,7 @@ scap_t* scap_open_gvisor_int(char *error, int32_t *rc, scap_open_args *args)
 	handle->m_num_suppressed_comms = 0;
 	handle->m_suppressed_tids = NULL;
 	handle->m_num_suppressed_evts = 0;
+	handle->m_next_batch_res = SCAP_SUCCESS;
 
 	handle->m_proclist.m_main_handle = handle;
 	handle->m_proclist.m_proc_callback = args->proc_callback;
@@ -696,6 +703,7 @@ scap_t* scap_open_offline_int(scap_open_args* oargs, int* rc, char* error)
 
 	handle->m_num_suppressed_comms = 0;
 	handle->m_num_suppressed_evts = 0;
+	handle->m_next_batch_res = SCAP_SUCCESS;
 
 	if ((*rc = copy_comms(handle, oargs->suppressed_comms)) != SCAP_SUCCESS)
 	{
@@ -994,7 +1002,8 @@ scap_t* scap_open(scap_open_args args, char *error, int32_t *rc)
 						args.import_users,
 						args.bpf_probe,
 						args.suppressed_comms,
-						&args.ppm_sc_of_interest);
+						&args.ppm_sc_of_interest,
+						args.wait_mode);
 		}
 #else
 		snprintf(error,	SCAP_LASTERR_SIZE, "scap_open: live mode currently not supported on Windows.");
@@ -1079,6 +1088,7 @@ uint32_t scap_restart_capture(scap_t* handle)
 	if(handle->m_vtable->savefile_ops)
 	{
 		scap_deinit_state(handle);
+		handle->m_next_batch_res = SCAP_SUCCESS;
 		return handle->m_vtable->savefile_ops->restart_capture(handle);
 	}
 	else
@@ -1187,6 +1197,14 @@ uint64_t scap_max_buf_used(scap_t* handle)
 int32_t scap_next(scap_t* handle, OUT scap_evt** pevent, OUT uint16_t* pcpuid)
 {
 	int32_t res = SCAP_FAILURE;
+
+	if(handle->m_next_batch_res != SCAP_SUCCESS)
+	{
+		res = handle->m_next_batch_res;
+		handle->m_next_batch_res = SCAP_SUCCESS;
+		return res;
+	}
+
 	if(handle->m_vtable)
 	{
 		res = handle->m_vtable->next(handle->m_engine, pevent, pcpuid);
@@ -1222,6 +1240,88 @@ int32_t scap_next(scap_t* handle, OUT scap_evt** pevent, OUT uint16_t* pcpuid)
 	return res;
 }
 
+int32_t scap_next_batch(scap_t* handle, OUT scap_batch_entry* entries, uint32_t max_events, OUT uint32_t* nevents)
+{
+	int32_t res = SCAP_FAILURE;
+	uint32_t j;
+	uint32_t n = 0;
+
+	*nevents = 0;
+
+	if(handle->m_next_batch_res != SCAP_SUCCESS)
+	{
+		res = handle->m_next_batch_res;
+		handle->m_next_batch_res = SCAP_SUCCESS;
+		return res;
+	}
+
+	if(max_events == 0)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "scap_next_batch called with an empty batch");
+		return SCAP_FAILURE;
+	}
+
+	if(!handle->m_vtable)
+	{
+		ASSERT(false);
+		return SCAP_FAILURE;
+	}
+
+	if(handle->m_vtable->next_batch)
+	{
+		res = handle->m_vtable->next_batch(handle->m_engine, entries, max_events, &n);
+	}
+	else
+	{
+		//
+		// The engine can't return more than one event at a time
+		//
+		entries[0].dump_flags = 0;
+		res = handle->m_vtable->next(handle->m_engine, &entries[0].evt, &entries[0].cpuid);
+		n = (res == SCAP_SUCCESS) ? 1 : 0;
+	}
+
+	if(n == 0)
+	{
+		return res;
+	}
+
+	//
+	// Events were returned: report the reason the batch was cut
+	// short (if any) on the next call
+	//
+	if(res != SCAP_SUCCESS && res != SCAP_TIMEOUT)
+	{
+		handle->m_next_batch_res = res;
+	}
+
+	//
+	// Drop the events coming from suppressed tids
+	//
+	for(j = 0; j < n; j++)
+	{
+		bool suppressed;
+
+		if((res = scap_check_suppressed(handle, entries[j].evt, &suppressed)) != SCAP_SUCCESS)
+		{
+			return res;
+		}
+
+		if(suppressed)
+		{
+			handle->m_num_suppressed_evts++;
+		}
+		else
+		{
+			entries[(*nevents)++] = entries[j];
+		}
+	}
+
+	handle->m_evtcnt += *nevents;
+
+	return (*nevents > 0) ? SCAP_SUCCESS : SCAP_TIMEOUT;
+}
+
 //
 // Return the process list for the given handle
 //
@@ -1589,10 +1689,27 @@ void scap_fseek(scap_t *handle, uint64_t off)
 {
 	if(handle->m_vtable->savefile_ops)
 	{
+		handle->m_next_batch_res = SCAP_SUCCESS;
 		return handle->m_vtable->savefile_ops->fseek_capture(handle->m_engine, off);
 	}
 }
 
+//
+// Seek to the first event with a timestamp not lower than ts, in captures
+// written with scap_dump_open_chunked
+//
+int32_t scap_seek_ts(scap_t *handle, uint64_t ts)
+{
+	if(handle->m_vtable->savefile_ops)
+	{
+		handle->m_next_batch_res = SCAP_SUCCESS;
+		return handle->m_vtable->savefile_ops->seek_ts(handle->m_engine, ts);
+	}
+
+	snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "scap_seek_ts only works on captures");
+	return SCAP_NOT_SUPPORTED;
+}
+
 int32_t scap_enable_simpledriver_mode(scap_t* handle)
 {
 	if(handle->m_vtable)
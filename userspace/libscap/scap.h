@@ -482,7 +482,9 @@ typedef enum event_direction
 typedef enum compression_mode
 {
 	SCAP_COMPRESSION_NONE = 0,
-	SCAP_COMPRESSION_GZIP = 1
+	SCAP_COMPRESSION_GZIP = 1,
+	SCAP_COMPRESSION_LZ4 = 2, ///< Only available when built with WITH_LZ4
+	SCAP_COMPRESSION_ZSTD = 3 ///< Only available when built with WITH_ZSTD
 }compression_mode;
 
 /*!
@@ -499,6 +501,16 @@ typedef enum scap_dump_flags
 
 typedef struct scap_dumper scap_dumper_t;
 
+/*!
+  \brief An event returned by \ref scap_next_batch.
+*/
+typedef struct scap_batch_entry
+{
+	scap_evt* evt; ///< The event.
+	uint16_t cpuid; ///< The ID of the CPU where the event was captured.
+	uint32_t dump_flags; ///< The scap_dump_flags of the event for offline captures, 0 for live captures.
+}scap_batch_entry;
+
 /*!
   \brief System call description struct.
 */
@@ -639,6 +651,28 @@ uint64_t scap_max_buf_used(scap_t* handle);
 */
 int32_t scap_next(scap_t* handle, OUT scap_evt** pevent, OUT uint16_t* pcpuid);
 
+/*!
+  \brief Get up to max_events events from the given capture instance in one call
+
+  \param handle Handle to the capture instance.
+  \param entries User-provided array of max_events entries that will be filled with
+    the events and the ID of the CPU where each of them was captured, in the same
+    order \ref scap_next would have returned them.
+  \param max_events The size of the entries array, must be at least 1.
+  \param nevents User-provided pointer that will be set to the number of entries filled.
+
+  \return SCAP_SUCCESS if at least one event was returned. Otherwise the same
+   values as \ref scap_next, with *nevents set to 0. If the batch was cut short
+   by the end of the capture or by an error, the condition is returned by the
+   following call.
+
+  \note All the events of a batch remain valid until the next call to
+   \ref scap_next or \ref scap_next_batch. Engines that can't keep more than one
+   event around return batches of a single event, so the batch can be shorter than
+   max_events even if more events are immediately available.
+*/
+int32_t scap_next_batch(scap_t* handle, OUT scap_batch_entry* entries, uint32_t max_events, OUT uint32_t* nevents);
+
 /*!
   \brief Get the length of an event
 
@@ -710,6 +744,12 @@ int64_t scap_get_readfile_offset(scap_t* handle);
 */
 scap_dumper_t* scap_dump_open(scap_t *handle, const char *fname, compression_mode compress, bool skip_proc_scan);
 
+/*!
+  \brief Return true if trace files can be written and read with the given
+         compression in this build.
+*/
+bool scap_compression_supported(compression_mode compress);
+
 /*!
   \brief Open a trace file for writing, using the provided fd.
 
@@ -720,6 +760,21 @@ scap_dumper_t* scap_dump_open(scap_t *handle, const char *fname, compression_mod
 */
 scap_dumper_t* scap_dump_open_fd(scap_t *handle, int fd, compression_mode compress, bool skip_proc_scan);
 
+/*!
+  \brief Open a trace file for writing, grouping the events in chunks that
+         are compressed independently and listed in an index at the end of
+         the file. Such files can be read back in parallel and support
+         \ref scap_seek_ts.
+
+  \param handle Handle to the capture instance.
+  \param fname The name of the trace file.
+  \param compress The compression of each chunk.
+  \param chunk_size The uncompressed size of a chunk, in bytes. 0 for the default.
+
+  \return Dump handle that can be used to identify this specific dump instance.
+*/
+scap_dumper_t* scap_dump_open_chunked(scap_t *handle, const char *fname, compression_mode compress, uint32_t chunk_size, bool skip_proc_scan);
+
 /*!
   \brief Close a trace file.
 
@@ -751,6 +806,34 @@ int64_t scap_dump_ftell(scap_dumper_t *d);
 */
 void scap_dump_flush(scap_dumper_t *d);
 
+/*!
+  \brief Move the writes of a trace file to a background thread.
+
+  From now on, the data is copied into nbuffers preallocated buffers of
+  buffer_size bytes, and a writer thread compresses them and writes them to
+  the file. When all the buffers are waiting for the writer, \ref scap_dump
+  drops the events instead of waiting, and counts them in
+  \ref scap_dump_get_drops. The other writes wait for the writer.
+
+  \param d The dump handle, returned by \ref scap_dump_open or \ref scap_dump_open_fd
+  \param buffer_size The size of each buffer, in bytes. 0 for the default (8MB).
+  \param nbuffers The number of buffers, at least 2. 0 for the default (2).
+  \param error Pointer to a buffer that will contain the error string in case the
+    function fails. The buffer must have size SCAP_LASTERR_SIZE.
+
+  \return SCAP_SUCCESS if the call is successful, SCAP_NOT_SUPPORTED for the
+   memory and chunked dumpers.
+*/
+int32_t scap_dump_set_async(scap_dumper_t *d, uint32_t buffer_size, uint32_t nbuffers, char *error);
+
+/*!
+  \brief Return the number of events dropped by \ref scap_dump because the
+         async writer couldn't keep up.
+
+  \param d The dump handle, returned by \ref scap_dump_open
+*/
+uint64_t scap_dump_get_drops(scap_dumper_t *d);
+
 /*!
   \brief Tell how many bytes would be written (a dry run of scap_dump)
 
@@ -1057,6 +1140,7 @@ void scap_refresh_proc_table(scap_t* handle);
 void scap_set_refresh_proc_table_when_saving(scap_t* handle, bool refresh);
 uint64_t scap_ftell(scap_t *handle);
 void scap_fseek(scap_t *handle, uint64_t off);
+int32_t scap_seek_ts(scap_t *handle, uint64_t ts);
 int32_t scap_enable_tracers_capture(scap_t* handle);
 int32_t scap_enable_page_faults(scap_t *handle);
 int32_t scap_proc_add(scap_t* handle, uint64_t tid, scap_threadinfo* tinfo);
@@ -0,0 +1,800 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scap_compress.h"
+#include "settings.h"
+
+#ifdef HAS_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAS_LZ4
+#include <lz4.h>
+#include <lz4frame.h>
+#endif
+
+//
+// The dump writes are small, a few fields of each event at a time, so they
+// are gathered in blocks of this size before being compressed. The lz4
+// frame compressor also needs an output buffer as big as the compressed
+// bound of its input.
+//
+#define COMPRESS_BLOCK_SIZE (64 * 1024)
+
+struct scap_compressor
+{
+	compression_mode m_compress;
+	gzFile m_f;
+	int64_t m_written; ///< The uncompressed bytes written so far
+	uint8_t* m_in; ///< Writes not compressed yet
+	size_t m_in_len;
+	uint8_t* m_out;
+	size_t m_out_size;
+#ifdef HAS_ZSTD
+	ZSTD_CCtx* m_zstd;
+#endif
+#ifdef HAS_LZ4
+	LZ4F_cctx* m_lz4;
+	LZ4F_preferences_t m_lz4_prefs;
+#endif
+};
+
+struct scap_compress_ctx
+{
+	compression_mode m_compress;
+#ifdef HAS_ZSTD
+	ZSTD_CCtx* m_zstd;
+#endif
+};
+
+struct scap_decompressor
+{
+	compression_mode m_compress;
+	bool m_in_frame; ///< A frame has been started and not finished yet
+#if defined(USE_ZLIB) && !defined(UDIG)
+	z_stream m_gzip;
+	bool m_gzip_init;
+#endif
+#ifdef HAS_ZSTD
+	ZSTD_DCtx* m_zstd;
+#endif
+#ifdef HAS_LZ4
+	LZ4F_dctx* m_lz4;
+#endif
+};
+
+bool scap_compression_supported(compression_mode compress)
+{
+	switch(compress)
+	{
+	case SCAP_COMPRESSION_NONE:
+		return true;
+	case SCAP_COMPRESSION_GZIP:
+#if defined(USE_ZLIB) && !defined(UDIG)
+		return true;
+#else
+		return false;
+#endif
+	case SCAP_COMPRESSION_LZ4:
+#ifdef HAS_LZ4
+		return true;
+#else
+		return false;
+#endif
+	case SCAP_COMPRESSION_ZSTD:
+#ifdef HAS_ZSTD
+		return true;
+#else
+		return false;
+#endif
+	default:
+		return false;
+	}
+}
+
+const char* scap_compression_name(compression_mode compress)
+{
+	switch(compress)
+	{
+	case SCAP_COMPRESSION_NONE:
+		return "none";
+	case SCAP_COMPRESSION_GZIP:
+		return "gzip";
+	case SCAP_COMPRESSION_LZ4:
+		return "lz4";
+	case SCAP_COMPRESSION_ZSTD:
+		return "zstd";
+	default:
+		return "unknown";
+	}
+}
+
+compression_mode scap_compression_from_magic(const uint8_t* magic, size_t len)
+{
+	if(len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+	{
+		return SCAP_COMPRESSION_GZIP;
+	}
+
+	if(len >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+	{
+		return SCAP_COMPRESSION_ZSTD;
+	}
+
+	if(len >= 4 && magic[0] == 0x04 && magic[1] == 0x22 && magic[2] == 0x4d && magic[3] == 0x18)
+	{
+		return SCAP_COMPRESSION_LZ4;
+	}
+
+	return SCAP_COMPRESSION_NONE;
+}
+
+uint64_t scap_compress_bound(compression_mode compress, uint64_t srclen)
+{
+	switch(compress)
+	{
+#if defined(USE_ZLIB) && !defined(UDIG)
+	case SCAP_COMPRESSION_GZIP:
+		return compressBound(srclen);
+#endif
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+		return ZSTD_compressBound(srclen);
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+		return srclen > LZ4_MAX_INPUT_SIZE ? 0 : LZ4_compressBound((int)srclen);
+#endif
+	default:
+		return srclen;
+	}
+}
+
+scap_compress_ctx* scap_compress_ctx_open(compression_mode compress, char* error)
+{
+	if(!scap_compression_supported(compress))
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(compress));
+		return NULL;
+	}
+
+	scap_compress_ctx* ctx = (scap_compress_ctx*)calloc(1, sizeof(scap_compress_ctx));
+	if(ctx == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "compression context allocation failed");
+		return NULL;
+	}
+
+	ctx->m_compress = compress;
+#ifdef HAS_ZSTD
+	if(compress == SCAP_COMPRESSION_ZSTD)
+	{
+		ctx->m_zstd = ZSTD_createCCtx();
+		if(ctx->m_zstd == NULL)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "error creating the zstd compression context");
+			free(ctx);
+			return NULL;
+		}
+	}
+#endif
+
+	return ctx;
+}
+
+void scap_compress_ctx_close(scap_compress_ctx* ctx)
+{
+	if(ctx == NULL)
+	{
+		return;
+	}
+#ifdef HAS_ZSTD
+	ZSTD_freeCCtx(ctx->m_zstd);
+#endif
+	free(ctx);
+}
+
+int32_t scap_compress_buffer(scap_compress_ctx* ctx, uint8_t* dst, uint64_t* dstlen, const uint8_t* src, uint64_t srclen, char* error)
+{
+	switch(ctx->m_compress)
+	{
+	case SCAP_COMPRESSION_NONE:
+		if(srclen > *dstlen)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "compression buffer too small");
+			return SCAP_INPUT_TOO_SMALL;
+		}
+		memcpy(dst, src, srclen);
+		*dstlen = srclen;
+		return SCAP_SUCCESS;
+#if defined(USE_ZLIB) && !defined(UDIG)
+	case SCAP_COMPRESSION_GZIP:
+	{
+		uLongf dl = (uLongf)*dstlen;
+		int res = compress2(dst, &dl, src, srclen, Z_DEFAULT_COMPRESSION);
+		if(res != Z_OK)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "gzip compression error %d", res);
+			return SCAP_FAILURE;
+		}
+		*dstlen = dl;
+		return SCAP_SUCCESS;
+	}
+#endif
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+	{
+		size_t res = ZSTD_compressCCtx(ctx->m_zstd, dst, *dstlen, src, srclen, ZSTD_CLEVEL_DEFAULT);
+		if(ZSTD_isError(res))
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "zstd compression error: %s", ZSTD_getErrorName(res));
+			return SCAP_FAILURE;
+		}
+		*dstlen = res;
+		return SCAP_SUCCESS;
+	}
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+	{
+		if(srclen > LZ4_MAX_INPUT_SIZE)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "lz4 input too big (%llu bytes)", (unsigned long long)srclen);
+			return SCAP_FAILURE;
+		}
+		int cap = *dstlen > INT32_MAX ? INT32_MAX : (int)*dstlen;
+		int res = LZ4_compress_default((const char*)src, (char*)dst, (int)srclen, cap);
+		if(res <= 0)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "lz4 compression error");
+			return SCAP_FAILURE;
+		}
+		*dstlen = (uint64_t)res;
+		return SCAP_SUCCESS;
+	}
+#endif
+	default:
+		snprintf(error, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(ctx->m_compress));
+		return SCAP_NOT_SUPPORTED;
+	}
+}
+
+int32_t scap_decompress_buffer(compression_mode compress, uint8_t* dst, uint64_t dstlen, const uint8_t* src, uint64_t srclen, char* error)
+{
+	switch(compress)
+	{
+	case SCAP_COMPRESSION_NONE:
+		if(srclen != dstlen)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "uncompressed length mismatch: %llu, expected %llu",
+				 (unsigned long long)srclen, (unsigned long long)dstlen);
+			return SCAP_FAILURE;
+		}
+		memcpy(dst, src, srclen);
+		return SCAP_SUCCESS;
+#if defined(USE_ZLIB) && !defined(UDIG)
+	case SCAP_COMPRESSION_GZIP:
+	{
+		uLongf dl = (uLongf)dstlen;
+		int res = uncompress(dst, &dl, src, srclen);
+		if(res != Z_OK || dl != dstlen)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "gzip decompression error %d", res);
+			return SCAP_FAILURE;
+		}
+		return SCAP_SUCCESS;
+	}
+#endif
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+	{
+		size_t res = ZSTD_decompress(dst, dstlen, src, srclen);
+		if(ZSTD_isError(res))
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "zstd decompression error: %s", ZSTD_getErrorName(res));
+			return SCAP_FAILURE;
+		}
+		if(res != dstlen)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "zstd decompressed length mismatch: %llu, expected %llu",
+				 (unsigned long long)res, (unsigned long long)dstlen);
+			return SCAP_FAILURE;
+		}
+		return SCAP_SUCCESS;
+	}
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+	{
+		if(srclen > INT32_MAX || dstlen > INT32_MAX)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "lz4 block too big");
+			return SCAP_FAILURE;
+		}
+		int res = LZ4_decompress_safe((const char*)src, (char*)dst, (int)srclen, (int)dstlen);
+		if(res < 0 || (uint64_t)res != dstlen)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "lz4 decompression error %d", res);
+			return SCAP_FAILURE;
+		}
+		return SCAP_SUCCESS;
+	}
+#endif
+	default:
+		snprintf(error, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(compress));
+		return SCAP_NOT_SUPPORTED;
+	}
+}
+
+//
+// Write the compressed output accumulated in m_out
+//
+static inline int compressor_emit(scap_compressor* c, size_t len)
+{
+	if(len == 0)
+	{
+		return 0;
+	}
+	return gzwrite(c->m_f, c->m_out, len) == (int)len ? 0 : -1;
+}
+
+static void compressor_free(scap_compressor* c)
+{
+#ifdef HAS_ZSTD
+	if(c->m_zstd != NULL)
+	{
+		ZSTD_freeCCtx(c->m_zstd);
+	}
+#endif
+#ifdef HAS_LZ4
+	if(c->m_lz4 != NULL)
+	{
+		LZ4F_freeCompressionContext(c->m_lz4);
+	}
+#endif
+	free(c->m_in);
+	free(c->m_out);
+	free(c);
+}
+
+scap_compressor* scap_compressor_open(compression_mode compress, gzFile f, char* error)
+{
+	scap_compressor* c = (scap_compressor*)calloc(1, sizeof(scap_compressor));
+	if(c == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "compressor allocation failed");
+		return NULL;
+	}
+
+	c->m_compress = compress;
+	c->m_f = f;
+
+	switch(compress)
+	{
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+		c->m_zstd = ZSTD_createCCtx();
+		c->m_out_size = ZSTD_CStreamOutSize();
+		if(c->m_zstd == NULL ||
+		   ZSTD_isError(ZSTD_CCtx_setParameter(c->m_zstd, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT)))
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "error creating the zstd compression context");
+			compressor_free(c);
+			return NULL;
+		}
+		break;
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+	{
+		memset(&c->m_lz4_prefs, 0, sizeof(c->m_lz4_prefs));
+		c->m_lz4_prefs.frameInfo.blockMode = LZ4F_blockLinked;
+		c->m_out_size = LZ4F_compressBound(COMPRESS_BLOCK_SIZE, &c->m_lz4_prefs);
+		if(LZ4F_isError(LZ4F_createCompressionContext(&c->m_lz4, LZ4F_VERSION)))
+		{
+			c->m_lz4 = NULL;
+			snprintf(error, SCAP_LASTERR_SIZE, "error creating the lz4 compression context");
+			compressor_free(c);
+			return NULL;
+		}
+		break;
+	}
+#endif
+	default:
+		snprintf(error, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(compress));
+		compressor_free(c);
+		return NULL;
+	}
+
+	c->m_in = (uint8_t*)malloc(COMPRESS_BLOCK_SIZE);
+	c->m_out = (uint8_t*)malloc(c->m_out_size);
+	if(c->m_in == NULL || c->m_out == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "compressor buffer allocation failed");
+		compressor_free(c);
+		return NULL;
+	}
+
+#ifdef HAS_LZ4
+	if(compress == SCAP_COMPRESSION_LZ4)
+	{
+		size_t res = LZ4F_compressBegin(c->m_lz4, c->m_out, c->m_out_size, &c->m_lz4_prefs);
+		if(LZ4F_isError(res) || compressor_emit(c, res) != 0)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "error starting the lz4 frame");
+			compressor_free(c);
+			return NULL;
+		}
+	}
+#endif
+
+	return c;
+}
+
+#ifdef HAS_ZSTD
+static int zstd_stream(scap_compressor* c, const void* buf, size_t len, ZSTD_EndDirective mode)
+{
+	ZSTD_inBuffer in = {buf, len, 0};
+	size_t remaining;
+
+	do
+	{
+		ZSTD_outBuffer out = {c->m_out, c->m_out_size, 0};
+		remaining = ZSTD_compressStream2(c->m_zstd, &out, &in, mode);
+		if(ZSTD_isError(remaining) || compressor_emit(c, out.pos) != 0)
+		{
+			return -1;
+		}
+	} while(mode == ZSTD_e_continue ? in.pos < in.size : remaining != 0);
+
+	return 0;
+}
+#endif
+
+//
+// Compress the gathered writes
+//
+static int compressor_drain(scap_compressor* c)
+{
+	int res = -1;
+
+	if(c->m_in_len == 0)
+	{
+		return 0;
+	}
+
+	switch(c->m_compress)
+	{
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+		res = zstd_stream(c, c->m_in, c->m_in_len, ZSTD_e_continue);
+		break;
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+	{
+		size_t n = LZ4F_compressUpdate(c->m_lz4, c->m_out, c->m_out_size, c->m_in, c->m_in_len, NULL);
+		res = (!LZ4F_isError(n) && compressor_emit(c, n) == 0) ? 0 : -1;
+		break;
+	}
+#endif
+	default:
+		break;
+	}
+
+	c->m_in_len = 0;
+	return res;
+}
+
+int scap_compressor_write(scap_compressor* c, const void* buf, unsigned len)
+{
+	const uint8_t* p = (const uint8_t*)buf;
+	unsigned left = len;
+
+	while(left > 0)
+	{
+		size_t n = COMPRESS_BLOCK_SIZE - c->m_in_len;
+		if(n > left)
+		{
+			n = left;
+		}
+		memcpy(c->m_in + c->m_in_len, p, n);
+		c->m_in_len += n;
+		p += n;
+		left -= (unsigned)n;
+
+		if(c->m_in_len == COMPRESS_BLOCK_SIZE && compressor_drain(c) != 0)
+		{
+			return -1;
+		}
+	}
+
+	c->m_written += len;
+	return (int)len;
+}
+
+int64_t scap_compressor_tell(scap_compressor* c)
+{
+	return c->m_written;
+}
+
+int32_t scap_compressor_flush(scap_compressor* c)
+{
+	if(compressor_drain(c) != 0)
+	{
+		return SCAP_FAILURE;
+	}
+
+	switch(c->m_compress)
+	{
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+		if(zstd_stream(c, NULL, 0, ZSTD_e_flush) != 0)
+		{
+			return SCAP_FAILURE;
+		}
+		break;
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+	{
+		size_t res = LZ4F_flush(c->m_lz4, c->m_out, c->m_out_size, NULL);
+		if(LZ4F_isError(res) || compressor_emit(c, res) != 0)
+		{
+			return SCAP_FAILURE;
+		}
+		break;
+	}
+#endif
+	default:
+		return SCAP_FAILURE;
+	}
+
+	gzflush(c->m_f, Z_FULL_FLUSH);
+	return SCAP_SUCCESS;
+}
+
+int32_t scap_compressor_close(scap_compressor* c)
+{
+	int32_t res = SCAP_FAILURE;
+
+	if(compressor_drain(c) != 0)
+	{
+		compressor_free(c);
+		return SCAP_FAILURE;
+	}
+
+	switch(c->m_compress)
+	{
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+		res = zstd_stream(c, NULL, 0, ZSTD_e_end) == 0 ? SCAP_SUCCESS : SCAP_FAILURE;
+		break;
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+	{
+		size_t n = LZ4F_compressEnd(c->m_lz4, c->m_out, c->m_out_size, NULL);
+		res = (!LZ4F_isError(n) && compressor_emit(c, n) == 0) ? SCAP_SUCCESS : SCAP_FAILURE;
+		break;
+	}
+#endif
+	default:
+		break;
+	}
+
+	compressor_free(c);
+	return res;
+}
+
+static void decompressor_free_ctx(scap_decompressor* d)
+{
+#if defined(USE_ZLIB) && !defined(UDIG)
+	if(d->m_gzip_init)
+	{
+		inflateEnd(&d->m_gzip);
+		d->m_gzip_init = false;
+	}
+#endif
+#ifdef HAS_ZSTD
+	if(d->m_zstd != NULL)
+	{
+		ZSTD_freeDCtx(d->m_zstd);
+		d->m_zstd = NULL;
+	}
+#endif
+#ifdef HAS_LZ4
+	if(d->m_lz4 != NULL)
+	{
+		LZ4F_freeDecompressionContext(d->m_lz4);
+		d->m_lz4 = NULL;
+	}
+#endif
+}
+
+static int32_t decompressor_init_ctx(scap_decompressor* d, char* error)
+{
+	switch(d->m_compress)
+	{
+	case SCAP_COMPRESSION_NONE:
+		return SCAP_SUCCESS;
+#if defined(USE_ZLIB) && !defined(UDIG)
+	case SCAP_COMPRESSION_GZIP:
+		memset(&d->m_gzip, 0, sizeof(d->m_gzip));
+		// 32 detects the gzip header, like gzread does
+		if(inflateInit2(&d->m_gzip, 15 + 32) != Z_OK)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "error creating the gzip decompression context");
+			return SCAP_FAILURE;
+		}
+		d->m_gzip_init = true;
+		return SCAP_SUCCESS;
+#endif
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+		d->m_zstd = ZSTD_createDCtx();
+		if(d->m_zstd == NULL)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "error creating the zstd decompression context");
+			return SCAP_FAILURE;
+		}
+		return SCAP_SUCCESS;
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+		if(LZ4F_isError(LZ4F_createDecompressionContext(&d->m_lz4, LZ4F_VERSION)))
+		{
+			d->m_lz4 = NULL;
+			snprintf(error, SCAP_LASTERR_SIZE, "error creating the lz4 decompression context");
+			return SCAP_FAILURE;
+		}
+		return SCAP_SUCCESS;
+#endif
+	default:
+		snprintf(error, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(d->m_compress));
+		return SCAP_NOT_SUPPORTED;
+	}
+}
+
+scap_decompressor* scap_decompressor_open(compression_mode compress, char* error)
+{
+	scap_decompressor* d = (scap_decompressor*)calloc(1, sizeof(scap_decompressor));
+	if(d == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "decompressor allocation failed");
+		return NULL;
+	}
+
+	d->m_compress = compress;
+	if(decompressor_init_ctx(d, error) != SCAP_SUCCESS)
+	{
+		scap_decompressor_close(d);
+		return NULL;
+	}
+
+	return d;
+}
+
+int32_t scap_decompressor_run(scap_decompressor* d, uint8_t* dst, size_t* dstlen, const uint8_t* src, size_t* srclen, char* error)
+{
+	switch(d->m_compress)
+	{
+	case SCAP_COMPRESSION_NONE:
+		if(*srclen < *dstlen)
+		{
+			*dstlen = *srclen;
+		}
+		memcpy(dst, src, *dstlen);
+		*srclen = *dstlen;
+		return SCAP_SUCCESS;
+#if defined(USE_ZLIB) && !defined(UDIG)
+	case SCAP_COMPRESSION_GZIP:
+	{
+		d->m_gzip.next_in = (Bytef*)src;
+		d->m_gzip.avail_in = (uInt)*srclen;
+		d->m_gzip.next_out = dst;
+		d->m_gzip.avail_out = (uInt)*dstlen;
+		int res = inflate(&d->m_gzip, Z_NO_FLUSH);
+		if(res != Z_OK && res != Z_STREAM_END && res != Z_BUF_ERROR)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "gzip decompression error: %s", d->m_gzip.msg ? d->m_gzip.msg : "unknown error");
+			return SCAP_FAILURE;
+		}
+		*srclen -= d->m_gzip.avail_in;
+		*dstlen -= d->m_gzip.avail_out;
+
+		// Concatenated members are decompressed one after the other
+		if(res == Z_STREAM_END)
+		{
+			inflateReset(&d->m_gzip);
+			d->m_in_frame = false;
+		}
+		else if(*srclen > 0 || *dstlen > 0)
+		{
+			d->m_in_frame = true;
+		}
+		return SCAP_SUCCESS;
+	}
+#endif
+#ifdef HAS_ZSTD
+	case SCAP_COMPRESSION_ZSTD:
+	{
+		// Concatenated frames, like the ones of appended captures,
+		// are decompressed one after the other
+		ZSTD_inBuffer in = {src, *srclen, 0};
+		ZSTD_outBuffer out = {dst, *dstlen, 0};
+		size_t res = ZSTD_decompressStream(d->m_zstd, &out, &in);
+		if(ZSTD_isError(res))
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "zstd decompression error: %s", ZSTD_getErrorName(res));
+			return SCAP_FAILURE;
+		}
+		*srclen = in.pos;
+		*dstlen = out.pos;
+
+		// 0 means that a frame has just been completed
+		if(in.pos > 0 || out.pos > 0)
+		{
+			d->m_in_frame = res != 0;
+		}
+		return SCAP_SUCCESS;
+	}
+#endif
+#ifdef HAS_LZ4
+	case SCAP_COMPRESSION_LZ4:
+	{
+		size_t res = LZ4F_decompress(d->m_lz4, dst, dstlen, src, srclen, NULL);
+		if(LZ4F_isError(res))
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "lz4 decompression error: %s", LZ4F_getErrorName(res));
+			return SCAP_FAILURE;
+		}
+
+		// 0 means that a frame has just been completed
+		if(*srclen > 0 || *dstlen > 0)
+		{
+			d->m_in_frame = res != 0;
+		}
+		return SCAP_SUCCESS;
+	}
+#endif
+	default:
+		snprintf(error, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(d->m_compress));
+		return SCAP_NOT_SUPPORTED;
+	}
+}
+
+bool scap_decompressor_in_frame(scap_decompressor* d)
+{
+	return d->m_in_frame;
+}
+
+int32_t scap_decompressor_reset(scap_decompressor* d, char* error)
+{
+	d->m_in_frame = false;
+	decompressor_free_ctx(d);
+	return decompressor_init_ctx(d, error);
+}
+
+void scap_decompressor_close(scap_decompressor* d)
+{
+	decompressor_free_ctx(d);
+	free(d);
+}
@@ -0,0 +1,85 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+//
+// Compression codecs for trace files, besides the gzip streams handled
+// through gzFile. Each function fails with SCAP_NOT_SUPPORTED when the
+// requested compression has not been built in.
+//
+
+#include <stdint.h>
+#include <stddef.h>
+#include "scap.h"
+#include "scap_zlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+  \brief Detect the compression of a trace file from its first bytes.
+  Returns SCAP_COMPRESSION_NONE if no known magic number is found.
+*/
+compression_mode scap_compression_from_magic(const uint8_t* magic, size_t len);
+
+const char* scap_compression_name(compression_mode compress);
+
+//
+// One-shot compression of a buffer, used for the event chunks. The
+// context is kept across the buffers, since setting up a zstd one for
+// each of them costs more than compressing a small chunk.
+//
+typedef struct scap_compress_ctx scap_compress_ctx;
+
+scap_compress_ctx* scap_compress_ctx_open(compression_mode compress, char* error);
+void scap_compress_ctx_close(scap_compress_ctx* ctx);
+uint64_t scap_compress_bound(compression_mode compress, uint64_t srclen);
+int32_t scap_compress_buffer(scap_compress_ctx* ctx, uint8_t* dst, uint64_t* dstlen, const uint8_t* src, uint64_t srclen, char* error);
+int32_t scap_decompress_buffer(compression_mode compress, uint8_t* dst, uint64_t dstlen, const uint8_t* src, uint64_t srclen, char* error);
+
+//
+// Streaming compression of a dump file. The compressed data is written
+// to f, which must have been opened without gzip compression.
+//
+typedef struct scap_compressor scap_compressor;
+
+scap_compressor* scap_compressor_open(compression_mode compress, gzFile f, char* error);
+int scap_compressor_write(scap_compressor* c, const void* buf, unsigned len);
+int64_t scap_compressor_tell(scap_compressor* c); ///< The uncompressed bytes written so far
+int32_t scap_compressor_flush(scap_compressor* c);
+int32_t scap_compressor_close(scap_compressor* c); ///< Ends the stream and frees c, without closing f
+
+//
+// Streaming decompression. scap_decompressor_run decompresses at most
+// *srclen bytes of src into at most *dstlen bytes of dst, and returns
+// in *srclen and *dstlen the number of bytes consumed and produced.
+// Besides lz4 and zstd, gzip and uncompressed streams are supported
+// too, for the files that can only be read once.
+//
+typedef struct scap_decompressor scap_decompressor;
+
+scap_decompressor* scap_decompressor_open(compression_mode compress, char* error);
+int32_t scap_decompressor_run(scap_decompressor* d, uint8_t* dst, size_t* dstlen, const uint8_t* src, size_t* srclen, char* error);
+bool scap_decompressor_in_frame(scap_decompressor* d); ///< True if the data so far ends in the middle of a frame
+int32_t scap_decompressor_reset(scap_decompressor* d, char* error);
+void scap_decompressor_close(scap_decompressor* d);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,373 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scap.h"
+#include "scap-int.h"
+#include "scap_dump_async.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+
+//
+// The buffers form a ring. The caller fills m_buffers[m_cur], while the
+// writer writes the m_queued buffers starting from m_tail. One buffer is
+// always left to the caller, so at most m_nbuffers - 1 are queued.
+//
+struct scap_dump_async
+{
+	scap_dumper_t* m_dumper;
+	uint32_t m_buffer_size;
+	uint32_t m_nbuffers;
+	uint8_t** m_buffers;
+	uint32_t* m_lens;
+
+	// Only accessed by the caller
+	uint32_t m_cur;
+	int64_t m_ftell_base; ///< The uncompressed position when the writer started
+	uint64_t m_accepted; ///< The bytes accepted since then
+	uint64_t m_drops;
+
+	// Protected by m_mutex
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_work_cond; ///< Signaled when a buffer is queued or on stop
+	pthread_cond_t m_free_cond; ///< Signaled when a buffer has been written
+	uint32_t m_tail;
+	uint32_t m_queued;
+	uint64_t m_pending; ///< The bytes in the queued buffers
+	int64_t m_offset; ///< The file size after the last written buffer
+	bool m_failed;
+	bool m_stop;
+
+	pthread_t m_thread;
+};
+
+static void* writer_thread(void* arg)
+{
+	struct scap_dump_async* a = (struct scap_dump_async*)arg;
+
+	pthread_mutex_lock(&a->m_mutex);
+	while(true)
+	{
+		while(a->m_queued == 0 && !a->m_stop)
+		{
+			pthread_cond_wait(&a->m_work_cond, &a->m_mutex);
+		}
+
+		if(a->m_queued == 0)
+		{
+			break;
+		}
+
+		uint32_t idx = a->m_tail;
+		uint32_t len = a->m_lens[idx];
+		bool failed = a->m_failed;
+		pthread_mutex_unlock(&a->m_mutex);
+
+		// After a failure the data is discarded, the file is broken anyway
+		if(!failed && scap_dump_file_write(a->m_dumper, a->m_buffers[idx], len) != (int)len)
+		{
+			failed = true;
+		}
+		int64_t offset = gzoffset(a->m_dumper->m_f);
+
+		pthread_mutex_lock(&a->m_mutex);
+		a->m_failed = failed;
+		a->m_offset = offset;
+		a->m_pending -= len;
+		a->m_tail = (a->m_tail + 1) % a->m_nbuffers;
+		a->m_queued--;
+		pthread_cond_broadcast(&a->m_free_cond);
+	}
+	pthread_mutex_unlock(&a->m_mutex);
+
+	return NULL;
+}
+
+static void free_async(struct scap_dump_async* a)
+{
+	uint32_t j;
+
+	if(a->m_buffers != NULL)
+	{
+		for(j = 0; j < a->m_nbuffers; j++)
+		{
+			free(a->m_buffers[j]);
+		}
+	}
+	free(a->m_buffers);
+	free(a->m_lens);
+	free(a);
+}
+
+struct scap_dump_async* scap_dump_async_start(scap_dumper_t* d, uint32_t buffer_size, uint32_t nbuffers, char* error)
+{
+	uint32_t j;
+
+	struct scap_dump_async* a = (struct scap_dump_async*)calloc(1, sizeof(struct scap_dump_async));
+	if(a == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "async dumper allocation failed");
+		return NULL;
+	}
+
+	a->m_dumper = d;
+	a->m_buffer_size = buffer_size ? buffer_size : SCAP_DUMP_ASYNC_DEFAULT_BUFFER_SIZE;
+	a->m_nbuffers = nbuffers >= 2 ? nbuffers : SCAP_DUMP_ASYNC_DEFAULT_NBUFFERS;
+	a->m_buffers = (uint8_t**)calloc(a->m_nbuffers, sizeof(uint8_t*));
+	a->m_lens = (uint32_t*)calloc(a->m_nbuffers, sizeof(uint32_t));
+	if(a->m_buffers == NULL || a->m_lens == NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "async dumper allocation failed");
+		free_async(a);
+		return NULL;
+	}
+
+	// All the memory is allocated upfront, it's the bound of the queue
+	for(j = 0; j < a->m_nbuffers; j++)
+	{
+		a->m_buffers[j] = (uint8_t*)malloc(a->m_buffer_size);
+		if(a->m_buffers[j] == NULL)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "error allocating %u async dump buffers of %u bytes",
+				 a->m_nbuffers, a->m_buffer_size);
+			free_async(a);
+			return NULL;
+		}
+	}
+
+	a->m_ftell_base = scap_dump_ftell(d);
+	a->m_offset = gzoffset(d->m_f);
+
+	pthread_mutex_init(&a->m_mutex, NULL);
+	pthread_cond_init(&a->m_work_cond, NULL);
+	pthread_cond_init(&a->m_free_cond, NULL);
+
+	if(pthread_create(&a->m_thread, NULL, writer_thread, a) != 0)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "error creating the dump writer thread");
+		pthread_cond_destroy(&a->m_free_cond);
+		pthread_cond_destroy(&a->m_work_cond);
+		pthread_mutex_destroy(&a->m_mutex);
+		free_async(a);
+		return NULL;
+	}
+
+	return a;
+}
+
+//
+// Hand the current buffer to the writer and move to the next one. If none
+// is free, either wait for the writer or give up.
+//
+static bool submit(struct scap_dump_async* a, bool wait)
+{
+	pthread_mutex_lock(&a->m_mutex);
+	while(a->m_queued == a->m_nbuffers - 1 && !a->m_failed)
+	{
+		if(!wait)
+		{
+			pthread_mutex_unlock(&a->m_mutex);
+			return false;
+		}
+		pthread_cond_wait(&a->m_free_cond, &a->m_mutex);
+	}
+
+	if(a->m_failed)
+	{
+		pthread_mutex_unlock(&a->m_mutex);
+		return false;
+	}
+
+	a->m_queued++;
+	a->m_pending += a->m_lens[a->m_cur];
+	pthread_cond_signal(&a->m_work_cond);
+	pthread_mutex_unlock(&a->m_mutex);
+
+	a->m_cur = (a->m_cur + 1) % a->m_nbuffers;
+	a->m_lens[a->m_cur] = 0;
+	return true;
+}
+
+bool scap_dump_async_reserve(struct scap_dump_async* a, uint32_t len)
+{
+	// Bigger than a buffer, it can only be written blocking
+	if(len > a->m_buffer_size || a->m_buffer_size - a->m_lens[a->m_cur] >= len)
+	{
+		return true;
+	}
+
+	if(!submit(a, false))
+	{
+		a->m_drops++;
+		return false;
+	}
+
+	return true;
+}
+
+bool scap_dump_async_failed(struct scap_dump_async* a)
+{
+	bool res;
+
+	pthread_mutex_lock(&a->m_mutex);
+	res = a->m_failed;
+	pthread_mutex_unlock(&a->m_mutex);
+
+	return res;
+}
+
+int scap_dump_async_write(struct scap_dump_async* a, const void* buf, unsigned len)
+{
+	const uint8_t* p = (const uint8_t*)buf;
+	unsigned left = len;
+
+	while(left > 0)
+	{
+		// The full buffers are submitted only when more room is needed,
+		// so that the writes of a reserved event never wait
+		if(a->m_lens[a->m_cur] == a->m_buffer_size && !submit(a, true))
+		{
+			return -1;
+		}
+
+		uint32_t n = a->m_buffer_size - a->m_lens[a->m_cur];
+		if(n > left)
+		{
+			n = left;
+		}
+		memcpy(a->m_buffers[a->m_cur] + a->m_lens[a->m_cur], p, n);
+		a->m_lens[a->m_cur] += n;
+		p += n;
+		left -= n;
+	}
+
+	a->m_accepted += len;
+	return (int)len;
+}
+
+int32_t scap_dump_async_flush(struct scap_dump_async* a)
+{
+	bool failed;
+
+	if(a->m_lens[a->m_cur] > 0)
+	{
+		submit(a, true);
+	}
+
+	pthread_mutex_lock(&a->m_mutex);
+	while(a->m_queued > 0)
+	{
+		pthread_cond_wait(&a->m_free_cond, &a->m_mutex);
+	}
+	failed = a->m_failed;
+	pthread_mutex_unlock(&a->m_mutex);
+
+	return failed ? SCAP_FAILURE : SCAP_SUCCESS;
+}
+
+int32_t scap_dump_async_stop(struct scap_dump_async* a)
+{
+	int32_t res = scap_dump_async_flush(a);
+
+	pthread_mutex_lock(&a->m_mutex);
+	a->m_stop = true;
+	pthread_cond_signal(&a->m_work_cond);
+	pthread_mutex_unlock(&a->m_mutex);
+
+	pthread_join(a->m_thread, NULL);
+	pthread_cond_destroy(&a->m_free_cond);
+	pthread_cond_destroy(&a->m_work_cond);
+	pthread_mutex_destroy(&a->m_mutex);
+	free_async(a);
+	return res;
+}
+
+int64_t scap_dump_async_ftell(struct scap_dump_async* a)
+{
+	return a->m_ftell_base + (int64_t)a->m_accepted;
+}
+
+int64_t scap_dump_async_get_offset(struct scap_dump_async* a)
+{
+	int64_t res;
+
+	// The data not written yet is counted uncompressed
+	pthread_mutex_lock(&a->m_mutex);
+	res = a->m_offset + (int64_t)a->m_pending;
+	pthread_mutex_unlock(&a->m_mutex);
+
+	return res + a->m_lens[a->m_cur];
+}
+
+uint64_t scap_dump_async_get_drops(struct scap_dump_async* a)
+{
+	return a->m_drops;
+}
+
+#else // _WIN32
+
+struct scap_dump_async* scap_dump_async_start(scap_dumper_t* d, uint32_t buffer_size, uint32_t nbuffers, char* error)
+{
+	snprintf(error, SCAP_LASTERR_SIZE, "async dumps are not supported on this platform");
+	return NULL;
+}
+
+bool scap_dump_async_reserve(struct scap_dump_async* a, uint32_t len)
+{
+	return false;
+}
+
+bool scap_dump_async_failed(struct scap_dump_async* a)
+{
+	return true;
+}
+
+int scap_dump_async_write(struct scap_dump_async* a, const void* buf, unsigned len)
+{
+	return -1;
+}
+
+int32_t scap_dump_async_flush(struct scap_dump_async* a)
+{
+	return SCAP_FAILURE;
+}
+
+int32_t scap_dump_async_stop(struct scap_dump_async* a)
+{
+	return SCAP_FAILURE;
+}
+
+int64_t scap_dump_async_ftell(struct scap_dump_async* a)
+{
+	return -1;
+}
+
+int64_t scap_dump_async_get_offset(struct scap_dump_async* a)
+{
+	return -1;
+}
+
+uint64_t scap_dump_async_get_drops(struct scap_dump_async* a)
+{
+	return 0;
+}
+
+#endif // _WIN32
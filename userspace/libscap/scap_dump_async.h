@@ -0,0 +1,68 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+//
+// Background writer of the dumpers set with scap_dump_set_async().
+//
+// The data is copied into a ring of preallocated buffers. Each full buffer
+// is handed to a writer thread, which compresses it (through the gzFile or
+// the scap_compressor of the dumper) and writes it to the file, while the
+// caller keeps filling the next one.
+//
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "scap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCAP_DUMP_ASYNC_DEFAULT_BUFFER_SIZE (8 * 1024 * 1024)
+#define SCAP_DUMP_ASYNC_DEFAULT_NBUFFERS 2
+
+struct scap_dump_async;
+
+struct scap_dump_async* scap_dump_async_start(scap_dumper_t* d, uint32_t buffer_size, uint32_t nbuffers, char* error);
+
+// Make room for len bytes that must not block, like the ones of an event.
+// Returns false, and counts a drop, if all the buffers are waiting for the
+// writer or the writer failed.
+bool scap_dump_async_reserve(struct scap_dump_async* a, uint32_t len);
+
+// Return true if the writer failed to write to the file
+bool scap_dump_async_failed(struct scap_dump_async* a);
+
+// Copy data to the buffers, waiting for the writer if they're all full.
+// Returns -1 if the writer failed.
+int scap_dump_async_write(struct scap_dump_async* a, const void* buf, unsigned len);
+
+// Wait until all the data has been written to the file
+int32_t scap_dump_async_flush(struct scap_dump_async* a);
+
+// Flush, stop the writer and free a
+int32_t scap_dump_async_stop(struct scap_dump_async* a);
+
+int64_t scap_dump_async_ftell(struct scap_dump_async* a);
+int64_t scap_dump_async_get_offset(struct scap_dump_async* a);
+uint64_t scap_dump_async_get_drops(struct scap_dump_async* a);
+
+#ifdef __cplusplus
+}
+#endif
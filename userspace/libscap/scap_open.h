@@ -69,6 +69,29 @@ typedef enum {
 #endif
 } scap_mode_t;
 
+/*!
+  \brief How a live capture waits for new events when all the buffers are empty
+*/
+typedef enum {
+	/*!
+	 * Sleep, doubling the sleep time up to a maximum while the buffers stay
+	 * empty. This is the default.
+	 */
+	SCAP_WAIT_SLEEP = 0,
+	/*!
+	 * Block until the driver signals that new events are available, up to
+	 * the same maximum time: poll() on the devices for the kernel module and
+	 * the bpf probe, epoll on the ring buffers for the modern bpf probe.
+	 * The kernel module and the bpf probe signal it once a buffer holds
+	 * more than the bytes the sleep mode considers empty, the modern bpf
+	 * probe when events land in empty buffers. This gives lower latency on
+	 * bursty workloads and no wakeups at all on idle systems, at the price
+	 * of a wakeup notification from the driver. Engines that can't be
+	 * notified keep sleeping.
+	 */
+	SCAP_WAIT_POLL,
+} scap_wait_mode_t;
+
 /*!
   \brief Argument for scap_open
   Set any PPM_SC syscall idx to true to enable its tracing at driver level,
@@ -84,6 +107,8 @@ typedef struct scap_open_args
 	int fd; // If non-zero, will be used instead of fname.
 	const char* fname; ///< The name of the file to open. NULL for live captures.
 	uint32_t fbuffer_size; ///< If non-zero, offline captures will read from file using a buffer of this size.
+	uint32_t chunk_threads; ///< Number of threads decompressing ahead the chunks of captures written with scap_dump_open_chunked. If zero, they're decompressed by the thread reading the events.
+	bool savefile_eventmask; ///< If true, offline captures only return the event types set with scap_set_eventmask(), and skip the chunks without any. Otherwise, setting the event mask fails on them and all the events are returned.
 	proc_entry_callback proc_callback; ///< Callback to be invoked for each thread/fd that is extracted from /proc, or NULL if no callback is needed.
 	void* proc_callback_context; ///< Opaque pointer that will be included in the calls to proc_callback. Ignored if proc_callback is NULL.
 	bool import_users; ///< true if the user list should be created when opening the capture.
@@ -104,6 +129,8 @@ typedef struct scap_open_args
 	char* input_plugin_params; ///< optional parameters string for the source plugin pointed by src_plugin
 
 	scap_test_input_data* test_input_data; ///< only used for testing scap consumers by supplying arbitrary test data
+
+	scap_wait_mode_t wait_mode; ///< How live captures wait for new events when the buffers are empty
 }scap_open_args;
 
 #ifdef __cplusplus
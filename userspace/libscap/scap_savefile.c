@@ -32,6 +32,8 @@ struct iovec {
 #include "scap.h"
 #include "scap-int.h"
 #include "scap_savefile.h"
+#include "scap_compress.h"
+#include "scap_dump_async.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
@@ -39,14 +41,103 @@ struct iovec {
 ///////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 
+//
+// State of a dumper that groups the events in independently compressed
+// chunks, see scap_dump_open_chunked()
+//
+struct scap_dump_chunker
+{
+	compression_mode m_compress;
+	uint32_t m_chunk_size;
+	uint8_t* m_buf; ///< The event blocks of the chunk being filled
+	uint32_t m_len;
+	uint32_t m_size;
+	uint8_t* m_zbuf; ///< Holds the compressed chunk
+	uint64_t m_zsize;
+	scap_compress_ctx* m_cctx; ///< Reused for all the chunks, NULL if they are stored uncompressed
+	event_chunk_header m_hdr;
+	uint8_t m_evtypes[EVC_EVTYPES_LEN];
+	// The index entries of the chunks written so far. Until the index is
+	// written, index_distance holds the offset of the chunk in the file.
+	event_chunk_index_entry* m_index;
+	uint8_t* m_index_evtypes;
+	uint32_t m_nchunks;
+	uint32_t m_index_size;
+	bool m_in_event; ///< An event block is being written to the chunk
+};
+
+static int32_t scap_dump_flush_chunk(scap_dumper_t *d, char *error);
+
+//
+// Append data to the chunk being filled
+//
+static int scap_dump_chunk_write(struct scap_dump_chunker *c, void* buf, unsigned len)
+{
+	if(c->m_len + len > c->m_size)
+	{
+		uint32_t size = c->m_size;
+		while(c->m_len + len > size)
+		{
+			size *= 2;
+		}
+
+		uint8_t* tbuf = (uint8_t*)realloc(c->m_buf, size);
+		if(tbuf == NULL)
+		{
+			return -1;
+		}
+
+		c->m_buf = tbuf;
+		c->m_size = size;
+	}
+
+	memcpy(c->m_buf + c->m_len, buf, len);
+	c->m_len += len;
+	return len;
+}
+
+//
+// Write data to the file of a dumper
+//
+int scap_dump_file_write(scap_dumper_t *d, const void* buf, unsigned len)
+{
+	if(d->m_compressor != NULL)
+	{
+		return scap_compressor_write(d->m_compressor, buf, len);
+	}
+	return gzwrite(d->m_f, buf, len);
+}
+
 //
 // Write data into a dump file
 //
 int scap_dump_write(scap_dumper_t *d, void* buf, unsigned len)
 {
+	if(d->m_chunker != NULL)
+	{
+		if(d->m_chunker->m_in_event)
+		{
+			return scap_dump_chunk_write(d->m_chunker, buf, len);
+		}
+
+		//
+		// Other blocks, like the thread tables written by sinsp, go
+		// straight to the file, after the events that came before them
+		//
+		d->m_lasterr[0] = '\0';
+		if(scap_dump_flush_chunk(d, d->m_lasterr) != SCAP_SUCCESS)
+		{
+			return -1;
+		}
+	}
+
 	if(d->m_type == DT_FILE)
 	{
-		return gzwrite(d->m_f, buf, len);
+		if(d->m_async != NULL)
+		{
+			return scap_dump_async_write(d->m_async, buf, len);
+		}
+		return scap_dump_file_write(d, buf, len);
 	}
 	else
 	{
@@ -151,6 +242,23 @@ static int32_t scap_write_padding(scap_dumper_t *d, uint32_t blocklen)
 	}
 }
 
+//
+// Report a failed write of a block header. With a chunked dumper, that's
+// where the events before the block are flushed, and the reason why that
+// failed is more useful than where.
+//
+static void scap_dump_write_error(scap_t *handle, scap_dumper_t *d, const char *where)
+{
+	if(d->m_lasterr[0] != '\0')
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "%s", d->m_lasterr);
+	}
+	else
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error writing to file (%s)", where);
+	}
+}
+
 int32_t scap_write_proc_fds(scap_t *handle, struct scap_threadinfo *tinfo, scap_dumper_t *d)
 {
 	block_header bh;
@@ -191,7 +299,7 @@ int32_t scap_write_proc_fds(scap_t *handle, struct scap_threadinfo *tinfo, scap_
 	if(scap_dump_write(d, &bh, sizeof(bh)) != sizeof(bh))
 	{
 		free(lengths);
-		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error writing to file (fd1)");
+		scap_dump_write_error(handle, d, "fd1");
 		return SCAP_FAILURE;
 	}
 
@@ -334,7 +442,7 @@ int32_t scap_write_proclist_header(scap_t *handle, scap_dumper_t *d, uint32_t to
 
 	if(scap_dump_write(d, &bh, sizeof(bh)) != sizeof(bh))
 	{
-		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error writing to file (1)");
+		scap_dump_write_error(handle, d, "1");
 		return SCAP_FAILURE;
 	}
 
@@ -979,7 +1087,7 @@ int32_t scap_setup_dump(scap_t *handle, scap_dumper_t* d, const char *fname)
 }
 
 // fname is only used for log messages in scap_setup_dump
-static scap_dumper_t *scap_dump_open_gzfile(scap_t *handle, gzFile gzfile, const char *fname, bool skip_proc_scan)
+static scap_dumper_t *scap_dump_open_gzfile(scap_t *handle, gzFile gzfile, compression_mode compress, const char *fname, bool skip_proc_scan)
 {
 	scap_dumper_t* res = (scap_dumper_t*)malloc(sizeof(scap_dumper_t));
 	res->m_f = gzfile;
@@ -987,6 +1095,25 @@ static scap_dumper_t *scap_dump_open_gzfile(scap_t *handle, gzFile gzfile, const
 	res->m_targetbuf = NULL;
 	res->m_targetbufcurpos = NULL;
 	res->m_targetbufend = NULL;
+	res->m_chunker = NULL;
+	res->m_compressor = NULL;
+	res->m_async = NULL;
+	res->m_lasterr[0] = '\0';
+
+	//
+	// gzip is handled by the gzFile itself, the other compressions
+	// write their stream to the plain file
+	//
+	if(compress == SCAP_COMPRESSION_LZ4 || compress == SCAP_COMPRESSION_ZSTD)
+	{
+		res->m_compressor = scap_compressor_open(compress, gzfile, handle->m_lasterr);
+		if(res->m_compressor == NULL)
+		{
+			gzclose(gzfile);
+			free(res);
+			return NULL;
+		}
+	}
 
 	bool tmp_refresh_proc_table_when_saving = handle->refresh_proc_table_when_saving;
 	if(skip_proc_scan)
@@ -1022,6 +1149,8 @@ scap_dumper_t *scap_dump_open(scap_t *handle, const char *fname, compression_mod
 		mode = "wb";
 		break;
 	case SCAP_COMPRESSION_NONE:
+	case SCAP_COMPRESSION_LZ4:
+	case SCAP_COMPRESSION_ZSTD:
 		mode = "wbT";
 		break;
 	default:
@@ -1030,6 +1159,12 @@ scap_dumper_t *scap_dump_open(scap_t *handle, const char *fname, compression_mod
 		return NULL;
 	}
 
+	if((compress == SCAP_COMPRESSION_LZ4 || compress == SCAP_COMPRESSION_ZSTD) && !scap_compression_supported(compress))
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(compress));
+		return NULL;
+	}
+
 	if(fname[0] == '-' && fname[1] == '\0')
 	{
 #ifndef	_WIN32
@@ -1061,7 +1196,239 @@ scap_dumper_t *scap_dump_open(scap_t *handle, const char *fname, compression_mod
 		return NULL;
 	}
 
-	return scap_dump_open_gzfile(handle, f, fname, skip_proc_scan);
+	return scap_dump_open_gzfile(handle, f, compress, fname, skip_proc_scan);
+}
+
+//
+// Compress the current chunk and write it as an EVC block
+//
+static int32_t scap_dump_flush_chunk(scap_dumper_t *d, char *error)
+{
+	struct scap_dump_chunker *c = d->m_chunker;
+	uint8_t* payload = c->m_buf;
+	uint64_t payload_len = c->m_len;
+	block_header bh;
+	uint32_t bt;
+	int32_t zero = 0;
+
+	if(c->m_hdr.nevents == 0)
+	{
+		return SCAP_SUCCESS;
+	}
+
+	c->m_hdr.compression = SCAP_COMPRESSION_NONE;
+	c->m_hdr.raw_len = c->m_len;
+
+	//
+	// Without zlib, the gzip chunks are stored uncompressed
+	//
+	if(c->m_cctx != NULL)
+	{
+		uint64_t zsize = scap_compress_bound(c->m_compress, c->m_len);
+		if(zsize > c->m_zsize)
+		{
+			uint8_t* zbuf = (uint8_t*)realloc(c->m_zbuf, zsize);
+			if(zbuf == NULL)
+			{
+				snprintf(error, SCAP_LASTERR_SIZE, "chunk compression buffer allocation failed");
+				return SCAP_FAILURE;
+			}
+			c->m_zbuf = zbuf;
+			c->m_zsize = zsize;
+		}
+
+		payload_len = c->m_zsize;
+		if(scap_compress_buffer(c->m_cctx, c->m_zbuf, &payload_len, c->m_buf, c->m_len, error) != SCAP_SUCCESS)
+		{
+			return SCAP_FAILURE;
+		}
+
+		payload = c->m_zbuf;
+		c->m_hdr.compression = c->m_compress;
+	}
+
+	c->m_hdr.payload_len = (uint32_t)payload_len;
+
+	if(c->m_nchunks == c->m_index_size)
+	{
+		uint32_t size = c->m_index_size ? c->m_index_size * 2 : 64;
+		event_chunk_index_entry* index = (event_chunk_index_entry*)realloc(c->m_index, size * sizeof(event_chunk_index_entry));
+		if(index != NULL)
+		{
+			c->m_index = index;
+		}
+		uint8_t* evtypes = (uint8_t*)realloc(c->m_index_evtypes, (size_t)size * EVC_EVTYPES_LEN);
+		if(evtypes != NULL)
+		{
+			c->m_index_evtypes = evtypes;
+		}
+		if(index == NULL || evtypes == NULL)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "chunk index allocation failed");
+			return SCAP_FAILURE;
+		}
+		c->m_index_size = size;
+	}
+
+	event_chunk_index_entry* entry = &c->m_index[c->m_nchunks];
+	entry->index_distance = (uint64_t)gztell(d->m_f);
+	entry->first_ts = c->m_hdr.first_ts;
+	entry->last_ts = c->m_hdr.last_ts;
+	entry->nevents = c->m_hdr.nevents;
+	memcpy(c->m_index_evtypes + (size_t)c->m_nchunks * EVC_EVTYPES_LEN, c->m_evtypes, EVC_EVTYPES_LEN);
+
+	uint32_t padding = scap_normalize_block_len(c->m_hdr.payload_len) - c->m_hdr.payload_len;
+	bh.block_type = EVC_BLOCK_TYPE;
+	bh.block_total_length = scap_normalize_block_len(sizeof(block_header) + sizeof(event_chunk_header) + c->m_hdr.payload_len + 4);
+	bt = bh.block_total_length;
+
+	if(gzwrite(d->m_f, &bh, sizeof(bh)) != sizeof(bh) ||
+	        gzwrite(d->m_f, &c->m_hdr, sizeof(c->m_hdr)) != sizeof(c->m_hdr) ||
+	        gzwrite(d->m_f, payload, c->m_hdr.payload_len) != (int)c->m_hdr.payload_len ||
+	        gzwrite(d->m_f, &zero, padding) != padding ||
+	        gzwrite(d->m_f, &bt, sizeof(bt)) != sizeof(bt))
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "error writing to file (EVC)");
+		return SCAP_FAILURE;
+	}
+
+	c->m_nchunks++;
+	c->m_len = 0;
+	memset(&c->m_hdr, 0, sizeof(c->m_hdr));
+	memset(c->m_evtypes, 0, sizeof(c->m_evtypes));
+	return SCAP_SUCCESS;
+}
+
+//
+// Write the index of the chunks at the end of the file
+//
+static int32_t scap_dump_write_chunk_index(scap_dumper_t *d, char *error)
+{
+	struct scap_dump_chunker *c = d->m_chunker;
+	event_chunk_index_header ih;
+	block_header bh;
+	uint32_t bt;
+	uint32_t j;
+
+	uint64_t index_pos = (uint64_t)gztell(d->m_f);
+
+	ih.nchunks = c->m_nchunks;
+	ih.evtypes_len = EVC_EVTYPES_LEN;
+
+	bh.block_type = EVCI_BLOCK_TYPE;
+	bh.block_total_length = scap_normalize_block_len(sizeof(block_header) + sizeof(ih) +
+	        c->m_nchunks * (sizeof(event_chunk_index_entry) + EVC_EVTYPES_LEN) + 4);
+	bt = bh.block_total_length;
+
+	if(gzwrite(d->m_f, &bh, sizeof(bh)) != sizeof(bh) ||
+	        gzwrite(d->m_f, &ih, sizeof(ih)) != sizeof(ih))
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "error writing to file (EVCI1)");
+		return SCAP_FAILURE;
+	}
+
+	for(j = 0; j < c->m_nchunks; j++)
+	{
+		event_chunk_index_entry entry = c->m_index[j];
+		entry.index_distance = index_pos - entry.index_distance;
+
+		if(gzwrite(d->m_f, &entry, sizeof(entry)) != sizeof(entry) ||
+		        gzwrite(d->m_f, c->m_index_evtypes + (size_t)j * EVC_EVTYPES_LEN, EVC_EVTYPES_LEN) != EVC_EVTYPES_LEN)
+		{
+			snprintf(error, SCAP_LASTERR_SIZE, "error writing to file (EVCI2)");
+			return SCAP_FAILURE;
+		}
+	}
+
+	int32_t zero = 0;
+	uint32_t len = sizeof(ih) + c->m_nchunks * (sizeof(event_chunk_index_entry) + EVC_EVTYPES_LEN);
+	uint32_t padding = scap_normalize_block_len(len) - len;
+	if(gzwrite(d->m_f, &zero, padding) != padding ||
+	        gzwrite(d->m_f, &bt, sizeof(bt)) != sizeof(bt))
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "error writing to file (EVCI3)");
+		return SCAP_FAILURE;
+	}
+
+	return SCAP_SUCCESS;
+}
+
+static void scap_dump_free_chunker(struct scap_dump_chunker *c)
+{
+	free(c->m_buf);
+	free(c->m_zbuf);
+	scap_compress_ctx_close(c->m_cctx);
+	free(c->m_index);
+	free(c->m_index_evtypes);
+	free(c);
+}
+
+//
+// Open a savefile for writing, grouping the events in chunks
+//
+scap_dumper_t *scap_dump_open_chunked(scap_t *handle, const char *fname, compression_mode compress, uint32_t chunk_size, bool skip_proc_scan)
+{
+	switch(compress)
+	{
+	case SCAP_COMPRESSION_NONE:
+	case SCAP_COMPRESSION_GZIP:
+		break;
+	case SCAP_COMPRESSION_LZ4:
+	case SCAP_COMPRESSION_ZSTD:
+		if(!scap_compression_supported(compress))
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(compress));
+			return NULL;
+		}
+		break;
+	default:
+		ASSERT(false);
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "invalid compression mode");
+		return NULL;
+	}
+
+	struct scap_dump_chunker *c = (struct scap_dump_chunker *)calloc(1, sizeof(struct scap_dump_chunker));
+	if(c == NULL)
+	{
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "scap_dump_open_chunked memory allocation failure (1)");
+		return NULL;
+	}
+
+	c->m_compress = compress;
+	c->m_chunk_size = chunk_size ? chunk_size : EVC_DEFAULT_CHUNK_SIZE;
+	c->m_size = c->m_chunk_size;
+	c->m_buf = (uint8_t*)malloc(c->m_size);
+	if(c->m_buf == NULL)
+	{
+		scap_dump_free_chunker(c);
+		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "scap_dump_open_chunked memory allocation failure (2)");
+		return NULL;
+	}
+
+	if(compress != SCAP_COMPRESSION_NONE && scap_compression_supported(compress))
+	{
+		c->m_cctx = scap_compress_ctx_open(compress, handle->m_lasterr);
+		if(c->m_cctx == NULL)
+		{
+			scap_dump_free_chunker(c);
+			return NULL;
+		}
+	}
+
+	//
+	// The file itself is never compressed, so that the chunks can be
+	// found and decompressed independently
+	//
+	scap_dumper_t *d = scap_dump_open(handle, fname, SCAP_COMPRESSION_NONE, skip_proc_scan);
+	if(d == NULL)
+	{
+		scap_dump_free_chunker(c);
+		return NULL;
+	}
+
+	// From now on, the event blocks go to the chunk buffer
+	d->m_chunker = c;
+	return d;
 }
 
 //
@@ -1078,6 +1445,15 @@ scap_dumper_t* scap_dump_open_fd(scap_t *handle, int fd, compression_mode compre
 	case SCAP_COMPRESSION_NONE:
 		f = gzdopen(fd, "wbT");
 		break;
+	case SCAP_COMPRESSION_LZ4:
+	case SCAP_COMPRESSION_ZSTD:
+		if(!scap_compression_supported(compress))
+		{
+			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "%s compression not supported in this build", scap_compression_name(compress));
+			return NULL;
+		}
+		f = gzdopen(fd, "wbT");
+		break;
 	default:
 		ASSERT(false);
 		snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "invalid compression mode");
@@ -1090,7 +1466,7 @@ scap_dumper_t* scap_dump_open_fd(scap_t *handle, int fd, compression_mode compre
 		return NULL;
 	}
 
-	return scap_dump_open_gzfile(handle, f, "", skip_proc_scan);
+	return scap_dump_open_gzfile(handle, f, compress, "", skip_proc_scan);
 }
 
 //
@@ -1110,6 +1486,10 @@ scap_dumper_t *scap_memory_dump_open(scap_t *handle, uint8_t* targetbuf, uint64_
 	res->m_targetbuf = targetbuf;
 	res->m_targetbufcurpos = targetbuf;
 	res->m_targetbufend = targetbuf + targetbufsize;
+	res->m_chunker = NULL;
+	res->m_compressor = NULL;
+	res->m_async = NULL;
+	res->m_lasterr[0] = '\0';
 
 	//
 	// Disable proc parsing since it would be too heavy when saving to memory.
@@ -1147,6 +1527,10 @@ scap_dumper_t *scap_managedbuf_dump_create(scap_t *handle)
 	res->m_targetbuf = (uint8_t *)malloc(PPM_DUMPER_MANAGED_BUF_SIZE);
 	res->m_targetbufcurpos = res->m_targetbuf;
 	res->m_targetbufend = res->m_targetbuf + PPM_DUMPER_MANAGED_BUF_SIZE;
+	res->m_chunker = NULL;
+	res->m_compressor = NULL;
+	res->m_async = NULL;
+	res->m_lasterr[0] = '\0';
 
 	return res;
 }
@@ -1156,8 +1540,32 @@ scap_dumper_t *scap_managedbuf_dump_create(scap_t *handle)
 //
 void scap_dump_close(scap_dumper_t *d)
 {
+	if(d->m_async != NULL)
+	{
+		scap_dump_async_stop(d->m_async);
+		d->m_async = NULL;
+	}
+
+	if(d->m_chunker != NULL)
+	{
+		char error[SCAP_LASTERR_SIZE];
+
+		// Errors can't be reported from here, and the file will just
+		// be missing the events of the last chunk or the index
+		if(scap_dump_flush_chunk(d, error) == SCAP_SUCCESS)
+		{
+			scap_dump_write_chunk_index(d, error);
+		}
+		scap_dump_free_chunker(d->m_chunker);
+		d->m_chunker = NULL;
+	}
+
 	if(d->m_type == DT_FILE)
 	{
+		if(d->m_compressor != NULL)
+		{
+			scap_compressor_close(d->m_compressor);
+		}
 		gzclose(d->m_f);
 	}
 	else if (d->m_type == DT_MANAGED_BUF)
@@ -1173,9 +1581,15 @@ void scap_dump_close(scap_dumper_t *d)
 //
 int64_t scap_dump_get_offset(scap_dumper_t *d)
 {
-	if(d->m_type == DT_FILE)
+	if(d->m_async != NULL)
+	{
+		return scap_dump_async_get_offset(d->m_async);
+	}
+	else if(d->m_type == DT_FILE)
 	{
-		return gzoffset(d->m_f);
+		// Count the events still in the chunk buffer too, so
+		// that the size grows while the chunk is being filled
+		return gzoffset(d->m_f) + (d->m_chunker ? d->m_chunker->m_len : 0);
 	}
 	else
 	{
@@ -1185,8 +1599,16 @@ int64_t scap_dump_get_offset(scap_dumper_t *d)
 
 int64_t scap_dump_ftell(scap_dumper_t *d)
 {
-	if(d->m_type == DT_FILE)
+	if(d->m_async != NULL)
 	{
+		return scap_dump_async_ftell(d->m_async);
+	}
+	else if(d->m_type == DT_FILE)
+	{
+		if(d->m_compressor != NULL)
+		{
+			return scap_compressor_tell(d->m_compressor);
+		}
 		return gztell(d->m_f);
 	}
 	else
@@ -1197,10 +1619,55 @@ int64_t scap_dump_ftell(scap_dumper_t *d)
 
 void scap_dump_flush(scap_dumper_t *d)
 {
+	if(d->m_chunker != NULL)
+	{
+		char error[SCAP_LASTERR_SIZE];
+		scap_dump_flush_chunk(d, error);
+	}
+
+	if(d->m_async != NULL)
+	{
+		// The writer is idle until the next write, the file can be
+		// flushed from here
+		scap_dump_async_flush(d->m_async);
+	}
+
 	if(d->m_type == DT_FILE)
 	{
-		gzflush(d->m_f, Z_FULL_FLUSH);
+		if(d->m_compressor != NULL)
+		{
+			scap_compressor_flush(d->m_compressor);
+		}
+		else
+		{
+			gzflush(d->m_f, Z_FULL_FLUSH);
+		}
+	}
+}
+
+//
+// Move the writes of a file dumper to a background thread
+//
+int32_t scap_dump_set_async(scap_dumper_t *d, uint32_t buffer_size, uint32_t nbuffers, char *error)
+{
+	if(d->m_type != DT_FILE || d->m_chunker != NULL)
+	{
+		snprintf(error, SCAP_LASTERR_SIZE, "async writes are only supported by the plain file dumpers");
+		return SCAP_NOT_SUPPORTED;
 	}
+
+	if(d->m_async != NULL)
+	{
+		return SCAP_SUCCESS;
+	}
+
+	d->m_async = scap_dump_async_start(d, buffer_size, nbuffers, error);
+	return d->m_async != NULL ? SCAP_SUCCESS : SCAP_FAILURE;
+}
+
+uint64_t scap_dump_get_drops(scap_dumper_t *d)
+{
+	return d->m_async != NULL ? scap_dump_async_get_drops(d->m_async) : 0;
 }
 
 //
@@ -1220,9 +1687,54 @@ int32_t scap_dump(scap_t *handle, scap_dumper_t *d, scap_evt *e, uint16_t cpuid,
 {
 	block_header bh;
 	uint32_t bt;
+	int32_t res = SCAP_SUCCESS;
 	bool large_payload = flags & SCAP_DF_LARGE;
 
 	flags &= ~SCAP_DF_LARGE;
+
+	if(d->m_async != NULL)
+	{
+		int32_t block_len;
+
+		scap_number_of_bytes_to_write(e, cpuid, &block_len);
+		if(!scap_dump_async_reserve(d->m_async, block_len + sizeof(flags)))
+		{
+			if(scap_dump_async_failed(d->m_async))
+			{
+				snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error writing to file (async)");
+				return SCAP_FAILURE;
+			}
+
+			// The writer can't keep up, the event is dropped
+			return SCAP_SUCCESS;
+		}
+	}
+
+	if(d->m_chunker != NULL)
+	{
+		struct scap_dump_chunker *c = d->m_chunker;
+		int32_t block_len;
+
+		scap_number_of_bytes_to_write(e, cpuid, &block_len);
+		if(c->m_len > 0 && c->m_len + block_len + sizeof(flags) > c->m_chunk_size &&
+		        scap_dump_flush_chunk(d, handle->m_lasterr) != SCAP_SUCCESS)
+		{
+			return SCAP_FAILURE;
+		}
+
+		if(c->m_hdr.nevents == 0)
+		{
+			c->m_hdr.first_ts = e->ts;
+		}
+		c->m_hdr.nevents++;
+		c->m_hdr.last_ts = e->ts;
+		if(e->type < PPM_EVENT_MAX)
+		{
+			c->m_evtypes[e->type / 8] |= 1 << (e->type % 8);
+		}
+		c->m_in_event = true;
+	}
+
 	if(flags == 0)
 	{
 		//
@@ -1239,7 +1751,7 @@ int32_t scap_dump(scap_t *handle, scap_dumper_t *d, scap_evt *e, uint16_t cpuid,
 				scap_dump_write(d, &bt, sizeof(bt)) != sizeof(bt))
 		{
 			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error writing to file (6)");
-			return SCAP_FAILURE;
+			res = SCAP_FAILURE;
 		}
 	}
 	else
@@ -1259,10 +1771,15 @@ int32_t scap_dump(scap_t *handle, scap_dumper_t *d, scap_evt *e, uint16_t cpuid,
 				scap_dump_write(d, &bt, sizeof(bt)) != sizeof(bt))
 		{
 			snprintf(handle->m_lasterr, SCAP_LASTERR_SIZE, "error writing to file (7)");
-			return SCAP_FAILURE;
+			res = SCAP_FAILURE;
 		}
 	}
 
+	if(d->m_chunker != NULL)
+	{
+		d->m_chunker->m_in_event = false;
+	}
+
 	//
 	// Enable this to make sure that everything is saved to disk during the tests
 	//
@@ -1270,5 +1787,5 @@ int32_t scap_dump(scap_t *handle, scap_dumper_t *d, scap_evt *e, uint16_t cpuid,
 	fflush(f);
 #endif
 
-	return SCAP_SUCCESS;
+	return res;
 }
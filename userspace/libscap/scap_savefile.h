@@ -154,6 +154,56 @@ typedef struct _section_header_block
 
 #define EVF_BLOCK_TYPE_V2_LARGE		0x222
 
+///////////////////////////////////////////////////////////////////////////////
+// EVENT CHUNK BLOCK
+///////////////////////////////////////////////////////////////////////////////
+// A group of consecutive event blocks (EV_BLOCK_TYPE_V2* and
+// EVF_BLOCK_TYPE_V2*), compressed independently from the rest of the
+// file so that chunks can be decompressed in parallel or skipped.
+// The block contains an event_chunk_header followed by payload_len bytes
+// of payload, which decompress to raw_len bytes of event blocks.
+#define EVC_BLOCK_TYPE			0x230
+
+typedef struct _event_chunk_header
+{
+	uint32_t compression; // the compression_mode of the payload
+	uint32_t nevents;
+	uint64_t first_ts;
+	uint64_t last_ts;
+	uint32_t raw_len;
+	uint32_t payload_len;
+}event_chunk_header;
+
+///////////////////////////////////////////////////////////////////////////////
+// EVENT CHUNK INDEX BLOCK
+///////////////////////////////////////////////////////////////////////////////
+// Written as the last block of a file made of event chunks, so that it can
+// be found from the trailing block length. It contains an
+// event_chunk_index_header followed by nchunks entries, each made of an
+// event_chunk_index_entry and a bitmap of evtypes_len bytes with a bit set
+// for each event type present in the chunk.
+#define EVCI_BLOCK_TYPE			0x231
+
+typedef struct _event_chunk_index_header
+{
+	uint32_t nchunks;
+	uint32_t evtypes_len;
+}event_chunk_index_header;
+
+typedef struct _event_chunk_index_entry
+{
+	uint64_t index_distance; // distance in bytes from the chunk block to the index block
+	uint64_t first_ts;
+	uint64_t last_ts;
+	uint32_t nevents;
+}event_chunk_index_entry;
+
+// Size of the event type bitmaps written by this version
+#define EVC_EVTYPES_LEN			((PPM_EVENT_MAX + 7) / 8)
+
+// Default uncompressed size of a chunk
+#define EVC_DEFAULT_CHUNK_SIZE		(4 * 1024 * 1024)
+
 #if defined __sun
 #pragma pack()
 #else
@@ -29,6 +29,7 @@ extern "C" {
 struct scap_stats;
 typedef struct scap scap_t;
 typedef struct ppm_evt_hdr scap_evt;
+typedef struct scap_batch_entry scap_batch_entry;
 
 /*
  * magic constants, matching the kmod-only ioctl numbers defined as:
@@ -132,6 +133,14 @@ struct scap_savefile_vtable {
 	 * @return the flags of the event (currently only SCAP_DF_LARGE is supported)
 	 */
 	uint32_t (*get_event_dump_flags)(struct scap_engine_handle engine);
+
+	/**
+	 * @brief seek to the first event with a timestamp not lower than ts
+	 * @param engine the handle to the engine
+	 * @param ts the timestamp to seek to
+	 * @return SCAP_SUCCESS, or SCAP_NOT_SUPPORTED if the capture has no chunk index
+	 */
+	int32_t (*seek_ts)(struct scap_engine_handle engine, uint64_t ts);
 };
 
 struct scap_vtable {
@@ -208,6 +217,29 @@ struct scap_vtable {
 	 */
 	int32_t (*next)(struct scap_engine_handle engine, scap_evt **pevent, uint16_t *pcpuid);
 
+	/**
+	 * @brief fetch up to `max_events` events at once
+	 * @param engine wraps the pointer to the engine-specific handle
+	 * @param entries [out] array of `max_events` entries to fill
+	 * @param max_events the size of `entries`, at least 1
+	 * @param nevents [out] the number of entries filled
+	 * @return SCAP_SUCCESS or the same failure codes as next()
+	 *
+	 * The events are returned in the same order next() would return them.
+	 * The batch may stop early for any reason; the return value is the
+	 * result of the call that stopped it (SCAP_SUCCESS if the batch is
+	 * full), and the events stored in `entries` are valid even when it
+	 * is not SCAP_SUCCESS.
+	 *
+	 * The memory of all the events in the batch must be owned by the engine
+	 * and must remain valid at least until the next call to next() or
+	 * next_batch()
+	 *
+	 * This field is optional: if NULL, scap_next_batch() calls next()
+	 * and returns a single event
+	 */
+	int32_t (*next_batch)(struct scap_engine_handle engine, scap_batch_entry *entries, uint32_t max_events, uint32_t *nevents);
+
 	/**
 	 * @brief start a capture
 	 * @param engine
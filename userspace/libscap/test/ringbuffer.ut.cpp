@@ -0,0 +1,223 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "scap.h"
+#include "scap-int.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include <algorithm>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//
+// Fake devices backed by a plain memory buffer: m_buffer_size is the
+// producer position, m_bufinfo_size the consumer one.
+//
+static inline void test_get_buf_pointers(scap_device* dev, uint64_t* phead, uint64_t* ptail, uint64_t* pread_size)
+{
+	*phead = dev->m_buffer_size;
+	*ptail = dev->m_bufinfo_size;
+	*pread_size = *phead - *ptail;
+}
+
+static inline void test_advance_tail(scap_device* dev)
+{
+	dev->m_bufinfo_size += dev->m_lastreadsize;
+	dev->m_lastreadsize = 0;
+}
+
+static inline int32_t test_readbuf(scap_device* dev, char** buf, uint32_t* len)
+{
+	uint64_t head, tail, read_size;
+	test_get_buf_pointers(dev, &head, &tail, &read_size);
+	EXPECT_EQ(dev->m_lastreadsize, 0);
+	dev->m_lastreadsize = (uint32_t)read_size;
+	*buf = dev->m_buffer + tail;
+	*len = (uint32_t)read_size;
+	return SCAP_SUCCESS;
+}
+
+#define GET_BUF_POINTERS test_get_buf_pointers
+#define ADVANCE_TAIL test_advance_tail
+#define READBUF test_readbuf
+
+#include "ringbuffer/ringbuffer.h"
+
+class ringbuffer_merge : public testing::Test
+{
+protected:
+	void init(const std::vector<std::vector<uint64_t>>& timestamps)
+	{
+		ASSERT_EQ(devset_init(&m_devset, timestamps.size(), m_lasterr), SCAP_SUCCESS);
+		m_storage.resize(timestamps.size());
+
+		for(size_t j = 0; j < timestamps.size(); j++)
+		{
+			m_storage[j].resize(timestamps[j].size() * sizeof(scap_evt));
+			for(size_t i = 0; i < timestamps[j].size(); i++)
+			{
+				scap_evt* evt = (scap_evt*)&m_storage[j][i * sizeof(scap_evt)];
+				evt->ts = timestamps[j][i];
+				evt->tid = j;
+				evt->len = sizeof(scap_evt);
+				evt->type = PPME_GENERIC_E;
+				evt->nparams = 0;
+			}
+
+			m_devset.m_devs[j].m_buffer = m_storage[j].data();
+			m_devset.m_devs[j].m_buffer_size = m_storage[j].size();
+			m_devset.m_devs[j].m_bufinfo_size = 0;
+		}
+	}
+
+	void TearDown() override
+	{
+		if(m_devset.m_devs == NULL)
+		{
+			return;
+		}
+
+		// the buffers are not mmapped, don't let devset_free() unmap them
+		for(uint32_t j = 0; j < m_devset.m_ndevs; j++)
+		{
+			m_devset.m_devs[j].m_buffer = (char*)MAP_FAILED;
+			m_devset.m_devs[j].m_bufinfo = (struct ppm_ring_buffer_info*)MAP_FAILED;
+		}
+		devset_free(&m_devset);
+	}
+
+	// drains all the devices, returning the (ts, cpu) pairs in consumption order
+	std::vector<std::pair<uint64_t, uint16_t>> drain()
+	{
+		std::vector<std::pair<uint64_t, uint16_t>> res;
+		scap_evt* evt;
+		uint16_t cpuid;
+		int32_t timeouts = 0;
+
+		while(timeouts < 2)
+		{
+			int32_t rc = ringbuffer_next(&m_devset, &evt, &cpuid);
+			if(rc == SCAP_TIMEOUT)
+			{
+				timeouts++;
+				continue;
+			}
+			EXPECT_EQ(rc, SCAP_SUCCESS);
+			if(rc != SCAP_SUCCESS)
+			{
+				break;
+			}
+			timeouts = 0;
+			EXPECT_EQ(evt->tid, cpuid);
+			res.emplace_back(evt->ts, cpuid);
+		}
+
+		return res;
+	}
+
+	char m_lasterr[SCAP_LASTERR_SIZE];
+	struct scap_device_set m_devset = {};
+	std::vector<std::vector<char>> m_storage;
+};
+
+TEST_F(ringbuffer_merge, events_in_timestamp_order)
+{
+	init({{1, 4, 7, 10}, {2, 5, 8}, {}, {3, 6, 9, 11, 12}});
+
+	auto res = drain();
+	ASSERT_EQ(res.size(), 12);
+	for(size_t i = 0; i < res.size(); i++)
+	{
+		EXPECT_EQ(res[i].first, i + 1);
+	}
+
+	// every device must have been fully released to the producer
+	for(uint32_t j = 0; j < m_devset.m_ndevs; j++)
+	{
+		EXPECT_EQ(m_devset.m_devs[j].m_bufinfo_size, m_devset.m_devs[j].m_buffer_size);
+		EXPECT_EQ(m_devset.m_devs[j].m_lastreadsize, 0);
+	}
+}
+
+TEST_F(ringbuffer_merge, ties_broken_on_device_index)
+{
+	init({{5, 5}, {1, 5}, {5}});
+
+	auto res = drain();
+	std::vector<std::pair<uint64_t, uint16_t>> expected = {{1, 1}, {5, 0}, {5, 0}, {5, 1}, {5, 2}};
+	EXPECT_EQ(res, expected);
+}
+
+TEST_F(ringbuffer_merge, many_devices)
+{
+	const size_t ndevs = 67;
+	const size_t nevts = 50;
+	std::vector<std::vector<uint64_t>> timestamps(ndevs);
+	uint64_t seed = 42;
+	for(auto& dev : timestamps)
+	{
+		uint64_t ts = 0;
+		for(size_t i = 0; i < nevts; i++)
+		{
+			seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+			ts += (seed >> 33) % 1000;
+			dev.push_back(ts);
+		}
+	}
+	init(timestamps);
+
+	auto res = drain();
+	ASSERT_EQ(res.size(), ndevs * nevts);
+	EXPECT_TRUE(std::is_sorted(res.begin(), res.end()));
+}
+
+TEST_F(ringbuffer_merge, poll_wait)
+{
+	init({{}, {}});
+
+	int fds[2];
+	ASSERT_EQ(pipe(fds), 0);
+	ASSERT_EQ(write(fds[1], "x", 1), 1);
+	m_devset.m_devs[1].m_fd = fds[0];
+	m_devset.m_poll_wait = true;
+
+	// the pipe is readable, so we don't wait for the timeout
+	scap_evt* evt;
+	uint16_t cpuid;
+	EXPECT_EQ(ringbuffer_next(&m_devset, &evt, &cpuid), SCAP_TIMEOUT);
+	EXPECT_TRUE(m_devset.m_poll_wait);
+	EXPECT_EQ(m_devset.m_buffer_empty_wait_time_us, BUFFER_EMPTY_WAIT_TIME_US_START);
+
+	close(fds[1]);
+}
+
+TEST_F(ringbuffer_merge, poll_wait_not_supported)
+{
+	init({{}, {}});
+
+	// always readable and writable, like a device without poll() support
+	m_devset.m_devs[0].m_fd = open("/dev/null", O_RDONLY);
+	ASSERT_GE(m_devset.m_devs[0].m_fd, 0);
+	m_devset.m_poll_wait = true;
+
+	scap_evt* evt;
+	uint16_t cpuid;
+	EXPECT_EQ(ringbuffer_next(&m_devset, &evt, &cpuid), SCAP_TIMEOUT);
+	EXPECT_FALSE(m_devset.m_poll_wait);
+	EXPECT_GT(m_devset.m_buffer_empty_wait_time_us, BUFFER_EMPTY_WAIT_TIME_US_START);
+}
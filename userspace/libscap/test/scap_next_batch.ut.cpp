@@ -0,0 +1,136 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "scap.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+class scap_next_batch_test : public testing::Test
+{
+protected:
+	void open(size_t nevts)
+	{
+		for(size_t i = 0; i < nevts; i++)
+		{
+			scap_evt* evt = (scap_evt*)calloc(1, sizeof(scap_evt));
+			ASSERT_NE(evt, nullptr);
+			evt->ts = i + 1;
+			evt->tid = 1;
+			evt->len = sizeof(scap_evt);
+			evt->type = PPME_GENERIC_E;
+			evt->nparams = 0;
+			m_events.push_back(evt);
+		}
+
+		m_data.events = m_events.data();
+		m_data.event_count = m_events.size();
+		m_data.threads = nullptr;
+		m_data.thread_count = 0;
+		m_data.fdinfo_data = nullptr;
+
+		scap_open_args args = {};
+		args.mode = SCAP_MODE_LIVE;
+		args.test_input_data = &m_data;
+
+		char error[SCAP_LASTERR_SIZE];
+		int32_t rc;
+		m_handle = scap_open(args, error, &rc);
+		ASSERT_NE(m_handle, nullptr) << error;
+	}
+
+	void TearDown() override
+	{
+		if(m_handle != nullptr)
+		{
+			scap_close(m_handle);
+		}
+		for(auto evt : m_events)
+		{
+			free(evt);
+		}
+	}
+
+	scap_test_input_data m_data = {};
+	std::vector<scap_evt*> m_events;
+	scap_t* m_handle = nullptr;
+};
+
+TEST_F(scap_next_batch_test, events_in_order)
+{
+	open(7);
+
+	scap_batch_entry entries[3];
+	uint32_t nevents;
+	uint64_t expected_ts = 1;
+
+	ASSERT_EQ(scap_next_batch(m_handle, entries, 3, &nevents), SCAP_SUCCESS);
+	ASSERT_EQ(nevents, 3);
+	for(uint32_t i = 0; i < nevents; i++)
+	{
+		EXPECT_EQ(entries[i].evt->ts, expected_ts++);
+	}
+
+	ASSERT_EQ(scap_next_batch(m_handle, entries, 3, &nevents), SCAP_SUCCESS);
+	ASSERT_EQ(nevents, 3);
+	for(uint32_t i = 0; i < nevents; i++)
+	{
+		EXPECT_EQ(entries[i].evt->ts, expected_ts++);
+	}
+
+	// the last event comes together with the end of the capture, which
+	// must be reported by the following call
+	ASSERT_EQ(scap_next_batch(m_handle, entries, 3, &nevents), SCAP_SUCCESS);
+	ASSERT_EQ(nevents, 1);
+	EXPECT_EQ(entries[0].evt->ts, expected_ts);
+
+	ASSERT_EQ(scap_next_batch(m_handle, entries, 3, &nevents), SCAP_EOF);
+	EXPECT_EQ(nevents, 0);
+}
+
+TEST_F(scap_next_batch_test, mixed_with_scap_next)
+{
+	open(4);
+
+	scap_batch_entry entries[2];
+	uint32_t nevents;
+	scap_evt* evt;
+	uint16_t cpuid;
+
+	ASSERT_EQ(scap_next(m_handle, &evt, &cpuid), SCAP_SUCCESS);
+	EXPECT_EQ(evt->ts, 1);
+
+	ASSERT_EQ(scap_next_batch(m_handle, entries, 2, &nevents), SCAP_SUCCESS);
+	ASSERT_EQ(nevents, 2);
+	EXPECT_EQ(entries[0].evt->ts, 2);
+	EXPECT_EQ(entries[1].evt->ts, 3);
+
+	ASSERT_EQ(scap_next_batch(m_handle, entries, 2, &nevents), SCAP_SUCCESS);
+	ASSERT_EQ(nevents, 1);
+	EXPECT_EQ(entries[0].evt->ts, 4);
+
+	// the pending end of capture is returned by scap_next too
+	EXPECT_EQ(scap_next(m_handle, &evt, &cpuid), SCAP_EOF);
+}
+
+TEST_F(scap_next_batch_test, zero_max_events)
+{
+	open(1);
+
+	scap_batch_entry entry;
+	uint32_t nevents;
+	EXPECT_EQ(scap_next_batch(m_handle, &entry, 0, &nevents), SCAP_FAILURE);
+}
@@ -0,0 +1,667 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "scap.h"
+#include "scap_compress.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <thread>
+#include <signal.h>
+#include <fstream>
+#include <iterator>
+
+//
+// Writes a capture from the test input engine and reads it back with
+// the savefile engine, checking that the events are returned as written.
+//
+class scap_savefile_test : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		char error[SCAP_LASTERR_SIZE];
+
+		for(uint32_t i = 0; i < 1000; i++)
+		{
+			std::string name = "/tmp/file_" + std::string(i % 50, 'x');
+			scap_sized_buffer buf = {NULL, 0};
+			size_t size;
+
+			// the last events are the only close ones
+			if(i >= 900)
+			{
+				ASSERT_EQ(scap_event_encode_params(buf, &size, error, PPME_SYSCALL_CLOSE_E, 1, (int64_t)i), SCAP_INPUT_TOO_SMALL);
+				buf.buf = malloc(size);
+				buf.size = size;
+				ASSERT_EQ(scap_event_encode_params(buf, &size, error, PPME_SYSCALL_CLOSE_E, 1, (int64_t)i), SCAP_SUCCESS);
+			}
+			else
+			{
+				ASSERT_EQ(scap_event_encode_params(buf, &size, error, PPME_SYSCALL_OPEN_E, 3, name.c_str(), (uint32_t)0, (uint32_t)0), SCAP_INPUT_TOO_SMALL);
+				buf.buf = malloc(size);
+				buf.size = size;
+				ASSERT_EQ(scap_event_encode_params(buf, &size, error, PPME_SYSCALL_OPEN_E, 3, name.c_str(), (uint32_t)0, (uint32_t)0), SCAP_SUCCESS);
+			}
+
+			scap_evt* evt = (scap_evt*)buf.buf;
+			evt->ts = i + 1;
+			evt->tid = i % 7;
+			m_events.push_back(evt);
+		}
+
+		m_data.events = m_events.data();
+		m_data.event_count = m_events.size();
+		m_data.threads = nullptr;
+		m_data.thread_count = 0;
+		m_data.fdinfo_data = nullptr;
+
+		char tmpl[] = "/tmp/scap_savefile_test_XXXXXX";
+		int fd = mkstemp(tmpl);
+		ASSERT_GE(fd, 0);
+		close(fd);
+		m_fname = tmpl;
+	}
+
+	void TearDown() override
+	{
+		for(auto evt : m_events)
+		{
+			free(evt);
+		}
+		unlink(m_fname.c_str());
+	}
+
+	void write_capture(compression_mode compress, uint32_t chunk_size = 0, uint32_t async_buffer_size = 0)
+	{
+		scap_open_args args = {};
+		args.mode = SCAP_MODE_LIVE;
+		args.test_input_data = &m_data;
+
+		char error[SCAP_LASTERR_SIZE];
+		int32_t rc;
+		scap_t* h = scap_open(args, error, &rc);
+		ASSERT_NE(h, nullptr) << error;
+
+		scap_dumper_t* d = chunk_size ? scap_dump_open_chunked(h, m_fname.c_str(), compress, chunk_size, true) :
+						scap_dump_open(h, m_fname.c_str(), compress, true);
+		ASSERT_NE(d, nullptr) << scap_getlasterr(h);
+
+		if(async_buffer_size)
+		{
+			ASSERT_EQ(scap_dump_set_async(d, async_buffer_size, 3, error), SCAP_SUCCESS) << error;
+		}
+
+		scap_evt* evt;
+		uint16_t cpuid;
+		while(scap_next(h, &evt, &cpuid) == SCAP_SUCCESS)
+		{
+			ASSERT_EQ(scap_dump(h, d, evt, cpuid, 0), SCAP_SUCCESS);
+		}
+
+		EXPECT_EQ(scap_dump_get_drops(d), 0);
+		scap_dump_close(d);
+		scap_close(h);
+	}
+
+	scap_t* open_capture(uint32_t fbuffer_size = 0, uint32_t chunk_threads = 0, bool eventmask = false)
+	{
+		scap_open_args args = {};
+		args.mode = SCAP_MODE_CAPTURE;
+		args.fname = m_fname.c_str();
+		args.fbuffer_size = fbuffer_size;
+		args.chunk_threads = chunk_threads;
+		args.savefile_eventmask = eventmask;
+
+		char error[SCAP_LASTERR_SIZE];
+		int32_t rc;
+		scap_t* h = scap_open(args, error, &rc);
+		EXPECT_NE(h, nullptr) << error;
+		return h;
+	}
+
+	// reads the events left, checking they're the written ones starting
+	// from the first-th
+	void check_events(scap_t* h, size_t first)
+	{
+		scap_evt* evt;
+		uint16_t cpuid;
+		int32_t rc;
+		size_t n = first;
+		while((rc = scap_next(h, &evt, &cpuid)) == SCAP_SUCCESS)
+		{
+			ASSERT_LT(n, m_events.size());
+			ASSERT_EQ(evt->len, m_events[n]->len);
+			ASSERT_EQ(memcmp(evt, m_events[n], evt->len), 0);
+			n++;
+		}
+		EXPECT_EQ(rc, SCAP_EOF);
+		EXPECT_EQ(n, m_events.size());
+	}
+
+	void check_capture(uint32_t fbuffer_size, uint32_t chunk_threads = 0)
+	{
+		scap_t* h = open_capture(fbuffer_size, chunk_threads);
+		ASSERT_NE(h, nullptr);
+		check_events(h, 0);
+		scap_close(h);
+	}
+
+	// reads the capture through a pipe, which can't be rewound
+	void check_capture_pipe(uint32_t chunk_threads = 0)
+	{
+		int fds[2];
+		ASSERT_EQ(pipe(fds), 0);
+
+		// the reader may give up before the whole file is written
+		signal(SIGPIPE, SIG_IGN);
+		std::thread writer([&]() {
+			std::ifstream in(m_fname, std::ios::binary);
+			char buf[4096];
+			while(in.read(buf, sizeof(buf)) || in.gcount() > 0)
+			{
+				if(write(fds[1], buf, in.gcount()) != in.gcount())
+				{
+					break;
+				}
+			}
+			close(fds[1]);
+		});
+
+		scap_open_args args = {};
+		args.mode = SCAP_MODE_CAPTURE;
+		args.fd = fds[0];
+		args.chunk_threads = chunk_threads;
+
+		char error[SCAP_LASTERR_SIZE];
+		int32_t rc;
+		scap_t* h = scap_open(args, error, &rc);
+		EXPECT_NE(h, nullptr) << error;
+		if(h != nullptr)
+		{
+			check_events(h, 0);
+			scap_close(h);
+		}
+		else
+		{
+			close(fds[0]);
+		}
+		writer.join();
+	}
+
+	scap_test_input_data m_data = {};
+	std::vector<scap_evt*> m_events;
+	std::string m_fname;
+};
+
+TEST_F(scap_savefile_test, uncompressed)
+{
+	write_capture(SCAP_COMPRESSION_NONE);
+	check_capture(0);
+	check_capture(4096);
+	check_capture_pipe();
+}
+
+TEST_F(scap_savefile_test, gzip)
+{
+	write_capture(SCAP_COMPRESSION_GZIP);
+	check_capture(0);
+	check_capture(4096);
+	check_capture_pipe();
+}
+
+TEST_F(scap_savefile_test, truncated_stream_pipe)
+{
+	for(compression_mode compress : {SCAP_COMPRESSION_GZIP, SCAP_COMPRESSION_LZ4, SCAP_COMPRESSION_ZSTD})
+	{
+		if(!scap_compression_supported(compress))
+		{
+			continue;
+		}
+		write_capture(compress);
+
+		// the end of the stream is cut: all the events may still be
+		// decompressed, but it's an error, not the end of the capture
+		std::ifstream in(m_fname, std::ios::binary);
+		std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+		size_t len = data.size() - 4;
+
+		int fds[2];
+		ASSERT_EQ(pipe(fds), 0);
+		std::thread writer([&]() {
+			EXPECT_EQ(write(fds[1], data.data(), len), (ssize_t)len);
+			close(fds[1]);
+		});
+
+		scap_open_args args = {};
+		args.mode = SCAP_MODE_CAPTURE;
+		args.fd = fds[0];
+
+		char error[SCAP_LASTERR_SIZE];
+		int32_t rc;
+		scap_t* h = scap_open(args, error, &rc);
+		ASSERT_NE(h, nullptr) << error;
+
+		scap_evt* evt;
+		uint16_t cpuid;
+		while((rc = scap_next(h, &evt, &cpuid)) == SCAP_SUCCESS)
+		{
+		}
+		EXPECT_EQ(rc, SCAP_FAILURE) << scap_compression_name(compress);
+		scap_close(h);
+		writer.join();
+	}
+}
+
+TEST_F(scap_savefile_test, uncompressed_batches)
+{
+	write_capture(SCAP_COMPRESSION_NONE);
+
+	scap_t* h = open_capture();
+	ASSERT_NE(h, nullptr);
+
+	// with a mapped file, the events of a batch don't need to be copied
+	// and all stay valid until the next call
+	scap_batch_entry entries[64];
+	uint32_t nevents;
+	int32_t rc;
+	size_t n = 0;
+	while((rc = scap_next_batch(h, entries, 64, &nevents)) == SCAP_SUCCESS)
+	{
+		for(uint32_t i = 0; i < nevents; i++)
+		{
+			ASSERT_LT(n, m_events.size());
+			ASSERT_EQ(memcmp(entries[i].evt, m_events[n], m_events[n]->len), 0);
+			n++;
+		}
+	}
+	EXPECT_EQ(rc, SCAP_EOF);
+	EXPECT_EQ(n, m_events.size());
+
+	scap_close(h);
+}
+
+TEST_F(scap_savefile_test, uncompressed_growing)
+{
+	for(uint32_t chunk_size : {0, 4096})
+	{
+		write_capture(SCAP_COMPRESSION_NONE, chunk_size);
+
+		std::ifstream in(m_fname, std::ios::binary);
+		std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		in.close();
+
+		// the file is mapped while the writer is in the middle of a block,
+		// and the rest of it is appended after the first events are read
+		size_t mapped = data.size() * 3 / 4 + 1;
+		ASSERT_EQ(truncate(m_fname.c_str(), mapped), 0);
+
+		scap_t* h = open_capture();
+		ASSERT_NE(h, nullptr);
+
+		scap_evt* evt;
+		uint16_t cpuid;
+		for(size_t n = 0; n < 100; n++)
+		{
+			ASSERT_EQ(scap_next(h, &evt, &cpuid), SCAP_SUCCESS);
+			ASSERT_EQ(memcmp(evt, m_events[n], m_events[n]->len), 0);
+		}
+
+		FILE* f = fopen(m_fname.c_str(), "ab");
+		ASSERT_NE(f, nullptr);
+		ASSERT_EQ(fwrite(data.data() + mapped, 1, data.size() - mapped, f), data.size() - mapped);
+		fclose(f);
+
+		check_events(h, 100);
+		scap_close(h);
+	}
+}
+
+TEST_F(scap_savefile_test, chunked)
+{
+	// many small chunks, each with a few events
+	write_capture(SCAP_COMPRESSION_NONE, 4096);
+	check_capture(0);
+	check_capture(0, 1);
+	check_capture(0, 4);
+	check_capture(4096, 3);
+	check_capture_pipe();
+	check_capture_pipe(4);
+}
+
+TEST_F(scap_savefile_test, chunked_truncated)
+{
+	write_capture(SCAP_COMPRESSION_NONE, 4096);
+
+	// without its index and with its last chunk cut, the capture is read
+	// up to the last whole chunk
+	std::ifstream in(m_fname, std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	in.close();
+	ASSERT_EQ(truncate(m_fname.c_str(), data.size() / 2), 0);
+
+	for(uint32_t threads : {0, 4})
+	{
+		scap_t* h = open_capture(0, threads);
+		ASSERT_NE(h, nullptr);
+
+		scap_evt* evt;
+		uint16_t cpuid;
+		int32_t rc;
+		size_t n = 0;
+		while((rc = scap_next(h, &evt, &cpuid)) == SCAP_SUCCESS)
+		{
+			ASSERT_LT(n, m_events.size());
+			ASSERT_EQ(memcmp(evt, m_events[n], m_events[n]->len), 0);
+			n++;
+		}
+		EXPECT_NE(rc, SCAP_SUCCESS);
+		EXPECT_GT(n, 0);
+		EXPECT_LT(n, m_events.size());
+		scap_close(h);
+	}
+}
+
+TEST_F(scap_savefile_test, chunked_flush_error)
+{
+	scap_open_args args = {};
+	args.mode = SCAP_MODE_LIVE;
+	args.test_input_data = &m_data;
+
+	char error[SCAP_LASTERR_SIZE];
+	int32_t rc;
+	scap_t* h = scap_open(args, error, &rc);
+	ASSERT_NE(h, nullptr) << error;
+
+	// the events stay in the chunk until the thread table is written,
+	// which is when the file turns out to be full
+	scap_dumper_t* d = scap_dump_open_chunked(h, "/dev/full", SCAP_COMPRESSION_NONE, 1 << 20, true);
+	ASSERT_NE(d, nullptr) << scap_getlasterr(h);
+	for(auto evt : m_events)
+	{
+		ASSERT_EQ(scap_dump(h, d, evt, 0, 0), SCAP_SUCCESS);
+	}
+
+	EXPECT_EQ(scap_write_proclist_header(h, d, 0), SCAP_FAILURE);
+	EXPECT_STREQ(scap_getlasterr(h), "error writing to file (EVC)");
+
+	scap_dump_close(d);
+	scap_close(h);
+}
+
+TEST_F(scap_savefile_test, chunked_gzip)
+{
+	write_capture(SCAP_COMPRESSION_GZIP, 4096);
+	check_capture(0);
+	check_capture(0, 4);
+}
+
+TEST_F(scap_savefile_test, chunked_batches)
+{
+	write_capture(SCAP_COMPRESSION_NONE, 4096);
+
+	for(uint32_t threads : {0, 2})
+	{
+		scap_t* h = open_capture(0, threads);
+		ASSERT_NE(h, nullptr);
+
+		// a batch never spans two chunks, so all its events stay valid
+		scap_batch_entry entries[64];
+		uint32_t nevents;
+		int32_t rc;
+		size_t n = 0;
+		while((rc = scap_next_batch(h, entries, 64, &nevents)) == SCAP_SUCCESS)
+		{
+			for(uint32_t i = 0; i < nevents; i++)
+			{
+				ASSERT_LT(n, m_events.size());
+				ASSERT_EQ(memcmp(entries[i].evt, m_events[n], m_events[n]->len), 0);
+				n++;
+			}
+		}
+		EXPECT_EQ(rc, SCAP_EOF);
+		EXPECT_EQ(n, m_events.size());
+
+		scap_close(h);
+	}
+}
+
+TEST_F(scap_savefile_test, seek_ts)
+{
+	write_capture(SCAP_COMPRESSION_NONE, 4096);
+
+	for(uint32_t threads : {0, 4})
+	{
+		scap_t* h = open_capture(0, threads);
+		ASSERT_NE(h, nullptr);
+
+		// the event with ts = N is the N-th one
+		ASSERT_EQ(scap_seek_ts(h, 500), SCAP_SUCCESS);
+		check_events(h, 499);
+
+		// backwards, after reaching the end
+		ASSERT_EQ(scap_seek_ts(h, 10), SCAP_SUCCESS);
+		check_events(h, 9);
+
+		// past the last event
+		scap_evt* evt;
+		uint16_t cpuid;
+		ASSERT_EQ(scap_seek_ts(h, 5000), SCAP_SUCCESS);
+		EXPECT_EQ(scap_next(h, &evt, &cpuid), SCAP_EOF);
+
+		scap_close(h);
+	}
+}
+
+TEST_F(scap_savefile_test, seek_ts_without_index)
+{
+	write_capture(SCAP_COMPRESSION_NONE);
+
+	scap_t* h = open_capture();
+	ASSERT_NE(h, nullptr);
+	EXPECT_EQ(scap_seek_ts(h, 500), SCAP_NOT_SUPPORTED);
+	scap_close(h);
+}
+
+TEST_F(scap_savefile_test, chunked_eventmask)
+{
+	write_capture(SCAP_COMPRESSION_NONE, 4096);
+
+	for(uint32_t threads : {0, 2})
+	{
+		scap_t* h = open_capture(0, threads, true);
+		ASSERT_NE(h, nullptr);
+
+		// only the last chunks have close events, the others are skipped
+		ASSERT_EQ(scap_clear_eventmask(h), SCAP_SUCCESS);
+		ASSERT_EQ(scap_set_eventmask(h, PPME_SYSCALL_CLOSE_E), SCAP_SUCCESS);
+		check_events(h, 900);
+
+		scap_close(h);
+	}
+}
+
+TEST_F(scap_savefile_test, eventmask_not_enabled)
+{
+	// unless asked for when opening, the event mask can't be set and all
+	// the events are replayed
+	for(uint32_t chunk_size : {0, 4096})
+	{
+		write_capture(SCAP_COMPRESSION_NONE, chunk_size);
+
+		scap_t* h = open_capture();
+		ASSERT_NE(h, nullptr);
+		EXPECT_EQ(scap_clear_eventmask(h), SCAP_FAILURE);
+		EXPECT_EQ(scap_set_eventmask(h, PPME_SYSCALL_CLOSE_E), SCAP_FAILURE);
+		check_events(h, 0);
+		scap_close(h);
+	}
+}
+
+#ifdef HAS_LZ4
+TEST_F(scap_savefile_test, lz4)
+{
+	// the compression is detected when reading
+	write_capture(SCAP_COMPRESSION_LZ4);
+	check_capture(0);
+	check_capture(4096);
+	check_capture_pipe();
+}
+
+TEST_F(scap_savefile_test, chunked_lz4)
+{
+	write_capture(SCAP_COMPRESSION_LZ4, 4096);
+	check_capture(0);
+	check_capture(0, 4);
+}
+#endif
+
+#ifdef HAS_ZSTD
+TEST_F(scap_savefile_test, zstd)
+{
+	write_capture(SCAP_COMPRESSION_ZSTD);
+	check_capture(0);
+	check_capture(4096);
+	check_capture_pipe();
+}
+
+TEST_F(scap_savefile_test, chunked_zstd)
+{
+	write_capture(SCAP_COMPRESSION_ZSTD, 4096);
+	check_capture(0);
+	check_capture(0, 4);
+}
+#endif
+
+TEST_F(scap_savefile_test, unsupported_compression)
+{
+	scap_open_args args = {};
+	args.mode = SCAP_MODE_LIVE;
+	args.test_input_data = &m_data;
+
+	char error[SCAP_LASTERR_SIZE];
+	int32_t rc;
+	scap_t* h = scap_open(args, error, &rc);
+	ASSERT_NE(h, nullptr) << error;
+
+	EXPECT_TRUE(scap_compression_supported(SCAP_COMPRESSION_NONE));
+	for(compression_mode compress : {SCAP_COMPRESSION_LZ4, SCAP_COMPRESSION_ZSTD})
+	{
+		if(scap_compression_supported(compress))
+		{
+			continue;
+		}
+		EXPECT_EQ(scap_dump_open(h, m_fname.c_str(), compress, true), nullptr);
+		EXPECT_EQ(scap_dump_open_chunked(h, m_fname.c_str(), compress, 4096, true), nullptr);
+	}
+
+	scap_close(h);
+}
+
+TEST_F(scap_savefile_test, async)
+{
+	// the whole capture fits in a buffer, so nothing can be dropped
+	write_capture(SCAP_COMPRESSION_NONE, 0, 1 << 20);
+	check_capture(0);
+	write_capture(SCAP_COMPRESSION_GZIP, 0, 1 << 20);
+	check_capture(0);
+}
+
+TEST_F(scap_savefile_test, async_drops)
+{
+	scap_open_args args = {};
+	args.mode = SCAP_MODE_LIVE;
+	args.test_input_data = &m_data;
+
+	char error[SCAP_LASTERR_SIZE];
+	int32_t rc;
+	scap_t* h = scap_open(args, error, &rc);
+	ASSERT_NE(h, nullptr) << error;
+
+	// nobody reads the pipe while the events are dumped, so the writer
+	// gets stuck once the pipe and the buffers are full
+	int fds[2];
+	ASSERT_EQ(pipe(fds), 0);
+	scap_dumper_t* d = scap_dump_open_fd(h, fds[1], SCAP_COMPRESSION_NONE, true);
+	ASSERT_NE(d, nullptr) << scap_getlasterr(h);
+	ASSERT_EQ(scap_dump_set_async(d, 4096, 2, error), SCAP_SUCCESS) << error;
+
+	uint64_t nevents = 0;
+	for(uint32_t j = 0; j < 4; j++)
+	{
+		for(auto evt : m_events)
+		{
+			ASSERT_EQ(scap_dump(h, d, evt, 0, 0), SCAP_SUCCESS);
+			nevents++;
+		}
+	}
+	uint64_t drops = scap_dump_get_drops(d);
+	EXPECT_GT(drops, 0);
+
+	// the events that weren't dropped are all in the file
+	std::thread drain([&]() {
+		FILE* f = fopen(m_fname.c_str(), "wb");
+		char buf[4096];
+		ssize_t n;
+		while((n = read(fds[0], buf, sizeof(buf))) > 0)
+		{
+			fwrite(buf, 1, n, f);
+		}
+		fclose(f);
+	});
+	scap_dump_close(d);
+	drain.join();
+	close(fds[0]);
+	scap_close(h);
+
+	h = open_capture();
+	ASSERT_NE(h, nullptr);
+	scap_evt* evt;
+	uint16_t cpuid;
+	uint64_t n = 0;
+	while((rc = scap_next(h, &evt, &cpuid)) == SCAP_SUCCESS)
+	{
+		n++;
+	}
+	EXPECT_EQ(rc, SCAP_EOF);
+	EXPECT_EQ(n, nevents - drops);
+	scap_close(h);
+}
+
+TEST_F(scap_savefile_test, async_unsupported)
+{
+	write_capture(SCAP_COMPRESSION_NONE);
+
+	scap_open_args args = {};
+	args.mode = SCAP_MODE_LIVE;
+	args.test_input_data = &m_data;
+
+	char error[SCAP_LASTERR_SIZE];
+	int32_t rc;
+	scap_t* h = scap_open(args, error, &rc);
+	ASSERT_NE(h, nullptr) << error;
+
+	scap_dumper_t* d = scap_dump_open_chunked(h, m_fname.c_str(), SCAP_COMPRESSION_NONE, 4096, true);
+	ASSERT_NE(d, nullptr) << scap_getlasterr(h);
+	EXPECT_EQ(scap_dump_set_async(d, 0, 0, error), SCAP_NOT_SUPPORTED);
+	scap_dump_close(d);
+	scap_close(h);
+}
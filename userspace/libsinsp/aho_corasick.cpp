@@ -0,0 +1,196 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string.h>
+
+#include <queue>
+
+#include "aho_corasick.h"
+
+static inline uint8_t fold(uint8_t c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+aho_corasick::aho_corasick():
+	m_case_insensitive(false),
+	m_built(false),
+	m_nclasses(1),
+	m_root(0)
+{
+	memset(m_class, 0, sizeof(m_class));
+}
+
+void aho_corasick::set_case_insensitive(bool case_insensitive)
+{
+	m_case_insensitive = case_insensitive;
+	m_built = false;
+}
+
+void aho_corasick::add_pattern(const char* pattern, size_t len)
+{
+	m_patterns.emplace_back(pattern, len);
+	m_built = false;
+}
+
+void aho_corasick::build()
+{
+	memset(m_class, 0, sizeof(m_class));
+	m_nclasses = 1;
+
+	for(auto& p : m_patterns)
+	{
+		for(char ch : p)
+		{
+			uint8_t c = m_case_insensitive ? fold((uint8_t)ch) : (uint8_t)ch;
+			if(m_class[c] == 0)
+			{
+				m_class[c] = (uint8_t)m_nclasses++;
+				if(m_case_insensitive && c >= 'a' && c <= 'z')
+				{
+					m_class[c - ('a' - 'A')] = m_class[c];
+				}
+			}
+		}
+	}
+
+	// The trie of the patterns. Since no state goes back to the root, a 0
+	// transition means no child.
+	m_trie.assign(m_nclasses, 0);
+	m_root = 0;
+
+	for(auto& p : m_patterns)
+	{
+		uint32_t t = m_root;
+		uint32_t* parent = &m_root;
+		for(char ch : p)
+		{
+			uint32_t r = row(t, (uint8_t)ch);
+			if(m_trie[r] == 0)
+			{
+				m_trie[r] = (uint32_t)m_trie.size();
+				m_trie.resize(m_trie.size() + m_nclasses, 0);
+			}
+			t = m_trie[r];
+			parent = &m_trie[r];
+		}
+		*parent |= s_flag;
+	}
+
+	// Visiting the states breadth first, the missing transitions become
+	// the ones of the failure state, which is less deep and then complete
+	std::vector<uint32_t> fail(m_trie.size() / m_nclasses, 0);
+	std::queue<uint32_t> queue;
+
+	m_next = m_trie;
+	for(uint32_t c = 0; c < m_nclasses; c++)
+	{
+		uint32_t& t = m_next[c];
+		if(t != 0)
+		{
+			t |= (m_root & s_flag);
+			queue.push(t);
+		}
+	}
+
+	while(!queue.empty())
+	{
+		uint32_t s = queue.front() & ~s_flag;
+		queue.pop();
+
+		for(uint32_t c = 0; c < m_nclasses; c++)
+		{
+			uint32_t& t = m_next[s + c];
+			uint32_t ft = m_next[fail[s / m_nclasses] + c];
+			if(t != 0)
+			{
+				fail[(t & ~s_flag) / m_nclasses] = ft & ~s_flag;
+				t |= (ft & s_flag);
+				queue.push(t);
+			}
+			else
+			{
+				t = ft;
+			}
+		}
+	}
+
+	m_built = true;
+}
+
+bool aho_corasick::contains(const char* str)
+{
+	if(!m_built)
+	{
+		build();
+	}
+
+	uint32_t t = m_root;
+	for(const uint8_t* p = (const uint8_t*)str; !(t & s_flag); p++)
+	{
+		if(*p == 0)
+		{
+			return false;
+		}
+		t = m_next[row(t, *p)];
+	}
+
+	return true;
+}
+
+bool aho_corasick::startswith(const char* str)
+{
+	if(!m_built)
+	{
+		build();
+	}
+
+	// The prefixes of the string are the states reached along the trie
+	uint32_t t = m_root;
+	for(const uint8_t* p = (const uint8_t*)str; !(t & s_flag); p++)
+	{
+		if(*p == 0)
+		{
+			return false;
+		}
+
+		t = m_trie[row(t, *p)];
+		if(t == 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool aho_corasick::endswith(const char* str)
+{
+	if(!m_built)
+	{
+		build();
+	}
+
+	uint32_t t = m_root;
+	for(const uint8_t* p = (const uint8_t*)str; *p != 0; p++)
+	{
+		t = m_next[row(t, *p)];
+	}
+
+	// The root transitions don't carry the flag of the empty pattern
+	return ((t | m_root) & s_flag) != 0;
+}
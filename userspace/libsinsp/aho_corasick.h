@@ -0,0 +1,80 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+//
+// Matches a NUL-terminated string against a set of patterns in a single
+// pass, telling whether any of them is contained in, a prefix of or a
+// suffix of the string. It's what "contains", "startswith" and "endswith"
+// checks with many values use instead of one scan per value.
+//
+// The patterns are compiled into the DFA of the Aho-Corasick automaton,
+// over an alphabet made only of the bytes found in the patterns, so that
+// each byte of the string costs one table lookup. In case-insensitive mode
+// the ASCII letters are folded, like strcasestr() does in the C locale.
+//
+// The automaton is built on the first match after a pattern is added.
+//
+class aho_corasick
+{
+public:
+	aho_corasick();
+
+	void set_case_insensitive(bool case_insensitive);
+	void add_pattern(const char* pattern, size_t len);
+
+	// The number of patterns added
+	size_t size() const
+	{
+		return m_patterns.size();
+	}
+
+	bool contains(const char* str);
+	bool startswith(const char* str);
+	bool endswith(const char* str);
+
+private:
+	void build();
+
+	// The transitions are stored as the offset of the row of the next
+	// state, with s_flag set if a pattern ends at the state (in m_trie) or
+	// at the state or at one of its suffixes (in m_next)
+	static const uint32_t s_flag = 0x80000000;
+
+	inline uint32_t row(uint32_t transition, uint8_t c) const
+	{
+		return (transition & ~s_flag) + m_class[c];
+	}
+
+	bool m_case_insensitive;
+	bool m_built;
+	std::vector<std::string> m_patterns;
+
+	// The alphabet: bytes not found in any pattern are mapped to class 0
+	uint8_t m_class[256];
+	uint32_t m_nclasses;
+
+	std::vector<uint32_t> m_trie; ///< m_nclasses transitions per state, 0 if there is no child
+	std::vector<uint32_t> m_next; ///< Same as m_trie, completed with the failure transitions
+	uint32_t m_root; ///< The transition to the root, with s_flag set for an empty pattern
+};
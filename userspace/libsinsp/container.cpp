@@ -432,7 +432,7 @@ void sinsp_container_manager::identify_category(sinsp_threadinfo *tinfo)
 		{
 			g_logger.format(sinsp_logger::SEV_DEBUG,
 					"identify_category (%ld) (%s): initial process for container, assigning CAT_CONTAINER",
-					tinfo->m_tid, tinfo->m_comm.c_str());
+					tinfo->m_tid, tinfo->m_comm->c_str());
 		}
 
 		tinfo->m_category = sinsp_threadinfo::CAT_CONTAINER;
@@ -449,7 +449,7 @@ void sinsp_container_manager::identify_category(sinsp_threadinfo *tinfo)
 		{
 			g_logger.format(sinsp_logger::SEV_DEBUG,
 					"identify_category (%ld) (%s): taking parent category %d",
-					tinfo->m_tid, tinfo->m_comm.c_str(), ptinfo->m_category);
+					tinfo->m_tid, tinfo->m_comm->c_str(), ptinfo->m_category);
 		}
 
 		tinfo->m_category = ptinfo->m_category;
@@ -468,7 +468,7 @@ void sinsp_container_manager::identify_category(sinsp_threadinfo *tinfo)
 		{
 			g_logger.format(sinsp_logger::SEV_DEBUG,
 					"identify_category (%ld) (%s): container metadata incomplete",
-					tinfo->m_tid, tinfo->m_comm.c_str());
+					tinfo->m_tid, tinfo->m_comm->c_str());
 		}
 
 		return;
@@ -489,7 +489,7 @@ void sinsp_container_manager::identify_category(sinsp_threadinfo *tinfo)
 	{
 		g_logger.format(sinsp_logger::SEV_DEBUG,
 				"identify_category (%ld) (%s): container health probe PT_NONE",
-				tinfo->m_tid, tinfo->m_comm.c_str());
+				tinfo->m_tid, tinfo->m_comm->c_str());
 
 		return;
 	}
@@ -514,7 +514,7 @@ void sinsp_container_manager::identify_category(sinsp_threadinfo *tinfo)
 	{
 		g_logger.format(sinsp_logger::SEV_DEBUG,
 				"identify_category (%ld) (%s): not under container init, assigning category %s",
-				tinfo->m_tid, tinfo->m_comm.c_str(),
+				tinfo->m_tid, tinfo->m_comm->c_str(),
 				sinsp_container_info::container_health_probe::probe_type_names[ptype].c_str());
 
 		// Each health probe type maps to a command category
@@ -147,15 +147,20 @@ const sinsp_container_info::container_mount_info *sinsp_container_info::mount_by
 	return NULL;
 }
 
+//
+// This is also called from the container lookup threads, so neither the
+// thread nor its strings come from the thread manager, whose pool and
+// interned tables are not thread safe
+//
 std::shared_ptr<sinsp_threadinfo> sinsp_container_info::get_tinfo(sinsp* inspector) const
 {
-	std::shared_ptr<sinsp_threadinfo> tinfo(inspector->build_threadinfo());
+	std::shared_ptr<sinsp_threadinfo> tinfo = std::make_shared<sinsp_threadinfo>(inspector);
 	tinfo->m_tid = -1;
 	tinfo->m_pid = -1;
 	tinfo->m_vtid = -2;
 	tinfo->m_vpid = -2;
-	tinfo->m_comm = "container:" + m_id;
-	tinfo->m_exe = "container:" + m_id;
+	tinfo->m_comm = interned<std::string>("container:" + m_id);
+	tinfo->m_exe = tinfo->m_comm;
 	tinfo->m_container_id = m_id;
 
 	return tinfo;
@@ -171,11 +176,11 @@ sinsp_container_info::container_health_probe::probe_type sinsp_container_info::m
                 g_logger.format(sinsp_logger::SEV_DEBUG,
 				"match_health_probe (%s): Matching tinfo %s %d against %s %d",
 				m_id.c_str(),
-				tinfo->m_exe.c_str(), tinfo->m_args.size(),
+				tinfo->m_exe->c_str(), tinfo->m_args->size(),
 				p.m_health_probe_exe.c_str(), p.m_health_probe_args.size());
 
-                return (p.m_health_probe_exe == tinfo->m_exe &&
-			p.m_health_probe_args == tinfo->m_args);
+                return (p.m_health_probe_exe == tinfo->get_exe() &&
+			p.m_health_probe_args == tinfo->get_args());
         };
 
 	auto match = std::find_if(m_health_probes.begin(),
@@ -189,6 +189,30 @@ uint64_t sinsp_dumper::next_write_position()
 	return position;
 }
 
+void sinsp_dumper::set_async(uint32_t buffer_size, uint32_t nbuffers)
+{
+	if(m_dumper == NULL)
+	{
+		throw sinsp_exception("dumper not opened yet");
+	}
+
+	char error[SCAP_LASTERR_SIZE];
+	if(scap_dump_set_async(m_dumper, buffer_size, nbuffers, error) != SCAP_SUCCESS)
+	{
+		throw sinsp_exception(error);
+	}
+}
+
+uint64_t sinsp_dumper::dropped_events()
+{
+	if(m_dumper == NULL)
+	{
+		return 0;
+	}
+
+	return scap_dump_get_drops(m_dumper);
+}
+
 void sinsp_dumper::flush()
 {
 	if(m_dumper == NULL)
@@ -109,6 +109,25 @@ public:
 	*/
 	void flush();
 
+	/*!
+	  \brief Move the compression and the writes of the file to a
+	  background thread, so that a slow disk doesn't slow down the
+	  inspector. Must be called after open() or fdopen().
+
+	  \param buffer_size The size of each buffer of events, 0 for the default.
+
+	  \param nbuffers The number of buffers, 0 for the default. When all
+	   of them are waiting to be written, the events are dropped and
+	   counted by dropped_events().
+	*/
+	void set_async(uint32_t buffer_size = 0, uint32_t nbuffers = 0);
+
+	/*!
+	  \brief Return the number of events dropped because the background
+	  writer couldn't keep up.
+	*/
+	uint64_t dropped_events();
+
 	/*!
 	  \brief Writes an event to the file.
 
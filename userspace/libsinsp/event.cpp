@@ -841,7 +841,7 @@ Json::Value sinsp_evt::get_param_as_json(uint32_t id, OUT const char** resolved_
 			sinsp_threadinfo* atinfo = m_inspector->get_thread_ref(*(int64_t *)payload, false, true).get();
 			if(atinfo != NULL)
 			{
-				string& tcomm = atinfo->m_comm;
+				const string& tcomm = atinfo->get_comm();
 
 				//
 				// Make sure the string will fit
@@ -1568,7 +1568,7 @@ const char* sinsp_evt::get_param_as_str(uint32_t id, OUT const char** resolved_s
 			sinsp_threadinfo* atinfo = m_inspector->get_thread_ref(*(int64_t *)payload, false, true).get();
 			if(atinfo != NULL)
 			{
-				string& tcomm = atinfo->m_comm;
+				const string& tcomm = atinfo->get_comm();
 
 				//
 				// Make sure the string will fit
@@ -2811,4 +2811,27 @@ bool sinsp_evt::clone_event(sinsp_evt &dest, const sinsp_evt &src)
 	dest.m_fdinfo_name_changed = src.m_fdinfo_name_changed;
 
 	return true;
+}
+
+void sinsp_evt::share_event(sinsp_evt &dest, const sinsp_evt &src)
+{
+	dest.m_inspector = src.m_inspector;
+	dest.m_pevt = src.m_pevt;
+	dest.m_poriginal_evt = src.m_poriginal_evt;
+	dest.m_cpuid = src.m_cpuid;
+	dest.m_evtnum = src.m_evtnum;
+	dest.m_flags = src.m_flags;
+	dest.m_params_loaded = src.m_params_loaded;
+	dest.m_info = src.m_info;
+	dest.m_params = src.m_params;
+	dest.m_tinfo_ref = src.m_tinfo_ref;
+	dest.m_tinfo = src.m_tinfo;
+	dest.m_fdinfo = src.m_fdinfo;
+	dest.m_fdinfo_ref = src.m_fdinfo_ref;
+	dest.m_fdinfo_name_changed = src.m_fdinfo_name_changed;
+	dest.m_iosize = src.m_iosize;
+	dest.m_errorcode = src.m_errorcode;
+	dest.m_rawbuf_str_len = src.m_rawbuf_str_len;
+	dest.m_filtered_out = src.m_filtered_out;
+	dest.m_event_info_table = src.m_event_info_table;
 }
\ No newline at end of file
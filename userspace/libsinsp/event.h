@@ -525,6 +525,10 @@ private:
 	int render_fd_json(Json::Value *ret, int64_t fd, const char** resolved_str, sinsp_evt::param_fmt fmt);
 	uint32_t get_dump_flags();
 	static bool clone_event(sinsp_evt& dest, const sinsp_evt& src);
+	// Points dest to the same event, thread and fd as src, which stays
+	// untouched while another thread reads dest. dest has its own storage
+	// for the rendered parameters, and is valid as long as src is.
+	static void share_event(sinsp_evt& dest, const sinsp_evt& src);
 
 VISIBILITY_PRIVATE
 	enum flags
@@ -588,6 +592,7 @@ VISIBILITY_PRIVATE
 	friend class test_helpers::event_builder;
 	friend class test_helpers::sinsp_mock;
 	friend class sinsp_usergroup_manager;
+	friend class sinsp_filter_workers;
 };
 
 /*@}*/
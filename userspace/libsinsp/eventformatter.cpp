@@ -160,6 +160,7 @@ void sinsp_evt_formatter::set_format(gen_event_formatter::output_format of, cons
 
 			const char * fstart = cfmt + j + 1;
 			uint32_t fsize = chk->parse_field_name(fstart, true, false);
+			chk->share_extraction(string(fstart, fsize));
 
 			j += fsize;
 			ASSERT(j <= lfmt.length());
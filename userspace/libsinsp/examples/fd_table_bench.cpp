@@ -0,0 +1,214 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Compares sinsp_fdtable with the unordered_map it replaced, on the fd
+// lookups of a read/write heavy process: most events read or write one
+// of a few busy fds (e.g. the sockets of a proxy), alternating between
+// them, some touch the other open fds, and a few open and close files,
+// taking the lowest free fd as the kernel does.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include <sinsp.h>
+
+using namespace std;
+
+// The previous fd table, with its cache of the last fd
+class unordered_fdtable
+{
+public:
+	unordered_fdtable(): m_last_accessed_fd(-1), m_last_accessed_fdinfo(NULL)
+	{
+	}
+
+	inline sinsp_fdinfo_t* find(int64_t fd)
+	{
+		if(m_last_accessed_fd != -1 && fd == m_last_accessed_fd)
+		{
+			return m_last_accessed_fdinfo;
+		}
+
+		auto it = m_table.find(fd);
+		if(it == m_table.end())
+		{
+			return NULL;
+		}
+		m_last_accessed_fd = fd;
+		m_last_accessed_fdinfo = &it->second;
+		return &it->second;
+	}
+
+	inline sinsp_fdinfo_t* add(int64_t fd, sinsp_fdinfo_t* fdinfo)
+	{
+		m_last_accessed_fd = -1;
+		return &m_table.emplace(fd, *fdinfo).first->second;
+	}
+
+	inline void erase(int64_t fd)
+	{
+		if(fd == m_last_accessed_fd)
+		{
+			m_last_accessed_fd = -1;
+		}
+		m_table.erase(fd);
+	}
+
+private:
+	std::unordered_map<int64_t, sinsp_fdinfo_t> m_table;
+	int64_t m_last_accessed_fd;
+	sinsp_fdinfo_t* m_last_accessed_fdinfo;
+};
+
+struct op
+{
+	enum
+	{
+		IO,
+		OPEN,
+		CLOSE,
+	} m_type;
+	int64_t m_fd;
+};
+
+static vector<op> make_ops(uint32_t nfds, uint32_t nops)
+{
+	mt19937 rng(42);
+	vector<int64_t> open_fds;
+	set<int64_t> free_fds;
+	vector<op> ops;
+	const uint32_t nbusy = 4;
+
+	for(uint32_t j = 0; j < nfds; j++)
+	{
+		ops.push_back({op::OPEN, j});
+		open_fds.push_back(j);
+	}
+
+	for(uint32_t j = 0; j < nops; j++)
+	{
+		op o;
+		uint32_t r = rng() % 100;
+
+		if(r < 3 && open_fds.size() > nbusy)
+		{
+			// A file is opened, read and closed
+			o.m_type = op::OPEN;
+			o.m_fd = free_fds.empty() ? (int64_t)open_fds.size() : *free_fds.begin();
+			free_fds.erase(o.m_fd);
+			ops.push_back(o);
+			ops.push_back({op::IO, o.m_fd});
+
+			size_t k = nbusy + rng() % (open_fds.size() - nbusy);
+			o.m_type = op::CLOSE;
+			o.m_fd = open_fds[k];
+			open_fds[k] = ops[ops.size() - 2].m_fd;
+			free_fds.insert(o.m_fd);
+		}
+		else if(r < 80)
+		{
+			o.m_type = op::IO;
+			o.m_fd = open_fds[rng() % min<size_t>(nbusy, open_fds.size())];
+		}
+		else
+		{
+			o.m_type = op::IO;
+			o.m_fd = open_fds[rng() % open_fds.size()];
+		}
+		ops.push_back(o);
+	}
+
+	return ops;
+}
+
+template<typename T>
+static double run(T& table, const vector<op>& ops, uint64_t& found)
+{
+	sinsp_fdinfo_t fdinfo;
+	fdinfo.m_name = "/var/lib/some/file/with/a/long/path";
+
+	found = 0;
+	auto start = chrono::steady_clock::now();
+	for(auto& o : ops)
+	{
+		switch(o.m_type)
+		{
+		case op::IO:
+		{
+			// The parsers then read the fdinfo, e.g. its name and flags
+			sinsp_fdinfo_t* fdinfo = table.find(o.m_fd);
+			found += (fdinfo != NULL) ? fdinfo->m_name.size() + fdinfo->is_socket_connected() : 0;
+			break;
+		}
+		case op::OPEN:
+			table.add(o.m_fd, &fdinfo);
+			break;
+		case op::CLOSE:
+			table.erase(o.m_fd);
+			break;
+		}
+	}
+	auto end = chrono::steady_clock::now();
+
+	return (double)chrono::duration_cast<chrono::nanoseconds>(end - start).count() / ops.size();
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t nops = (argc > 1) ? strtoul(argv[1], NULL, 10) : 5000000;
+
+	sinsp inspector;
+
+	for(uint32_t nfds : {16, 256, 2048})
+	{
+		auto ops = make_ops(nfds, nops);
+
+		// The best of a few alternated runs, to filter out the noise
+		uint64_t unordered_found;
+		uint64_t found;
+		double unordered_ns = 0;
+		double ns = 0;
+		for(uint32_t j = 0; j < 5; j++)
+		{
+			unordered_fdtable unordered;
+			sinsp_fdtable table(&inspector);
+			double unordered_run_ns = run(unordered, ops, unordered_found);
+			double run_ns = run(table, ops, found);
+			unordered_ns = (j == 0) ? unordered_run_ns : min(unordered_ns, unordered_run_ns);
+			ns = (j == 0) ? run_ns : min(ns, run_ns);
+		}
+
+		cout << nfds << " fds, " << nops << " events" << endl;
+		cout << "unordered_map: " << unordered_ns << " ns/event" << endl;
+		cout << "sinsp_fdtable: " << ns << " ns/event (" << unordered_ns / ns << "x)" << endl;
+
+		if(unordered_found != found)
+		{
+			cerr << "mismatch: " << unordered_found << " fds found in the unordered_map, "
+			     << found << " in sinsp_fdtable" << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,226 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Runs a large generated rule set on every event of a capture file, once
+// compiled as written and once through sinsp_filter_optimizer, and compares
+// the time spent in the filters. The rules put the expensive checks first,
+// like many hand-written rules do. The optimized rules are also run as flat
+// programs instead of walking their filtercheck trees, and through a
+// sinsp_filter_ruleset, which skips the ones that can't match the type of
+// each event. The number of matches of every rule must always be the same.
+// With --no-share, the filterchecks don't share the extracted values.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sinsp.h>
+#include "extraction_cache.h"
+#include "filter_optimizer.h"
+#include "filter_ruleset.h"
+
+using namespace std;
+
+static vector<string> make_rules(uint32_t nrules)
+{
+	vector<string> rules;
+
+	for(uint32_t j = 0; rules.size() < nrules; j++)
+	{
+		string n = to_string(j);
+		rules.push_back("proc.aname = sshd" + n + " and fd.name startswith /etc/" + n + " and evt.type = open");
+		rules.push_back("container.id != host and proc.name = bin" + n + " and evt.dir = <");
+		rules.push_back("(proc.name = a" + n + " or proc.name = b" + n + " or proc.name = c" + n + ") and (evt.type = execve or evt.type = clone)");
+		rules.push_back("fd.name glob /var/log/*" + n + "* and (evt.type = write or evt.type = pwrite)");
+		rules.push_back("user.name = u" + n + " and proc.cmdline contains x" + n + " and evt.type = connect");
+		rules.push_back("not proc.aname in (init" + n + ", systemd" + n + ") and fd.num = " + n + " and evt.type = read");
+	}
+	rules.resize(nrules);
+
+	return rules;
+}
+
+static vector<unique_ptr<sinsp_filter>> compile_rules(sinsp* inspector, const vector<string>& rules, bool optimize, bool program = false)
+{
+	vector<unique_ptr<sinsp_filter>> filters;
+	std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(inspector));
+
+	for(auto& r : rules)
+	{
+		sinsp_filter_compiler compiler(factory, r);
+		compiler.set_optimize(optimize);
+		compiler.set_program(program);
+		filters.emplace_back(compiler.compile());
+	}
+
+	return filters;
+}
+
+static uint64_t run_rules(vector<unique_ptr<sinsp_filter>>& filters, sinsp_evt* evt, vector<uint64_t>& matches)
+{
+	auto start = chrono::steady_clock::now();
+	for(size_t j = 0; j < filters.size(); j++)
+	{
+		if(filters[j]->run(evt))
+		{
+			matches[j]++;
+		}
+	}
+	auto end = chrono::steady_clock::now();
+
+	return chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		cerr << "usage: " << argv[0] << " <capture file> [number of rules] [--no-share]" << endl;
+		return 1;
+	}
+	uint32_t nrules = (argc > 2) ? strtoul(argv[2], NULL, 10) : 600;
+
+	sinsp inspector;
+	inspector.set_shared_extraction(!(argc > 3 && string(argv[3]) == "--no-share"));
+	auto rules = make_rules(nrules);
+	auto plain = compile_rules(&inspector, rules, false);
+	auto optimized = compile_rules(&inspector, rules, true);
+	auto program = compile_rules(&inspector, rules, true, true);
+
+	sinsp_filter_ruleset ruleset;
+	for(auto& f : compile_rules(&inspector, rules, true))
+	{
+		ruleset.add(f.release());
+	}
+
+	sinsp_filter_optimizer::stats stats;
+	sinsp_filter_factory factory(&inspector);
+	for(auto& r : rules)
+	{
+		sinsp_filter_optimizer optimizer(&factory);
+		libsinsp::filter::parser p(r);
+		auto e = p.parse();
+		optimizer.optimize(e);
+		stats.m_flattened += optimizer.get_stats().m_flattened;
+		stats.m_merged += optimizer.get_stats().m_merged;
+		stats.m_deduplicated += optimizer.get_stats().m_deduplicated;
+		stats.m_reordered += optimizer.get_stats().m_reordered;
+	}
+
+	vector<uint64_t> plain_matches(nrules, 0);
+	vector<uint64_t> optimized_matches(nrules, 0);
+	vector<uint64_t> program_matches(nrules, 0);
+	vector<uint64_t> ruleset_matches(nrules, 0);
+	vector<uint32_t> ids;
+	uint64_t plain_ns = 0;
+	uint64_t optimized_ns = 0;
+	uint64_t program_ns = 0;
+	uint64_t ruleset_ns = 0;
+	uint64_t nevts = 0;
+
+	inspector.open(argv[1]);
+	while(true)
+	{
+		sinsp_evt* evt;
+		int32_t res = inspector.next(&evt);
+		if(res == SCAP_EOF)
+		{
+			break;
+		}
+		if(res != SCAP_SUCCESS)
+		{
+			continue;
+		}
+
+		// Rotate the order to not favor any of them
+		for(uint32_t k = 0; k < 3; k++)
+		{
+			switch((nevts + k) % 3)
+			{
+			case 0:
+				plain_ns += run_rules(plain, evt, plain_matches);
+				break;
+			case 1:
+				optimized_ns += run_rules(optimized, evt, optimized_matches);
+				break;
+			default:
+				program_ns += run_rules(program, evt, program_matches);
+				break;
+			}
+		}
+		nevts++;
+
+		ids.clear();
+		auto start = chrono::steady_clock::now();
+		ruleset.run(evt, ids);
+		auto end = chrono::steady_clock::now();
+		ruleset_ns += chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+		for(uint32_t id : ids)
+		{
+			ruleset_matches[id]++;
+		}
+	}
+	inspector.close();
+
+	if(nevts == 0)
+	{
+		cerr << "no events in " << argv[1] << endl;
+		return 1;
+	}
+
+	cout << nrules << " rules, " << nevts << " events" << endl;
+	cout << "optimizer: " << stats.m_flattened << " flattened, "
+	     << stats.m_merged << " merged, "
+	     << stats.m_deduplicated << " deduplicated, "
+	     << stats.m_reordered << " reordered" << endl;
+	cout << "as written: " << (double)plain_ns / nevts << " ns/evt" << endl;
+	cout << "optimized:  " << (double)optimized_ns / nevts << " ns/evt"
+	     << " (" << (double)plain_ns / optimized_ns << "x)" << endl;
+	cout << "program:    " << (double)program_ns / nevts << " ns/evt"
+	     << " (" << (double)plain_ns / program_ns << "x, "
+	     << (double)optimized_ns / program_ns << "x optimized)" << endl;
+	cout << "ruleset:    " << (double)ruleset_ns / nevts << " ns/evt"
+	     << " (" << (double)plain_ns / ruleset_ns << "x), "
+	     << (double)ruleset.get_stats().m_num_skipped / nevts << " rules skipped per event" << endl;
+
+	if(inspector.get_extraction_cache())
+	{
+		auto& metrics = inspector.get_extraction_cache()->get_metrics();
+		cout << "shared extraction: " << metrics.m_num_extract_cache << " of "
+		     << metrics.m_num_extract << " extractions cached" << endl;
+	}
+
+	for(uint32_t j = 0; j < nrules; j++)
+	{
+		if(plain_matches[j] != optimized_matches[j] ||
+		   plain_matches[j] != program_matches[j] ||
+		   plain_matches[j] != ruleset_matches[j])
+		{
+			cerr << "mismatch on '" << rules[j] << "': " << plain_matches[j]
+			     << " matches as written, " << optimized_matches[j] << " optimized, "
+			     << program_matches[j] << " as a program, "
+			     << ruleset_matches[j] << " in the ruleset" << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
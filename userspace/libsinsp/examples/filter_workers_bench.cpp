@@ -0,0 +1,158 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Reads a capture file and runs a large generated rule set, with outputs,
+// on every event through sinsp_filter_workers, once on the calling thread
+// only and once on the given number of threads. Prints the time spent in
+// sinsp::next() and in the rules, per event. The matches and the outputs
+// of every rule must be the same both times.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sinsp.h>
+#include "filter_workers.h"
+
+using namespace std;
+
+static vector<pair<string, string>> make_rules(uint32_t nrules)
+{
+	vector<pair<string, string>> rules;
+
+	for(uint32_t j = 0; rules.size() < nrules; j++)
+	{
+		string n = to_string(j);
+		rules.emplace_back("proc.aname = sshd" + n + " and fd.name startswith /etc/" + n + " and evt.type = open",
+				   "%proc.name %proc.aname[2] %fd.name");
+		rules.emplace_back("fd.name contains " + n + " and evt.type in (open, openat, read, write)",
+				   "%evt.time %proc.name %proc.cmdline %fd.name %evt.args");
+		rules.emplace_back("(proc.name = a" + n + " or proc.pname contains " + n + ") and evt.dir = <",
+				   "%proc.pname %proc.name %evt.type %evt.res");
+		rules.emplace_back("fd.name glob /var/log/*" + n + "* and (evt.type = write or evt.type = pwrite)",
+				   "%user.name %fd.name %evt.buflen");
+		rules.emplace_back("proc.cmdline contains " + n + " and not proc.aname in (init" + n + ", systemd" + n + ")",
+				   "%proc.cmdline %proc.exepath %container.id");
+	}
+	rules.resize(nrules);
+
+	return rules;
+}
+
+struct bench_result
+{
+	uint64_t m_nevts = 0;
+	uint64_t m_next_ns = 0;
+	uint64_t m_run_ns = 0;
+	vector<uint64_t> m_matches;
+	vector<size_t> m_output_len;
+};
+
+static bench_result run(const char* fname, const vector<pair<string, string>>& rules, uint32_t nthreads)
+{
+	sinsp inspector;
+	sinsp_filter_workers workers(&inspector, nthreads);
+	bench_result res;
+
+	for(auto& r : rules)
+	{
+		workers.add(r.first, r.second);
+	}
+	res.m_matches.resize(rules.size(), 0);
+	res.m_output_len.resize(rules.size(), 0);
+
+	vector<sinsp_filter_workers::match> matches;
+
+	inspector.open(fname);
+	while(true)
+	{
+		sinsp_evt* evt;
+
+		auto start = chrono::steady_clock::now();
+		int32_t r = inspector.next(&evt);
+		auto parsed = chrono::steady_clock::now();
+		res.m_next_ns += chrono::duration_cast<chrono::nanoseconds>(parsed - start).count();
+
+		if(r == SCAP_EOF)
+		{
+			break;
+		}
+		if(r != SCAP_SUCCESS)
+		{
+			continue;
+		}
+
+		workers.run(evt, matches);
+		res.m_run_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - parsed).count();
+		res.m_nevts++;
+
+		for(auto& m : matches)
+		{
+			res.m_matches[m.m_id]++;
+			res.m_output_len[m.m_id] += m.m_output.size();
+		}
+	}
+	inspector.close();
+
+	return res;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc < 2)
+	{
+		cerr << "usage: " << argv[0] << " <capture file> [number of threads] [number of rules]" << endl;
+		return 1;
+	}
+	uint32_t nthreads = (argc > 2) ? strtoul(argv[2], NULL, 10) : 4;
+	uint32_t nrules = (argc > 3) ? strtoul(argv[3], NULL, 10) : 500;
+
+	auto rules = make_rules(nrules);
+	bench_result inline_res = run(argv[1], rules, 1);
+	bench_result threads_res = run(argv[1], rules, nthreads);
+
+	if(inline_res.m_nevts == 0)
+	{
+		cerr << "no events in " << argv[1] << endl;
+		return 1;
+	}
+
+	cout << nrules << " rules, " << inline_res.m_nevts << " events, "
+	     << thread::hardware_concurrency() << " CPUs" << endl;
+	cout << "next():    " << (double)inline_res.m_next_ns / inline_res.m_nevts << " ns/evt, "
+	     << (double)threads_res.m_next_ns / threads_res.m_nevts << " ns/evt" << endl;
+	cout << "1 thread:  " << (double)inline_res.m_run_ns / inline_res.m_nevts << " ns/evt" << endl;
+	cout << nthreads << " threads: " << (double)threads_res.m_run_ns / threads_res.m_nevts << " ns/evt"
+	     << " (" << (double)inline_res.m_run_ns / threads_res.m_run_ns << "x)" << endl;
+
+	for(uint32_t j = 0; j < nrules; j++)
+	{
+		if(inline_res.m_matches[j] != threads_res.m_matches[j] ||
+		   inline_res.m_output_len[j] != threads_res.m_output_len[j])
+		{
+			cerr << "mismatch on '" << rules[j].first << "': " << inline_res.m_matches[j]
+			     << " matches on 1 thread, " << threads_res.m_matches[j] << " on " << nthreads << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
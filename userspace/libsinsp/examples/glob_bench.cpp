@@ -0,0 +1,110 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Compares the time needed to match file paths against the glob patterns
+// of typical rules, with sinsp_utils::glob_match() that interprets the
+// pattern at each call and with the patterns compiled by glob_matcher.
+// The results of the two must always be the same.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sinsp.h>
+#include "glob_matcher.h"
+
+using namespace std;
+
+static const char* s_dirs[] = {"/etc/", "/usr/lib/", "/var/log/", "/home/user/.ssh/", "/proc/1/", "/dev/"};
+
+static vector<string> make_paths(uint32_t npaths)
+{
+	vector<string> paths;
+	uint32_t seed = 1;
+
+	for(uint32_t j = 0; j < npaths; j++)
+	{
+		seed = seed * 1103515245 + 12345;
+		string p = s_dirs[(seed >> 16) % (sizeof(s_dirs) / sizeof(s_dirs[0]))];
+		p += "file" + to_string((seed >> 8) % 100) + ((seed & 1) ? ".conf" : ".log");
+		paths.push_back(p);
+	}
+
+	return paths;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t npaths = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+	auto paths = make_paths(npaths);
+	const char* patterns[] = {
+		"/etc/*",
+		"*.log",
+		"/var/log/*.log*",
+		"/home/*/.ssh/*",
+		"/usr/lib/file?.conf",
+		"/proc/[0-9]*/file*",
+		"*/file*1*.conf",
+	};
+
+	for(const char* pattern : patterns)
+	{
+		glob_matcher g;
+		g.compile(pattern);
+
+		uint64_t fnmatch_matches = 0;
+		auto start = chrono::steady_clock::now();
+		for(auto& p : paths)
+		{
+			if(sinsp_utils::glob_match(pattern, p.c_str()))
+			{
+				fnmatch_matches++;
+			}
+		}
+		auto end = chrono::steady_clock::now();
+		uint64_t fnmatch_ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+
+		uint64_t compiled_matches = 0;
+		start = chrono::steady_clock::now();
+		for(auto& p : paths)
+		{
+			if(g.match(p.c_str(), p.size()))
+			{
+				compiled_matches++;
+			}
+		}
+		end = chrono::steady_clock::now();
+		uint64_t compiled_ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+
+		cout << pattern << ": " << (double)fnmatch_ns / npaths << " ns/path with glob_match, "
+		     << (double)compiled_ns / npaths << " ns/path compiled ("
+		     << (double)fnmatch_ns / compiled_ns << "x), "
+		     << compiled_matches << " matches" << endl;
+
+		if(fnmatch_matches != compiled_matches)
+		{
+			cerr << "mismatch on " << pattern << ": " << fnmatch_matches << " matches with glob_match, "
+			     << compiled_matches << " compiled" << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Measures the memory used by a synthetic table of JVM-like processes with
+// many threads each. The arguments, the environment and the cgroups of the
+// threads, about 3.7KB, are interned in the thread manager, so they are
+// only stored once per process.
+//
+// Prints the RSS growth of the table, per thread, next to the size of the
+// strings of a thread.
+//
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <sinsp.h>
+
+using namespace std;
+
+static uint64_t get_rss()
+{
+	ifstream statm("/proc/self/statm");
+	uint64_t size = 0;
+	uint64_t resident = 0;
+	statm >> size >> resident;
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t nprocs = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200;
+	uint32_t nthreads = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1000;
+
+	sinsp inspector;
+	sinsp_thread_manager* manager = inspector.m_thread_manager;
+	size_t strings_size = 0;
+	uint64_t start_rss = get_rss();
+
+	for(uint32_t p = 0; p < nprocs; p++)
+	{
+		string id = to_string(p);
+		vector<string> args = {"-Xms2g", "-Xmx4g", "-XX:+UseG1GC",
+			"-Dservice.instance=" + id, "-cp", "/opt/app/lib/" + string(1500, 'c') + ".jar",
+			"com.example.Main"};
+		vector<string> env = {"PATH=/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin",
+			"JAVA_HOME=/usr/lib/jvm/java-17-openjdk", "HOSTNAME=app-" + id,
+			"JAVA_TOOL_OPTIONS=" + string(500, 'o'), "CONFIG=" + string(1000, 's')};
+		sinsp_threadinfo::cgroups_t cgroups;
+		for(const char* subsys : {"cpu", "cpuset", "memory", "perf_event"})
+		{
+			cgroups.emplace_back(subsys, "/kubepods/burstable/pod" + id + "/" + string(64, 'f'));
+		}
+
+		for(uint32_t t = 0; t < nthreads; t++)
+		{
+			auto tinfo = inspector.build_threadinfo();
+			tinfo->m_tid = 1000000 + p * nthreads + t;
+			tinfo->m_pid = 1000000 + p * nthreads;
+			tinfo->set_comm("java");
+			tinfo->set_exe("/usr/lib/jvm/java-17-openjdk/bin/java");
+			tinfo->set_exepath("/usr/lib/jvm/java-17-openjdk/bin/java");
+			tinfo->set_args(args);
+			tinfo->m_env = manager->intern(env);
+			tinfo->m_cgroups = manager->intern(cgroups);
+			inspector.add_thread(tinfo);
+
+			if(p == 0 && t == 0)
+			{
+				strings_size = tinfo->get_comm().size() + tinfo->get_exe().size() +
+					tinfo->get_exepath().size();
+				for(const auto& it : args)
+				{
+					strings_size += it.size();
+				}
+				for(const auto& it : env)
+				{
+					strings_size += it.size();
+				}
+				for(const auto& it : cgroups)
+				{
+					strings_size += it.first.size() + it.second.size();
+				}
+			}
+		}
+	}
+
+	uint64_t rss = get_rss() - start_rss;
+	uint64_t nthreads_total = manager->get_thread_count();
+	cout << nthreads_total << " threads, " << manager->get_interned_count() << " interned values" << endl;
+	cout << "rss: " << rss / (1024 * 1024) << " MB, " << (nthreads_total ? rss / nthreads_total : 0)
+	     << " bytes per thread" << endl;
+	cout << "threadinfo: " << sizeof(sinsp_threadinfo) << " bytes, strings: "
+	     << strings_size << " bytes per thread" << endl;
+
+	return 0;
+}
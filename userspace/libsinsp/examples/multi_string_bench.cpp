@@ -0,0 +1,190 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Compares the time needed to match file paths against a growing number of
+// "contains", "icontains", "startswith" and "endswith" values, once with
+// one libc scan per value, like an or-chain of filterchecks does, and once
+// with aho_corasick, like the filterchecks merged by sinsp_filter_optimizer
+// do. The results of the two must always be the same.
+//
+
+#include <string.h>
+#include <strings.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "aho_corasick.h"
+
+using namespace std;
+
+static const char* s_dirs[] = {"/etc/", "/usr/lib/", "/usr/bin/", "/var/log/", "/proc/self/", "/home/user/.config/"};
+
+static vector<string> make_paths(uint32_t npaths)
+{
+	vector<string> paths;
+	uint32_t seed = 1;
+
+	for(uint32_t j = 0; j < npaths; j++)
+	{
+		seed = seed * 1103515245 + 12345;
+		string p = s_dirs[(seed >> 16) % (sizeof(s_dirs) / sizeof(s_dirs[0]))];
+		p += "file" + to_string((seed >> 8) % 5000) + ((seed & 1) ? ".conf" : ".log");
+		paths.push_back(p);
+	}
+
+	return paths;
+}
+
+static vector<string> make_patterns(uint32_t npatterns, bool prefixes)
+{
+	vector<string> patterns;
+
+	for(uint32_t j = 0; j < npatterns; j++)
+	{
+		if(prefixes)
+		{
+			patterns.push_back(string(s_dirs[j % (sizeof(s_dirs) / sizeof(s_dirs[0]))]) + "file" + to_string(j * 37));
+		}
+		else
+		{
+			patterns.push_back("file" + to_string(j * 37) + ".");
+		}
+	}
+
+	return patterns;
+}
+
+static uint64_t bench(const vector<string>& paths, const function<bool(const char*)>& match, uint64_t& nmatches)
+{
+	auto start = chrono::steady_clock::now();
+	for(auto& p : paths)
+	{
+		if(match(p.c_str()))
+		{
+			nmatches++;
+		}
+	}
+	auto end = chrono::steady_clock::now();
+
+	return chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t npaths = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200000;
+	auto paths = make_paths(npaths);
+	const char* ops[] = {"contains", "icontains", "startswith", "endswith"};
+
+	for(const char* op : ops)
+	{
+		for(uint32_t npatterns : {2, 8, 32, 128})
+		{
+			string opname = op;
+			auto patterns = make_patterns(npatterns, opname == "startswith");
+			if(opname == "endswith")
+			{
+				for(auto& p : patterns)
+				{
+					p += "log";
+				}
+			}
+
+			aho_corasick ac;
+			ac.set_case_insensitive(opname == "icontains");
+			for(auto& p : patterns)
+			{
+				ac.add_pattern(p.c_str(), p.size());
+			}
+
+			function<bool(const char*)> scan;
+			function<bool(const char*)> automaton;
+			if(opname == "contains" || opname == "icontains")
+			{
+				bool icase = opname == "icontains";
+				scan = [&patterns, icase](const char* s)
+				{
+					for(auto& p : patterns)
+					{
+						if((icase ? strcasestr(s, p.c_str()) : strstr(s, p.c_str())) != NULL)
+						{
+							return true;
+						}
+					}
+					return false;
+				};
+				automaton = [&ac](const char* s) { return ac.contains(s); };
+			}
+			else if(opname == "startswith")
+			{
+				scan = [&patterns](const char* s)
+				{
+					for(auto& p : patterns)
+					{
+						if(strncmp(s, p.c_str(), p.size()) == 0)
+						{
+							return true;
+						}
+					}
+					return false;
+				};
+				automaton = [&ac](const char* s) { return ac.startswith(s); };
+			}
+			else
+			{
+				scan = [&patterns](const char* s)
+				{
+					size_t len = strlen(s);
+					for(auto& p : patterns)
+					{
+						if(len >= p.size() && memcmp(s + len - p.size(), p.c_str(), p.size()) == 0)
+						{
+							return true;
+						}
+					}
+					return false;
+				};
+				automaton = [&ac](const char* s) { return ac.endswith(s); };
+			}
+
+			uint64_t scan_matches = 0;
+			uint64_t automaton_matches = 0;
+			automaton(""); // build the automaton out of the measurements
+			uint64_t scan_ns = bench(paths, scan, scan_matches);
+			uint64_t automaton_ns = bench(paths, automaton, automaton_matches);
+
+			cout << op << " with " << npatterns << " values: "
+			     << (double)scan_ns / npaths << " ns/str with one scan per value, "
+			     << (double)automaton_ns / npaths << " ns/str with aho_corasick ("
+			     << (double)scan_ns / automaton_ns << "x), "
+			     << scan_matches << " matches" << endl;
+
+			if(scan_matches != automaton_matches)
+			{
+				cerr << "mismatch on " << op << ": " << scan_matches << " matches with one scan per value, "
+				     << automaton_matches << " with aho_corasick" << endl;
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Compares the per-event cost of polling the pending state events queue
+// in sinsp::next() with a plain tbb::concurrent_queue and with
+// libsinsp::pending_queue, both while the queue is empty and while a
+// background thread injects an element every millisecond, like an async
+// container lookup would.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include <sinsp.h>
+#include "pending_queue.h"
+#include "tbb/concurrent_queue.h"
+
+using namespace std;
+
+typedef shared_ptr<sinsp_evt> evt_ptr;
+
+template<typename Q>
+static double bench(Q& q, uint64_t npolls, bool inject, uint64_t* npopped)
+{
+	atomic<bool> stop(false);
+	thread producer;
+	evt_ptr evt;
+
+	if(inject)
+	{
+		producer = thread([&]() {
+			while(!stop.load(memory_order_relaxed))
+			{
+				q.push(make_shared<sinsp_evt>());
+				this_thread::sleep_for(chrono::milliseconds(1));
+			}
+		});
+	}
+
+	*npopped = 0;
+	auto start = chrono::steady_clock::now();
+	for(uint64_t j = 0; j < npolls; j++)
+	{
+		if(q.try_pop(evt))
+		{
+			(*npopped)++;
+		}
+	}
+	auto end = chrono::steady_clock::now();
+
+	if(inject)
+	{
+		stop = true;
+		producer.join();
+		while(q.try_pop(evt))
+		{
+		}
+	}
+
+	return (double)chrono::duration_cast<chrono::nanoseconds>(end - start).count() / npolls;
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t npolls = (argc > 1) ? strtoull(argv[1], NULL, 10) : 100000000;
+	uint64_t npopped;
+
+	cout << "polls per run: " << npolls << endl;
+
+	for(bool inject : {false, true})
+	{
+		tbb::concurrent_queue<evt_ptr> tbb_queue;
+		libsinsp::pending_queue<evt_ptr> pending;
+
+		double tbb_ns = bench(tbb_queue, npolls, inject, &npopped);
+		cout << (inject ? "[1 evt/ms] " : "[empty]    ")
+		     << "tbb::concurrent_queue::try_pop:  " << tbb_ns << " ns/evt"
+		     << " (" << npopped << " popped)" << endl;
+
+		double pending_ns = bench(pending, npolls, inject, &npopped);
+		cout << (inject ? "[1 evt/ms] " : "[empty]    ")
+		     << "libsinsp::pending_queue::try_pop: " << pending_ns << " ns/evt"
+		     << " (" << npopped << " popped)" << endl;
+	}
+
+	return 0;
+}
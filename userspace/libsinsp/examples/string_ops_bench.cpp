@@ -0,0 +1,180 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Compares the string comparisons of the filters, done with the extracted
+// lengths and memmem.h, with the libc calls on NUL-terminated strings that
+// they replace, on short (file paths) and long (command lines, buffers)
+// operands. The results of the two must always be the same.
+//
+
+#include <string.h>
+#include <strings.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sinsp.h>
+#include "filterchecks.h"
+#include "memmem.h"
+
+using namespace std;
+
+// The comparisons as they were done before, through the same kind of
+// dispatch on the operator and the type as flt_compare()
+__attribute__((noinline))
+static bool libc_compare(cmpop op, ppm_param_type type, const char* operand1, const char* operand2, uint32_t op1_len, uint32_t op2_len)
+{
+	if(type == PT_BYTEBUF)
+	{
+		return memmem(operand1, op1_len, operand2, op2_len) != NULL;
+	}
+
+	switch(op)
+	{
+	case CO_EQ:
+		return strcmp(operand1, operand2) == 0;
+	case CO_CONTAINS:
+		return strstr(operand1, operand2) != NULL;
+	case CO_ICONTAINS:
+		return strcasestr(operand1, operand2) != NULL;
+	case CO_STARTSWITH:
+		return strncmp(operand1, operand2, strlen(operand2)) == 0;
+	case CO_ENDSWITH:
+		return sinsp_utils::endswith(operand1, operand2);
+	default:
+		return false;
+	}
+}
+
+static vector<string> make_strings(uint32_t nstrings, uint32_t len)
+{
+	vector<string> strings;
+	uint32_t seed = 1;
+
+	for(uint32_t j = 0; j < nstrings; j++)
+	{
+		string s;
+		while(s.size() < len)
+		{
+			seed = seed * 1103515245 + 12345;
+			s += "/usr/lib/x86_64-linux-gnu/" + to_string((seed >> 16) % 1000);
+		}
+		s.resize(len);
+		strings.push_back(s);
+	}
+
+	return strings;
+}
+
+template<typename F>
+static uint64_t bench(const vector<string>& strings, uint32_t nrounds, const F& cmp, uint64_t& nmatches)
+{
+	auto start = chrono::steady_clock::now();
+	for(uint32_t r = 0; r < nrounds; r++)
+	{
+		for(auto& s : strings)
+		{
+			if(cmp(s))
+			{
+				nmatches++;
+			}
+		}
+	}
+	auto end = chrono::steady_clock::now();
+
+	return chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t nstrings = 1000;
+	cout << "memmem implementation: " << sinsp_memmem_impl() << endl;
+
+	for(uint32_t len : {24, 256, 4096})
+	{
+		auto strings = make_strings(nstrings, len);
+		uint32_t nrounds = 4000000 / (nstrings * (len / 24 + 1)) + 1;
+
+		// found near the end of the strings, or not at all
+		string tail = strings[0].substr(len - 6);
+		const char* ops[] = {"=", "contains", "icontains", "bcontains", "startswith", "endswith"};
+		for(const char* op : ops)
+		{
+			string opname = op;
+			for(const string& value : {tail, string("/nonexistent")})
+			{
+				char* v = (char*)value.c_str();
+				uint32_t vlen = (uint32_t)value.size();
+				cmpop cop = CO_EQ;
+				ppm_param_type type = PT_CHARBUF;
+				if(opname == "contains")
+				{
+					cop = CO_CONTAINS;
+				}
+				else if(opname == "icontains")
+				{
+					cop = CO_ICONTAINS;
+				}
+				else if(opname == "bcontains")
+				{
+					cop = CO_BCONTAINS;
+					type = PT_BYTEBUF;
+				}
+				else if(opname == "startswith")
+				{
+					cop = CO_STARTSWITH;
+				}
+				else if(opname == "endswith")
+				{
+					cop = CO_ENDSWITH;
+				}
+
+				auto libc = [cop, type, v, vlen](const string& s)
+				{
+					return libc_compare(cop, type, s.c_str(), v, s.size(), vlen);
+				};
+				auto fast = [cop, type, v, vlen](const string& s)
+				{
+					return flt_compare(cop, type, (void*)s.c_str(), v, s.size(), vlen);
+				};
+
+				uint64_t libc_matches = 0;
+				uint64_t fast_matches = 0;
+				uint64_t libc_ns = bench(strings, nrounds, libc, libc_matches);
+				uint64_t fast_ns = bench(strings, nrounds, fast, fast_matches);
+				double ncmps = (double)nstrings * nrounds;
+
+				cout << len << " bytes, " << op << " '" << value << "': "
+				     << libc_ns / ncmps << " ns with libc, "
+				     << fast_ns / ncmps << " ns with lengths ("
+				     << (double)libc_ns / fast_ns << "x)" << endl;
+
+				if(libc_matches != fast_matches)
+				{
+					cerr << "mismatch on " << op << ": " << libc_matches << " matches with libc, "
+					     << fast_matches << " with lengths" << endl;
+					return 1;
+				}
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,138 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Measures the latency of sinsp::next() while the inactive threads are
+// purged from a large thread table: a few threads generate all the
+// events, one per millisecond, while the others exited without the
+// inspector seeing it, and are removed once they time out.
+//
+// Prints the histogram of the next() latencies, by power of 2.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <sinsp.h>
+#include <scap_test.h>
+
+using namespace std;
+
+static const int64_t first_tid = 1000000;
+static const uint32_t nactive = 1000;
+
+static vector<scap_evt*> make_events(uint32_t nevents)
+{
+	vector<scap_evt*> events;
+	char error[SCAP_LASTERR_SIZE];
+	uint64_t ts = 1566230400000000000;
+
+	for(uint32_t j = 0; j < nevents; j++)
+	{
+		scap_sized_buffer buf = {NULL, 0};
+		size_t size;
+
+		scap_event_encode_params(buf, &size, error, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDONLY, 0);
+		buf.buf = malloc(size);
+		buf.size = size;
+		if(buf.buf == NULL ||
+		   scap_event_encode_params(buf, &size, error, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDONLY, 0) != SCAP_SUCCESS)
+		{
+			cerr << "cannot encode the events" << endl;
+			exit(1);
+		}
+
+		scap_evt* evt = (scap_evt*)buf.buf;
+		evt->ts = ts;
+		evt->tid = first_tid + j % nactive;
+		events.push_back(evt);
+		ts += 1000000;
+	}
+
+	return events;
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t nthreads = (argc > 1) ? strtoul(argv[1], NULL, 10) : 100000;
+	uint32_t nevents = (argc > 2) ? strtoul(argv[2], NULL, 10) : 200000;
+
+	vector<scap_evt*> events = make_events(nevents);
+	scap_test_input_data data = {};
+	data.events = events.data();
+	data.event_count = events.size();
+
+	sinsp inspector;
+	inspector.open_test_input(&data);
+
+	for(uint32_t j = 0; j < nthreads; j++)
+	{
+		auto tinfo = inspector.build_threadinfo();
+		tinfo->m_tid = first_tid + j;
+		tinfo->m_pid = tinfo->m_tid;
+		tinfo->m_ptid = 1;
+		tinfo->set_comm("bench");
+		tinfo->set_exe("/usr/bin/bench");
+		inspector.add_thread(tinfo);
+	}
+
+	vector<uint64_t> histogram(64, 0);
+	uint64_t max_ns = 0;
+	uint64_t total_ns = 0;
+	sinsp_evt* evt;
+
+	while(true)
+	{
+		auto start = chrono::steady_clock::now();
+		int32_t res = inspector.next(&evt);
+		auto end = chrono::steady_clock::now();
+		if(res != SCAP_SUCCESS)
+		{
+			break;
+		}
+
+		uint64_t ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+		uint32_t bucket = 0;
+		while(bucket < 63 && (1ULL << (bucket + 1)) <= ns)
+		{
+			bucket++;
+		}
+		histogram[bucket]++;
+		max_ns = max(max_ns, ns);
+		total_ns += ns;
+	}
+
+	cout << nthreads << " threads, " << nevents << " events, "
+	     << inspector.m_thread_manager->get_thread_count() << " threads left" << endl;
+	cout << "average: " << total_ns / nevents << " ns, max: " << max_ns << " ns" << endl;
+	for(uint32_t j = 0; j < histogram.size(); j++)
+	{
+		if(histogram[j] != 0)
+		{
+			cout << (1ULL << j) << "-" << (1ULL << (j + 1)) << " ns: " << histogram[j] << endl;
+		}
+	}
+
+	inspector.close();
+	for(auto evt : events)
+	{
+		free(evt);
+	}
+
+	return 0;
+}
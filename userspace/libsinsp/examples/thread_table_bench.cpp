@@ -0,0 +1,203 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Compares threadinfo_map_t with the unordered_map it replaced, on a host
+// with many threads: most operations look up the threads that run the
+// most, some look up threads that exited, and a few threads exit while
+// others are created with the next tids, as the kernel allocates them.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <sinsp.h>
+
+using namespace std;
+
+// The previous thread table
+class unordered_threadinfo_map
+{
+public:
+	typedef std::shared_ptr<sinsp_threadinfo> ptr_t;
+
+	inline void put(ptr_t tinfo)
+	{
+		m_threads[tinfo->m_tid] = std::move(tinfo);
+	}
+
+	inline sinsp_threadinfo* get(uint64_t tid)
+	{
+		auto it = m_threads.find(tid);
+		if (it == m_threads.end())
+		{
+			return  nullptr;
+		}
+		return it->second.get();
+	}
+
+	inline void erase(uint64_t tid)
+	{
+		m_threads.erase(tid);
+	}
+
+private:
+	std::unordered_map<int64_t, ptr_t> m_threads;
+};
+
+struct op
+{
+	enum
+	{
+		GET,
+		EXIT,
+	} m_type;
+	int64_t m_tid;
+	int64_t m_new_tid; ///< For EXIT, the tid of the thread created after
+};
+
+static vector<op> make_ops(uint32_t nthreads, uint32_t nops, vector<int64_t>& initial)
+{
+	mt19937 rng(42);
+	const int64_t pid_max = 4194304;
+	vector<int64_t> live;
+	vector<op> ops;
+	int64_t next_tid = 1000;
+
+	for(uint32_t j = 0; j < nthreads; j++)
+	{
+		live.push_back(next_tid);
+		next_tid += 1 + rng() % 4;
+	}
+	initial = live;
+
+	for(uint32_t j = 0; j < nops; j++)
+	{
+		op o;
+		uint32_t r = rng() % 100;
+
+		if(r < 2)
+		{
+			// A thread exits and another one starts
+			size_t k = rng() % live.size();
+			o.m_type = op::EXIT;
+			o.m_tid = live[k];
+			o.m_new_tid = next_tid;
+			live[k] = next_tid;
+			next_tid = (next_tid % pid_max) + 1 + rng() % 4;
+		}
+		else if(r < 7)
+		{
+			// A thread that exited, or not seen yet
+			o.m_type = op::GET;
+			o.m_tid = next_tid + pid_max;
+		}
+		else if(r < 80)
+		{
+			// The threads that run the most, 1% of them
+			o.m_type = op::GET;
+			o.m_tid = live[rng() % (live.size() / 100 + 1)];
+		}
+		else
+		{
+			o.m_type = op::GET;
+			o.m_tid = live[rng() % live.size()];
+		}
+		ops.push_back(o);
+	}
+
+	return ops;
+}
+
+template<typename T>
+static double run(T& table, const vector<int64_t>& initial, const vector<op>& ops, vector<threadinfo_map_t::ptr_t>& pool, uint64_t& found)
+{
+	vector<threadinfo_map_t::ptr_t> free_threads = pool;
+
+	for(int64_t tid : initial)
+	{
+		auto tinfo = free_threads.back();
+		free_threads.pop_back();
+		tinfo->m_tid = tid;
+		table.put(tinfo);
+	}
+
+	found = 0;
+	auto start = chrono::steady_clock::now();
+	for(auto& o : ops)
+	{
+		sinsp_threadinfo* tinfo = table.get(o.m_tid);
+		if(o.m_type == op::GET)
+		{
+			found += (tinfo != nullptr) ? 1 : 0;
+		}
+		else
+		{
+			// The exited thread is reused for the new one
+			table.erase(o.m_tid);
+			auto newti = free_threads.back();
+			free_threads.pop_back();
+			newti->m_tid = o.m_new_tid;
+			table.put(newti);
+			free_threads.push_back(pool[tinfo->m_pid]);
+		}
+	}
+	auto end = chrono::steady_clock::now();
+
+	return (double)chrono::duration_cast<chrono::nanoseconds>(end - start).count() / ops.size();
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t nthreads = (argc > 1) ? strtoul(argv[1], NULL, 10) : 100000;
+	uint32_t nops = (argc > 2) ? strtoul(argv[2], NULL, 10) : 10000000;
+
+	vector<int64_t> initial;
+	auto ops = make_ops(nthreads, nops, initial);
+
+	vector<threadinfo_map_t::ptr_t> pool;
+	for(uint32_t j = 0; j < nthreads + 1; j++)
+	{
+		// The pid is used to find the thread back in the pool
+		pool.push_back(make_shared<sinsp_threadinfo>(nullptr));
+		pool.back()->m_pid = j;
+	}
+
+	uint64_t unordered_found;
+	uint64_t open_found;
+	unordered_threadinfo_map unordered;
+	threadinfo_map_t open;
+	double unordered_ns = run(unordered, initial, ops, pool, unordered_found);
+	double open_ns = run(open, initial, ops, pool, open_found);
+
+	cout << nthreads << " threads, " << nops << " operations" << endl;
+	cout << "unordered_map:   " << unordered_ns << " ns/op" << endl;
+	cout << "open addressing: " << open_ns << " ns/op (" << unordered_ns / open_ns << "x)" << endl;
+
+	if(unordered_found != open_found)
+	{
+		cerr << "mismatch: " << unordered_found << " threads found in the unordered_map, "
+		     << open_found << " with open addressing" << endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+//
+// Compares the time needed by the membership tests of "in" checks with
+// the unordered_set of filter_value_t they used before and with
+// filter_value_set, for lists of process names and of ports of several
+// sizes. Half of the looked up values, picked at random, are in the list. The results of the
+// two must always be the same.
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <sinsp.h>
+#include "filter_value.h"
+#include "filter_value_set.h"
+
+using namespace std;
+
+static string make_name(uint32_t j)
+{
+	static const char* s_prefixes[] = {"", "kube-", "containerd-shim-", "systemd-"};
+	return s_prefixes[j % 4] + string("proc") + to_string(j * 7919);
+}
+
+static void run(const string& what, vector<vector<uint8_t>>& list, vector<vector<uint8_t>>& lookups)
+{
+	unordered_set<filter_value_t, g_hash_membuf, g_equal_to_membuf> members;
+	filter_value_set set;
+	for(auto& v : list)
+	{
+		members.insert(filter_value_t(&v[0], (uint32_t)v.size()));
+		set.insert(&v[0], (uint32_t)v.size());
+	}
+
+	uint64_t members_found = 0;
+	auto start = chrono::steady_clock::now();
+	for(uint32_t r = 0; r < 100; r++)
+	{
+		for(auto& v : lookups)
+		{
+			members_found += (members.find(filter_value_t(&v[0], (uint32_t)v.size())) != members.end());
+		}
+	}
+	auto end = chrono::steady_clock::now();
+	uint64_t members_ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+
+	uint64_t set_found = 0;
+	start = chrono::steady_clock::now();
+	for(uint32_t r = 0; r < 100; r++)
+	{
+		for(auto& v : lookups)
+		{
+			set_found += set.contains(&v[0], (uint32_t)v.size());
+		}
+	}
+	end = chrono::steady_clock::now();
+	uint64_t set_ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+
+	static const char* s_layouts[] = {"empty", "integers", "small", "hash"};
+	double n = (double)lookups.size() * 100;
+	cout << what << " (" << s_layouts[set.get_layout()] << "): "
+	     << members_ns / n << " ns/lookup with unordered_set, "
+	     << set_ns / n << " ns/lookup with filter_value_set ("
+	     << (double)members_ns / set_ns << "x)" << endl;
+
+	if(members_found != set_found)
+	{
+		cerr << "mismatch on " << what << ": " << members_found << " found with unordered_set, "
+		     << set_found << " with filter_value_set" << endl;
+		exit(1);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t nlookups = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10000;
+	uint32_t sizes[] = {4, 8, 32, 256, 4096};
+
+	for(uint32_t size : sizes)
+	{
+		vector<vector<uint8_t>> names;
+		vector<vector<uint8_t>> ports;
+		for(uint32_t j = 0; j < size; j++)
+		{
+			string name = make_name(j);
+			names.emplace_back(name.begin(), name.end());
+			uint16_t port = (uint16_t)(j * 13 + 1);
+			ports.emplace_back((uint8_t*)&port, (uint8_t*)&port + sizeof(port));
+		}
+
+		vector<vector<uint8_t>> name_lookups;
+		vector<vector<uint8_t>> port_lookups;
+		uint32_t seed = 1;
+		for(uint32_t j = 0; j < nlookups; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			uint32_t k = (seed >> 8) % (size * 2);
+			string name = make_name(k);
+			name_lookups.emplace_back(name.begin(), name.end());
+			uint16_t port = (uint16_t)(k * 13 + 1);
+			port_lookups.emplace_back((uint8_t*)&port, (uint8_t*)&port + sizeof(port));
+		}
+
+		run(to_string(size) + " names", names, name_lookups);
+		run(to_string(size) + " ports", ports, port_lookups);
+	}
+
+	return 0;
+}
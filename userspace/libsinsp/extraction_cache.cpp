@@ -0,0 +1,104 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "sinsp.h"
+#include "extraction_cache.h"
+
+sinsp_extraction_cache::sinsp_extraction_cache():
+	m_metrics()
+{
+	m_uncached.m_evtnum = UINT64_MAX;
+	m_uncached.m_owner = NULL;
+	m_uncached.m_res = false;
+}
+
+uint32_t sinsp_extraction_cache::get_key(const std::string& field)
+{
+	auto it = m_keys.find(field);
+	if(it != m_keys.end())
+	{
+		return it->second;
+	}
+
+	uint32_t key = (uint32_t)m_keys.size();
+	m_keys[field] = key;
+
+	entry e;
+	e.m_evtnum = UINT64_MAX;
+	e.m_owner = NULL;
+	e.m_res = false;
+	m_entries.push_back(e);
+	m_entries.push_back(e);
+
+	return key;
+}
+
+const sinsp_extraction_cache::entry& sinsp_extraction_cache::fill(sinsp_filter_check* chk, uint32_t key, sinsp_evt* evt, bool sanitize_strings)
+{
+	entry& e = m_entries[key * 2 + (sanitize_strings ? 1 : 0)];
+	uint64_t en = evt->get_num();
+
+	// Extracting again overwrites the storage of chk, that the values of
+	// the other entry of the key may point to
+	entry& other = m_entries[key * 2 + (sanitize_strings ? 0 : 1)];
+	if(other.m_owner == chk)
+	{
+		other.m_evtnum = UINT64_MAX;
+		other.m_owner = NULL;
+	}
+
+	// The events that don't come from the capture, like the container
+	// events, aren't numbered and can't be cached
+	if(en == 0)
+	{
+		if(e.m_owner == chk)
+		{
+			e.m_evtnum = UINT64_MAX;
+			e.m_owner = NULL;
+		}
+
+		m_uncached.m_res = chk->extract(evt, m_uncached.m_values, sanitize_strings);
+		return m_uncached;
+	}
+
+	e.m_res = chk->extract(evt, e.m_values, sanitize_strings);
+	e.m_evtnum = en;
+	e.m_owner = chk;
+
+	return e;
+}
+
+void sinsp_extraction_cache::forget(const sinsp_filter_check* chk)
+{
+	for(auto& e : m_entries)
+	{
+		if(e.m_owner == chk)
+		{
+			e.m_evtnum = UINT64_MAX;
+			e.m_owner = NULL;
+		}
+	}
+}
+
+void sinsp_extraction_cache::clear()
+{
+	for(auto& e : m_entries)
+	{
+		e.m_evtnum = UINT64_MAX;
+		e.m_owner = NULL;
+	}
+}
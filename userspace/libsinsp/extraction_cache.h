@@ -0,0 +1,133 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "filterchecks.h"
+
+//
+// The values extracted from the current event, shared by all the
+// filterchecks of an inspector, from all the filters and formatters, that
+// extract the same field with the same argument. Many rules check the same
+// fields, e.g. proc.name or fd.name, which are then extracted only once per
+// event instead of once per rule.
+//
+// The fields are identified by their name as written in the filter or in
+// the format, argument included (e.g. "proc.aname[2]"). The cached values
+// point to the storage of the filtercheck that extracted them, which stays
+// valid until that filtercheck extracts again: the entries are then valid
+// for a single event number, and forgotten when their filtercheck is
+// deleted.
+//
+// The filterchecks whose values depend on the events they extracted before
+// (e.g. evt.deltatime or thread.cpu) don't share them.
+//
+class sinsp_extraction_cache
+{
+public:
+	sinsp_extraction_cache();
+
+	// The key of a field, given its name
+	uint32_t get_key(const std::string& field);
+
+	// The values of the field for evt, extracted by chk unless another
+	// filtercheck extracted them already
+	inline bool extract(sinsp_filter_check* chk, uint32_t key, sinsp_evt* evt, OUT std::vector<extract_value_t>& values, bool sanitize_strings)
+	{
+		const entry& e = lookup(chk, key, evt, sanitize_strings);
+		values = e.m_values;
+		return e.m_res;
+	}
+
+	// The same, for the fields with a single value
+	inline uint8_t* extract(sinsp_filter_check* chk, uint32_t key, sinsp_evt* evt, OUT uint32_t* len, bool sanitize_strings)
+	{
+		const entry& e = lookup(chk, key, evt, sanitize_strings);
+		if(!e.m_res || e.m_values.empty())
+		{
+			return NULL;
+		}
+		*len = e.m_values[0].len;
+		return e.m_values[0].ptr;
+	}
+
+	// Forgets the values extracted by chk
+	void forget(const sinsp_filter_check* chk);
+
+	// Forgets all the values, e.g. when a new capture starts and the event
+	// numbers start over
+	void clear();
+
+	// The number of different fields
+	size_t size() const
+	{
+		return m_keys.size();
+	}
+
+	// m_num_extract and m_num_extract_cache are the extractions asked to
+	// the cache and the ones that could use a cached value
+	const check_cache_metrics& get_metrics() const
+	{
+		return m_metrics;
+	}
+
+private:
+	struct entry
+	{
+		uint64_t m_evtnum;
+		const sinsp_filter_check* m_owner;
+		bool m_res;
+		std::vector<extract_value_t> m_values;
+	};
+
+	inline const entry& lookup(sinsp_filter_check* chk, uint32_t key, sinsp_evt* evt, bool sanitize_strings)
+	{
+		entry& e = m_entries[key * 2 + (sanitize_strings ? 1 : 0)];
+
+		m_metrics.m_num_extract++;
+
+		if(e.m_evtnum == evt->get_num() && e.m_owner != NULL)
+		{
+			m_metrics.m_num_extract_cache++;
+			if(chk->m_cache_metrics != NULL)
+			{
+				chk->m_cache_metrics->m_num_extract_cache++;
+			}
+			return e;
+		}
+
+		return fill(chk, key, evt, sanitize_strings);
+	}
+
+	const entry& fill(sinsp_filter_check* chk, uint32_t key, sinsp_evt* evt, bool sanitize_strings);
+
+	std::unordered_map<std::string, uint32_t> m_keys;
+
+	// Two per key, for the values with and without sanitized strings
+	std::vector<entry> m_entries;
+
+	// The values of the events that can't be cached
+	entry m_uncached;
+
+	check_cache_metrics m_metrics;
+};
@@ -305,24 +305,100 @@ template<> void sinsp_fdinfo_t::unregister_event_callback(sinsp_pd_callback_type
 sinsp_fdtable::sinsp_fdtable(sinsp* inspector)
 {
 	m_inspector = inspector;
+	m_tid = 0;
+	m_size = 0;
 	reset_cache();
 }
 
+sinsp_fdtable::sinsp_fdtable(const sinsp_fdtable& other)
+{
+	m_inspector = other.m_inspector;
+	m_size = 0;
+	*this = other;
+}
+
+sinsp_fdtable& sinsp_fdtable::operator=(const sinsp_fdtable& other)
+{
+	if(this == &other)
+	{
+		return *this;
+	}
+
+	clear();
+	m_inspector = other.m_inspector;
+	m_tid = other.m_tid;
+	reset_cache();
+
+	for(size_t c = 0; c < other.m_chunks.size(); c++)
+	{
+		const chunk& ch = other.m_chunks[c];
+		for(uint32_t j = 0; j < s_chunk_size; j++)
+		{
+			if(ch.m_used & (1 << j))
+			{
+				insert(c * s_chunk_size + j, ch.m_fdinfos[j]);
+			}
+		}
+	}
+
+	for(auto& it : other.m_table)
+	{
+		insert(it.first, it.second);
+	}
+
+	return *this;
+}
+
+sinsp_fdinfo_t* sinsp_fdtable::insert(int64_t fd, const sinsp_fdinfo_t& fdinfo)
+{
+	m_size++;
+
+	if((uint64_t)fd < s_max_low_fd)
+	{
+		size_t c = fd / s_chunk_size;
+		uint32_t j = fd % s_chunk_size;
+		if(c >= m_chunks.size())
+		{
+			m_chunks.resize(c + 1);
+		}
+		chunk& ch = m_chunks[c];
+		if(!ch.m_fdinfos)
+		{
+			ch.m_fdinfos.reset(new sinsp_fdinfo_t[s_chunk_size]);
+		}
+
+		//
+		// The fdinfo keeps the buffers of the previous fd with the
+		// same number
+		//
+		ch.m_used |= (1 << j);
+		sinsp_fdinfo_t* res = &ch.m_fdinfos[j];
+		res->copy(fdinfo, true);
+		return res;
+	}
+
+	sinsp_fdinfo_pool* pool = get_pool();
+	pair<unordered_map<int64_t, sinsp_fdinfo_t>::iterator, bool> insert_res = (pool != NULL) ?
+		m_table.emplace(fd, pool->copy(fdinfo)) :
+		m_table.emplace(fd, fdinfo);
+	return &(insert_res.first->second);
+}
+
 sinsp_fdinfo_t* sinsp_fdtable::add(int64_t fd, sinsp_fdinfo_t* fdinfo)
 {
 	//
 	// Look for the FD in the table
 	//
-	auto it = m_table.find(fd);
+	sinsp_fdinfo_t* existing = lookup(fd);
 
 	// Three possible exits here:
 	// 1. fd is not on the table
 	//   a. the table size is under the limit so create a new entry
 	//   b. table size is over the limit, discard the fd
 	// 2. fd is already in the table, replace it
-	if(it == m_table.end())
+	if(existing == NULL)
 	{
-		if(m_table.size() < m_inspector->m_max_fdtable_size)
+		if(m_size < m_inspector->m_max_fdtable_size)
 		{
 			//
 			// No entry in the table, this is the normal case
@@ -331,8 +407,7 @@ sinsp_fdinfo_t* sinsp_fdtable::add(int64_t fd, sinsp_fdinfo_t* fdinfo)
 #ifdef GATHER_INTERNAL_STATS
 			m_inspector->m_stats.m_n_added_fds++;
 #endif
-			pair<unordered_map<int64_t, sinsp_fdinfo_t>::iterator, bool> insert_res = m_table.emplace(fd, *fdinfo);
-			return &(insert_res.first->second);
+			return insert(fd, *fdinfo);
 		}
 		else
 		{
@@ -344,7 +419,7 @@ sinsp_fdinfo_t* sinsp_fdtable::add(int64_t fd, sinsp_fdinfo_t* fdinfo)
 		//
 		// the fd is already in the table.
 		//
-		if(it->second.m_flags & sinsp_fdinfo_t::FLAGS_CLOSE_IN_PROGRESS)
+		if(existing->m_flags & sinsp_fdinfo_t::FLAGS_CLOSE_IN_PROGRESS)
 		{
 			//
 			// Sometimes an FD-creating syscall can be called on an FD that is being closed (i.e
@@ -355,7 +430,15 @@ sinsp_fdinfo_t* sinsp_fdtable::add(int64_t fd, sinsp_fdinfo_t* fdinfo)
 			fdinfo->m_flags &= ~sinsp_fdinfo_t::FLAGS_CLOSE_IN_PROGRESS;
 			fdinfo->m_flags |= sinsp_fdinfo_t::FLAGS_CLOSE_CANCELED;
 
-			m_table[CANCELED_FD_NUMBER] = it->second;
+			sinsp_fdinfo_t* canceled = lookup(CANCELED_FD_NUMBER);
+			if(canceled != NULL)
+			{
+				canceled->copy(*existing, true);
+			}
+			else
+			{
+				insert(CANCELED_FD_NUMBER, *existing);
+			}
 		}
 		else
 		{
@@ -375,21 +458,19 @@ sinsp_fdinfo_t* sinsp_fdtable::add(int64_t fd, sinsp_fdinfo_t* fdinfo)
 		//
 		// Replace the fd as a struct copy
 		//
-		it->second.copy(*fdinfo, true);
-		return &(it->second);
+		existing->copy(*fdinfo, true);
+		return existing;
 	}
 }
 
 void sinsp_fdtable::erase(int64_t fd)
 {
-	unordered_map<int64_t, sinsp_fdinfo_t>::iterator fdit = m_table.find(fd);
-
 	if(fd == m_last_accessed_fd)
 	{
 		m_last_accessed_fd = -1;
 	}
 
-	if(fdit == m_table.end())
+	if(lookup(fd) == NULL)
 	{
 		//
 		// Looks like there's no fd to remove.
@@ -401,25 +482,63 @@ void sinsp_fdtable::erase(int64_t fd)
 #ifdef GATHER_INTERNAL_STATS
 		m_inspector->m_stats.m_n_failed_fd_lookups++;
 #endif
+		return;
+	}
+
+	if((uint64_t)fd < s_max_low_fd)
+	{
+		chunk& ch = m_chunks[fd / s_chunk_size];
+		uint32_t j = fd % s_chunk_size;
+		ch.m_fdinfos[j].free_state();
+		ch.m_used &= ~(1 << j);
 	}
 	else
 	{
+		auto fdit = m_table.find(fd);
+		sinsp_fdinfo_pool* pool = get_pool();
+		if(pool != NULL)
+		{
+			pool->release(fdit->second);
+		}
 		m_table.erase(fdit);
+	}
+	m_size--;
+
 #ifdef GATHER_INTERNAL_STATS
-		m_inspector->m_stats.m_n_noncached_fd_lookups++;
-		m_inspector->m_stats.m_n_removed_fds++;
+	m_inspector->m_stats.m_n_noncached_fd_lookups++;
+	m_inspector->m_stats.m_n_removed_fds++;
 #endif
-	}
 }
 
 void sinsp_fdtable::clear()
 {
+	for(auto& ch : m_chunks)
+	{
+		for(uint32_t j = 0; j < s_chunk_size; j++)
+		{
+			if(ch.m_used & (1 << j))
+			{
+				ch.m_fdinfos[j].free_state();
+			}
+		}
+		ch.m_used = 0;
+	}
+
+	sinsp_fdinfo_pool* pool = get_pool();
+	if(pool != NULL)
+	{
+		for(auto& it : m_table)
+		{
+			pool->release(it.second);
+		}
+	}
 	m_table.clear();
+	m_size = 0;
 }
 
 size_t sinsp_fdtable::size()
 {
-	return m_table.size();
+	return m_size;
 }
 
 void sinsp_fdtable::reset_cache()
@@ -427,6 +546,15 @@ void sinsp_fdtable::reset_cache()
 	m_last_accessed_fd = -1;
 }
 
+sinsp_fdinfo_pool* sinsp_fdtable::get_pool()
+{
+	if(m_inspector == NULL || m_inspector->m_thread_manager == NULL)
+	{
+		return NULL;
+	}
+	return &m_inspector->m_thread_manager->get_fdinfo_pool();
+}
+
 void sinsp_fdtable::lookup_device(sinsp_fdinfo_t* fdi, uint64_t fd)
 {
 #ifdef HAS_CAPTURE
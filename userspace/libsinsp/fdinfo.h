@@ -17,6 +17,9 @@ limitations under the License.
 
 #pragma once
 #include "sinsp_pd_callback_type.h"
+#include "object_pool.h"
+#include "state_access.h"
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -85,6 +88,25 @@ public:
 		copy(other, false);
 	}
 
+	// Takes the strings and the state of other, which is left with neither
+	sinsp_fdinfo(sinsp_fdinfo&& other) noexcept:
+		m_type(other.m_type),
+		m_openflags(other.m_openflags),
+		m_sockinfo(other.m_sockinfo),
+		m_name(std::move(other.m_name)),
+		m_name_raw(std::move(other.m_name_raw)),
+		m_oldname(std::move(other.m_oldname)),
+		m_usrstate(other.m_usrstate),
+		m_flags(other.m_flags),
+		m_dev(other.m_dev),
+		m_mount_id(other.m_mount_id),
+		m_ino(other.m_ino),
+		m_callbacks(other.m_callbacks)
+	{
+		other.m_usrstate = NULL;
+		other.m_callbacks = NULL;
+	}
+
 	~sinsp_fdinfo()
 	{
 		if(m_callbacks != NULL)
@@ -107,6 +129,17 @@ public:
 	void reset();
 	std::string* tostring();
 
+	//
+	// Deletes the callbacks and the user state
+	//
+	inline void free_state()
+	{
+		delete m_callbacks;
+		m_callbacks = NULL;
+		delete m_usrstate;
+		m_usrstate = NULL;
+	}
+
 	inline void copy(const sinsp_fdinfo &other, bool free_state)
 	{
 		m_type = other.m_type;
@@ -519,18 +552,92 @@ private:
 
 /*@}*/
 
+//
+// The fdinfos removed from the fd tables, kept with the capacity of their
+// strings to store the next fds added to a table: adding an fd then copies
+// its name into the buffers of a closed one instead of allocating them.
+//
+class sinsp_fdinfo_pool
+{
+public:
+	sinsp_fdinfo_pool(size_t max_free):
+		m_max_free(max_free),
+		m_stats()
+	{
+	}
+
+	// A copy of fdinfo, in the storage of a released one if any
+	inline sinsp_fdinfo_t copy(const sinsp_fdinfo_t& fdinfo)
+	{
+		if(m_fdinfos.empty())
+		{
+			m_stats.m_n_allocs++;
+			return fdinfo;
+		}
+
+		m_stats.m_n_reuses++;
+		sinsp_fdinfo_t res(std::move(m_fdinfos.back()));
+		m_fdinfos.pop_back();
+		res.copy(fdinfo, false);
+		return res;
+	}
+
+	// Keeps the storage of fdinfo, which is left empty
+	inline void release(sinsp_fdinfo_t& fdinfo)
+	{
+		if(m_fdinfos.size() >= m_max_free)
+		{
+			m_stats.m_n_frees++;
+			return;
+		}
+
+		m_fdinfos.emplace_back(std::move(fdinfo));
+		m_fdinfos.back().free_state();
+	}
+
+	inline object_pool_stats get_stats() const
+	{
+		object_pool_stats stats = m_stats;
+		stats.m_n_free = m_fdinfos.size();
+		return stats;
+	}
+
+	inline void clear()
+	{
+		std::vector<sinsp_fdinfo_t>().swap(m_fdinfos);
+	}
+
+private:
+	size_t m_max_free;
+	std::vector<sinsp_fdinfo_t> m_fdinfos;
+	object_pool_stats m_stats;
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // fd info table
 ///////////////////////////////////////////////////////////////////////////////
+//
+// The fds of a thread group. The kernel gives out the lowest free fd, so
+// nearly all of them are small and dense: the fds below s_max_low_fd are
+// stored in chunks of s_chunk_size fdinfos, found by indexing the chunk
+// list with the fd, and only the other ones are hashed. A chunk is
+// allocated when the first of its fds is added and then kept, with the
+// strings of the closed fds, for the next fds; the fdinfos never move, so
+// the pointers returned by find() and add() stay valid until the fd is
+// erased.
+//
+// loop() visits the low fds in order, then the hashed ones, and its
+// callbacks must not add or remove fds.
+//
 class sinsp_fdtable
 {
 public:
 	sinsp_fdtable(sinsp* inspector);
+	sinsp_fdtable(const sinsp_fdtable& other);
+	sinsp_fdtable& operator=(const sinsp_fdtable& other);
 
 	inline sinsp_fdinfo_t* find(int64_t fd)
 	{
-		std::unordered_map<int64_t, sinsp_fdinfo_t>::iterator fdit;
-
 		//
 		// Try looking up in our simple cache
 		//
@@ -545,9 +652,9 @@ public:
 		//
 		// Caching failed, do a real lookup
 		//
-		fdit = m_table.find(fd);
+		sinsp_fdinfo_t* fdinfo = lookup(fd);
 
-		if(fdit == m_table.end())
+		if(fdinfo == NULL)
 		{
 	#ifdef GATHER_INTERNAL_STATS
 			m_inspector->m_stats.m_n_failed_fd_lookups++;
@@ -559,10 +666,18 @@ public:
 	#ifdef GATHER_INTERNAL_STATS
 			m_inspector->m_stats.m_n_noncached_fd_lookups++;
 	#endif
+			if(g_state_read_only)
+			{
+				return fdinfo;
+			}
+
 			m_last_accessed_fd = fd;
-			m_last_accessed_fdinfo = &(fdit->second);
-			lookup_device(&(fdit->second), fd);
-			return &(fdit->second);
+			m_last_accessed_fdinfo = fdinfo;
+			if(fdinfo->m_mount_id != 0)
+			{
+				lookup_device(fdinfo, fd);
+			}
+			return fdinfo;
 		}
 	}
 	
@@ -574,8 +689,34 @@ public:
 	size_t size();
 	void reset_cache();
 
+	template <typename Visitor>
+	inline bool loop(const Visitor& callback)
+	{
+		for(size_t c = 0; c < m_chunks.size(); c++)
+		{
+			chunk& ch = m_chunks[c];
+			for(uint32_t j = 0; j < s_chunk_size; j++)
+			{
+				if((ch.m_used & (1 << j)) &&
+				   !callback((int64_t)(c * s_chunk_size + j), ch.m_fdinfos[j]))
+				{
+					return false;
+				}
+			}
+		}
+
+		for(auto& it : m_table)
+		{
+			if(!callback(it.first, it.second))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	sinsp* m_inspector;
-	std::unordered_map<int64_t, sinsp_fdinfo_t> m_table;
 
 	//
 	// Simple fd cache
@@ -585,5 +726,46 @@ public:
 	uint64_t m_tid;
 
 private:
+	enum
+	{
+		s_chunk_size = 16,
+		s_max_low_fd = 4096, ///< MAX_FD_TABLE_SIZE, the default limit of the table
+	};
+
+	//
+	// The used bits are next to the pointer to the fdinfos, so that a
+	// lookup only reads the fdinfo it finds out of the chunk list
+	//
+	struct chunk
+	{
+		uint16_t m_used; ///< One bit per fd, set if the fd is in the table
+		std::unique_ptr<sinsp_fdinfo_t[]> m_fdinfos; ///< NULL until an fd of the chunk is added
+	};
+
+	inline sinsp_fdinfo_t* lookup(int64_t fd)
+	{
+		if((uint64_t)fd < s_max_low_fd)
+		{
+			size_t c = fd / s_chunk_size;
+			uint32_t j = fd % s_chunk_size;
+			if(c < m_chunks.size() && (m_chunks[c].m_used & (1 << j)))
+			{
+				return &m_chunks[c].m_fdinfos[j];
+			}
+			return NULL;
+		}
+
+		auto it = m_table.find(fd);
+		return (it != m_table.end()) ? &it->second : NULL;
+	}
+
+	// Adds fd, which is not in the table
+	sinsp_fdinfo_t* insert(int64_t fd, const sinsp_fdinfo_t& fdinfo);
+
 	void lookup_device(sinsp_fdinfo_t* fdi, uint64_t fd);
+	sinsp_fdinfo_pool* get_pool();
+
+	std::vector<chunk> m_chunks;
+	std::unordered_map<int64_t, sinsp_fdinfo_t> m_table; ///< The fds from s_max_low_fd on, and the negative ones
+	size_t m_size;
 };
@@ -35,20 +35,18 @@ limitations under the License.
 #include "sinsp_int.h"
 #include "utils.h"
 
+#include "extraction_cache.h"
 #include "filter.h"
+#include "filter_evttype_resolver.h"
+#include "filter_optimizer.h"
 #include "filterchecks.h"
+#include "memmem.h"
 #include "value_parser.h"
 #include "filter/parser.h"
 #ifndef _WIN32
 #include "arpa/inet.h"
 #endif
 
-#ifndef _GNU_SOURCE
-//
-// Fallback implementation of memmem
-//
-void *memmem(const void *haystack, size_t haystacklen, const void *needle, size_t needlelen);
-#endif
 
 #ifdef _WIN32
 #pragma comment(lib, "Ws2_32.lib")
@@ -147,36 +145,51 @@ bool flt_compare_int64(cmpop op, int64_t operand1, int64_t operand2)
 	}
 }
 
-bool flt_compare_string(cmpop op, char* operand1, char* operand2)
+//
+// The length of a string operand. The length that comes with it is only a
+// hint: it's 0 when the filtercheck doesn't set it, and it also counts the
+// terminator for the strings taken from the event parameters.
+//
+static inline uint32_t string_len(const char* str, uint32_t len)
+{
+	if(len != 0 && str[len - 1] != 0 && str[len] == 0)
+	{
+		return len;
+	}
+	return (uint32_t)strlen(str);
+}
+
+bool flt_compare_string(cmpop op, char* operand1, char* operand2, uint32_t op1_len, uint32_t op2_len)
 {
 	switch(op)
 	{
 	case CO_EQ:
-		return (strcmp(operand1, operand2) == 0);
+		op1_len = string_len(operand1, op1_len);
+		op2_len = string_len(operand2, op2_len);
+		return op1_len == op2_len && (memcmp(operand1, operand2, op1_len) == 0);
 	case CO_NE:
-		return (strcmp(operand1, operand2) != 0);
+		op1_len = string_len(operand1, op1_len);
+		op2_len = string_len(operand2, op2_len);
+		return op1_len != op2_len || (memcmp(operand1, operand2, op1_len) != 0);
 	case CO_CONTAINS:
+		// libc's strstr() is vectorized already, and faster than
+		// sinsp_memmem() with the lengths in our benchmarks
 		return (strstr(operand1, operand2) != NULL);
-    case CO_ICONTAINS:
-#ifdef _WIN32
-	{
-		string s1(operand1);
-		string s2(operand2);
-		std::transform(s1.begin(), s1.end(), s1.begin(), [](unsigned char c){ return std::tolower(c); });
-		std::transform(s2.begin(), s2.end(), s2.begin(), [](unsigned char c){ return std::tolower(c); });
-		return (strstr(s1.c_str(), s2.c_str()) != NULL);
-	}
-#else
-		return (strcasestr(operand1, operand2) != NULL);
-#endif
+	case CO_ICONTAINS:
+		return (sinsp_memimem(operand1, string_len(operand1, op1_len),
+				      operand2, string_len(operand2, op2_len)) != NULL);
 	case CO_BCONTAINS:
 		throw sinsp_exception("'bcontains' not supported for string filters");
 	case CO_STARTSWITH:
-		return (strncmp(operand1, operand2, strlen(operand2)) == 0);
+		op1_len = string_len(operand1, op1_len);
+		op2_len = string_len(operand2, op2_len);
+		return op2_len <= op1_len && (memcmp(operand1, operand2, op2_len) == 0);
 	case CO_BSTARTSWITH:
 		throw sinsp_exception("'bstartswith' not supported for string filters");
 	case CO_ENDSWITH:
-		return (sinsp_utils::endswith(operand1, operand2));
+		op1_len = string_len(operand1, op1_len);
+		op2_len = string_len(operand2, op2_len);
+		return op2_len <= op1_len && (memcmp(operand1 + op1_len - op2_len, operand2, op2_len) == 0);
 	case CO_GLOB:
 		return sinsp_utils::glob_match(operand2, operand1);
 	case CO_LT:
@@ -203,11 +216,11 @@ bool flt_compare_buffer(cmpop op, char* operand1, char* operand2, uint32_t op1_l
 	case CO_NE:
 		return op1_len != op2_len || (memcmp(operand1, operand2, op1_len) != 0);
 	case CO_CONTAINS:
-		return (memmem(operand1, op1_len, operand2, op2_len) != NULL);
+		return (sinsp_memmem(operand1, op1_len, operand2, op2_len) != NULL);
 	case CO_ICONTAINS:
 		throw sinsp_exception("'icontains' not supported for buffer filters");
 	case CO_BCONTAINS:
-		return (memmem(operand1, op1_len, operand2, op2_len) != NULL);
+		return (sinsp_memmem(operand1, op1_len, operand2, op2_len) != NULL);
 	case CO_STARTSWITH:
 		return op2_len <= op1_len && (memcmp(operand1, operand2, op2_len) == 0);
 	case CO_BSTARTSWITH:
@@ -456,7 +469,7 @@ bool flt_compare(cmpop op, ppm_param_type type, void* operand1, void* operand2,
 	case PT_CHARBUF:
 	case PT_FSPATH:
 	case PT_FSRELPATH:
-		return flt_compare_string(op, (char*)operand1, (char*)operand2);
+		return flt_compare_string(op, (char*)operand1, (char*)operand2, op1_len, op2_len);
 	case PT_BYTEBUF:
 		return flt_compare_buffer(op, (char*)operand1, (char*)operand2, op1_len, op2_len);
 	case PT_DOUBLE:
@@ -471,6 +484,132 @@ bool flt_compare(cmpop op, ppm_param_type type, void* operand1, void* operand2,
 	}
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// comparison functions specialized on the operand type and on the operator
+///////////////////////////////////////////////////////////////////////////////
+template<typename T, cmpop op>
+static bool flt_typed_compare_num(const uint8_t* operand1, uint32_t op1_len, const uint8_t* operand2, uint32_t op2_len)
+{
+	T v1 = *(const T*)operand1;
+	T v2 = *(const T*)operand2;
+
+	switch(op)
+	{
+	case CO_EQ:
+		return v1 == v2;
+	case CO_NE:
+		return v1 != v2;
+	case CO_LT:
+		return v1 < v2;
+	case CO_LE:
+		return v1 <= v2;
+	case CO_GT:
+		return v1 > v2;
+	default:
+		return v1 >= v2;
+	}
+}
+
+// operand2 is a filter value, whose length is always exact
+template<cmpop op>
+static bool flt_typed_compare_string(const uint8_t* operand1, uint32_t op1_len, const uint8_t* operand2, uint32_t op2_len)
+{
+	op1_len = string_len((const char*)operand1, op1_len);
+
+	switch(op)
+	{
+	case CO_EQ:
+		return op1_len == op2_len && memcmp(operand1, operand2, op1_len) == 0;
+	case CO_NE:
+		return op1_len != op2_len || memcmp(operand1, operand2, op1_len) != 0;
+	case CO_STARTSWITH:
+		return op2_len <= op1_len && memcmp(operand1, operand2, op2_len) == 0;
+	default:
+		return op2_len <= op1_len && memcmp(operand1 + op1_len - op2_len, operand2, op2_len) == 0;
+	}
+}
+
+template<typename T>
+static flt_typed_compare_t flt_typed_compare_num(cmpop op)
+{
+	switch(op)
+	{
+	case CO_EQ:
+		return flt_typed_compare_num<T, CO_EQ>;
+	case CO_NE:
+		return flt_typed_compare_num<T, CO_NE>;
+	case CO_LT:
+		return flt_typed_compare_num<T, CO_LT>;
+	case CO_LE:
+		return flt_typed_compare_num<T, CO_LE>;
+	case CO_GT:
+		return flt_typed_compare_num<T, CO_GT>;
+	case CO_GE:
+		return flt_typed_compare_num<T, CO_GE>;
+	default:
+		return NULL;
+	}
+}
+
+flt_typed_compare_t flt_typed_compare(cmpop op, ppm_param_type type)
+{
+	// The same types and conversions as flt_compare()
+	switch(type)
+	{
+	case PT_INT8:
+		return flt_typed_compare_num<int8_t>(op);
+	case PT_INT16:
+		return flt_typed_compare_num<int16_t>(op);
+	case PT_INT32:
+		return flt_typed_compare_num<int32_t>(op);
+	case PT_INT64:
+	case PT_FD:
+	case PT_PID:
+	case PT_ERRNO:
+		return flt_typed_compare_num<int64_t>(op);
+	case PT_FLAGS8:
+	case PT_ENUMFLAGS8:
+	case PT_UINT8:
+	case PT_SIGTYPE:
+		return flt_typed_compare_num<uint8_t>(op);
+	case PT_FLAGS16:
+	case PT_UINT16:
+	case PT_ENUMFLAGS16:
+	case PT_PORT:
+	case PT_SYSCALLID:
+		return flt_typed_compare_num<uint16_t>(op);
+	case PT_UINT32:
+	case PT_FLAGS32:
+	case PT_ENUMFLAGS32:
+	case PT_MODE:
+	case PT_BOOL:
+	case PT_IPV4ADDR:
+		return flt_typed_compare_num<uint32_t>(op);
+	case PT_UINT64:
+	case PT_RELTIME:
+	case PT_ABSTIME:
+		return flt_typed_compare_num<uint64_t>(op);
+	case PT_CHARBUF:
+	case PT_FSPATH:
+	case PT_FSRELPATH:
+		switch(op)
+		{
+		case CO_EQ:
+			return flt_typed_compare_string<CO_EQ>;
+		case CO_NE:
+			return flt_typed_compare_string<CO_NE>;
+		case CO_STARTSWITH:
+			return flt_typed_compare_string<CO_STARTSWITH>;
+		case CO_ENDSWITH:
+			return flt_typed_compare_string<CO_ENDSWITH>;
+		default:
+			return NULL;
+		}
+	default:
+		return NULL;
+	}
+}
+
 bool flt_compare_avg(cmpop op,
 					 ppm_param_type type,
 					 void* operand1,
@@ -591,11 +730,21 @@ sinsp_filter_check::sinsp_filter_check()
 	m_info.m_fields = NULL;
 	m_info.m_nfields = -1;
 	m_val_storage_len = 0;
+	m_typed_compare = NULL;
 	m_val_storages = vector<vector<uint8_t>> (1, vector<uint8_t>(256));
+	m_val_storages_lens = vector<uint32_t>(1, 0);
 	m_val_storages_min_size = (numeric_limits<uint32_t>::max)();
 	m_val_storages_max_size = (numeric_limits<uint32_t>::min)();
 }
 
+sinsp_filter_check::~sinsp_filter_check()
+{
+	if(m_shared_cache)
+	{
+		m_shared_cache->forget(this);
+	}
+}
+
 void sinsp_filter_check::set_inspector(sinsp* inspector)
 {
 	m_inspector = inspector;
@@ -1176,14 +1325,16 @@ void sinsp_filter_check::add_filter_value(const char* str, uint32_t len, uint32_
 	if (i >= m_val_storages.size())
 	{
 		m_val_storages.push_back(vector<uint8_t>(256));
+		m_val_storages_lens.push_back(0);
 	}
 
 	parsed_len = parse_filter_value(str, len, filter_value_p(i), filter_value(i)->size());
+	m_val_storages_lens[i] = parsed_len;
 
 	// XXX/mstemm this doesn't work if someone called
 	// add_filter_value more than once for a given index.
 	filter_value_t item(filter_value_p(i), parsed_len);
-	m_val_storages_members.insert(item);
+	m_val_storages_members.insert(item.first, item.second);
 
 	if(parsed_len < m_val_storages_min_size)
 	{
@@ -1200,6 +1351,60 @@ void sinsp_filter_check::add_filter_value(const char* str, uint32_t len, uint32_
 	{
 		m_val_storages_paths.add_search_path(item);
 	}
+
+	// The length of the strings, so that comparisons don't need strlen()
+	if(i == 0 &&
+	   (m_field->m_type == PT_CHARBUF ||
+	    m_field->m_type == PT_FSPATH ||
+	    m_field->m_type == PT_FSRELPATH))
+	{
+		m_val_storage_len = parsed_len;
+	}
+
+	// Only a single value is compared with the specialized functions. The
+	// ones for strings also need its exact length.
+	m_typed_compare = NULL;
+	if(m_val_storages.size() == 1)
+	{
+		m_typed_compare = flt_typed_compare(m_cmpop, m_field->m_type);
+		if((m_field->m_type == PT_CHARBUF ||
+		    m_field->m_type == PT_FSPATH ||
+		    m_field->m_type == PT_FSRELPATH) &&
+		   strlen((char*)filter_value_p()) != parsed_len)
+		{
+			m_typed_compare = NULL;
+		}
+	}
+
+	switch(m_cmpop)
+	{
+	case CO_CONTAINS:
+	case CO_ICONTAINS:
+	case CO_STARTSWITH:
+	case CO_ENDSWITH:
+		if(m_field->m_type == PT_CHARBUF ||
+		   m_field->m_type == PT_FSPATH ||
+		   m_field->m_type == PT_FSRELPATH)
+		{
+			m_val_storages_patterns.set_case_insensitive(m_cmpop == CO_ICONTAINS);
+			m_val_storages_patterns.add_pattern((char*)filter_value_p(i), parsed_len);
+		}
+		break;
+	case CO_GLOB:
+		if(m_field->m_type == PT_CHARBUF ||
+		   m_field->m_type == PT_FSPATH ||
+		   m_field->m_type == PT_FSRELPATH)
+		{
+			if(i >= m_val_storages_globs.size())
+			{
+				m_val_storages_globs.resize(i + 1);
+			}
+			m_val_storages_globs[i].compile(string((char*)filter_value_p(i), parsed_len));
+		}
+		break;
+	default:
+		break;
+	}
 }
 
 size_t sinsp_filter_check::parse_filter_value(const char* str, uint32_t len, uint8_t *storage, uint32_t storage_len)
@@ -1235,7 +1440,7 @@ bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, vector<extra
 {
 	if (m_info.m_fields[m_field_id].m_flags & EPF_IS_LIST)
 	{
-		// NOTE: using m_val_storages_members.find(item) relies on memcmp to
+		// NOTE: using m_val_storages_members.contains() relies on memcmp to
 		// compare filter_value_t values, and not the base-level flt_compare.
 		// This has two main consequences. First, this only works for equality
 		// comparison, which luckily is what we want for 'in' and 'intersects'.
@@ -1252,17 +1457,14 @@ bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, vector<extra
 		{
 			throw sinsp_exception("list filters are only supported for CHARBUF and UINT64 types");
 		}
-		filter_value_t item(NULL, 0);
 		switch (op)
 		{
 			case CO_IN:
 				for (auto it = values.begin(); it != values.end(); ++it)
 				{
-					item.first = (*it).ptr;
-					item.second = (*it).len;
 					if((*it).len < m_val_storages_min_size ||
 						(*it).len > m_val_storages_max_size ||
-						m_val_storages_members.find(item) == m_val_storages_members.end())
+						!m_val_storages_members.contains((*it).ptr, (*it).len))
 					{
 						return false;
 					}
@@ -1271,11 +1473,9 @@ bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, vector<extra
 			case CO_INTERSECTS:
 				for (auto it = values.begin(); it != values.end(); ++it)
 				{
-					item.first = (*it).ptr;
-					item.second = (*it).len;
 					if((*it).len >= m_val_storages_min_size &&
 						(*it).len <= m_val_storages_max_size &&
-						m_val_storages_members.find(item) != m_val_storages_members.end())
+						m_val_storages_members.contains((*it).ptr, (*it).len))
 					{
 						return true;
 					}
@@ -1306,6 +1506,11 @@ bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, vector<extra
 
 bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, void* operand1, uint32_t op1_len, uint32_t op2_len)
 {
+	if(m_typed_compare != NULL && op == m_cmpop && type == m_field->m_type)
+	{
+		return m_typed_compare((uint8_t*)operand1, op1_len, filter_value_p(), m_val_storage_len);
+	}
+
 	if (op == CO_IN || op == CO_PMATCH || op == CO_INTERSECTS)
 	{
 		// Certain filterchecks can't be done as a set
@@ -1329,7 +1534,7 @@ bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, void* operan
 						  operand1,
 						  filter_value_p(i),
 						  op1_len,
-						  filter_value(i)->size()))
+						  filter_value_len(i)))
 				{
 					return true;
 				}
@@ -1337,9 +1542,9 @@ bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, void* operan
 			return false;
 		default:
 			// For raw strings, the length may not be set. So we do a strlen to find it.
-			if(type == PT_CHARBUF && op1_len == 0)
+			if(type == PT_CHARBUF)
 			{
-				op1_len = strlen((char *) operand1);
+				op1_len = string_len((char *) operand1, op1_len);
 			}
 
 			filter_value_t item((uint8_t *) operand1, op1_len);
@@ -1353,7 +1558,7 @@ bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, void* operan
 
 				if(op1_len >= m_val_storages_min_size &&
 				   op1_len <= m_val_storages_max_size &&
-				   m_val_storages_members.find(item) != m_val_storages_members.end())
+				   m_val_storages_members.contains((uint8_t *) operand1, op1_len))
 				{
 					return true;
 				}
@@ -1370,6 +1575,71 @@ bool sinsp_filter_check::flt_compare(cmpop op, ppm_param_type type, void* operan
 			break;
 		}
 	}
+	else if(op == CO_GLOB &&
+		m_val_storages_globs.size() == m_val_storages.size() &&
+		(type == PT_CHARBUF || type == PT_FSPATH || type == PT_FSRELPATH))
+	{
+		uint32_t len = string_len((char*)operand1, op1_len);
+		for(auto& g : m_val_storages_globs)
+		{
+			if(g.match((char*)operand1, len))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	else if(m_val_storages.size() > 1)
+	{
+		// The or-chains of string checks merged by sinsp_filter_optimizer,
+		// e.g. "proc.cmdline contains (a, b, c)". With few values, a libc
+		// scan per value is faster than walking the automaton, especially
+		// for startswith and endswith that only look at a few bytes.
+		if(m_val_storages_patterns.size() == m_val_storages.size() &&
+		   (type == PT_CHARBUF || type == PT_FSPATH || type == PT_FSRELPATH))
+		{
+			size_t npatterns = m_val_storages_patterns.size();
+			switch(op)
+			{
+			case CO_CONTAINS:
+			case CO_ICONTAINS:
+				if(npatterns >= 4)
+				{
+					return m_val_storages_patterns.contains((char*)operand1);
+				}
+				break;
+			case CO_STARTSWITH:
+				if(npatterns >= 16)
+				{
+					return m_val_storages_patterns.startswith((char*)operand1);
+				}
+				break;
+			case CO_ENDSWITH:
+				if(npatterns >= 16)
+				{
+					return m_val_storages_patterns.endswith((char*)operand1);
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		// op2_len is the length of the first value only
+		for(uint16_t i = 0; i < m_val_storages.size(); i++)
+		{
+			if(::flt_compare(op,
+					 type,
+					 operand1,
+					 filter_value_p(i),
+					 op1_len,
+					 filter_value_len(i)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
 	else
 	{
 		return (::flt_compare(op,
@@ -1391,6 +1661,7 @@ bool sinsp_filter_check::extract(sinsp_evt *evt, OUT vector<extract_value_t>& va
 {
 	values.clear();
 	extract_value_t val;
+	val.len = 0;
 	val.ptr = extract(evt, &val.len, sanitize_string);
 	if (val.ptr != NULL)
 	{
@@ -1434,12 +1705,30 @@ bool sinsp_filter_check::extract_cached(sinsp_evt *evt, OUT vector<extract_value
 
 		return !m_extraction_cache_entry->m_res.empty();
 	}
+	else if(m_shared_cache)
+	{
+		return m_shared_cache->extract(this, m_shared_cache_key, evt, values, sanitize_strings);
+	}
 	else
 	{
 		return extract(evt, values, sanitize_strings);
 	}
 }
 
+void sinsp_filter_check::share_extraction(const std::string& field)
+{
+	if(m_inspector == NULL || m_extract_multivalued || m_extract_stateful)
+	{
+		return;
+	}
+
+	m_shared_cache = m_inspector->get_extraction_cache();
+	if(m_shared_cache)
+	{
+		m_shared_cache_key = m_shared_cache->get_key(field);
+	}
+}
+
 bool sinsp_filter_check::compare(gen_event *evt)
 {
 	if(m_cache_metrics != NULL)
@@ -1475,6 +1764,22 @@ bool sinsp_filter_check::compare(gen_event *evt)
 
 bool sinsp_filter_check::compare(sinsp_evt *evt)
 {
+	// Single values compared with a specialized function don't need the
+	// vector of the extracted values
+	if(m_typed_compare != NULL && m_extraction_cache_entry == NULL && !m_extract_multivalued)
+	{
+		if(m_cache_metrics != NULL)
+		{
+			m_cache_metrics->m_num_extract++;
+		}
+
+		uint32_t len = 0;
+		uint8_t* val = m_shared_cache ?
+			m_shared_cache->extract(this, m_shared_cache_key, evt, &len, false) :
+			extract(evt, &len, false);
+		return val != NULL && m_typed_compare(val, len, filter_value_p(), m_val_storage_len);
+	}
+
 	m_extracted_values.clear();
 	if(!extract_cached(evt, m_extracted_values, false))
 	{
@@ -1509,6 +1814,9 @@ sinsp_filter_compiler::sinsp_filter_compiler(
 	m_flt_str = fltstr;
 	m_flt_ast = NULL;
 	m_ttable_only = ttable_only;
+	m_optimize = true;
+	m_program = false;
+	m_profiling = false;
 }
 
 sinsp_filter_compiler::sinsp_filter_compiler(
@@ -1521,6 +1829,9 @@ sinsp_filter_compiler::sinsp_filter_compiler(
 	m_flt_str = fltstr;
 	m_flt_ast = NULL;
 	m_ttable_only = ttable_only;
+	m_optimize = true;
+	m_program = false;
+	m_profiling = false;
 }
 
 sinsp_filter_compiler::sinsp_filter_compiler(
@@ -1532,6 +1843,9 @@ sinsp_filter_compiler::sinsp_filter_compiler(
 	m_filter = NULL;
 	m_flt_ast = fltast;
 	m_ttable_only = ttable_only;
+	m_optimize = true;
+	m_program = false;
+	m_profiling = false;
 }
 
 sinsp_filter* sinsp_filter_compiler::compile()
@@ -1552,6 +1866,18 @@ sinsp_filter* sinsp_filter_compiler::compile()
 		}
 	}
 
+	// optimize the AST, working on a copy if it's owned by the caller
+	if (m_optimize)
+	{
+		if (m_flt_ast != m_internal_flt_ast.get())
+		{
+			m_internal_flt_ast = libsinsp::filter::ast::clone(m_flt_ast);
+		}
+		sinsp_filter_optimizer optimizer(m_factory.get());
+		optimizer.optimize(m_internal_flt_ast);
+		m_flt_ast = m_internal_flt_ast.get();
+	}
+
 	// create new filter using factory
 	auto new_filter = m_factory->new_filter();
 	auto new_sinsp_filter = dynamic_cast<sinsp_filter*>(new_filter);
@@ -1577,11 +1903,44 @@ sinsp_filter* sinsp_filter_compiler::compile()
 		throw e;
 	}
 
+	// the evt.type checks only make sense for the sinsp events
+	if (dynamic_cast<sinsp_filter_factory*>(m_factory.get()) != nullptr)
+	{
+		std::set<uint16_t> evttypes;
+		sinsp_filter_evttype_resolver().evttypes(m_flt_ast, evttypes);
+		new_sinsp_filter->set_evttypes(evttypes);
+	}
+
+	if (m_program)
+	{
+		new_sinsp_filter->set_program(true);
+	}
+
+	if (m_profiling)
+	{
+		new_sinsp_filter->set_profiling(true);
+	}
+
 	// return compiled filter
 	m_filter = NULL;
 	return new_sinsp_filter;
 }
 
+void sinsp_filter_compiler::set_optimize(bool optimize)
+{
+	m_optimize = optimize;
+}
+
+void sinsp_filter_compiler::set_program(bool program)
+{
+	m_program = program;
+}
+
+void sinsp_filter_compiler::set_profiling(bool profiling)
+{
+	m_profiling = profiling;
+}
+
 void sinsp_filter_compiler::visit(libsinsp::filter::ast::and_expr* e)
 {
 	bool nested = m_last_boolop != BO_AND;
@@ -1629,6 +1988,15 @@ void sinsp_filter_compiler::visit(libsinsp::filter::ast::not_expr* e)
 	m_filter->pop_expression();
 }
 
+static void share_extraction(gen_event_filter_check *check, const string& field)
+{
+	sinsp_filter_check* sinsp_check = dynamic_cast<sinsp_filter_check*>(check);
+	if(sinsp_check != nullptr)
+	{
+		sinsp_check->share_extraction(field);
+	}
+}
+
 void sinsp_filter_compiler::visit(libsinsp::filter::ast::unary_check_expr* e)
 {
 	string field = create_filtercheck_name(e->field, e->arg);
@@ -1638,6 +2006,11 @@ void sinsp_filter_compiler::visit(libsinsp::filter::ast::unary_check_expr* e)
 	check->m_cmpop = str_to_cmpop(e->op);
 	check->m_boolop = m_last_boolop;
 	check->parse_field_name(field.c_str(), true, true);
+	share_extraction(check, field);
+	if (m_profiling)
+	{
+		m_filter->m_check_names[check] = libsinsp::filter::ast::as_string(*e);
+	}
 }
 
 static void add_filtercheck_value(gen_event_filter_check *chk, size_t idx, const std::string& value)
@@ -1668,6 +2041,11 @@ void sinsp_filter_compiler::visit(libsinsp::filter::ast::binary_check_expr* e)
 	check->m_cmpop = str_to_cmpop(e->op);
 	check->m_boolop = m_last_boolop;
 	check->parse_field_name(field.c_str(), true, true);
+	share_extraction(check, field);
+	if (m_profiling)
+	{
+		m_filter->m_check_names[check] = libsinsp::filter::ast::as_string(*e);
+	}
 
 	// Read the the the right-hand values of the filtercheck.
 	// For list-related operators ('in', 'intersects', 'pmatch'), the vector
@@ -1903,6 +2281,11 @@ std::list<gen_event_filter_factory::filter_fieldclass_info> sinsp_filter_factory
 				info.tags.insert("EPF_TABLE_ONLY");
 			}
 
+			if(fld->m_flags & EPF_IS_LIST)
+			{
+				info.tags.insert("EPF_IS_LIST");
+			}
+
 			if(fld->m_flags & EPF_ARG_REQUIRED)
 			{
 				info.tags.insert("ARG_REQUIRED");
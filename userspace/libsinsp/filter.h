@@ -105,6 +105,26 @@ public:
 	*/
 	sinsp_filter* compile();
 
+	/*!
+		\brief Enables or disables sinsp_filter_optimizer, that rewrites
+		the filter before building the filtercheck tree. Enabled by default.
+	*/
+	void set_optimize(bool optimize);
+
+	/*!
+		\brief Enables or disables running the compiled filter as a flat
+		gen_event_filter_program instead of walking its filtercheck tree.
+		Disabled by default.
+	*/
+	void set_program(bool program);
+
+	/*!
+		\brief Enables or disables the profiling of the compiled filter,
+		see gen_event_filter::set_profiling(). The checks are named as
+		written in its profile. Disabled by default.
+	*/
+	void set_profiling(bool profiling);
+
 private:
 	void visit(libsinsp::filter::ast::and_expr*) override;
 	void visit(libsinsp::filter::ast::or_expr*) override;
@@ -119,6 +139,9 @@ private:
 	gen_event_filter_check* create_filtercheck(std::string& field);
 
 	bool m_ttable_only;
+	bool m_optimize;
+	bool m_program;
+	bool m_profiling;
 	bool m_expect_values;
 	boolop m_last_boolop;
 	std::string m_flt_str;
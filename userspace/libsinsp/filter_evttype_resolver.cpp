@@ -0,0 +1,179 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <algorithm>
+#include <iterator>
+
+#include "sinsp.h"
+#include "filter_evttype_resolver.h"
+
+using namespace std;
+using namespace libsinsp::filter;
+
+void sinsp_filter_evttype_resolver::evttypes(ast::expr* filter, set<uint16_t>& out)
+{
+	visit(filter, false, out);
+}
+
+void sinsp_filter_evttype_resolver::evttypes(const string& evtname, set<uint16_t>& out)
+{
+	for(uint16_t j = 0; j < PPM_EVENT_MAX; j++)
+	{
+		// The evt.type of the generic events is the name of the syscall
+		if(j == PPME_GENERIC_E || j == PPME_GENERIC_X)
+		{
+			continue;
+		}
+
+		if(evtname == g_infotables.m_event_info[j].name)
+		{
+			out.insert(j);
+		}
+	}
+
+	for(uint32_t j = 0; j < PPM_SC_MAX; j++)
+	{
+		const char* name = g_infotables.m_syscall_info_table[j].name;
+		if(name != NULL && evtname == name)
+		{
+			out.insert(PPME_GENERIC_E);
+			out.insert(PPME_GENERIC_X);
+			break;
+		}
+	}
+}
+
+void sinsp_filter_evttype_resolver::all_evttypes(set<uint16_t>& out)
+{
+	for(uint16_t j = 0; j < PPM_EVENT_MAX; j++)
+	{
+		out.insert(j);
+	}
+}
+
+void sinsp_filter_evttype_resolver::names_evttypes(const vector<string>& names, bool negated, set<uint16_t>& out)
+{
+	set<uint16_t> types;
+	for(auto& n : names)
+	{
+		evttypes(n, types);
+	}
+
+	if(!negated)
+	{
+		out.insert(types.begin(), types.end());
+		return;
+	}
+
+	types.erase(PPME_GENERIC_E);
+	types.erase(PPME_GENERIC_X);
+	for(uint16_t j = 0; j < PPM_EVENT_MAX; j++)
+	{
+		if(types.find(j) == types.end())
+		{
+			out.insert(j);
+		}
+	}
+}
+
+//
+// The evt types of "a and b" are the ones of both a and b, the ones of
+// "a or b" the ones of either. Under a negation the two are swapped, since
+// "not (a and b)" is "not a or not b".
+//
+void sinsp_filter_evttype_resolver::visit(ast::expr* e, bool negated, set<uint16_t>& out)
+{
+	const vector<unique_ptr<ast::expr>>* children = NULL;
+	bool intersect = false;
+
+	if(auto a = dynamic_cast<ast::and_expr*>(e))
+	{
+		children = &a->children;
+		intersect = !negated;
+	}
+	else if(auto o = dynamic_cast<ast::or_expr*>(e))
+	{
+		children = &o->children;
+		intersect = negated;
+	}
+	else if(auto n = dynamic_cast<ast::not_expr*>(e))
+	{
+		visit(n->child.get(), !negated, out);
+		return;
+	}
+	else if(auto c = dynamic_cast<ast::binary_check_expr*>(e))
+	{
+		if(c->field == "evt.type" && c->arg.empty())
+		{
+			vector<string> names;
+			if(auto v = dynamic_cast<ast::value_expr*>(c->value.get()))
+			{
+				names.push_back(v->value);
+			}
+			else if(auto l = dynamic_cast<ast::list_expr*>(c->value.get()))
+			{
+				names = l->values;
+			}
+
+			if(c->op == "=" || c->op == "==" || c->op == "in")
+			{
+				names_evttypes(names, negated, out);
+				return;
+			}
+			else if(c->op == "!=")
+			{
+				names_evttypes(names, !negated, out);
+				return;
+			}
+		}
+
+		all_evttypes(out);
+		return;
+	}
+	else
+	{
+		all_evttypes(out);
+		return;
+	}
+
+	if(!intersect)
+	{
+		for(auto& c : *children)
+		{
+			visit(c.get(), negated, out);
+		}
+		return;
+	}
+
+	set<uint16_t> res;
+	for(size_t j = 0; j < children->size(); j++)
+	{
+		set<uint16_t> types;
+		visit((*children)[j].get(), negated, types);
+		if(j == 0)
+		{
+			res = std::move(types);
+			continue;
+		}
+
+		set<uint16_t> both;
+		set_intersection(res.begin(), res.end(), types.begin(), types.end(),
+			inserter(both, both.begin()));
+		res = std::move(both);
+	}
+	out.insert(res.begin(), res.end());
+}
@@ -0,0 +1,56 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <set>
+#include <string>
+
+#include "filter/ast.h"
+
+/*!
+  \brief Finds the types of the events (ppm_event_type) that a filter can
+  match, by looking at its evt.type checks.
+
+  Every check that doesn't involve evt.type can match any event, so e.g.
+  "evt.type = open and proc.name = cat" can only match the open events,
+  while "evt.type = open or proc.name = cat" can match all of them.
+  Negations are taken into account, e.g. "not evt.type = open" matches
+  all the events but the open ones.
+
+  The generic events (PPME_GENERIC_E/X) are matched by the names of the
+  syscalls without a dedicated event, and are never excluded by a
+  negation since their evt.type varies.
+*/
+class SINSP_PUBLIC sinsp_filter_evttype_resolver
+{
+public:
+	/*!
+		\brief Adds to out the types of the events that filter can match
+	*/
+	void evttypes(libsinsp::filter::ast::expr* filter, std::set<uint16_t>& out);
+
+	/*!
+		\brief Adds to out the types of the events whose evt.type is evtname
+	*/
+	void evttypes(const std::string& evtname, std::set<uint16_t>& out);
+
+private:
+	void visit(libsinsp::filter::ast::expr* e, bool negated, std::set<uint16_t>& out);
+	void names_evttypes(const std::vector<std::string>& names, bool negated, std::set<uint16_t>& out);
+	static void all_evttypes(std::set<uint16_t>& out);
+};
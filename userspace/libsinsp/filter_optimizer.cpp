@@ -0,0 +1,480 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+#include "filter_optimizer.h"
+
+using namespace std;
+using namespace libsinsp::filter;
+
+//
+// The relative cost of extracting a field. Thread fields are cheap because
+// the threadinfo is already attached to the event, while the ones that walk
+// the process tree or need a path, user, container or orchestrator lookup
+// are not.
+//
+static const struct
+{
+	const char* m_prefix;
+	uint32_t m_cost;
+} s_field_costs[] =
+{
+	{"evt.type", 1},
+	{"evt.dir", 1},
+	{"evt.num", 1},
+	{"evt.cpu", 1},
+	{"evt.arg", 4},
+	{"evt.rawarg", 4},
+	{"evt.raw", 1},
+	{"evt.buffer", 6},
+	{"evt.", 3},
+	{"proc.aname", 10},
+	{"proc.apid", 10},
+	{"proc.", 3},
+	{"thread.", 3},
+	{"fd.name", 8},
+	{"fd.directory", 8},
+	{"fd.filename", 8},
+	{"fd.", 4},
+	{"user.", 6},
+	{"group.", 6},
+	{"container.", 20},
+	{"k8s.", 30},
+	{"mesos.", 30},
+	{"marathon.", 30},
+};
+
+// The default cost of the fields not in s_field_costs, e.g. plugin fields
+static const uint32_t s_default_field_cost = 5;
+
+// Without index, proc.aname and proc.apid look at all the ancestors
+static const uint32_t s_ancestors_cost = 50;
+
+static const unordered_set<string> s_numeric_types =
+{
+	"INT8", "INT16", "INT32", "INT64",
+	"UINT8", "UINT16", "UINT32", "UINT64",
+	"ERRNO", "FD", "PID", "SYSCALLID", "RELTIME", "ABSTIME",
+	"PORT", "L4PROTO", "SOCKFAMILY", "BOOL",
+	"FLAGS8", "FLAGS16", "FLAGS32", "MODE", "UID", "GID", "DOUBLE",
+};
+
+static uint32_t op_cost_factor(const string& op)
+{
+	if(op == "contains" || op == "icontains" || op == "bcontains" ||
+		op == "startswith" || op == "bstartswith" || op == "endswith")
+	{
+		return 2;
+	}
+
+	if(op == "glob" || op == "pmatch")
+	{
+		return 3;
+	}
+
+	return 1;
+}
+
+// The operator of the check that a check with this operator is merged
+// into, or an empty string if it can't be merged
+static string merged_op(const string& op)
+{
+	if(op == "=" || op == "==" || op == "in")
+	{
+		return "in";
+	}
+	if(op == "contains" || op == "icontains" || op == "startswith" || op == "endswith")
+	{
+		return op;
+	}
+	return "";
+}
+
+static bool is_string_type(const string& type)
+{
+	return type == "CHARBUF" || type == "FSPATH" || type == "FSRELPATH";
+}
+
+sinsp_filter_optimizer::sinsp_filter_optimizer(gen_event_filter_factory* factory):
+	m_factory(factory),
+	m_fields_loaded(false)
+{
+}
+
+void sinsp_filter_optimizer::optimize(unique_ptr<ast::expr>& e)
+{
+	if(auto n = dynamic_cast<ast::not_expr*>(e.get()))
+	{
+		optimize(n->child);
+
+		// not not x = x
+		if(auto nn = dynamic_cast<ast::not_expr*>(n->child.get()))
+		{
+			unique_ptr<ast::expr> child = std::move(nn->child);
+			e = std::move(child);
+			m_stats.m_flattened += 2;
+		}
+		return;
+	}
+
+	vector<unique_ptr<ast::expr>>* children = NULL;
+	bool is_and = false;
+	if(auto a = dynamic_cast<ast::and_expr*>(e.get()))
+	{
+		children = &a->children;
+		is_and = true;
+	}
+	else if(auto o = dynamic_cast<ast::or_expr*>(e.get()))
+	{
+		children = &o->children;
+	}
+	else
+	{
+		return;
+	}
+
+	optimize_children(*children, is_and);
+
+	if(children->size() == 1)
+	{
+		unique_ptr<ast::expr> child = std::move(children->front());
+		e = std::move(child);
+		m_stats.m_flattened++;
+	}
+}
+
+void sinsp_filter_optimizer::optimize_children(vector<unique_ptr<ast::expr>>& children, bool is_and)
+{
+	vector<unique_ptr<ast::expr>> flat;
+
+	for(auto& c : children)
+	{
+		optimize(c);
+
+		// (a and b) and c = a and b and c, same for or
+		vector<unique_ptr<ast::expr>>* nested = NULL;
+		if(is_and)
+		{
+			auto a = dynamic_cast<ast::and_expr*>(c.get());
+			nested = a != NULL ? &a->children : NULL;
+		}
+		else
+		{
+			auto o = dynamic_cast<ast::or_expr*>(c.get());
+			nested = o != NULL ? &o->children : NULL;
+		}
+
+		if(nested != NULL)
+		{
+			for(auto& n : *nested)
+			{
+				flat.push_back(std::move(n));
+			}
+			m_stats.m_flattened++;
+		}
+		else
+		{
+			flat.push_back(std::move(c));
+		}
+	}
+
+	children = std::move(flat);
+
+	if(!is_and)
+	{
+		merge_in(children);
+	}
+	deduplicate(children);
+	sort_by_cost(children);
+}
+
+//
+// a = x or a = y or a in (z) -> a in (x, y, z)
+// a contains x or a contains y -> a contains (x, y)
+//
+// This is only done for string fields: "in" is a hash lookup of the raw
+// value, which for the other types isn't always the same as "=" (e.g. for
+// IP addresses and paths). The string checks with many values are matched
+// in a single pass by the filtercheck, see aho_corasick.
+//
+void sinsp_filter_optimizer::merge_in(vector<unique_ptr<ast::expr>>& children)
+{
+	unordered_map<string, size_t> first;
+	vector<bool> removed(children.size(), false);
+	bool merged = false;
+
+	for(size_t j = 0; j < children.size(); j++)
+	{
+		auto c = dynamic_cast<ast::binary_check_expr*>(children[j].get());
+		if(c == NULL)
+		{
+			continue;
+		}
+
+		string op = merged_op(c->op);
+		if(op.empty())
+		{
+			continue;
+		}
+
+		// "x = a" on a list field is a compile error, and "in" means
+		// that all its values are in the set
+		const field_info* info = find_field(c->field);
+		if(info == NULL || info->m_is_list ||
+		   (op == "in" ? info->m_type != "CHARBUF" : !is_string_type(info->m_type)))
+		{
+			continue;
+		}
+
+		string key = c->field + "[" + c->arg + "] " + op;
+		auto it = first.find(key);
+		if(it == first.end())
+		{
+			first[key] = j;
+			continue;
+		}
+
+		auto dst = static_cast<ast::binary_check_expr*>(children[it->second].get());
+		if(dst->op != op || dynamic_cast<ast::list_expr*>(dst->value.get()) == NULL)
+		{
+			vector<string> values;
+			if(auto v = dynamic_cast<ast::value_expr*>(dst->value.get()))
+			{
+				values.push_back(v->value);
+			}
+			else
+			{
+				values = static_cast<ast::list_expr*>(dst->value.get())->values;
+			}
+			dst->op = op;
+			dst->value = ast::list_expr::create(values);
+		}
+
+		auto dst_values = &static_cast<ast::list_expr*>(dst->value.get())->values;
+		auto add_value = [dst_values](const string& v)
+		{
+			if(find(dst_values->begin(), dst_values->end(), v) == dst_values->end())
+			{
+				dst_values->push_back(v);
+			}
+		};
+
+		if(auto v = dynamic_cast<ast::value_expr*>(c->value.get()))
+		{
+			add_value(v->value);
+		}
+		else if(auto l = dynamic_cast<ast::list_expr*>(c->value.get()))
+		{
+			for(auto& v : l->values)
+			{
+				add_value(v);
+			}
+		}
+
+		removed[j] = true;
+		merged = true;
+		m_stats.m_merged++;
+	}
+
+	if(!merged)
+	{
+		return;
+	}
+
+	vector<unique_ptr<ast::expr>> res;
+	for(size_t j = 0; j < children.size(); j++)
+	{
+		if(!removed[j])
+		{
+			res.push_back(std::move(children[j]));
+		}
+	}
+	children = std::move(res);
+}
+
+// a and a = a, a or a = a
+void sinsp_filter_optimizer::deduplicate(vector<unique_ptr<ast::expr>>& children)
+{
+	vector<unique_ptr<ast::expr>> res;
+
+	for(auto& c : children)
+	{
+		bool dup = false;
+		for(auto& r : res)
+		{
+			if(ast::compare(c.get(), r.get()))
+			{
+				dup = true;
+				break;
+			}
+		}
+
+		if(dup)
+		{
+			m_stats.m_deduplicated++;
+		}
+		else
+		{
+			res.push_back(std::move(c));
+		}
+	}
+
+	children = std::move(res);
+}
+
+void sinsp_filter_optimizer::sort_by_cost(vector<unique_ptr<ast::expr>>& children)
+{
+	vector<pair<uint32_t, size_t>> costs;
+	for(size_t j = 0; j < children.size(); j++)
+	{
+		costs.emplace_back(cost(children[j].get()), j);
+	}
+
+	// Sorting the pairs keeps the rule order among checks of equal cost
+	sort(costs.begin(), costs.end());
+
+	bool changed = false;
+	vector<unique_ptr<ast::expr>> res;
+	for(size_t j = 0; j < costs.size(); j++)
+	{
+		changed |= costs[j].second != j;
+		res.push_back(std::move(children[costs[j].second]));
+	}
+	children = std::move(res);
+
+	if(changed)
+	{
+		m_stats.m_reordered++;
+	}
+}
+
+uint32_t sinsp_filter_optimizer::cost(ast::expr* e)
+{
+	uint32_t res = 0;
+
+	if(auto a = dynamic_cast<ast::and_expr*>(e))
+	{
+		for(auto& c : a->children)
+		{
+			res += cost(c.get());
+		}
+	}
+	else if(auto o = dynamic_cast<ast::or_expr*>(e))
+	{
+		for(auto& c : o->children)
+		{
+			res += cost(c.get());
+		}
+	}
+	else if(auto n = dynamic_cast<ast::not_expr*>(e))
+	{
+		res = cost(n->child.get());
+	}
+	else if(auto u = dynamic_cast<ast::unary_check_expr*>(e))
+	{
+		res = check_cost(u->field, u->arg, u->op);
+	}
+	else if(auto b = dynamic_cast<ast::binary_check_expr*>(e))
+	{
+		res = check_cost(b->field, b->arg, b->op);
+	}
+
+	return res;
+}
+
+uint32_t sinsp_filter_optimizer::check_cost(const string& field, const string& arg, const string& op)
+{
+	uint32_t res = s_default_field_cost;
+
+	for(auto& fc : s_field_costs)
+	{
+		if(field.compare(0, strlen(fc.m_prefix), fc.m_prefix) == 0)
+		{
+			res = fc.m_cost;
+			break;
+		}
+	}
+
+	if((field == "proc.aname" || field == "proc.apid") && arg.empty())
+	{
+		res = s_ancestors_cost;
+	}
+	else if(res > 2 && s_numeric_types.find(field_type(field)) != s_numeric_types.end())
+	{
+		// Integer compares don't copy nor scan strings
+		res = 2;
+	}
+
+	return res * op_cost_factor(op);
+}
+
+//
+// Returns the type and flags of a field as reported by the factory, or
+// NULL if it's unknown. Fields like evt.arg.fd are looked up by their
+// prefix.
+//
+const sinsp_filter_optimizer::field_info* sinsp_filter_optimizer::find_field(const string& field)
+{
+	if(!m_fields_loaded)
+	{
+		m_fields_loaded = true;
+		if(m_factory != NULL)
+		{
+			for(auto& fc : m_factory->get_fields())
+			{
+				for(auto& f : fc.fields)
+				{
+					field_info& info = m_fields[f.name];
+					info.m_type = f.data_type;
+					info.m_is_list = f.tags.find("EPF_IS_LIST") != f.tags.end();
+				}
+			}
+		}
+	}
+
+	string name = field;
+	while(true)
+	{
+		auto it = m_fields.find(name);
+		if(it != m_fields.end())
+		{
+			return &it->second;
+		}
+
+		size_t pos = name.rfind('.');
+		if(pos == string::npos)
+		{
+			return NULL;
+		}
+		name.resize(pos);
+	}
+}
+
+//
+// Returns the type of a field, e.g. "CHARBUF", or an empty string if it's
+// unknown
+//
+const string& sinsp_filter_optimizer::field_type(const string& field)
+{
+	static const string s_unknown;
+
+	const field_info* info = find_field(field);
+	return info != NULL ? info->m_type : s_unknown;
+}
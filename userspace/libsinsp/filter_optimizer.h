@@ -0,0 +1,101 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "gen_filter.h"
+#include "filter/ast.h"
+
+/*!
+  \brief Rewrites the AST of a filter so that the filtercheck tree built
+  from it is cheaper to evaluate, without changing its result:
+  - nested and/or of the same kind are flattened, single-child and/or and
+    double negations are removed
+  - "a = x or a = y or a in (z)" on string fields becomes "a in (x, y, z)",
+    and "a contains x or a contains y" becomes "a contains (x, y)", which
+    the filtercheck matches in a single pass (same for icontains,
+    startswith and endswith)
+  - duplicated checks in the same and/or are removed
+  - the children of each and/or are sorted by estimated cost, so that the
+    cheap checks (evt.type, evt.dir, integer compares) short-circuit the
+    expensive ones (proc.aname, fd.name, container and k8s metadata)
+
+  \note The rewrite relies on the filterchecks having no side effects,
+  which the short-circuit evaluation of gen_event_filter_expression
+  already assumes.
+*/
+class SINSP_PUBLIC sinsp_filter_optimizer
+{
+public:
+	struct stats
+	{
+		uint32_t m_flattened = 0; ///< and/or/not nodes removed
+		uint32_t m_merged = 0; ///< Checks merged into another one on the same field
+		uint32_t m_deduplicated = 0; ///< Duplicated checks removed
+		uint32_t m_reordered = 0; ///< and/or whose children were reordered
+	};
+
+	/*!
+		\param factory The factory that will build the filterchecks, used
+		to know the type of the fields. Without it, or for the fields it
+		doesn't know, no check is merged and the costs are name-based only.
+		The checks on list fields (EPF_IS_LIST) are never merged, since
+		those only support "in" and "intersects" on all their values.
+	*/
+	explicit sinsp_filter_optimizer(gen_event_filter_factory* factory = NULL);
+
+	/*!
+		\brief Optimizes e in place. The root node may be replaced.
+	*/
+	void optimize(std::unique_ptr<libsinsp::filter::ast::expr>& e);
+
+	/*!
+		\brief Returns the estimated cost of evaluating e once, in arbitrary
+		units where 1 is the cost of comparing evt.type. The cost of an
+		and/or is the one of evaluating all its children.
+	*/
+	uint32_t cost(libsinsp::filter::ast::expr* e);
+
+	const stats& get_stats() const
+	{
+		return m_stats;
+	}
+
+private:
+	void optimize_children(std::vector<std::unique_ptr<libsinsp::filter::ast::expr>>& children, bool is_and);
+	void merge_in(std::vector<std::unique_ptr<libsinsp::filter::ast::expr>>& children);
+	void deduplicate(std::vector<std::unique_ptr<libsinsp::filter::ast::expr>>& children);
+	void sort_by_cost(std::vector<std::unique_ptr<libsinsp::filter::ast::expr>>& children);
+	struct field_info
+	{
+		std::string m_type;
+		bool m_is_list = false;
+	};
+
+	uint32_t check_cost(const std::string& field, const std::string& arg, const std::string& op);
+	const field_info* find_field(const std::string& field);
+	const std::string& field_type(const std::string& field);
+
+	gen_event_filter_factory* m_factory;
+	bool m_fields_loaded;
+	std::unordered_map<std::string, field_info> m_fields;
+	stats m_stats;
+};
@@ -0,0 +1,93 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include "sinsp.h"
+#include "filter_ruleset.h"
+
+using namespace std;
+
+sinsp_filter_ruleset::sinsp_filter_ruleset():
+	m_by_evttype(PPM_EVENT_MAX)
+{
+}
+
+uint32_t sinsp_filter_ruleset::add(gen_event_filter* filter)
+{
+	uint32_t id = (uint32_t)m_filters.size();
+	m_filters.emplace_back(filter);
+
+	const set<uint16_t>& evttypes = filter->evttypes();
+	if(evttypes.empty())
+	{
+		for(auto& ids : m_by_evttype)
+		{
+			ids.push_back(id);
+		}
+		return id;
+	}
+
+	for(uint16_t t : evttypes)
+	{
+		if(t < m_by_evttype.size())
+		{
+			m_by_evttype[t].push_back(id);
+		}
+	}
+
+	return id;
+}
+
+uint32_t sinsp_filter_ruleset::size() const
+{
+	return (uint32_t)m_filters.size();
+}
+
+uint32_t sinsp_filter_ruleset::run(gen_event* evt, vector<uint32_t>& matches)
+{
+	uint16_t type = evt->get_type();
+	uint32_t nfilters = (uint32_t)m_filters.size();
+
+	m_stats.m_num_events++;
+
+	// Events of unknown type go through all the filters
+	if(type >= m_by_evttype.size())
+	{
+		for(uint32_t id = 0; id < nfilters; id++)
+		{
+			if(m_filters[id]->run(evt))
+			{
+				matches.push_back(id);
+			}
+		}
+		m_stats.m_num_evaluated += nfilters;
+		return 0;
+	}
+
+	const vector<uint32_t>& ids = m_by_evttype[type];
+	for(uint32_t id : ids)
+	{
+		if(m_filters[id]->run(evt))
+		{
+			matches.push_back(id);
+		}
+	}
+
+	uint32_t skipped = nfilters - (uint32_t)ids.size();
+	m_stats.m_num_evaluated += ids.size();
+	m_stats.m_num_skipped += skipped;
+	return skipped;
+}
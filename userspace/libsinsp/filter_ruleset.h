@@ -0,0 +1,72 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "gen_filter.h"
+
+/*!
+  \brief A set of filters indexed by event type. Each event is only passed
+  to the filters that can match its type, according to
+  gen_event_filter::evttypes().
+*/
+class SINSP_PUBLIC sinsp_filter_ruleset
+{
+public:
+	struct stats
+	{
+		uint64_t m_num_events = 0; ///< Calls to run()
+		uint64_t m_num_evaluated = 0; ///< Filters run on an event
+		uint64_t m_num_skipped = 0; ///< Filters not run because of the event type
+	};
+
+	sinsp_filter_ruleset();
+
+	/*!
+		\brief Adds a filter, taking ownership of it
+		\return The id of the filter, i.e. the number of filters added before it
+	*/
+	uint32_t add(gen_event_filter* filter);
+
+	/*!
+		\brief Returns the number of filters
+	*/
+	uint32_t size() const;
+
+	/*!
+		\brief Runs on evt the filters that can match its type, and appends
+		the ids of the ones that match to matches, in increasing order.
+		\return The number of filters skipped because of the type of evt
+	*/
+	uint32_t run(gen_event* evt, std::vector<uint32_t>& matches);
+
+	const stats& get_stats() const
+	{
+		return m_stats;
+	}
+
+private:
+	std::vector<std::unique_ptr<gen_event_filter>> m_filters;
+
+	// The ids of the filters that can match each event type
+	std::vector<std::vector<uint32_t>> m_by_evttype;
+
+	stats m_stats;
+};
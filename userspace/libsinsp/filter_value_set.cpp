@@ -0,0 +1,343 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "filter_value_set.h"
+
+static const uint64_t s_mul = 0x9e3779b97f4a7c15ULL;
+
+// The finalizer of MurmurHash3
+static inline uint64_t fmix64(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// Maps a 32 bit hash to [0, n) without a division
+static inline uint32_t reduce(uint32_t h, uint32_t n)
+{
+	return (uint32_t)(((uint64_t)h * n) >> 32);
+}
+
+static inline uint32_t bucket_of(uint64_t h, uint32_t nbuckets)
+{
+	return reduce((uint32_t)(h >> 32), nbuckets);
+}
+
+static inline uint32_t slot_of(uint64_t h, uint32_t displacement, uint32_t nslots)
+{
+	return reduce((uint32_t)fmix64(h ^ (displacement * s_mul)), nslots);
+}
+
+filter_value_set::filter_value_set():
+	m_built(true),
+	m_layout(EMPTY),
+	m_int_width(0),
+	m_hash_seed(0)
+{
+}
+
+void filter_value_set::insert(const uint8_t* val, uint32_t len)
+{
+	m_values.emplace_back((uint32_t)m_data.size(), len);
+	m_data.append((const char*)val, len);
+	m_built = false;
+}
+
+size_t filter_value_set::size()
+{
+	if(!m_built)
+	{
+		build();
+	}
+
+	switch(m_layout)
+	{
+	case INTEGERS:
+		return m_ints.size();
+	case SMALL:
+		return m_small_lens.size();
+	case HASH:
+		return m_slots.size();
+	default:
+		return 0;
+	}
+}
+
+filter_value_set::layout filter_value_set::get_layout()
+{
+	if(!m_built)
+	{
+		build();
+	}
+
+	return m_layout;
+}
+
+uint64_t filter_value_set::hash(const uint8_t* val, uint32_t len, uint64_t seed)
+{
+	uint64_t h = seed ^ (len * s_mul);
+
+	for(; len >= 8; val += 8, len -= 8)
+	{
+		h = (h ^ *(uint64_t*)val) * s_mul;
+		h ^= h >> 29;
+	}
+
+	if(len > 0)
+	{
+		h = (h ^ load_prefix(val, len)) * s_mul;
+		h ^= h >> 29;
+	}
+
+	return fmix64(h);
+}
+
+void filter_value_set::build()
+{
+	const char* data = m_data.data();
+
+	// Sorted by length first, without duplicates
+	std::sort(m_values.begin(), m_values.end(),
+		[data](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b)
+		{
+			if(a.second != b.second)
+			{
+				return a.second < b.second;
+			}
+			return memcmp(data + a.first, data + b.first, a.second) < 0;
+		});
+	m_values.erase(std::unique(m_values.begin(), m_values.end(),
+		[data](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b)
+		{
+			return a.second == b.second && memcmp(data + a.first, data + b.first, a.second) == 0;
+		}), m_values.end());
+
+	m_ints.clear();
+	m_bitset.clear();
+	m_small_lens.clear();
+	m_small_prefixes.clear();
+	m_small_suffixes.clear();
+	m_small_offsets.clear();
+	m_displacements.clear();
+	m_slots.clear();
+	m_built = true;
+
+	if(m_values.empty())
+	{
+		m_layout = EMPTY;
+		return;
+	}
+
+	uint32_t width = m_values.front().second;
+	if(width == m_values.back().second &&
+	   (width == 1 || width == 2 || width == 4 || width == 8))
+	{
+		m_layout = INTEGERS;
+		m_int_width = width;
+		for(auto& v : m_values)
+		{
+			m_ints.push_back(load_int((const uint8_t*)data + v.first, width));
+		}
+		std::sort(m_ints.begin(), m_ints.end());
+
+		if(m_ints.size() > s_max_scan && m_ints.back() <= s_max_bitset)
+		{
+			m_bitset.assign(m_ints.back() / 64 + 1, 0);
+			for(uint64_t v : m_ints)
+			{
+				m_bitset[v / 64] |= 1ULL << (v % 64);
+			}
+		}
+		return;
+	}
+
+	if(m_values.size() <= s_max_small)
+	{
+		m_layout = SMALL;
+		for(auto& v : m_values)
+		{
+			m_small_lens.push_back(v.second);
+			m_small_prefixes.push_back(load_prefix((const uint8_t*)data + v.first, v.second));
+			m_small_suffixes.push_back(v.second >= 8 ? load_suffix((const uint8_t*)data + v.first, v.second) : 0);
+			m_small_offsets.push_back(v.first);
+		}
+		return;
+	}
+
+	m_layout = HASH;
+	for(uint64_t seed = 0; !build_hash(seed); seed++)
+	{
+	}
+}
+
+//
+// Hash and displace: the values are spread into buckets of 4 on average,
+// then, from the largest bucket to the smallest, each bucket gets the first
+// displacement that moves all its values to free slots. With as many slots
+// as values, the last buckets need about as many attempts as there are
+// values, so building is still quick for the lists found in rules.
+//
+bool filter_value_set::build_hash(uint64_t seed)
+{
+	const uint8_t* data = (const uint8_t*)m_data.data();
+	uint32_t nslots = (uint32_t)m_values.size();
+	uint32_t nbuckets = (nslots + 3) / 4;
+
+	std::vector<uint64_t> hashes;
+	std::vector<std::vector<uint32_t>> buckets(nbuckets);
+	for(uint32_t j = 0; j < nslots; j++)
+	{
+		uint64_t h = hash(data + m_values[j].first, m_values[j].second, seed);
+		hashes.push_back(h);
+		buckets[bucket_of(h, nbuckets)].push_back(j);
+	}
+
+	std::vector<uint32_t> order;
+	for(uint32_t b = 0; b < nbuckets; b++)
+	{
+		order.push_back(b);
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[&buckets](uint32_t a, uint32_t b)
+		{
+			return buckets[a].size() > buckets[b].size();
+		});
+
+	m_displacements.assign(nbuckets, 0);
+	m_slots.assign(nslots, slot());
+	std::vector<bool> taken(nslots, false);
+	std::vector<uint32_t> slots;
+	uint32_t max_attempts = std::max(nslots, (uint32_t)1024) * 64;
+
+	for(uint32_t b : order)
+	{
+		auto& bucket = buckets[b];
+		if(bucket.empty())
+		{
+			break;
+		}
+
+		uint32_t d;
+		for(d = 0; d < max_attempts; d++)
+		{
+			slots.clear();
+			for(uint32_t j : bucket)
+			{
+				uint32_t s = slot_of(hashes[j], d, nslots);
+				if(taken[s] || std::find(slots.begin(), slots.end(), s) != slots.end())
+				{
+					break;
+				}
+				slots.push_back(s);
+			}
+
+			if(slots.size() == bucket.size())
+			{
+				break;
+			}
+		}
+
+		if(d == max_attempts)
+		{
+			// Two values with the same hash, or just bad luck
+			return false;
+		}
+
+		m_displacements[b] = d;
+		for(uint32_t k = 0; k < bucket.size(); k++)
+		{
+			slot& s = m_slots[slots[k]];
+			s.m_hash = hashes[bucket[k]];
+			s.m_offset = m_values[bucket[k]].first;
+			s.m_len = m_values[bucket[k]].second;
+			taken[slots[k]] = true;
+		}
+	}
+
+	m_hash_seed = seed;
+	return true;
+}
+
+bool filter_value_set::contains_int(uint64_t v) const
+{
+	if(!m_bitset.empty())
+	{
+		return (v / 64) < m_bitset.size() &&
+			(m_bitset[v / 64] & (1ULL << (v % 64))) != 0;
+	}
+
+	if(m_ints.size() <= s_max_scan)
+	{
+		bool found = false;
+		for(uint64_t i : m_ints)
+		{
+			found |= (i == v);
+		}
+		return found;
+	}
+
+	return std::binary_search(m_ints.begin(), m_ints.end(), v);
+}
+
+bool filter_value_set::contains_small(const uint8_t* val, uint32_t len) const
+{
+	uint64_t prefix = load_prefix(val, len);
+	uint64_t suffix = len >= 8 ? load_suffix(val, len) : 0;
+
+	uint32_t candidates = 0;
+	for(uint32_t j = 0; j < m_small_lens.size(); j++)
+	{
+		candidates |= (uint32_t)((m_small_lens[j] == len) &
+					 (m_small_prefixes[j] == prefix) &
+					 (m_small_suffixes[j] == suffix)) << j;
+	}
+
+	if(candidates == 0 || len <= 16)
+	{
+		return candidates != 0;
+	}
+
+	const char* data = m_data.data();
+	for(uint32_t j = 0; candidates != 0; j++, candidates >>= 1)
+	{
+		if((candidates & 1) &&
+		   memcmp(data + m_small_offsets[j] + 8, val + 8, len - 16) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool filter_value_set::contains_hash(const uint8_t* val, uint32_t len) const
+{
+	uint64_t h = hash(val, len, m_hash_seed);
+	uint32_t b = bucket_of(h, (uint32_t)m_displacements.size());
+	const slot& s = m_slots[slot_of(h, m_displacements[b], (uint32_t)m_slots.size())];
+
+	return s.m_hash == h && s.m_len == len &&
+		memcmp(m_data.data() + s.m_offset, val, len) == 0;
+}
@@ -0,0 +1,169 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+//
+// The values of an "in" or "intersects" check, for membership tests of the
+// extracted value. The values are copied into a single buffer when added
+// and the set is built, immutable, on the first lookup after that, in the
+// layout that fits them best:
+//
+// - INTEGERS: all the values have the same width of 1, 2, 4 or 8 bytes,
+//   which is the case for the numeric fields (ports, uids, ...). They are
+//   compared as integers: by scanning them when there are a few, with a
+//   bitset when they're all small, otherwise by binary search.
+// - SMALL: a few byte strings, scanned by comparing their length, their
+//   first 8 bytes and their last 8 bytes as integers, without branches,
+//   before comparing the rest of the candidates.
+// - HASH: more byte strings, in the table of a minimal perfect hash
+//   function (hash and displace), so that a lookup hashes the value once
+//   and compares it with one candidate only.
+//
+class filter_value_set
+{
+public:
+	enum layout
+	{
+		EMPTY,
+		INTEGERS,
+		SMALL,
+		HASH,
+	};
+
+	filter_value_set();
+
+	void insert(const uint8_t* val, uint32_t len);
+
+	bool contains(const uint8_t* val, uint32_t len)
+	{
+		if(!m_built)
+		{
+			build();
+		}
+
+		switch(m_layout)
+		{
+		case INTEGERS:
+			return len == m_int_width && contains_int(load_int(val, len));
+		case SMALL:
+			return contains_small(val, len);
+		case HASH:
+			return contains_hash(val, len);
+		default:
+			return false;
+		}
+	}
+
+	// The number of distinct values
+	size_t size();
+
+	layout get_layout();
+
+	static uint64_t hash(const uint8_t* val, uint32_t len, uint64_t seed);
+
+	// The most byte strings of the SMALL layout, and the most integers
+	// scanned instead of being looked up in a bitset or by binary search
+	static const uint32_t s_max_small = 4;
+	static const uint32_t s_max_scan = 8;
+
+	// The largest integer stored in a bitset, 8KB of memory
+	static const uint64_t s_max_bitset = 0xffff;
+
+private:
+	void build();
+	bool build_hash(uint64_t seed);
+
+	static inline uint64_t load_int(const uint8_t* val, uint32_t len)
+	{
+		switch(len)
+		{
+		case 1:
+			return *val;
+		case 2:
+			return *(uint16_t*)val;
+		case 4:
+			return *(uint32_t*)val;
+		default:
+			return *(uint64_t*)val;
+		}
+	}
+
+	// The first 8 bytes of a string, padded with zeros
+	static inline uint64_t load_prefix(const uint8_t* val, uint32_t len)
+	{
+		if(len >= 8)
+		{
+			return *(uint64_t*)val;
+		}
+		else if(len >= 4)
+		{
+			// Two loads, overlapping when len < 8
+			return *(uint32_t*)val | ((uint64_t)*(uint32_t*)(val + len - 4) << (8 * (len - 4)));
+		}
+		else if(len > 0)
+		{
+			return val[0] | (val[len / 2] << (8 * (len / 2))) | (val[len - 1] << (8 * (len - 1)));
+		}
+		return 0;
+	}
+
+	// The last 8 bytes of a string of at least 8 bytes
+	static inline uint64_t load_suffix(const uint8_t* val, uint32_t len)
+	{
+		return *(uint64_t*)(val + len - 8);
+	}
+
+	bool contains_int(uint64_t v) const;
+	bool contains_small(const uint8_t* val, uint32_t len) const;
+	bool contains_hash(const uint8_t* val, uint32_t len) const;
+
+	// The values as added, before build()
+	std::string m_data;
+	std::vector<std::pair<uint32_t, uint32_t>> m_values; ///< Offset and length in m_data
+
+	bool m_built;
+	layout m_layout;
+
+	// INTEGERS
+	uint32_t m_int_width;
+	std::vector<uint64_t> m_ints; ///< Sorted
+	std::vector<uint64_t> m_bitset; ///< Empty if m_ints is searched
+
+	// SMALL, sorted by length. With the first and the last 8 bytes, the
+	// strings of up to 16 bytes are compared without reading them.
+	std::vector<uint32_t> m_small_lens;
+	std::vector<uint64_t> m_small_prefixes;
+	std::vector<uint64_t> m_small_suffixes;
+	std::vector<uint32_t> m_small_offsets;
+
+	// HASH
+	struct slot
+	{
+		uint64_t m_hash;
+		uint32_t m_offset;
+		uint32_t m_len;
+	};
+	uint64_t m_hash_seed;
+	std::vector<uint32_t> m_displacements; ///< One per bucket
+	std::vector<slot> m_slots; ///< One per value
+};
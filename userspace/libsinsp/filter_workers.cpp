@@ -0,0 +1,254 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <algorithm>
+
+#include "sinsp.h"
+#include "sinsp_int.h"
+#include "filter.h"
+#include "eventformatter.h"
+#include "extraction_cache.h"
+#include "filter_workers.h"
+#include "state_access.h"
+
+using namespace std;
+
+sinsp_filter_workers::shard::shard(sinsp* inspector):
+	m_evt(inspector)
+{
+	if(inspector->get_extraction_cache())
+	{
+		m_extraction_cache = make_shared<sinsp_extraction_cache>();
+	}
+}
+
+sinsp_filter_workers::sinsp_filter_workers(sinsp* inspector, uint32_t nthreads):
+	m_inspector(inspector),
+	m_nrules(0),
+	m_last_evtnum(0),
+	m_evt(NULL),
+	m_pending(0),
+	m_generation(0),
+	m_stop(false)
+{
+	nthreads = max(nthreads, (uint32_t)1);
+
+	for(uint32_t k = 0; k < nthreads; k++)
+	{
+		m_shards.emplace_back(new shard(inspector));
+	}
+
+	// The calling thread runs the first shard
+	for(uint32_t k = 1; k < nthreads; k++)
+	{
+		m_threads.emplace_back(&sinsp_filter_workers::worker, this, k);
+	}
+}
+
+sinsp_filter_workers::~sinsp_filter_workers()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stop = true;
+		m_generation.fetch_add(1, memory_order_release);
+	}
+	m_evt_cond.notify_all();
+
+	for(auto& t : m_threads)
+	{
+		t.join();
+	}
+}
+
+uint32_t sinsp_filter_workers::add(const string& filter, const string& output_format)
+{
+	shard& s = *m_shards[m_nrules % m_shards.size()];
+
+	//
+	// The filterchecks of the rule share the values they extract with
+	// the ones of the same thread only
+	//
+	shared_ptr<sinsp_extraction_cache> inspector_cache = m_inspector->m_extraction_cache;
+	m_inspector->m_extraction_cache = s.m_extraction_cache;
+
+	try
+	{
+		sinsp_filter_compiler compiler(m_inspector, filter);
+		unique_ptr<sinsp_filter> f(compiler.compile());
+
+		unique_ptr<sinsp_evt_formatter> formatter;
+		if(!output_format.empty())
+		{
+			formatter.reset(new sinsp_evt_formatter(m_inspector, output_format));
+		}
+
+		s.m_ruleset.add(f.release());
+		s.m_formatters.push_back(std::move(formatter));
+	}
+	catch(...)
+	{
+		m_inspector->m_extraction_cache = inspector_cache;
+		throw;
+	}
+
+	m_inspector->m_extraction_cache = inspector_cache;
+
+	return m_nrules++;
+}
+
+uint32_t sinsp_filter_workers::size() const
+{
+	return m_nrules;
+}
+
+uint32_t sinsp_filter_workers::get_nthreads() const
+{
+	return (uint32_t)m_shards.size();
+}
+
+void sinsp_filter_workers::run(sinsp_evt* evt, vector<match>& matches)
+{
+	matches.clear();
+
+	if(evt->get_num() <= m_last_evtnum)
+	{
+		for(auto& s : m_shards)
+		{
+			if(s->m_extraction_cache)
+			{
+				s->m_extraction_cache->clear();
+			}
+		}
+	}
+	m_last_evtnum = evt->get_num();
+
+	m_evt = evt;
+	if(!m_threads.empty())
+	{
+		m_pending.store((uint32_t)m_threads.size(), memory_order_relaxed);
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_generation.fetch_add(1, memory_order_release);
+		}
+		m_evt_cond.notify_all();
+	}
+
+	// The calling thread reads the tables like the workers
+	g_state_read_only = true;
+	run_shard(*m_shards[0], 0);
+	g_state_read_only = false;
+
+	if(!m_threads.empty())
+	{
+		for(uint32_t j = 0; j < SPIN_COUNT && m_pending.load(memory_order_acquire) != 0; j++)
+		{
+			this_thread::yield();
+		}
+
+		if(m_pending.load(memory_order_acquire) != 0)
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_done_cond.wait(lock, [this] { return m_pending.load(memory_order_acquire) == 0; });
+		}
+	}
+
+	for(auto& s : m_shards)
+	{
+		if(s->m_error)
+		{
+			exception_ptr error = s->m_error;
+			s->m_error = nullptr;
+			rethrow_exception(error);
+		}
+	}
+
+	for(auto& s : m_shards)
+	{
+		for(auto& m : s->m_matches)
+		{
+			matches.push_back(std::move(m));
+		}
+	}
+
+	if(m_shards.size() > 1)
+	{
+		sort(matches.begin(), matches.end(), [](const match& a, const match& b) { return a.m_id < b.m_id; });
+	}
+}
+
+void sinsp_filter_workers::run_shard(shard& s, uint32_t k)
+{
+	uint32_t nthreads = (uint32_t)m_shards.size();
+
+	s.m_ids.clear();
+	s.m_matches.clear();
+
+	try
+	{
+		sinsp_evt::share_event(s.m_evt, *m_evt);
+		s.m_ruleset.run(&s.m_evt, s.m_ids);
+
+		for(uint32_t id : s.m_ids)
+		{
+			s.m_matches.emplace_back();
+			s.m_matches.back().m_id = id * nthreads + k;
+			if(s.m_formatters[id])
+			{
+				s.m_formatters[id]->tostring(&s.m_evt, &s.m_matches.back().m_output);
+			}
+		}
+	}
+	catch(...)
+	{
+		s.m_error = current_exception();
+	}
+}
+
+void sinsp_filter_workers::worker(uint32_t k)
+{
+	uint64_t generation = 0;
+
+	g_state_read_only = true;
+
+	while(true)
+	{
+		for(uint32_t j = 0; j < SPIN_COUNT && m_generation.load(memory_order_acquire) == generation; j++)
+		{
+			this_thread::yield();
+		}
+
+		if(m_generation.load(memory_order_acquire) == generation)
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_evt_cond.wait(lock, [&] { return m_generation.load(memory_order_acquire) != generation; });
+		}
+
+		if(m_stop)
+		{
+			return;
+		}
+		generation = m_generation.load(memory_order_acquire);
+
+		run_shard(*m_shards[k], k);
+
+		if(m_pending.fetch_sub(1, memory_order_acq_rel) == 1)
+		{
+			lock_guard<mutex> lock(m_mutex);
+			m_done_cond.notify_one();
+		}
+	}
+}
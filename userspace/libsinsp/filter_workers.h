@@ -0,0 +1,143 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event.h"
+#include "filter_ruleset.h"
+
+class sinsp;
+class sinsp_evt_formatter;
+class sinsp_extraction_cache;
+
+/*!
+  \brief A set of rules, each a filter and the format of its output, run
+  on every event by a pool of threads. The rules are split among the
+  threads, the calling one included, which extract the fields, run the
+  filters and format the outputs of the rules they own, while the events
+  are still parsed one at a time on the thread calling sinsp::next().
+
+  run() returns once all the threads are done with the event, so the
+  thread and fd tables are never updated while the threads read them.
+  Each rule always runs on the same thread, so the fields whose values
+  depend on the previous events (e.g. thread.cpu) keep working.
+
+  The rules use the fields of libsinsp, not the ones of the plugins.
+*/
+class SINSP_PUBLIC sinsp_filter_workers
+{
+public:
+	struct match
+	{
+		uint32_t m_id; ///< The id of the rule
+		std::string m_output; ///< Its output for the event, empty if it has no format
+	};
+
+	/*!
+	  \brief Runs the rules on nthreads threads, the calling one included.
+	  With a single thread, run() does everything on the calling thread.
+	*/
+	sinsp_filter_workers(sinsp* inspector, uint32_t nthreads);
+	~sinsp_filter_workers();
+
+	/*!
+	  \brief Adds a rule
+	  \param filter The filter of the rule
+	  \param output_format The format of its output, or an empty string if
+	  it has no output
+	  \return The id of the rule, i.e. the number of rules added before it
+	  \note Throws a sinsp_exception if the filter or the format are not valid
+	*/
+	uint32_t add(const std::string& filter, const std::string& output_format);
+
+	/*!
+	  \brief Returns the number of rules
+	*/
+	uint32_t size() const;
+
+	/*!
+	  \brief Returns the number of threads running the rules, the calling
+	  one included
+	*/
+	uint32_t get_nthreads() const;
+
+	/*!
+	  \brief Runs the rules on evt, the event just returned by sinsp::next(),
+	  and fills matches with the ones that match, by increasing id, with
+	  their outputs.
+	  \note Rethrows the exception thrown by a rule, if any
+	*/
+	void run(sinsp_evt* evt, std::vector<match>& matches);
+
+	// Number of times a thread checks for a new event, or for the other
+	// threads to be done, before going to sleep
+	static const uint32_t SPIN_COUNT = 200;
+
+private:
+	struct shard
+	{
+		shard(sinsp* inspector);
+
+		// The rules owned by the thread, the rule with id i being the
+		// one with local id i / nthreads in the shard i % nthreads
+		sinsp_filter_ruleset m_ruleset;
+		std::vector<std::unique_ptr<sinsp_evt_formatter>> m_formatters;
+
+		// Its own copy of the event, whose parameters it renders, and
+		// of the shared field values, which point to its filterchecks
+		sinsp_evt m_evt;
+		std::shared_ptr<sinsp_extraction_cache> m_extraction_cache;
+
+		std::vector<uint32_t> m_ids;
+		std::vector<match> m_matches;
+		std::exception_ptr m_error;
+	};
+
+	void run_shard(shard& s, uint32_t k);
+	void worker(uint32_t k);
+
+	sinsp* m_inspector;
+	std::vector<std::unique_ptr<shard>> m_shards;
+	std::vector<std::thread> m_threads;
+	uint32_t m_nrules;
+
+	// Number of the last event run, to forget the shared field values
+	// when a new capture starts over
+	uint64_t m_last_evtnum;
+
+	// The event being run, and the number of worker threads that
+	// haven't finished with it
+	sinsp_evt* m_evt;
+	std::atomic<uint32_t> m_pending;
+
+	std::mutex m_mutex;
+	// Signaled when there is a new event to run
+	std::condition_variable m_evt_cond;
+	// Signaled when the last worker thread is done with the event
+	std::condition_variable m_done_cond;
+	std::atomic<uint64_t> m_generation;
+	std::atomic<bool> m_stop;
+};
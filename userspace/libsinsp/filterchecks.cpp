@@ -2035,6 +2035,7 @@ int32_t sinsp_filter_check_thread::parse_field_name(const char* str, bool alloc_
 		{
 			m_th_state_id = m_inspector->reserve_thread_memory(sizeof(uint64_t));
 		}
+		m_extract_stateful = true;
 
 		return sinsp_filter_check::parse_field_name(str, alloc_state, needed_for_filtering);
 	}
@@ -2052,12 +2053,18 @@ int32_t sinsp_filter_check_thread::parse_field_name(const char* str, bool alloc_
 		{
 			m_th_state_id = m_inspector->reserve_thread_memory(sizeof(uint64_t));
 		}
+		m_extract_stateful = true;
 
 		return sinsp_filter_check::parse_field_name(str, alloc_state, needed_for_filtering);
 	}
 	else
 	{
-		return sinsp_filter_check::parse_field_name(str, alloc_state, needed_for_filtering);
+		int32_t res = sinsp_filter_check::parse_field_name(str, alloc_state, needed_for_filtering);
+
+		// The exectime depends on the previous switch event extracted
+		m_extract_stateful = (m_field_id == TYPE_EXECTIME);
+
+		return res;
 	}
 }
 
@@ -2226,11 +2233,11 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 			m_tstr.clear();
 
 			uint32_t j;
-			uint32_t nargs = (uint32_t)tinfo->m_args.size();
+			uint32_t nargs = (uint32_t)tinfo->m_args->size();
 
 			for(j = 0; j < nargs; j++)
 			{
-				m_tstr += tinfo->m_args[j];
+				m_tstr += tinfo->get_args()[j];
 				if(j < nargs -1)
 				{
 					m_tstr += ' ';
@@ -2268,11 +2275,11 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 			m_tstr = tinfo->get_exe() + " ";
 
 			uint32_t j;
-			uint32_t nargs = (uint32_t)tinfo->m_args.size();
+			uint32_t nargs = (uint32_t)tinfo->m_args->size();
 
 			for(j = 0; j < nargs; j++)
 			{
-				m_tstr += tinfo->m_args[j];
+				m_tstr += tinfo->get_args()[j];
 				if(j < nargs -1)
 				{
 					m_tstr += ' ';
@@ -2471,9 +2478,9 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 
 			sinsp_threadinfo::visitor_func_t check_thread_for_shell = [&res] (sinsp_threadinfo *pt)
 			{
-				size_t len = pt->m_comm.size();
+				size_t len = pt->m_comm->size();
 
-				if(len >= 2 && pt->m_comm[len - 2] == 's' && pt->m_comm[len - 1] == 'h')
+				if(len >= 2 && pt->get_comm()[len - 2] == 's' && pt->get_comm()[len - 1] == 'h')
 				{
 					res = &pt->m_pid;
 				}
@@ -2571,7 +2578,7 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 	case TYPE_CGROUPS:
 		{
 			m_tstr.clear();
-			auto cgroups = tinfo->cgroups();
+			const auto& cgroups = tinfo->cgroups();
 
 			uint32_t j;
 			uint32_t nargs = (uint32_t)cgroups.size();
@@ -2596,7 +2603,7 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 		}
 	case TYPE_CGROUP:
 		{
-			auto cgroups = tinfo->cgroups();
+			const auto& cgroups = tinfo->cgroups();
 			uint32_t nargs = (uint32_t)cgroups.size();
 
 			if(nargs == 0)
@@ -2719,18 +2726,18 @@ uint8_t* sinsp_filter_check_thread::extract(sinsp_evt *evt, OUT uint32_t* len, b
 		RETURN_EXTRACT_STRING(m_tstr);
 	case TYPE_CMDNARGS:
 		{
-			m_u64val = (uint32_t)tinfo->m_args.size();
+			m_u64val = (uint32_t)tinfo->m_args->size();
 			RETURN_EXTRACT_VAR(m_u64val);
 		}
 	case TYPE_CMDLENARGS:
 		{
 			m_u64val = 0;
 			uint32_t j;
-			uint32_t nargs = (uint32_t)tinfo->m_args.size();
+			uint32_t nargs = (uint32_t)tinfo->m_args->size();
 
 			for(j = 0; j < nargs; j++)
 			{
-				m_u64val += tinfo->m_args[j].length();
+				m_u64val += tinfo->get_args()[j].length();
 
 			}
 			RETURN_EXTRACT_VAR(m_u64val);
@@ -2843,7 +2850,7 @@ bool sinsp_filter_check_thread::compare_full_aname(sinsp_evt *evt)
 
 		res = flt_compare(m_cmpop,
 				  PT_CHARBUF,
-				  (void*)pt->m_comm.c_str());
+				  (void*)pt->m_comm->c_str());
 
 		if(res == true)
 		{
@@ -3264,6 +3271,7 @@ int32_t sinsp_filter_check_event::parse_field_name(const char* str, bool alloc_s
 		{
 			m_th_state_id = m_inspector->reserve_thread_memory(sizeof(uint16_t));
 		}
+		m_extract_stateful = true;
 
 		res = sinsp_filter_check::parse_field_name(str, alloc_state, needed_for_filtering);
 	}
@@ -3298,6 +3306,11 @@ int32_t sinsp_filter_check_event::parse_field_name(const char* str, bool alloc_s
 	else
 	{
 		res = sinsp_filter_check::parse_field_name(str, alloc_state, needed_for_filtering);
+
+		// The deltas depend on the previous event extracted
+		m_extract_stateful = (m_field_id == TYPE_DELTA ||
+				      m_field_id == TYPE_DELTA_S ||
+				      m_field_id == TYPE_DELTA_NS);
 	}
 
 	return res;
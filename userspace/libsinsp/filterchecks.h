@@ -20,6 +20,9 @@ limitations under the License.
 #include <json/json.h>
 #include "filter_value.h"
 #include "prefix_search.h"
+#include "aho_corasick.h"
+#include "filter_value_set.h"
+#include "glob_matcher.h"
 #if !defined(CYGWING_AGENT) && !defined(MINIMAL_BUILD)
 #include "k8s.h"
 #include "mesos.h"
@@ -28,12 +31,19 @@ limitations under the License.
 #include "gen_filter.h"
 
 class sinsp_filter_check_reference;
+class sinsp_extraction_cache;
 
 bool flt_compare(cmpop op, ppm_param_type type, void* operand1, void* operand2, uint32_t op1_len = 0, uint32_t op2_len = 0);
 bool flt_compare_avg(cmpop op, ppm_param_type type, void* operand1, void* operand2, uint32_t op1_len, uint32_t op2_len, uint32_t cnt1, uint32_t cnt2);
 bool flt_compare_ipv4net(cmpop op, uint64_t operand1, const ipv4net* operand2);
 bool flt_compare_ipv6net(cmpop op, const ipv6addr *operand1, const ipv6net *operand2);
 
+// A comparison specialized on the type of the operands and on the operator
+typedef bool (*flt_typed_compare_t)(const uint8_t* operand1, uint32_t op1_len, const uint8_t* operand2, uint32_t op2_len);
+
+// The specialized comparison for op and type, or NULL if there isn't one
+flt_typed_compare_t flt_typed_compare(cmpop op, ppm_param_type type);
+
 char* flt_to_string(uint8_t* rawval, filtercheck_field_info* finfo);
 int32_t gmt2local(time_t t);
 
@@ -90,9 +100,7 @@ class sinsp_filter_check : public gen_event_filter_check,
 public:
 	sinsp_filter_check();
 
-	virtual ~sinsp_filter_check()
-	{
-	}
+	virtual ~sinsp_filter_check();
 
 	//
 	// Allocate a new check of the same type.
@@ -151,6 +159,13 @@ public:
 	//
 	bool extract_cached(sinsp_evt *evt, OUT vector<extract_value_t>& values, bool sanitize_strings = true);
 
+	//
+	// Share the values extracted by extract_cached() with the other
+	// filterchecks of the inspector that extract the same field, given
+	// its name as written in the filter or in the format.
+	//
+	void share_extraction(const std::string& field);
+
 	//
 	// Extract the field as json from the event (by default, fall
 	// back to the regular extract functionality)
@@ -205,12 +220,21 @@ protected:
 	inline uint8_t* filter_value_p(uint16_t i = 0) { return &m_val_storages[i][0]; }
 	inline vector<uint8_t>* filter_value(uint16_t i = 0) { return &m_val_storages[i]; }
 
-	unordered_set<filter_value_t,
-		g_hash_membuf,
-		g_equal_to_membuf> m_val_storages_members;
+	// The parsed length of each value, the storages being larger
+	vector<uint32_t> m_val_storages_lens;
+	inline uint32_t filter_value_len(uint16_t i = 0) { return m_val_storages_lens[i]; }
+
+	filter_value_set m_val_storages_members;
 
 	path_prefix_search m_val_storages_paths;
 
+	// The values of string contains/icontains/startswith/endswith checks,
+	// matched all at once when there's more than one
+	aho_corasick m_val_storages_patterns;
+
+	// The values of string glob checks, compiled
+	vector<glob_matcher> m_val_storages_globs;
+
 	uint32_t m_val_storages_min_size;
 	uint32_t m_val_storages_max_size;
 
@@ -220,6 +244,22 @@ protected:
 	uint32_t m_th_state_id;
 	uint32_t m_val_storage_len;
 
+	// When the check compares the field with a single value, the
+	// comparison specialized for the field type and the operator, which
+	// flt_compare() uses instead of switching on them
+	flt_typed_compare_t m_typed_compare;
+
+	// true for the checks that only implement the multi-valued extract()
+	bool m_extract_multivalued = false;
+
+	// true for the checks whose values depend on the events they extracted
+	// before, which then can't be shared
+	bool m_extract_stateful = false;
+
+	// Set by share_extraction()
+	std::shared_ptr<sinsp_extraction_cache> m_shared_cache;
+	uint32_t m_shared_cache_key = 0;
+
 private:
 	void set_inspector(sinsp* inspector);
 
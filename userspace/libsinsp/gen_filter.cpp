@@ -14,6 +14,7 @@ You should have received a copy of the GNU General Public License
 along with Falco.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <chrono>
 #include <cstddef>
 #include <iomanip>
 #include <algorithm>
@@ -23,6 +24,24 @@ along with Falco.  If not, see <http://www.gnu.org/licenses/>.
 #include "sinsp.h"
 #include "sinsp_int.h"
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define GEN_FILTER_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define GEN_FILTER_TSC
+#endif
+
+static inline uint64_t profile_ticks()
+{
+#ifdef GEN_FILTER_TSC
+	return __rdtsc();
+#else
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 gen_event::gen_event()
 {
 }
@@ -69,6 +88,11 @@ bool gen_event_filter_expression::compare(gen_event *evt)
 	bool res = true;
 	gen_event_filter_check* chk = NULL;
 
+	if(!m_counters.empty())
+	{
+		return compare_profiled(evt);
+	}
+
 	for(j = 0; j < size; j++)
 	{
 		chk = m_checks[j];
@@ -132,11 +156,74 @@ bool gen_event_filter_expression::compare(gen_event *evt)
 	return res;
 }
 
+//
+// The same as compare(), counting the evaluations of the checks
+//
+bool gen_event_filter_expression::compare_profiled(gen_event *evt)
+{
+	bool res = true;
+
+	for(uint32_t j = 0; j < m_checks.size(); j++)
+	{
+		gen_event_filter_check* chk = m_checks[j];
+		uint32_t op = (uint32_t)chk->m_boolop;
+
+		if(j > 0)
+		{
+			if(((op & ~BO_NOT) == BO_OR && res) ||
+			   ((op & ~BO_NOT) == BO_AND && !res))
+			{
+				break;
+			}
+			else if((op & ~BO_NOT) != BO_OR && (op & ~BO_NOT) != BO_AND)
+			{
+				ASSERT(false);
+				continue;
+			}
+		}
+		else if(op != BO_NONE && op != BO_NOT)
+		{
+			ASSERT(false);
+			continue;
+		}
+
+		gen_event_filter_counters& counters = m_counters[j];
+		uint64_t start = profile_ticks();
+		res = chk->compare(evt) != ((op & BO_NOT) != 0);
+		counters.m_ticks += profile_ticks() - start;
+		counters.m_num_evals++;
+		counters.m_num_true += res ? 1 : 0;
+	}
+
+	return res;
+}
+
 bool gen_event_filter_expression::extract(gen_event *evt, vector<extract_value_t>& values, bool sanitize_strings)
 {
 	return false;
 }
 
+void gen_event_filter_expression::set_profiling(bool enable)
+{
+	if(enable)
+	{
+		m_counters.assign(m_checks.size(), gen_event_filter_counters());
+	}
+	else
+	{
+		std::vector<gen_event_filter_counters>().swap(m_counters);
+	}
+
+	for(auto chk : m_checks)
+	{
+		gen_event_filter_expression* expr = dynamic_cast<gen_event_filter_expression*>(chk);
+		if(expr != NULL)
+		{
+			expr->set_profiling(enable);
+		}
+	}
+}
+
 int32_t gen_event_filter_expression::get_expr_boolop()
 {
 	std::vector<gen_event_filter_check*>* cks = &(m_checks);
@@ -165,6 +252,279 @@ int32_t gen_event_filter_expression::get_expr_boolop()
 	return b0;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// gen_event_filter_profile implementation
+///////////////////////////////////////////////////////////////////////////////
+static void profile_to_string(const gen_event_filter_profile& p, uint32_t depth, std::ostringstream& os)
+{
+	const gen_event_filter_counters& c = p.m_counters;
+
+	os << std::string(depth * 2, ' ') << p.m_name << ": " << c.m_num_evals << " evals";
+	if(c.m_num_evals > 0)
+	{
+		os << ", " << std::fixed << std::setprecision(1)
+		   << 100.0 * c.m_num_true / c.m_num_evals << "% true";
+		if(!p.m_children.empty())
+		{
+			os << ", " << 100.0 * p.m_num_short_circuits / c.m_num_evals << "% short-circuited";
+		}
+		os << ", " << (double)c.m_ticks / c.m_num_evals << " ticks/eval";
+	}
+	os << std::endl;
+
+	for(auto& child : p.m_children)
+	{
+		profile_to_string(child, depth + 1, os);
+	}
+}
+
+std::string gen_event_filter_profile::to_string() const
+{
+	std::ostringstream os;
+	profile_to_string(*this, 0, os);
+	return os.str();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// gen_event_filter_program implementation
+///////////////////////////////////////////////////////////////////////////////
+gen_event_filter_program::gen_event_filter_program(gen_event_filter_expression* expr)
+{
+	lower(expr);
+	thread_jumps();
+	fuse_jumps();
+}
+
+bool gen_event_filter_program::run(gen_event *evt) const
+{
+	const instr* code = m_code.data();
+	uint32_t size = (uint32_t)m_code.size();
+	uint32_t pc = 0;
+	bool res = true;
+
+	while(pc < size)
+	{
+		const instr& i = code[pc];
+
+		switch(i.m_op)
+		{
+		case OP_CHECK:
+			res = i.m_check->compare(evt) != i.m_negate;
+			break;
+		case OP_NOT:
+			res = !res;
+			break;
+		case OP_TRUE:
+			res = true;
+			break;
+		default:
+			break;
+		}
+
+		pc = (i.m_jump == (res ? JUMP_IF_TRUE : JUMP_IF_FALSE)) ? i.m_target : pc + 1;
+	}
+
+	return res;
+}
+
+std::string gen_event_filter_program::to_string() const
+{
+	std::ostringstream os;
+
+	for(uint32_t j = 0; j < m_code.size(); j++)
+	{
+		const instr& i = m_code[j];
+
+		os << j << ": ";
+		switch(i.m_op)
+		{
+		case OP_CHECK:
+			os << (i.m_negate ? "not check" : "check");
+			break;
+		case OP_NOT:
+			os << "not";
+			break;
+		case OP_TRUE:
+			os << "true";
+			break;
+		default:
+			os << "nop";
+			break;
+		}
+
+		if(i.m_jump != JUMP_NEVER)
+		{
+			os << ", if " << (i.m_jump == JUMP_IF_TRUE ? "true" : "false")
+			   << " jump to " << i.m_target;
+		}
+		os << std::endl;
+	}
+
+	return os.str();
+}
+
+//
+// Leaves the result of the expression in res, like compare() returns it. The
+// jumps taken when the result is known go to the end of the expression, and
+// are patched once it's lowered.
+//
+void gen_event_filter_program::lower(gen_event_filter_expression* expr)
+{
+	std::vector<uint32_t> exits;
+
+	if(expr->m_checks.empty())
+	{
+		emit(OP_TRUE, false, JUMP_NEVER, NULL);
+		return;
+	}
+
+	for(uint32_t j = 0; j < expr->m_checks.size(); j++)
+	{
+		gen_event_filter_check* chk = expr->m_checks[j];
+		bool negate = (chk->m_boolop & BO_NOT) != 0;
+
+		if(j > 0)
+		{
+			switch(chk->m_boolop)
+			{
+			case BO_OR:
+			case BO_ORNOT:
+				exits.push_back((uint32_t)m_code.size());
+				emit(OP_JUMP, false, JUMP_IF_TRUE, NULL);
+				break;
+			case BO_AND:
+			case BO_ANDNOT:
+				exits.push_back((uint32_t)m_code.size());
+				emit(OP_JUMP, false, JUMP_IF_FALSE, NULL);
+				break;
+			default:
+				// compare() ignores the check
+				ASSERT(false);
+				continue;
+			}
+		}
+		else if(chk->m_boolop != BO_NONE && chk->m_boolop != BO_NOT)
+		{
+			ASSERT(false);
+			continue;
+		}
+
+		lower_operand(chk, negate);
+	}
+
+	for(uint32_t e : exits)
+	{
+		m_code[e].m_target = (uint32_t)m_code.size();
+	}
+}
+
+void gen_event_filter_program::lower_operand(gen_event_filter_check* chk, bool negate)
+{
+	gen_event_filter_expression* expr = dynamic_cast<gen_event_filter_expression*>(chk);
+
+	// The expressions with a single operand, like "not check", are only
+	// negations of it
+	if(expr != NULL && expr->m_checks.size() == 1 &&
+	   (expr->m_checks[0]->m_boolop == BO_NONE || expr->m_checks[0]->m_boolop == BO_NOT))
+	{
+		lower_operand(expr->m_checks[0], negate != (expr->m_checks[0]->m_boolop == BO_NOT));
+	}
+	else if(expr != NULL)
+	{
+		lower(expr);
+		if(negate)
+		{
+			emit(OP_NOT, false, JUMP_NEVER, NULL);
+		}
+	}
+	else
+	{
+		emit(OP_CHECK, negate, JUMP_NEVER, chk);
+	}
+}
+
+void gen_event_filter_program::emit(opcode op, bool negate, jump_cond jump, gen_event_filter_check* chk)
+{
+	instr i;
+	i.m_op = op;
+	i.m_negate = negate;
+	i.m_jump = jump;
+	i.m_target = 0;
+	i.m_check = chk;
+	m_code.push_back(i);
+}
+
+//
+// A jump to a jump that only tests the result again goes to where the
+// latter would go. E.g. in "(a or b) and c", when a is true b is skipped
+// and the jump ending "a or b" isn't taken, so a jumps to c directly.
+// All the jumps go forward.
+//
+void gen_event_filter_program::thread_jumps()
+{
+	for(auto& i : m_code)
+	{
+		if(i.m_jump == JUMP_NEVER)
+		{
+			continue;
+		}
+
+		uint32_t t = i.m_target;
+		while(t < m_code.size() && m_code[t].m_op == OP_JUMP)
+		{
+			t = (m_code[t].m_jump == i.m_jump) ? m_code[t].m_target : t + 1;
+		}
+		i.m_target = t;
+	}
+}
+
+//
+// Merges the jumps into the instructions before them, unless something
+// jumps to them
+//
+void gen_event_filter_program::fuse_jumps()
+{
+	uint32_t size = (uint32_t)m_code.size();
+	std::vector<bool> targeted(size + 1, false);
+	std::vector<uint32_t> index(size + 1, 0);
+	std::vector<instr> code;
+
+	for(auto& i : m_code)
+	{
+		if(i.m_jump != JUMP_NEVER)
+		{
+			targeted[i.m_target] = true;
+		}
+	}
+
+	for(uint32_t j = 0; j < size; j++)
+	{
+		instr i = m_code[j];
+		index[j] = (uint32_t)code.size();
+
+		if(i.m_op != OP_JUMP && i.m_jump == JUMP_NEVER &&
+		   j + 1 < size && m_code[j + 1].m_op == OP_JUMP && !targeted[j + 1])
+		{
+			j++;
+			index[j] = (uint32_t)code.size();
+			i.m_jump = m_code[j].m_jump;
+			i.m_target = m_code[j].m_target;
+		}
+
+		code.push_back(i);
+	}
+	index[size] = (uint32_t)code.size();
+
+	for(auto& i : code)
+	{
+		if(i.m_jump != JUMP_NEVER)
+		{
+			i.m_target = index[i.m_target];
+		}
+	}
+
+	m_code.swap(code);
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // sinsp_filter implementation
@@ -208,14 +568,138 @@ void gen_event_filter::pop_expression()
 
 bool gen_event_filter::run(gen_event *evt)
 {
+	if(m_counters)
+	{
+		uint64_t start = profile_ticks();
+		bool res = m_filter->compare(evt);
+		m_counters->m_ticks += profile_ticks() - start;
+		m_counters->m_num_evals++;
+		m_counters->m_num_true += res ? 1 : 0;
+		return res;
+	}
+
+	if(m_program)
+	{
+		return m_program->run(evt);
+	}
+
 	return m_filter->compare(evt);
 }
 
+void gen_event_filter::set_program(bool enable)
+{
+	if(enable)
+	{
+		m_program.reset(new gen_event_filter_program(m_filter));
+	}
+	else
+	{
+		m_program.reset();
+	}
+}
+
+const gen_event_filter_program* gen_event_filter::get_program() const
+{
+	return m_program.get();
+}
+
+void gen_event_filter::set_profiling(bool enable)
+{
+	m_filter->set_profiling(enable);
+
+	if(enable)
+	{
+		m_counters.reset(new gen_event_filter_counters());
+	}
+	else
+	{
+		m_counters.reset();
+	}
+}
+
+static void build_profile(const gen_event_filter_check* chk,
+			  const gen_event_filter_counters& counters,
+			  bool negated,
+			  const std::map<const gen_event_filter_check*, std::string>& names,
+			  gen_event_filter_profile& p)
+{
+	const gen_event_filter_expression* expr = dynamic_cast<const gen_event_filter_expression*>(chk);
+
+	p.m_counters = counters;
+
+	if(expr == NULL)
+	{
+		auto it = names.find(chk);
+		p.m_name = (negated ? "not " : "") + (it != names.end() ? it->second : std::string("check"));
+		return;
+	}
+
+	// The brackets around a single operand, or the root of the tree,
+	// evaluate it as many times
+	if(!negated && expr->m_checks.size() == 1 && expr->m_counters.size() == 1)
+	{
+		build_profile(expr->m_checks[0], expr->m_counters[0],
+			      (expr->m_checks[0]->m_boolop & BO_NOT) != 0,
+			      names, p);
+		return;
+	}
+
+	std::string op;
+	if(expr->m_checks.size() > 1)
+	{
+		op = ((expr->m_checks[1]->m_boolop & ~BO_NOT) == BO_OR) ? "or" : "and";
+	}
+
+	if(negated)
+	{
+		p.m_name = op.empty() ? "not" : "not " + op;
+	}
+	else
+	{
+		p.m_name = op.empty() ? "()" : op;
+	}
+
+	if(!expr->m_counters.empty())
+	{
+		p.m_num_short_circuits = counters.m_num_evals - expr->m_counters.back().m_num_evals;
+	}
+
+	for(uint32_t j = 0; j < expr->m_checks.size() && j < expr->m_counters.size(); j++)
+	{
+		p.m_children.emplace_back();
+		build_profile(expr->m_checks[j], expr->m_counters[j],
+			      (expr->m_checks[j]->m_boolop & BO_NOT) != 0,
+			      names, p.m_children.back());
+	}
+}
+
+gen_event_filter_profile gen_event_filter::get_profile() const
+{
+	gen_event_filter_profile p;
+
+	if(m_counters)
+	{
+		build_profile(m_filter, *m_counters, false, m_check_names, p);
+	}
+
+	return p;
+}
+
 void gen_event_filter::add_check(gen_event_filter_check* chk)
 {
 	m_curexpr->add_check((gen_event_filter_check *) chk);
 }
 
+const std::set<uint16_t>& gen_event_filter::evttypes() const
+{
+	return m_evttypes;
+}
+
+void gen_event_filter::set_evttypes(const std::set<uint16_t>& evttypes)
+{
+	m_evttypes = evttypes;
+}
+
 bool gen_event_filter_factory::filter_field_info::is_skippable()
 {
 	// Skip fields with the EPF_TABLE_ONLY flag.
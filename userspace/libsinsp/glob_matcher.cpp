@@ -0,0 +1,279 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string.h>
+
+#include "glob_matcher.h"
+#include "memmem.h"
+#include "utils.h"
+
+glob_matcher::glob_matcher():
+	m_compiled(false),
+	m_min_len(0)
+{
+}
+
+void glob_matcher::compile(const std::string& pattern)
+{
+	m_pattern = pattern;
+	m_compiled = false;
+	m_chunks.assign(1, chunk());
+	m_sets.clear();
+	m_min_len = 0;
+
+#ifdef _WIN32
+	// sinsp_utils::glob_match() relies on PathMatchSpec(), which has
+	// different rules
+	return;
+#endif
+
+	for(size_t pos = 0; pos < pattern.size(); pos++)
+	{
+		atom a;
+		uint8_t c = (uint8_t)pattern[pos];
+
+		if(c == '*')
+		{
+			if(!m_chunks.back().m_atoms.empty() || m_chunks.size() == 1)
+			{
+				m_chunks.push_back(chunk());
+			}
+			continue;
+		}
+		else if(c == '?')
+		{
+			a.m_type = atom::ANY;
+		}
+		else if(c == '[')
+		{
+			std::bitset<256> set;
+			if(!parse_set(pattern, pos, set))
+			{
+				return;
+			}
+			a.m_type = atom::SET;
+			a.m_set = (uint32_t)m_sets.size();
+			m_sets.push_back(set);
+		}
+		else
+		{
+			if(c == '\\')
+			{
+				if(++pos == pattern.size())
+				{
+					return;
+				}
+				c = (uint8_t)pattern[pos];
+			}
+			a.m_type = atom::LITERAL;
+			a.m_byte = c;
+		}
+
+		m_chunks.back().m_atoms.push_back(a);
+	}
+
+	for(auto& ch : m_chunks)
+	{
+		ch.m_is_literal = true;
+		for(auto& a : ch.m_atoms)
+		{
+			if(a.m_type != atom::LITERAL)
+			{
+				ch.m_is_literal = false;
+				break;
+			}
+			ch.m_literal.push_back((char)a.m_byte);
+		}
+		m_min_len += ch.m_atoms.size();
+	}
+
+	m_compiled = true;
+}
+
+//
+// Parses the bracket expression starting at pattern[pos], leaving pos on
+// its closing bracket. Returns false for the ones that aren't supported:
+// unterminated, with character classes, equivalence classes or collating
+// symbols, or with reversed ranges.
+//
+bool glob_matcher::parse_set(const std::string& pattern, size_t& pos, std::bitset<256>& set)
+{
+	size_t p = pos + 1;
+	bool negated = false;
+
+	if(p < pattern.size() && (pattern[p] == '!' || pattern[p] == '^'))
+	{
+		negated = true;
+		p++;
+	}
+
+	bool first = true;
+	while(true)
+	{
+		if(p >= pattern.size())
+		{
+			return false;
+		}
+
+		uint8_t lo = (uint8_t)pattern[p];
+		if(lo == ']' && !first)
+		{
+			break;
+		}
+		first = false;
+
+		if(lo == '[' && p + 1 < pattern.size() &&
+		   (pattern[p + 1] == ':' || pattern[p + 1] == '=' || pattern[p + 1] == '.'))
+		{
+			return false;
+		}
+
+		if(lo == '\\')
+		{
+			if(++p >= pattern.size())
+			{
+				return false;
+			}
+			lo = (uint8_t)pattern[p];
+		}
+		p++;
+
+		uint8_t hi = lo;
+		if(p + 1 < pattern.size() && pattern[p] == '-' && pattern[p + 1] != ']')
+		{
+			p++;
+			if(pattern[p] == '[' || pattern[p] == '\\')
+			{
+				return false;
+			}
+			hi = (uint8_t)pattern[p];
+			p++;
+			if(hi < lo)
+			{
+				return false;
+			}
+		}
+
+		for(uint32_t c = lo; c <= hi; c++)
+		{
+			set.set(c);
+		}
+	}
+
+	if(negated)
+	{
+		set.flip();
+	}
+	// The string terminator is never part of it
+	set.reset(0);
+
+	pos = p;
+	return true;
+}
+
+bool glob_matcher::match_chunk(const chunk& c, const char* str) const
+{
+	for(size_t j = 0; j < c.m_atoms.size(); j++)
+	{
+		const atom& a = c.m_atoms[j];
+		uint8_t b = (uint8_t)str[j];
+		switch(a.m_type)
+		{
+		case atom::LITERAL:
+			if(b != a.m_byte)
+			{
+				return false;
+			}
+			break;
+		case atom::ANY:
+			break;
+		case atom::SET:
+			if(!m_sets[a.m_set].test(b))
+			{
+				return false;
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+// Returns the leftmost position where c matches in str, or NULL
+const char* glob_matcher::find_chunk(const chunk& c, const char* str, size_t len) const
+{
+	size_t clen = c.m_atoms.size();
+
+	if(c.m_is_literal)
+	{
+		return sinsp_memmem(str, len, c.m_literal.c_str(), clen);
+	}
+
+	for(size_t j = 0; j + clen <= len; j++)
+	{
+		if(match_chunk(c, str + j))
+		{
+			return str + j;
+		}
+	}
+
+	return NULL;
+}
+
+bool glob_matcher::match(const char* str, size_t len) const
+{
+	if(!m_compiled)
+	{
+		return sinsp_utils::glob_match(m_pattern.c_str(), str);
+	}
+
+	if(len < m_min_len)
+	{
+		return false;
+	}
+
+	const chunk& head = m_chunks.front();
+	if(m_chunks.size() == 1)
+	{
+		return len == head.m_atoms.size() && match_chunk(head, str);
+	}
+
+	// The literal prefix and suffix first
+	const chunk& tail = m_chunks.back();
+	size_t tail_len = tail.m_atoms.size();
+	if(!match_chunk(head, str) || !match_chunk(tail, str + len - tail_len))
+	{
+		return false;
+	}
+
+	// Each chunk between two stars at the leftmost position where it fits,
+	// which leaves the most room to the next ones
+	const char* p = str + head.m_atoms.size();
+	const char* end = str + len - tail_len;
+	for(size_t j = 1; j + 1 < m_chunks.size(); j++)
+	{
+		const chunk& c = m_chunks[j];
+		const char* found = find_chunk(c, p, end - p);
+		if(found == NULL)
+		{
+			return false;
+		}
+		p = found + c.m_atoms.size();
+	}
+
+	return true;
+}
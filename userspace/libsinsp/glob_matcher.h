@@ -0,0 +1,86 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+//
+// A glob pattern compiled once, to be matched against many strings with the
+// same result as sinsp_utils::glob_match(), i.e. fnmatch() without flags.
+//
+// The pattern is split at its stars into chunks of single-byte atoms (a
+// byte, "?" or a bracket expression). The first chunk must match at the
+// beginning of the string and the last one at its end, which rejects most
+// strings by looking only at a few bytes. The chunks in between are then
+// searched from left to right, with sinsp_memmem() when they are literal.
+//
+// Patterns using features that aren't compiled, e.g. the character classes
+// of bracket expressions, are matched with sinsp_utils::glob_match().
+//
+class glob_matcher
+{
+public:
+	glob_matcher();
+
+	void compile(const std::string& pattern);
+
+	// false if the pattern is matched with sinsp_utils::glob_match()
+	bool compiled() const
+	{
+		return m_compiled;
+	}
+
+	// str must be NUL-terminated, len is its length
+	bool match(const char* str, size_t len) const;
+
+private:
+	struct atom
+	{
+		enum type
+		{
+			LITERAL,
+			ANY,
+			SET,
+		};
+
+		type m_type;
+		uint8_t m_byte; ///< For LITERAL
+		uint32_t m_set; ///< For SET, index in m_sets
+	};
+
+	struct chunk
+	{
+		std::vector<atom> m_atoms;
+		std::string m_literal; ///< The bytes of the chunk, when all atoms are LITERAL
+		bool m_is_literal;
+	};
+
+	bool parse_set(const std::string& pattern, size_t& pos, std::bitset<256>& set);
+	bool match_chunk(const chunk& c, const char* str) const;
+	const char* find_chunk(const chunk& c, const char* str, size_t len) const;
+
+	std::string m_pattern;
+	bool m_compiled;
+	std::vector<chunk> m_chunks; ///< One more than the stars in the pattern
+	std::vector<std::bitset<256>> m_sets;
+	size_t m_min_len;
+};
@@ -0,0 +1,236 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+template<typename T>
+class interned_table;
+
+//
+// An immutable value, shared by all the holders of an equal value interned
+// in the same table, and deleted with its last holder. Copying it only
+// copies a reference.
+//
+template<typename T>
+class interned
+{
+public:
+	//
+	// The empty value, shared by all the default constructed ones
+	//
+	interned(): m_value(empty())
+	{
+	}
+
+	//
+	// A value of its own, for the holders without a table
+	//
+	explicit interned(T value): m_value(std::make_shared<const T>(std::move(value)))
+	{
+	}
+
+	inline const T& get() const
+	{
+		return *m_value;
+	}
+
+	inline const T* operator->() const
+	{
+		return m_value.get();
+	}
+
+	inline const T& operator*() const
+	{
+		return *m_value;
+	}
+
+	//
+	// The number of holders of the value
+	//
+	inline long use_count() const
+	{
+		return m_value.use_count();
+	}
+
+	inline bool operator==(const interned& other) const
+	{
+		return m_value == other.m_value || *m_value == *other.m_value;
+	}
+
+	inline bool operator!=(const interned& other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	explicit interned(std::shared_ptr<const T> value): m_value(std::move(value))
+	{
+	}
+
+	static const std::shared_ptr<const T>& empty()
+	{
+		static const std::shared_ptr<const T> value = std::make_shared<const T>();
+		return value;
+	}
+
+	std::shared_ptr<const T> m_value;
+
+	friend class interned_table<T>;
+};
+
+//
+// The hash of the interned values: strings, and vectors of strings or of
+// pairs of strings
+//
+struct interned_hash
+{
+	inline size_t operator()(const std::string& s) const
+	{
+		return std::hash<std::string>()(s);
+	}
+
+	template<typename U, typename V>
+	inline size_t operator()(const std::pair<U, V>& p) const
+	{
+		return combine((*this)(p.first), (*this)(p.second));
+	}
+
+	template<typename U>
+	inline size_t operator()(const std::vector<U>& v) const
+	{
+		size_t res = v.size();
+		for(const auto& it : v)
+		{
+			res = combine(res, (*this)(it));
+		}
+		return res;
+	}
+
+private:
+	static inline size_t combine(size_t seed, size_t h)
+	{
+		return seed ^ (h + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+	}
+};
+
+//
+// A table of interned values: interning a value returns the one already
+// in the table if there is an equal one, so that all the holders share
+// it, and the empty values are all the default one. A value leaves the
+// table when its last holder drops it, and the values can outlive the
+// table.
+//
+// The table is not thread safe, and the values must be dropped by the
+// thread that interns them.
+//
+template<typename T>
+class interned_table
+{
+public:
+	interned_table(): m_state(std::make_shared<state>())
+	{
+	}
+
+	inline interned<T> intern(const T& value)
+	{
+		if(value.empty())
+		{
+			return interned<T>();
+		}
+
+		std::shared_ptr<const T> res = find(value);
+		return interned<T>(res ? std::move(res) : add(new T(value)));
+	}
+
+	inline interned<T> intern(T&& value)
+	{
+		if(value.empty())
+		{
+			return interned<T>();
+		}
+
+		std::shared_ptr<const T> res = find(value);
+		return interned<T>(res ? std::move(res) : add(new T(std::move(value))));
+	}
+
+	//
+	// The number of different values in the table
+	//
+	inline size_t size() const
+	{
+		return m_state->m_values.size();
+	}
+
+private:
+	struct ptr_hash
+	{
+		inline size_t operator()(const T* value) const
+		{
+			return interned_hash()(*value);
+		}
+	};
+
+	struct ptr_equal
+	{
+		inline bool operator()(const T* a, const T* b) const
+		{
+			return *a == *b;
+		}
+	};
+
+	struct state
+	{
+		std::unordered_map<const T*, std::weak_ptr<const T>, ptr_hash, ptr_equal> m_values;
+	};
+
+	struct deleter
+	{
+		deleter(const std::shared_ptr<state>& s): m_state(s)
+		{
+		}
+
+		void operator()(const T* value) const
+		{
+			m_state->m_values.erase(value);
+			delete value;
+		}
+
+		std::shared_ptr<state> m_state;
+	};
+
+	inline std::shared_ptr<const T> find(const T& value) const
+	{
+		auto it = m_state->m_values.find(&value);
+		return (it != m_state->m_values.end()) ? it->second.lock() : nullptr;
+	}
+
+	inline std::shared_ptr<const T> add(const T* value)
+	{
+		std::shared_ptr<const T> res(value, deleter(m_state));
+		m_state->m_values.emplace(value, res);
+		return res;
+	}
+
+	std::shared_ptr<state> m_state;
+};
@@ -46,3 +46,314 @@ void *memmem(const void *haystack, size_t haystacklen,
 	return NULL;
 }
 #endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include "memmem.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SINSP_MEMMEM_X86
+#include <immintrin.h>
+#endif
+
+static inline uint8_t to_lower(uint8_t c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+static inline uint8_t to_upper(uint8_t c)
+{
+	return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+}
+
+template<bool icase>
+static inline bool equal(const char* a, const char* b, size_t len)
+{
+	if(!icase)
+	{
+		return memcmp(a, b, len) == 0;
+	}
+
+	for(size_t j = 0; j < len; j++)
+	{
+		if(to_lower((uint8_t)a[j]) != to_lower((uint8_t)b[j]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//
+// The searches below are only called with 1 < needlelen <= haystacklen
+//
+
+template<bool icase>
+static inline bool equal_byte(uint8_t a, uint8_t b)
+{
+	return icase ? to_lower(a) == to_lower(b) : a == b;
+}
+
+// Same filter on the first and the last byte as the vector code below
+template<bool icase>
+static const char* search_scalar(const char* haystack, size_t haystacklen, const char* needle, size_t needlelen)
+{
+	const uint8_t first = (uint8_t)needle[0];
+	const uint8_t last = (uint8_t)needle[needlelen - 1];
+
+	for(size_t j = 0; j + needlelen <= haystacklen; j++)
+	{
+		if(equal_byte<icase>((uint8_t)haystack[j], first) &&
+		   equal_byte<icase>((uint8_t)haystack[j + needlelen - 1], last) &&
+		   equal<icase>(haystack + j + 1, needle + 1, needlelen - 2))
+		{
+			return haystack + j;
+		}
+	}
+
+	return NULL;
+}
+
+#ifdef SINSP_MEMMEM_X86
+
+//
+// Each block of the haystack is compared with the first byte of the needle,
+// and the block needlelen - 1 bytes further with the last one. Only the
+// positions where both match are compared with the whole needle. The bytes
+// left after the last full block are searched with the scalar code.
+//
+template<bool icase>
+static inline const char* verify(const char* p, uint32_t mask, const char* needle, size_t needlelen)
+{
+	while(mask != 0)
+	{
+		uint32_t bit = __builtin_ctz(mask);
+		if(equal<icase>(p + bit + 1, needle + 1, needlelen - 2))
+		{
+			return p + bit;
+		}
+		mask &= mask - 1;
+	}
+
+	return NULL;
+}
+
+template<bool icase>
+static inline uint32_t candidates_sse2(__m128i a, __m128i b, __m128i first_lo, __m128i first_up, __m128i last_lo, __m128i last_up)
+{
+	__m128i eq_first = _mm_cmpeq_epi8(a, first_lo);
+	__m128i eq_last = _mm_cmpeq_epi8(b, last_lo);
+	if(icase)
+	{
+		eq_first = _mm_or_si128(eq_first, _mm_cmpeq_epi8(a, first_up));
+		eq_last = _mm_or_si128(eq_last, _mm_cmpeq_epi8(b, last_up));
+	}
+
+	return (uint32_t)_mm_movemask_epi8(_mm_and_si128(eq_first, eq_last));
+}
+
+template<bool icase>
+static const char* search_sse2(const char* haystack, size_t haystacklen, const char* needle, size_t needlelen)
+{
+	const uint8_t first = (uint8_t)needle[0];
+	const uint8_t last = (uint8_t)needle[needlelen - 1];
+	const __m128i first_lo = _mm_set1_epi8((char)(icase ? to_lower(first) : first));
+	const __m128i first_up = _mm_set1_epi8((char)(icase ? to_upper(first) : first));
+	const __m128i last_lo = _mm_set1_epi8((char)(icase ? to_lower(last) : last));
+	const __m128i last_up = _mm_set1_epi8((char)(icase ? to_upper(last) : last));
+	size_t j = 0;
+
+	// Blocks of 16 bytes, then one of 8 bytes for the short haystacks
+	for(size_t step = 16; step >= 8; step /= 2)
+	{
+		for(; j + needlelen - 1 + step <= haystacklen; j += step)
+		{
+			uint32_t mask;
+			if(step == 16)
+			{
+				mask = candidates_sse2<icase>(
+					_mm_loadu_si128((const __m128i*)(haystack + j)),
+					_mm_loadu_si128((const __m128i*)(haystack + j + needlelen - 1)),
+					first_lo, first_up, last_lo, last_up);
+			}
+			else
+			{
+				mask = candidates_sse2<icase>(
+					_mm_loadl_epi64((const __m128i*)(haystack + j)),
+					_mm_loadl_epi64((const __m128i*)(haystack + j + needlelen - 1)),
+					first_lo, first_up, last_lo, last_up) & 0xff;
+			}
+
+			const char* res = verify<icase>(haystack + j, mask, needle, needlelen);
+			if(res != NULL)
+			{
+				return res;
+			}
+		}
+	}
+
+	return search_scalar<icase>(haystack + j, haystacklen - j, needle, needlelen);
+}
+
+template<bool icase>
+__attribute__((target("avx2")))
+static inline __m256i candidates_avx2(const char* p, size_t needlelen, __m256i first_lo, __m256i first_up, __m256i last_lo, __m256i last_up)
+{
+	__m256i a = _mm256_loadu_si256((const __m256i*)p);
+	__m256i b = _mm256_loadu_si256((const __m256i*)(p + needlelen - 1));
+	__m256i eq_first = _mm256_cmpeq_epi8(a, first_lo);
+	__m256i eq_last = _mm256_cmpeq_epi8(b, last_lo);
+	if(icase)
+	{
+		eq_first = _mm256_or_si256(eq_first, _mm256_cmpeq_epi8(a, first_up));
+		eq_last = _mm256_or_si256(eq_last, _mm256_cmpeq_epi8(b, last_up));
+	}
+
+	return _mm256_and_si256(eq_first, eq_last);
+}
+
+template<bool icase>
+__attribute__((target("avx2")))
+static const char* search_avx2(const char* haystack, size_t haystacklen, const char* needle, size_t needlelen)
+{
+	const uint8_t first = (uint8_t)needle[0];
+	const uint8_t last = (uint8_t)needle[needlelen - 1];
+	const __m256i first_lo = _mm256_set1_epi8((char)(icase ? to_lower(first) : first));
+	const __m256i first_up = _mm256_set1_epi8((char)(icase ? to_upper(first) : first));
+	const __m256i last_lo = _mm256_set1_epi8((char)(icase ? to_lower(last) : last));
+	const __m256i last_up = _mm256_set1_epi8((char)(icase ? to_upper(last) : last));
+	const char* res = NULL;
+	size_t j = 0;
+
+	// Two blocks at a time, since candidates are rare
+	for(; j + needlelen - 1 + 64 <= haystacklen; j += 64)
+	{
+		__m256i c0 = candidates_avx2<icase>(haystack + j, needlelen, first_lo, first_up, last_lo, last_up);
+		__m256i c1 = candidates_avx2<icase>(haystack + j + 32, needlelen, first_lo, first_up, last_lo, last_up);
+		if(_mm256_testz_si256(_mm256_or_si256(c0, c1), _mm256_or_si256(c0, c1)))
+		{
+			continue;
+		}
+
+		if((res = verify<icase>(haystack + j, (uint32_t)_mm256_movemask_epi8(c0), needle, needlelen)) != NULL ||
+		   (res = verify<icase>(haystack + j + 32, (uint32_t)_mm256_movemask_epi8(c1), needle, needlelen)) != NULL)
+		{
+			_mm256_zeroupper();
+			return res;
+		}
+	}
+
+	for(; j + needlelen - 1 + 32 <= haystacklen; j += 32)
+	{
+		__m256i c = candidates_avx2<icase>(haystack + j, needlelen, first_lo, first_up, last_lo, last_up);
+		if((res = verify<icase>(haystack + j, (uint32_t)_mm256_movemask_epi8(c), needle, needlelen)) != NULL)
+		{
+			_mm256_zeroupper();
+			return res;
+		}
+	}
+
+	// The rest fits in a SSE2 block or two. Clear the upper halves of the
+	// registers first, or mixing AVX and SSE code gets very slow.
+	_mm256_zeroupper();
+	return search_sse2<icase>(haystack + j, haystacklen - j, needle, needlelen);
+}
+
+#endif // SINSP_MEMMEM_X86
+
+typedef const char* (*search_fn)(const char*, size_t, const char*, size_t);
+
+struct search_impl
+{
+	const char* m_name;
+	search_fn m_memmem;
+	search_fn m_memimem;
+};
+
+static search_impl select_impl()
+{
+#ifdef SINSP_MEMMEM_X86
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+	{
+		return {"avx2", search_avx2<false>, search_avx2<true>};
+	}
+	return {"sse2", search_sse2<false>, search_sse2<true>};
+#else
+	return {"scalar", search_scalar<false>, search_scalar<true>};
+#endif
+}
+
+static inline const search_impl& get_impl()
+{
+	static const search_impl s_impl = select_impl();
+	return s_impl;
+}
+
+const char* sinsp_memmem(const char* haystack, size_t haystacklen, const char* needle, size_t needlelen)
+{
+	if(needlelen == 0)
+	{
+		return haystack;
+	}
+	if(needlelen > haystacklen)
+	{
+		return NULL;
+	}
+	if(needlelen == 1)
+	{
+		return (const char*)memchr(haystack, needle[0], haystacklen);
+	}
+
+#ifdef SINSP_MEMMEM_X86
+	// Too short for a single AVX2 block
+	if(haystacklen < needlelen + 31)
+	{
+		return search_sse2<false>(haystack, haystacklen, needle, needlelen);
+	}
+#endif
+
+	return get_impl().m_memmem(haystack, haystacklen, needle, needlelen);
+}
+
+const char* sinsp_memimem(const char* haystack, size_t haystacklen, const char* needle, size_t needlelen)
+{
+	if(needlelen == 0)
+	{
+		return haystack;
+	}
+	if(needlelen > haystacklen)
+	{
+		return NULL;
+	}
+	if(needlelen == 1)
+	{
+		if(to_lower((uint8_t)needle[0]) == to_upper((uint8_t)needle[0]))
+		{
+			return (const char*)memchr(haystack, needle[0], haystacklen);
+		}
+		for(size_t j = 0; j < haystacklen; j++)
+		{
+			if(to_lower((uint8_t)haystack[j]) == to_lower((uint8_t)needle[0]))
+			{
+				return haystack + j;
+			}
+		}
+		return NULL;
+	}
+
+#ifdef SINSP_MEMMEM_X86
+	if(haystacklen < needlelen + 31)
+	{
+		return search_sse2<true>(haystack, haystacklen, needle, needlelen);
+	}
+#endif
+
+	return get_impl().m_memimem(haystack, haystacklen, needle, needlelen);
+}
+
+const char* sinsp_memmem_impl()
+{
+	return get_impl().m_name;
+}
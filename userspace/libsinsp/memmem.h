@@ -0,0 +1,39 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stddef.h>
+
+//
+// Substring search in buffers of known length, used by the "icontains"
+// filter operator and by "contains" and "bcontains" on byte buffers. On
+// x86-64 the candidate positions are found 16 or 32 bytes at a time by
+// comparing the first and the last byte of the needle with SSE2 or, when
+// the CPU supports it, AVX2. The implementation is chosen at runtime on the
+// first call. Elsewhere the same filter is applied one byte at a time.
+//
+
+// Returns the first occurrence of needle in haystack, or NULL
+const char* sinsp_memmem(const char* haystack, size_t haystacklen, const char* needle, size_t needlelen);
+
+// Same as sinsp_memmem(), but ASCII letters match regardless of their case,
+// like strcasestr() does in the C locale
+const char* sinsp_memimem(const char* haystack, size_t haystacklen, const char* needle, size_t needlelen);
+
+// The name of the implementation in use: "avx2", "sse2" or "scalar"
+const char* sinsp_memmem_impl();
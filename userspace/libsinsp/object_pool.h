@@ -0,0 +1,245 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
+
+//
+// The allocations done by a pool, and the ones it saved
+//
+struct object_pool_stats
+{
+	uint64_t m_n_allocs; ///< Objects built because the pool was empty
+	uint64_t m_n_reuses; ///< Objects handed out again by the pool
+	uint64_t m_n_frees; ///< Released objects deleted because the pool was full
+	uint64_t m_n_free; ///< Objects currently in the pool
+};
+
+//
+// A pool of objects handed out as shared pointers. When the last reference
+// to an object is dropped, the object is reset and kept by the pool instead
+// of being deleted, so that the next get() returns it without allocating:
+// its strings and vectors keep their capacity. The pool keeps at most
+// max_free objects, and the control blocks of their shared pointers.
+//
+// The objects can outlive the pool, and are deleted when released after it.
+// The pool is not thread safe: the objects must be got and released on the
+// thread that owns the pool.
+//
+template<typename T>
+class object_pool
+{
+public:
+	typedef std::shared_ptr<T> ptr_t;
+
+	object_pool(size_t max_free, std::function<void(T&)> reset):
+		m_state(std::make_shared<state>(max_free, std::move(reset)))
+	{
+	}
+
+	~object_pool()
+	{
+		m_state->close();
+	}
+
+	//
+	// Returns an object from the pool, or one built by build() if the
+	// pool is empty
+	//
+	template<typename Build>
+	inline ptr_t get(const Build& build)
+	{
+		T* obj;
+		if(m_state->m_objects.empty())
+		{
+			obj = build();
+			m_state->m_stats.m_n_allocs++;
+		}
+		else
+		{
+			obj = m_state->m_objects.back();
+			m_state->m_objects.pop_back();
+			m_state->m_stats.m_n_reuses++;
+		}
+
+		return ptr_t(obj, deleter(m_state), allocator<T>(m_state));
+	}
+
+	inline object_pool_stats get_stats() const
+	{
+		object_pool_stats stats = m_state->m_stats;
+		stats.m_n_free = m_state->m_objects.size();
+		return stats;
+	}
+
+	//
+	// Deletes the objects in the pool
+	//
+	inline void clear()
+	{
+		m_state->clear();
+	}
+
+private:
+	struct state
+	{
+		state(size_t max_free, std::function<void(T&)> reset):
+			m_open(true),
+			m_max_free(max_free),
+			m_reset(std::move(reset)),
+			m_block_size(0),
+			m_stats()
+		{
+		}
+
+		~state()
+		{
+			clear();
+		}
+
+		void clear()
+		{
+			for(T* obj : m_objects)
+			{
+				delete obj;
+			}
+			m_objects.clear();
+
+			for(void* block : m_blocks)
+			{
+				::operator delete(block);
+			}
+			m_blocks.clear();
+		}
+
+		void close()
+		{
+			m_open = false;
+			clear();
+		}
+
+		bool m_open;
+		size_t m_max_free;
+		std::function<void(T&)> m_reset;
+		std::vector<T*> m_objects;
+
+		// The free control blocks, all of the same size
+		size_t m_block_size;
+		std::vector<void*> m_blocks;
+
+		object_pool_stats m_stats;
+	};
+
+	struct deleter
+	{
+		deleter(const std::shared_ptr<state>& s): m_state(s)
+		{
+		}
+
+		void operator()(T* obj) const
+		{
+			if(m_state->m_open && m_state->m_objects.size() < m_state->m_max_free)
+			{
+				m_state->m_reset(*obj);
+				m_state->m_objects.push_back(obj);
+			}
+			else
+			{
+				delete obj;
+				m_state->m_stats.m_n_frees++;
+			}
+		}
+
+		std::shared_ptr<state> m_state;
+	};
+
+	//
+	// Allocates the control blocks of the shared pointers, which have the
+	// same size for all the objects of the pool
+	//
+	template<typename U>
+	struct allocator
+	{
+		typedef U value_type;
+
+		template<typename V>
+		struct rebind
+		{
+			typedef allocator<V> other;
+		};
+
+		allocator(const std::shared_ptr<state>& s): m_state(s)
+		{
+		}
+
+		template<typename V>
+		allocator(const allocator<V>& other): m_state(other.m_state)
+		{
+		}
+
+		U* allocate(size_t n)
+		{
+			size_t size = n * sizeof(U);
+			if(m_state->m_block_size == 0)
+			{
+				m_state->m_block_size = size;
+			}
+
+			if(size == m_state->m_block_size && !m_state->m_blocks.empty())
+			{
+				void* block = m_state->m_blocks.back();
+				m_state->m_blocks.pop_back();
+				return static_cast<U*>(block);
+			}
+			return static_cast<U*>(::operator new(size));
+		}
+
+		void deallocate(U* p, size_t n)
+		{
+			if(m_state->m_open &&
+			   n * sizeof(U) == m_state->m_block_size &&
+			   m_state->m_blocks.size() < m_state->m_max_free)
+			{
+				m_state->m_blocks.push_back(p);
+				return;
+			}
+			::operator delete(p);
+		}
+
+		template<typename V>
+		bool operator==(const allocator<V>& other) const
+		{
+			return m_state == other.m_state;
+		}
+
+		template<typename V>
+		bool operator!=(const allocator<V>& other) const
+		{
+			return m_state != other.m_state;
+		}
+
+		std::shared_ptr<state> m_state;
+	};
+
+	std::shared_ptr<state> m_state;
+};
@@ -1164,7 +1164,7 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 		return;
 	}
 
-	if(ptinfo->m_comm == "<NA>" && ptinfo->m_user.uid == 0xffffffff)
+	if(ptinfo->get_comm() == "<NA>" && ptinfo->m_user.uid == 0xffffffff)
 	{
 		valid_parent = false;
 	}
@@ -1269,7 +1269,7 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 			return;
 		}
 
-		if(ptinfo->m_comm != "<NA>" && ptinfo->m_user.uid != 0xffffffff)
+		if(ptinfo->get_comm() != "<NA>" && ptinfo->m_user.uid != 0xffffffff)
 		{
 			//
 			// Parent found in proc, use its data
@@ -1295,7 +1295,7 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 			// (The session id will remain unset)
 			//
 			parinfo = evt->get_param(1);
-			tinfo->m_exe = (char*)parinfo->m_val;
+			tinfo->set_exe(parinfo->m_val);
 
 			switch(etype)
 			{
@@ -1313,7 +1313,7 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 			case PPME_SYSCALL_VFORK_20_X:
 			case PPME_SYSCALL_CLONE3_X:
 				parinfo = evt->get_param(13);
-				tinfo->m_comm = parinfo->m_val;
+				tinfo->set_comm(parinfo->m_val);
 				break;
 			default:
 				ASSERT(false);
@@ -1371,10 +1371,10 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 		//
 		// Track down that those are cloned fds
 		//
-		for(auto fdit = tinfo->m_fdtable.m_table.begin(); fdit != tinfo->m_fdtable.m_table.end(); ++fdit)
-		{
-			fdit->second.set_is_cloned();
-		}
+		tinfo->m_fdtable.loop([] (int64_t fd, sinsp_fdinfo_t& fdinfo) {
+			fdinfo.set_is_cloned();
+			return true;
+		});
 
 		//
 		// It's important to reset the cache of the child thread, to prevent it from
@@ -1414,7 +1414,7 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 
 	// Copy the command name
 	parinfo = evt->get_param(1);
-	tinfo->m_exe = (char*)parinfo->m_val;
+	tinfo->set_exe(parinfo->m_val);
 
 	switch(etype)
 	{
@@ -1432,7 +1432,7 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 	case PPME_SYSCALL_VFORK_20_X:
 	case PPME_SYSCALL_CLONE3_X:
 		parinfo = evt->get_param(13);
-		tinfo->m_comm = parinfo->m_val;
+		tinfo->set_comm(parinfo->m_val);
 		break;
 	default:
 		ASSERT(false);
@@ -1612,7 +1612,7 @@ void sinsp_parser::parse_clone_exit(sinsp_evt *evt)
 #endif
 		DBG_SINSP_INFO("tid collision for %" PRIu64 "(%s)",
 		               tinfo->m_tid,
-		               tinfo->m_comm.c_str());
+		               tinfo->m_comm->c_str());
 	}
 }
 
@@ -1682,7 +1682,7 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 
 	// Get the exe
 	parinfo = evt->get_param(1);
-	evt->m_tinfo->m_exe = parinfo->m_val;
+	evt->m_tinfo->set_exe(parinfo->m_val);
 
 	switch(etype)
 	{
@@ -1700,7 +1700,7 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 	case PPME_SYSCALL_EXECVEAT_X:
 		// Get the comm
 		parinfo = evt->get_param(13);
-		evt->m_tinfo->m_comm = parinfo->m_val;
+		evt->m_tinfo->set_comm(parinfo->m_val);
 		break;
 	default:
 		ASSERT(false);
@@ -1858,14 +1858,14 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 			parinfo = enter_evt->get_param(0);
 			if (strncmp(parinfo->m_val, "<NA>", 5) == 0)
 			{
-				evt->m_tinfo->m_exepath = "<NA>";
+				evt->m_tinfo->set_exepath("<NA>");
 			}
 			else
 			{
 				sinsp_utils::concatenate_paths(fullpath, SCAP_MAX_PATH_SIZE,
 											   evt->m_tinfo->m_cwd.c_str(), (uint32_t)evt->m_tinfo->m_cwd.size(),
 											   parinfo->m_val, (uint32_t)parinfo->m_len, m_inspector->m_is_windows);
-				evt->m_tinfo->m_exepath = fullpath;
+				evt->m_tinfo->set_exepath(fullpath);
 			}
 		}
 		break;
@@ -1886,7 +1886,7 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 			parinfo = enter_evt->get_param(1);
 			if (strncmp(parinfo->m_val, "<NA>", 5) == 0)
 			{
-				evt->m_tinfo->m_exepath = "<NA>";
+				evt->m_tinfo->set_exepath("<NA>");
 				break;
 			}
 			char *pathname = parinfo->m_val;
@@ -1917,7 +1917,7 @@ void sinsp_parser::parse_execve_exit(sinsp_evt *evt)
 										   pathname,
 										   namelen,
 										   m_inspector->m_is_windows);
-			evt->m_tinfo->m_exepath = fullpath;
+			evt->m_tinfo->set_exepath(fullpath);
 		}
 		break;
 	default:
@@ -2596,7 +2596,7 @@ inline void sinsp_parser::add_socket(sinsp_evt *evt, int64_t fd, uint32_t domain
 		                " type=" + to_string(type) +
 		                " protocol=" + to_string(protocol) +
 		                " pid=" + to_string(evt->m_tinfo->m_pid) +
-		                " comm=" + evt->m_tinfo->m_comm);
+		                " comm=" + evt->m_tinfo->get_comm());
 	}
 
 #ifndef INCLUDE_UNKNOWN_SOCKET_FDS
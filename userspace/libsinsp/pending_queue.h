@@ -0,0 +1,90 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#include "tbb/concurrent_queue.h"
+
+namespace libsinsp
+{
+
+/**
+ * A multi-producer, single-consumer queue meant to be polled on a hot path
+ * where it is almost always empty.
+ *
+ * Producers push the elements in a tbb::concurrent_queue and then bump
+ * a counter of the queued elements. The consumer only looks at the queue
+ * when a relaxed load of the counter says there is something in it, so
+ * polling an empty queue costs a read of a cache line that is only written
+ * when elements are pushed.
+ *
+ * try_pop() must be called from a single thread at a time.
+ */
+template<typename T>
+class pending_queue
+{
+public:
+	pending_queue(): m_size(0) {}
+
+	void push(const T& value)
+	{
+		m_queue.push(value);
+		m_size.fetch_add(1, std::memory_order_release);
+	}
+
+	void push(T&& value)
+	{
+		m_queue.push(std::move(value));
+		m_size.fetch_add(1, std::memory_order_release);
+	}
+
+	inline bool try_pop(T& value)
+	{
+		if(m_size.load(std::memory_order_relaxed) == 0)
+		{
+			return false;
+		}
+
+		//
+		// Pairs with the release increment in push(), making the
+		// element that has been counted visible to try_pop()
+		//
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if(!m_queue.try_pop(value))
+		{
+			return false;
+		}
+
+		m_size.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	inline bool empty() const
+	{
+		return m_size.load(std::memory_order_relaxed) == 0;
+	}
+
+private:
+	tbb::concurrent_queue<T> m_queue;
+	std::atomic<uint64_t> m_size;
+};
+
+}
@@ -28,6 +28,7 @@ sinsp_filter_check_plugin::sinsp_filter_check_plugin()
 	m_info.m_flags = filter_check_info::FL_NONE;
 	m_eplugin = nullptr;
 	m_compatible_sources = NULL;
+	m_extract_multivalued = true;
 }
 
 sinsp_filter_check_plugin::sinsp_filter_check_plugin(std::shared_ptr<sinsp_plugin> plugin)
@@ -43,12 +44,14 @@ sinsp_filter_check_plugin::sinsp_filter_check_plugin(std::shared_ptr<sinsp_plugi
 	m_info.m_nfields = m_eplugin->fields().size();
 	m_info.m_flags = filter_check_info::FL_NONE;
 	m_compatible_sources = NULL;
+	m_extract_multivalued = true;
 }
 
 sinsp_filter_check_plugin::sinsp_filter_check_plugin(const sinsp_filter_check_plugin &p)
 {
 	m_eplugin = p.m_eplugin;
 	m_compatible_sources = NULL;
+	m_extract_multivalued = true;
 	if (p.m_compatible_sources)
 	{
 		m_compatible_sources = new std::set<size_t>(*p.m_compatible_sources);
@@ -33,6 +33,7 @@ limitations under the License.
 #include "filter.h"
 #include "filterchecks.h"
 #include "cyclewriter.h"
+#include "extraction_cache.h"
 #include "protodecoder.h"
 #include "dns_manager.h"
 #include "plugin.h"
@@ -170,6 +171,8 @@ sinsp::sinsp(bool static_container, const std::string &static_id, const std::str
 
 	m_replay_scap_evt = NULL;
 
+	m_extraction_cache = std::make_shared<sinsp_extraction_cache>();
+
 	m_plugin_manager = new sinsp_plugin_manager();
 }
 
@@ -381,6 +384,14 @@ void sinsp::init()
 	m_firstevent_ts = 0;
 	m_fds_to_remove->clear();
 
+	//
+	// The event numbers start over
+	//
+	if(m_extraction_cache)
+	{
+		m_extraction_cache->clear();
+	}
+
 	//
 	// Return the tracers to the pool and clear the tracers list
 	//
@@ -2011,6 +2022,18 @@ void sinsp::set_large_envs(bool enable)
 	m_large_envs_enabled = enable;
 }
 
+void sinsp::set_shared_extraction(bool enable)
+{
+	if(!enable)
+	{
+		m_extraction_cache.reset();
+	}
+	else if(!m_extraction_cache)
+	{
+		m_extraction_cache = std::make_shared<sinsp_extraction_cache>();
+	}
+}
+
 void sinsp::set_debug_mode(bool enable_debug)
 {
 	m_isdebug_enabled = enable_debug;
@@ -2630,72 +2653,96 @@ void sinsp::set_thread_timeout_s(uint32_t val)
 bool sinsp_thread_manager::remove_inactive_threads()
 {
 	bool res = false;
+	uint64_t now = m_inspector->m_lastevent_ts;
 
-	if(m_last_flush_time_ns == 0)
+	if(m_inactive_wheel_ts == 0)
 	{
 		//
-		// Set the first table scan for 30 seconds in, so that we can spot bugs in the logic without having
-		// to wait for tens of minutes
+		// Start processing the wheel 30 seconds in, like the first table
+		// scan used to, so that the threads imported before the capture
+		// aren't removed at its first event
 		//
-		if(m_inspector->m_inactive_thread_scan_time_ns > 30 * ONE_SECOND_IN_NS)
-		{
-			m_last_flush_time_ns =
-				(m_inspector->m_lastevent_ts - m_inspector->m_inactive_thread_scan_time_ns + 30 * ONE_SECOND_IN_NS);
-		}
-		else
-		{
-			m_last_flush_time_ns =
-				(m_inspector->m_lastevent_ts - m_inspector->m_inactive_thread_scan_time_ns);
-		}
+		m_inactive_wheel_ts = now - now % ONE_SECOND_IN_NS +
+			std::min<uint64_t>(m_inspector->m_inactive_thread_scan_time_ns, 30 * ONE_SECOND_IN_NS);
 	}
 
-	if(m_inspector->m_lastevent_ts >
-		m_last_flush_time_ns + m_inspector->m_inactive_thread_scan_time_ns)
+	for(uint32_t j = 0; j < m_max_inactive_thread_checks; j++)
 	{
-		std::vector<std::pair<uint64_t, bool>> to_delete;
+		if(m_inactive_expired.empty())
+		{
+			//
+			// Move to the next slot once it's over
+			//
+			if(now < m_inactive_wheel_ts + ONE_SECOND_IN_NS)
+			{
+				break;
+			}
 
-		res = true;
+			//
+			// At the first event, or after a gap longer than the wheel,
+			// all the slots are due: visit each of them once
+			//
+			if(now - m_inactive_wheel_ts > s_inactive_wheel_size * ONE_SECOND_IN_NS)
+			{
+				m_inactive_wheel_ts = now - now % ONE_SECOND_IN_NS - (s_inactive_wheel_size - 1) * ONE_SECOND_IN_NS;
+			}
 
-		m_last_flush_time_ns = m_inspector->m_lastevent_ts;
+			m_inactive_expired.swap(m_inactive_wheel[(m_inactive_wheel_ts / ONE_SECOND_IN_NS) % s_inactive_wheel_size]);
+			m_inactive_wheel_ts += ONE_SECOND_IN_NS;
+			continue;
+		}
 
-		g_logger.format(sinsp_logger::SEV_INFO, "Flushing thread table");
+		inactive_check check = m_inactive_expired.back();
+		m_inactive_expired.pop_back();
 
 		//
-		// Go through the table and remove dead entries.
+		// Skip the threads removed or rescheduled since, and put back
+		// the ones of a later turn of the wheel
 		//
-		m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
-			bool closed = (tinfo.m_flags & PPM_CL_CLOSED) != 0;
+		sinsp_threadinfo* tinfo = m_threadtable.get(check.m_tid);
+		if(tinfo == nullptr || tinfo->m_inactive_check_ts != check.m_ts)
+		{
+			continue;
+		}
 
-			if(closed ||
-				((m_inspector->m_lastevent_ts > tinfo.m_lastaccess_ts + m_inspector->m_thread_timeout_ns) &&
-					!scap_is_thread_alive(m_inspector->m_h, tinfo.m_pid, tinfo.m_tid, tinfo.m_comm.c_str()))
-					)
-			{
-				//
-				// Reset the cache
-				//
-				m_last_tid = 0;
-				m_last_tinfo.reset();
+		if(check.m_ts > now)
+		{
+			schedule_inactive_check(tinfo, check.m_ts);
+			continue;
+		}
 
-#ifdef GATHER_INTERNAL_STATS
-				m_removed_threads->increment();
-#endif
-				to_delete.emplace_back(tinfo.m_tid, closed);
-			}
-			return true;
-		});
+		bool closed = (tinfo->m_flags & PPM_CL_CLOSED) != 0;
 
-		if (!to_delete.empty()) {
-            for (auto &it : to_delete) {
-                remove_thread(it.first, it.second);
-            }
+		if(closed ||
+			((now > tinfo->m_lastaccess_ts + m_inspector->m_thread_timeout_ns) &&
+				!scap_is_thread_alive(m_inspector->m_h, tinfo->m_pid, tinfo->m_tid, tinfo->m_comm->c_str()))
+				)
+		{
+			//
+			// Reset the cache
+			//
+			m_last_tid = 0;
+			m_last_tinfo.reset();
+
+			res = true;
+			remove_thread(check.m_tid, closed);
+
+			//
+			// A thread that exited stays in the table while it has
+			// children. Mark it closed, so that it is removed with the
+			// last one or at its next check if the count of its children
+			// is off.
+			//
+			tinfo = m_threadtable.get(check.m_tid);
+			if(tinfo == nullptr)
+			{
+				continue;
+			}
+			tinfo->m_flags |= PPM_CL_CLOSED;
+		}
 
-            //
-            // Rebalance the thread table dependency tree, so we free up threads that
-            // exited but that are stuck because of reference counting.
-            //
-            recreate_child_dependencies();
-        }
+		schedule_inactive_check(tinfo, std::max(tinfo->m_lastaccess_ts + m_inspector->m_thread_timeout_ns,
+							now + m_inspector->m_inactive_thread_scan_time_ns));
 	}
 
 	return res;
@@ -2757,5 +2804,5 @@ std::shared_ptr<std::string> sinsp::lookup_cgroup_dir(const string& subsys)
 std::shared_ptr<sinsp_threadinfo>
 libsinsp::event_processor::build_threadinfo(sinsp* inspector)
 {
-	return std::make_shared<sinsp_threadinfo>(inspector);
+	return inspector->m_thread_manager->new_threadinfo();
 }
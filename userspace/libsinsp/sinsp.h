@@ -47,7 +47,7 @@ limitations under the License.
 #ifdef _WIN32
 #pragma warning(disable: 4251 4200 4221 4190)
 #else
-#include "tbb/concurrent_queue.h"
+#include "pending_queue.h"
 #endif
 
 #include "sinsp_inet.h"
@@ -113,6 +113,7 @@ class sinsp_partial_tracer;
 class mesos;
 class sinsp_plugin;
 class sinsp_plugin_manager;
+class sinsp_extraction_cache;
 
 #if defined(HAS_CAPTURE) && !defined(_WIN32)
 class sinsp_ssl;
@@ -406,14 +407,15 @@ public:
 	void disable_automatic_threadtable_purging();
 
 	/*!
-	 * \brief sets the interval at which the thread purge code runs. This does
-	 *        not run every event as it's mildly expensive if there are lots of threads
+	 * \brief sets the interval at which the thread purge code checks again
+	 *        the threads that timed out but are still alive. The checks are
+	 *        spread over the events, a few per event.
 	 */
 	void set_thread_purge_interval_s(uint32_t val);
 
 	/*!
 	 * \brief sets the amount of time after which a thread which has seen no events
-	 *        can be purged. As the purging happens only every m_thread_purge_interval_s,
+	 *        can be purged. As a thread is checked at most every m_thread_purge_interval_s,
 	 *        the max time a thread may linger is actually m_thread_purge_interval +
 	 *        m_thread_timeout_s
 	 */
@@ -513,7 +515,7 @@ public:
 	std::shared_ptr<sinsp_threadinfo> build_threadinfo()
     {
         return m_external_event_processor ? m_external_event_processor->build_threadinfo(this)
-                                          : std::make_shared<sinsp_threadinfo>(this);
+                                          : m_thread_manager->new_threadinfo();
     }
 
 	/*!
@@ -668,6 +670,25 @@ public:
 	*/
 	void set_large_envs(bool enable);
 
+	/*!
+	  \brief Enable/disable the sharing of the extracted field values
+
+	  \param enable when it is true, the filterchecks of the filters and
+	  the formatters created afterwards extract each field once per event
+	  and share the values with the ones extracting the same field
+	  (enabled by default)
+	*/
+	void set_shared_extraction(bool enable);
+
+	/*!
+	  \brief Returns the cache of the shared field values, with its
+	  hit counts, or NULL if sharing is disabled
+	*/
+	inline const std::shared_ptr<sinsp_extraction_cache>& get_extraction_cache() const
+	{
+		return m_extraction_cache;
+	}
+
 	/*!
 	  \brief Set the debugging mode of the inspector.
 
@@ -1259,8 +1280,10 @@ public:
 	// 	information, read from sinsp::next().
 	// *	user added/removed events
 	// * 	group added/removed events
+	// It's polled for every event, but checking it while it's
+	// empty only costs a relaxed load.
 #ifndef _WIN32
-	tbb::concurrent_queue<shared_ptr<sinsp_evt>> m_pending_state_evts;
+	libsinsp::pending_queue<shared_ptr<sinsp_evt>> m_pending_state_evts;
 #endif
 
 	// Holds an event dequeued from the above queue
@@ -1308,6 +1331,12 @@ public:
 	// information of the replayed scap event.
 	uint16_t m_replay_scap_cpuid;
 
+	//
+	// The field values extracted from the current event, shared by the
+	// filterchecks. The filterchecks keep a reference to it.
+	//
+	std::shared_ptr<sinsp_extraction_cache> m_extraction_cache;
+
 	bool m_inited;
 	static std::atomic<int> instance_count;
 
@@ -1338,6 +1367,7 @@ public:
 	friend class sinsp_network_interfaces;
 	friend class test_helper;
 	friend class sinsp_usergroup_manager;
+	friend class sinsp_filter_workers;
 
 	template<class TKey,class THash,class TCompare> friend class sinsp_connection_manager;
 };
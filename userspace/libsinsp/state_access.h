@@ -0,0 +1,27 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#pragma once
+
+//
+// True on the threads that read the thread and fd tables while the thread
+// that parses the events waits, e.g. in sinsp_filter_workers::run(). Their
+// lookups don't update the caches of the tables, nor the threads and fds
+// they find, and don't add the threads they don't find, so that several
+// threads can read the tables at once.
+//
+extern thread_local bool g_state_read_only;
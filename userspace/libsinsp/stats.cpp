@@ -35,6 +35,10 @@ void sinsp_stats::clear()
 	m_n_fds = 0;
 	m_n_added_fds = 0;
 	m_n_removed_fds = 0;
+	m_n_threadinfo_allocs = 0;
+	m_n_threadinfo_reuses = 0;
+	m_n_fdinfo_allocs = 0;
+	m_n_fdinfo_reuses = 0;
 	m_n_stored_evts = 0;
 	m_n_store_drops = 0;
 	m_n_retrieved_evts = 0;
@@ -58,6 +62,8 @@ void sinsp_stats::emit(FILE* f)
 	fprintf(f, "n. fds: %" PRIu64 "\n", m_n_fds);
 	fprintf(f, "added fds: %" PRIu64 "\n", m_n_added_fds);
 	fprintf(f, "removed fds: %" PRIu64 "\n", m_n_removed_fds);
+	fprintf(f, "threadinfos: %" PRIu64 " allocated, %" PRIu64 " reused\n", m_n_threadinfo_allocs, m_n_threadinfo_reuses);
+	fprintf(f, "fdinfos: %" PRIu64 " allocated, %" PRIu64 " reused\n", m_n_fdinfo_allocs, m_n_fdinfo_reuses);
 	fprintf(f, "stored evts: %" PRIu64 "\n", m_n_stored_evts);
 	fprintf(f, "store drops: %" PRIu64 "\n", m_n_store_drops);
 	fprintf(f, "retrieved evts: %" PRIu64 "\n", m_n_retrieved_evts);
@@ -47,6 +47,10 @@ public:
 	uint64_t m_n_fds;
 	uint64_t m_n_added_fds;
 	uint64_t m_n_removed_fds;
+	uint64_t m_n_threadinfo_allocs;
+	uint64_t m_n_threadinfo_reuses;
+	uint64_t m_n_fdinfo_allocs;
+	uint64_t m_n_fdinfo_reuses;
 	uint64_t m_n_stored_evts;
 	uint64_t m_n_store_drops;
 	uint64_t m_n_retrieved_evts;
@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string.h>
+#include <aho_corasick.h>
+#include <gtest/gtest.h>
+
+static aho_corasick make(std::vector<std::string> patterns, bool case_insensitive = false)
+{
+	aho_corasick ac;
+	ac.set_case_insensitive(case_insensitive);
+	for(auto& p : patterns)
+	{
+		ac.add_pattern(p.c_str(), p.size());
+	}
+	return ac;
+}
+
+TEST(aho_corasick, contains)
+{
+	auto ac = make({"he", "she", "his", "hers"});
+
+	EXPECT_EQ(ac.size(), 4);
+	EXPECT_TRUE(ac.contains("ushers"));
+	EXPECT_TRUE(ac.contains("ahishers"));
+	EXPECT_TRUE(ac.contains("he"));
+	EXPECT_TRUE(ac.contains("xxhisxx"));
+	EXPECT_FALSE(ac.contains("hi"));
+	EXPECT_FALSE(ac.contains("HE"));
+	EXPECT_FALSE(ac.contains(""));
+
+	// a pattern found only through the failure links
+	auto ac2 = make({"abcd", "bc"});
+	EXPECT_TRUE(ac2.contains("abce"));
+	EXPECT_FALSE(ac2.contains("abd"));
+
+	EXPECT_TRUE(make({""}).contains(""));
+	EXPECT_FALSE(make({}).contains("abc"));
+}
+
+TEST(aho_corasick, icontains)
+{
+	auto ac = make({"Bash", "zSH"}, true);
+
+	EXPECT_TRUE(ac.contains("/bin/BASH"));
+	EXPECT_TRUE(ac.contains("/usr/bin/zsh"));
+	EXPECT_FALSE(ac.contains("/bin/sh"));
+}
+
+TEST(aho_corasick, startswith)
+{
+	auto ac = make({"/etc/", "/usr/lib", "/usr/"});
+
+	EXPECT_TRUE(ac.startswith("/etc/passwd"));
+	EXPECT_TRUE(ac.startswith("/usr/bin/ls"));
+	EXPECT_TRUE(ac.startswith("/usr/lib64"));
+	EXPECT_TRUE(ac.startswith("/etc/"));
+	EXPECT_FALSE(ac.startswith("/etc"));
+	EXPECT_FALSE(ac.startswith("/var/etc/"));
+	EXPECT_FALSE(ac.startswith("//etc/"));
+	EXPECT_TRUE(make({""}).startswith("abc"));
+}
+
+TEST(aho_corasick, endswith)
+{
+	auto ac = make({".so", ".so.1", "bash"});
+
+	EXPECT_TRUE(ac.endswith("/lib/libc.so"));
+	EXPECT_TRUE(ac.endswith("/lib/libz.so.1"));
+	EXPECT_TRUE(ac.endswith("/bin/bash"));
+	EXPECT_FALSE(ac.endswith("/lib/libz.so.2"));
+	EXPECT_FALSE(ac.endswith("/bin/bashrc"));
+	EXPECT_FALSE(ac.endswith("so"));
+}
+
+TEST(aho_corasick, same_as_libc)
+{
+	std::vector<std::string> patterns = {"ab", "bab", "aab", "bba", "b", "abab"};
+	auto ac = make(patterns);
+
+	// all the strings of up to 6 "a" or "b"
+	for(uint32_t len = 0; len <= 6; len++)
+	{
+		for(uint32_t bits = 0; bits < (1u << len); bits++)
+		{
+			std::string s;
+			for(uint32_t j = 0; j < len; j++)
+			{
+				s += (bits & (1u << j)) ? 'b' : 'a';
+			}
+
+			bool contains = false;
+			bool startswith = false;
+			bool endswith = false;
+			for(auto& p : patterns)
+			{
+				contains |= strstr(s.c_str(), p.c_str()) != NULL;
+				startswith |= s.compare(0, p.size(), p) == 0;
+				endswith |= s.size() >= p.size() && s.compare(s.size() - p.size(), p.size(), p) == 0;
+			}
+
+			EXPECT_EQ(ac.contains(s.c_str()), contains) << s;
+			EXPECT_EQ(ac.startswith(s.c_str()), startswith) << s;
+			EXPECT_EQ(ac.endswith(s.c_str()), endswith) << s;
+		}
+	}
+}
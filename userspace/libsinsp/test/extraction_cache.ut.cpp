@@ -0,0 +1,147 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "sinsp_with_test_input.h"
+#include "eventformatter.h"
+#include "extraction_cache.h"
+
+class extraction_cache : public sinsp_with_test_input
+{
+protected:
+	// opens and closes nfiles files, each with its own name
+	void add_open_close_events(uint32_t nfiles)
+	{
+		for(uint32_t j = 0; j < nfiles; j++)
+		{
+			std::string name = "/tmp/file_" + std::to_string(j);
+
+			add_event(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, name.c_str(), PPM_O_RDWR, 0);
+			add_event(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (int64_t)3, name.c_str(), PPM_O_RDWR, 0, 5, 123);
+			add_event(increasing_ts(), 1, PPME_SYSCALL_CLOSE_E, 1, (int64_t)3);
+			add_event(increasing_ts(), 1, PPME_SYSCALL_CLOSE_X, 1, 0);
+		}
+	}
+
+	sinsp_filter* compile(const std::string& str)
+	{
+		sinsp_filter_compiler compiler(&m_inspector, str);
+		return compiler.compile();
+	}
+
+	// runs the filters on the open events, checking their results
+	void check_filters(uint32_t nfiles)
+	{
+		std::unique_ptr<sinsp_filter> first(compile("evt.type = open and fd.name = /tmp/file_0"));
+		std::unique_ptr<sinsp_filter> tmp(compile("evt.type = open and fd.name startswith /tmp/"));
+		std::unique_ptr<sinsp_filter> odd(compile("evt.type = open and fd.name pmatch (/tmp/file_1, /tmp/file_3)"));
+		uint32_t nopens = 0;
+		sinsp_evt* evt;
+
+		while((evt = next_event()) != nullptr)
+		{
+			bool is_open = evt->get_type() == PPME_SYSCALL_OPEN_X;
+			EXPECT_EQ(first->run(evt), is_open && nopens == 0);
+			EXPECT_EQ(tmp->run(evt), is_open);
+			EXPECT_EQ(odd->run(evt), is_open && (nopens == 1 || nopens == 3));
+			nopens += is_open ? 1 : 0;
+		}
+
+		EXPECT_EQ(nopens, nfiles);
+	}
+};
+
+TEST_F(extraction_cache, shared_by_filters)
+{
+	const uint32_t nfiles = 10;
+
+	add_default_init_thread();
+	add_open_close_events(nfiles);
+	open_inspector();
+
+	auto& cache = m_inspector.get_extraction_cache();
+	ASSERT_NE(cache, nullptr);
+
+	check_filters(nfiles);
+
+	// evt.type and fd.name
+	EXPECT_EQ(cache->size(), 2);
+
+	// fd.name is extracted once per open event, then found in the cache
+	const check_cache_metrics& metrics = cache->get_metrics();
+	EXPECT_GT(metrics.m_num_extract_cache, 2 * nfiles);
+	EXPECT_LT(metrics.m_num_extract_cache, metrics.m_num_extract);
+}
+
+TEST_F(extraction_cache, disabled)
+{
+	const uint32_t nfiles = 10;
+
+	add_default_init_thread();
+	add_open_close_events(nfiles);
+	m_inspector.set_shared_extraction(false);
+	open_inspector();
+
+	ASSERT_EQ(m_inspector.get_extraction_cache(), nullptr);
+
+	check_filters(nfiles);
+}
+
+TEST_F(extraction_cache, stateful_fields)
+{
+	// The thread state of these fields is reserved before the capture starts
+	std::unique_ptr<sinsp_filter> f(compile("evt.deltatime exists or thread.cpu exists or thread.exectime exists or evt.latency exists"));
+	EXPECT_EQ(m_inspector.get_extraction_cache()->size(), 0);
+}
+
+TEST_F(extraction_cache, deleted_filtercheck)
+{
+	const uint32_t nfiles = 4;
+
+	add_default_init_thread();
+	add_open_close_events(nfiles);
+	open_inspector();
+
+	std::unique_ptr<sinsp_filter> other(compile("fd.name = /tmp/file_2"));
+	sinsp_evt_formatter formatter(&m_inspector, "%fd.name");
+	uint32_t nopens = 0;
+	sinsp_evt* evt;
+
+	while((evt = next_event()) != nullptr)
+	{
+		if(evt->get_type() != PPME_SYSCALL_OPEN_X)
+		{
+			continue;
+		}
+
+		// The values extracted by a filter are forgotten when it's deleted
+		{
+			std::unique_ptr<sinsp_filter> f(compile("fd.name = /tmp/file_1"));
+			EXPECT_EQ(f->run(evt), nopens == 1);
+		}
+
+		std::string name = "/tmp/file_" + std::to_string(nopens);
+		std::string output;
+		EXPECT_EQ(other->run(evt), nopens == 2);
+		EXPECT_TRUE(formatter.tostring(evt, &output));
+		EXPECT_EQ(output, name);
+		nopens++;
+	}
+
+	EXPECT_EQ(nopens, nfiles);
+}
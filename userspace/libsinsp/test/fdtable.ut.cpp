@@ -0,0 +1,147 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <map>
+#include <random>
+
+#include <sinsp.h>
+#include <gtest/gtest.h>
+
+static std::map<int64_t, std::string> to_map(sinsp_fdtable& table)
+{
+	std::map<int64_t, std::string> res;
+	table.loop([&](int64_t fd, sinsp_fdinfo_t& fdinfo) {
+		EXPECT_TRUE(res.emplace(fd, fdinfo.m_name).second);
+		return true;
+	});
+	return res;
+}
+
+TEST(fdtable, add_find_erase)
+{
+	sinsp inspector;
+	sinsp_fdtable table(&inspector);
+	sinsp_fdinfo_t fdinfo;
+
+	EXPECT_EQ(table.find(0), nullptr);
+	EXPECT_EQ(table.find(-1), nullptr);
+	EXPECT_EQ(table.find(100000), nullptr);
+
+	fdinfo.m_name = "a";
+	sinsp_fdinfo_t* a = table.add(3, &fdinfo);
+	fdinfo.m_name = "b";
+	sinsp_fdinfo_t* b = table.add(100000, &fdinfo);
+	fdinfo.m_name = "c";
+	table.add(-5, &fdinfo);
+	EXPECT_EQ(table.size(), 3);
+	EXPECT_EQ(table.find(3), a);
+	EXPECT_EQ(table.find(100000), b);
+	EXPECT_EQ(table.find(-5)->m_name, "c");
+
+	// The fdinfos don't move when other fds are added
+	for(int64_t fd = 4; fd < 2000; fd++)
+	{
+		table.add(fd, &fdinfo);
+	}
+	EXPECT_EQ(table.find(3), a);
+	EXPECT_EQ(a->m_name, "a");
+	EXPECT_EQ(table.size(), 1999);
+
+	// Adding an fd that exists replaces it
+	fdinfo.m_name = "d";
+	EXPECT_EQ(table.add(3, &fdinfo), a);
+	EXPECT_EQ(a->m_name, "d");
+	EXPECT_EQ(table.size(), 1999);
+
+	table.erase(3);
+	table.erase(100000);
+	EXPECT_EQ(table.find(3), nullptr);
+	EXPECT_EQ(table.find(100000), nullptr);
+	EXPECT_EQ(table.size(), 1997);
+
+	table.clear();
+	EXPECT_EQ(table.size(), 0);
+	EXPECT_TRUE(to_map(table).empty());
+}
+
+TEST(fdtable, same_as_map)
+{
+	std::mt19937 rng(42);
+	sinsp inspector;
+	sinsp_fdtable table(&inspector);
+	std::map<int64_t, std::string> ref;
+	sinsp_fdinfo_t fdinfo;
+
+	// Mostly low fds, as the kernel allocates them, and some large ones
+	for(uint32_t j = 0; j < 100000; j++)
+	{
+		int64_t fd = (rng() % 4) ? (int64_t)(rng() % 100) : (int64_t)(rng() % 5000) - 10;
+		switch(rng() % 4)
+		{
+		case 0:
+		case 1:
+			fdinfo.m_name = std::to_string(j);
+			table.add(fd, &fdinfo);
+			ref[fd] = fdinfo.m_name;
+			break;
+		case 2:
+			if(ref.erase(fd) != 0)
+			{
+				table.erase(fd);
+			}
+			break;
+		default:
+		{
+			auto it = ref.find(fd);
+			sinsp_fdinfo_t* res = table.find(fd);
+			if(it == ref.end())
+			{
+				ASSERT_EQ(res, nullptr);
+			}
+			else
+			{
+				ASSERT_NE(res, nullptr);
+				ASSERT_EQ(res->m_name, it->second);
+			}
+			break;
+		}
+		}
+		ASSERT_EQ(table.size(), ref.size());
+	}
+
+	EXPECT_EQ(to_map(table), ref);
+
+	// The copies have the same fds, in their own fdinfos
+	sinsp_fdtable copy(table);
+	EXPECT_EQ(to_map(copy), ref);
+	EXPECT_EQ(copy.size(), ref.size());
+	EXPECT_NE(copy.find(ref.begin()->first), table.find(ref.begin()->first));
+
+	sinsp_fdtable other(&inspector);
+	fdinfo.m_name = "x";
+	other.add(1, &fdinfo);
+	other.add(100000, &fdinfo);
+	other = table;
+	EXPECT_EQ(to_map(other), ref);
+
+	// The loop stops when the callback returns false
+	size_t n = 0;
+	EXPECT_FALSE(table.loop([&](int64_t fd, sinsp_fdinfo_t& fdinfo) {
+		return ++n < 3;
+	}));
+	EXPECT_EQ(n, 3);
+}
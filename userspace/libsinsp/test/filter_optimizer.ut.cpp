@@ -0,0 +1,279 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <sinsp.h>
+#include <filter_optimizer.h>
+#include <gtest/gtest.h>
+
+#include "sinsp_with_test_input.h"
+
+using namespace libsinsp::filter;
+
+//
+// Adds a list field, like the ones of the plugins, to the sinsp fields
+//
+class list_field_factory : public sinsp_filter_factory
+{
+public:
+	list_field_factory(): sinsp_filter_factory(NULL)
+	{
+	}
+
+	std::list<gen_event_filter_factory::filter_fieldclass_info> get_fields() override
+	{
+		auto ret = sinsp_filter_factory::get_fields();
+		gen_event_filter_factory::filter_fieldclass_info cinfo;
+		cinfo.name = "test";
+		gen_event_filter_factory::filter_field_info info;
+		info.name = "test.list";
+		info.data_type = "CHARBUF";
+		info.tags.insert("EPF_IS_LIST");
+		cinfo.fields.push_back(info);
+		ret.push_back(cinfo);
+		return ret;
+	}
+};
+
+static std::string optimize(const std::string& in, sinsp_filter_optimizer::stats* stats = NULL)
+{
+	list_field_factory factory;
+	sinsp_filter_optimizer optimizer(&factory);
+	parser p(in);
+	auto e = p.parse();
+	optimizer.optimize(e);
+	if(stats != NULL)
+	{
+		*stats = optimizer.get_stats();
+	}
+	return ast::as_string(*e.get());
+}
+
+static bool filter_run(sinsp_evt* evt, const std::string& filter_str, bool optimize)
+{
+	std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(NULL));
+	sinsp_filter_compiler compiler(factory, filter_str);
+	compiler.set_optimize(optimize);
+	std::unique_ptr<sinsp_filter> filter(compiler.compile());
+	return filter->run(evt);
+}
+
+TEST(sinsp_filter_optimizer, flatten)
+{
+	sinsp_filter_optimizer::stats stats;
+
+	EXPECT_EQ(optimize("(proc.name = a and proc.pid = 1) and (proc.exe = b and proc.ppid = 2)", &stats),
+		"(proc.pid = 1 and proc.ppid = 2 and proc.name = a and proc.exe = b)");
+	EXPECT_EQ(stats.m_flattened, 2);
+
+	EXPECT_EQ(optimize("proc.name = a or (proc.name contains b or (proc.exe = c))"),
+		"(proc.name = a or proc.exe = c or proc.name contains b)");
+	EXPECT_EQ(optimize("not not proc.name = a"), "proc.name = a");
+	EXPECT_EQ(optimize("not not not proc.name = a"), "not proc.name = a");
+	EXPECT_EQ(optimize("(proc.name = a)"), "proc.name = a");
+
+	// different operators are never mixed
+	EXPECT_EQ(optimize("proc.name = a and (proc.name = b or proc.exe = c)"),
+		"(proc.name = a and (proc.name = b or proc.exe = c))");
+}
+
+TEST(sinsp_filter_optimizer, merge_in)
+{
+	sinsp_filter_optimizer::stats stats;
+
+	EXPECT_EQ(optimize("proc.name = a or proc.name = b or proc.name in (c, a)", &stats),
+		"proc.name in (a, b, c)");
+	EXPECT_EQ(stats.m_merged, 2);
+
+	EXPECT_EQ(optimize("evt.type = open or proc.name = a or evt.type = openat"),
+		"(evt.type in (open, openat) or proc.name = a)");
+	EXPECT_EQ(optimize("proc.aname[2] = a or proc.aname[3] = b or proc.aname[2] = c"),
+		"(proc.aname[2] in (a, c) or proc.aname[3] = b)");
+
+	// "in" is not always the same as "=" for non-string fields
+	EXPECT_EQ(optimize("proc.pid = 1 or proc.pid = 2"), "(proc.pid = 1 or proc.pid = 2)");
+	EXPECT_EQ(optimize("fd.ip = 10.0.0.1 or fd.ip = 10.0.0.2"), "(fd.ip = 10.0.0.1 or fd.ip = 10.0.0.2)");
+
+	// "in" on a list field checks all its values, and "=" is an error
+	EXPECT_EQ(optimize("test.list = a or test.list = b"), "(test.list = a or test.list = b)");
+	EXPECT_EQ(optimize("test.list in (a) or test.list in (b)"), "(test.list in (a) or test.list in (b))");
+	EXPECT_EQ(optimize("test.list contains a or test.list contains b"),
+		"(test.list contains a or test.list contains b)");
+
+	// and, or other operators
+	EXPECT_EQ(optimize("proc.name = a and proc.name = b"), "(proc.name = a and proc.name = b)");
+	EXPECT_EQ(optimize("proc.name = a or proc.name != b"), "(proc.name = a or proc.name != b)");
+}
+
+TEST(sinsp_filter_optimizer, merge_strings)
+{
+	sinsp_filter_optimizer::stats stats;
+
+	EXPECT_EQ(optimize("proc.cmdline contains a or proc.cmdline contains b or proc.cmdline contains a", &stats),
+		"proc.cmdline contains (a, b)");
+	EXPECT_EQ(stats.m_merged, 2);
+
+	EXPECT_EQ(optimize("fd.name startswith /etc or fd.name startswith /usr or fd.name endswith .so"),
+		"(fd.name startswith (/etc, /usr) or fd.name endswith .so)");
+	EXPECT_EQ(optimize("proc.name icontains a or proc.name contains b or proc.name icontains c"),
+		"(proc.name icontains (a, c) or proc.name contains b)");
+	EXPECT_EQ(optimize("proc.name = a or proc.name contains b or proc.name = c"),
+		"(proc.name in (a, c) or proc.name contains b)");
+
+	// and, or non-string fields
+	EXPECT_EQ(optimize("proc.name contains a and proc.name contains b"),
+		"(proc.name contains a and proc.name contains b)");
+	EXPECT_EQ(optimize("evt.buffer contains a or evt.buffer contains b"),
+		"(evt.buffer contains a or evt.buffer contains b)");
+}
+
+TEST(sinsp_filter_optimizer, deduplicate)
+{
+	sinsp_filter_optimizer::stats stats;
+
+	EXPECT_EQ(optimize("proc.pid = 1 and proc.pid = 1", &stats), "proc.pid = 1");
+	EXPECT_EQ(stats.m_deduplicated, 1);
+
+	EXPECT_EQ(optimize("(proc.pid = 1 or fd.num = 2) and (proc.pid = 1 or fd.num = 2) and proc.name = a"),
+		"(proc.name = a and (proc.pid = 1 or fd.num = 2))");
+}
+
+TEST(sinsp_filter_optimizer, reorder)
+{
+	sinsp_filter_optimizer::stats stats;
+
+	EXPECT_EQ(optimize("proc.aname = bash and fd.name startswith /etc and evt.type = open", &stats),
+		"(evt.type = open and fd.name startswith /etc and proc.aname = bash)");
+	EXPECT_EQ(stats.m_reordered, 1);
+
+	EXPECT_EQ(optimize("container.id != host and (k8s.ns.name = a or evt.dir = <)"),
+		"(container.id != host and (evt.dir = < or k8s.ns.name = a))");
+
+	// checks of the same cost keep their order
+	EXPECT_EQ(optimize("proc.name = b and proc.name = a", &stats), "(proc.name = b and proc.name = a)");
+	EXPECT_EQ(stats.m_reordered, 0);
+}
+
+TEST(sinsp_filter_optimizer, cost)
+{
+	sinsp_filter_factory factory(NULL);
+	sinsp_filter_optimizer optimizer(&factory);
+
+	auto cost = [&optimizer](const std::string& in)
+	{
+		parser p(in);
+		return optimizer.cost(p.parse().get());
+	};
+
+	EXPECT_EQ(cost("evt.type = open"), 1);
+	EXPECT_LT(cost("proc.pid = 1"), cost("proc.name = a"));
+	EXPECT_LT(cost("proc.name = a"), cost("fd.name = /etc"));
+	EXPECT_LT(cost("fd.name = /etc"), cost("fd.name glob /etc/*"));
+	EXPECT_LT(cost("proc.aname[1] = a"), cost("proc.aname = a"));
+	EXPECT_LT(cost("fd.name = /etc"), cost("container.name = a"));
+	EXPECT_LT(cost("container.name = a"), cost("k8s.pod.name = a"));
+	EXPECT_EQ(cost("evt.type = open and proc.pid = 1"), cost("evt.type = open") + cost("proc.pid = 1"));
+	EXPECT_EQ(cost("not proc.aname = a"), cost("proc.aname = a"));
+}
+
+TEST(sinsp_filter_optimizer, same_results)
+{
+	char scap_evt_err[2048];
+	uint8_t read_buf[] = {'h', 'e', 'l', 'l', 'o'};
+	uint8_t scap_evt_buf[2048];
+	size_t evt_size;
+	scap_sized_buffer scap_evt;
+	scap_evt.buf = (void*) &scap_evt_buf[0];
+	scap_evt.size = (size_t) sizeof(scap_evt_buf);
+	ASSERT_EQ(scap_event_encode_params(
+		scap_evt, &evt_size, scap_evt_err, PPME_SYSCALL_READ_X, 3, 0,
+		scap_const_sized_buffer{&read_buf[0],sizeof(read_buf)}), SCAP_SUCCESS);
+	sinsp_evt evt;
+	evt.init((uint8_t*) scap_evt.buf, 0);
+
+	const char* filters[] = {
+		"evt.type = read",
+		"evt.type = open or evt.type = read",
+		"evt.type = open or evt.type = close",
+		"evt.type = open or evt.type in (close, read)",
+		"not (evt.type = open or evt.type = close)",
+		"not not evt.type = read",
+		"evt.dir = < and (evt.type = write or evt.type = read)",
+		"evt.buffer contains ell and evt.type = read and evt.type = read",
+		"(evt.dir = > or evt.type = read) and not evt.type = write",
+		"evt.buffer bcontains 6c6c and (evt.dir = > or evt.dir = >)",
+		"evt.category contains e or evt.category contains xyz",
+		"evt.category contains xyz or evt.category contains abc",
+		"evt.category icontains E or evt.category icontains XYZ",
+		"evt.category startswith xyz or evt.category startswith f or evt.category startswith i",
+		"evt.category endswith e or evt.category endswith d or evt.category endswith xyz",
+		"evt.category endswith xyz or evt.category endswith abc",
+	};
+
+	for(auto f : filters)
+	{
+		EXPECT_EQ(filter_run(&evt, f, true), filter_run(&evt, f, false)) << f;
+	}
+
+	// enough values to be matched with aho_corasick
+	const char* ops[] = {"contains", "icontains", "startswith", "endswith"};
+	for(auto op : ops)
+	{
+		for(auto v : {"e", "E", "f", "i", "xyz"})
+		{
+			std::string f = std::string("evt.category ") + op + " " + v;
+			for(uint32_t j = 0; j < 20; j++)
+			{
+				f += std::string(" or evt.category ") + op + " x" + std::to_string(j);
+			}
+			EXPECT_EQ(filter_run(&evt, f, true), filter_run(&evt, f, false)) << f;
+		}
+	}
+}
+
+class sinsp_filter_optimizer_evt : public sinsp_with_test_input
+{
+protected:
+	bool run(const std::string& str)
+	{
+		sinsp_filter_compiler compiler(&m_inspector, str);
+		std::unique_ptr<sinsp_filter> filter(compiler.compile());
+		return filter->run(m_evt);
+	}
+
+	sinsp_evt* m_evt = NULL;
+};
+
+TEST_F(sinsp_filter_optimizer_evt, merged_values_lengths)
+{
+	add_default_init_thread();
+	add_event(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/file_0", PPM_O_RDWR, 0);
+	add_event(increasing_ts(), 1, PPME_SYSCALL_OPEN_X, 6, (int64_t)3, "/tmp/file_0", PPM_O_RDWR, 0, 5, 123);
+	open_inspector();
+	next_event();
+	m_evt = next_event();
+	ASSERT_NE(m_evt, nullptr);
+
+	// the merged values are each compared with their own length, shorter
+	// or longer than the first one
+	EXPECT_TRUE(run("fd.name contains /xyz/abc or fd.name contains ile"));
+	EXPECT_TRUE(run("fd.name contains ile or fd.name contains /xyz/abc"));
+	EXPECT_FALSE(run("fd.name contains xyz or fd.name contains file_0/x"));
+	EXPECT_TRUE(run("fd.name startswith /tmp/file_0/xyz or fd.name startswith /tm"));
+	EXPECT_FALSE(run("fd.name startswith /t/ or fd.name startswith /tmp/file_01"));
+	EXPECT_TRUE(run("fd.name endswith /usr/tmp/file_0 or fd.name endswith _0"));
+	EXPECT_FALSE(run("fd.name endswith _0x or fd.name endswith p/file_1"));
+}
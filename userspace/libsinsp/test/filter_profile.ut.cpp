@@ -0,0 +1,127 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <sinsp.h>
+#include <filter.h>
+#include <gtest/gtest.h>
+
+TEST(filter_profile, counters)
+{
+	char scap_evt_err[2048];
+	uint8_t read_buf[] = {'h', 'e', 'l', 'l', 'o'};
+	uint8_t scap_evt_buf[2048];
+	size_t evt_size;
+	scap_sized_buffer scap_evt;
+	scap_evt.buf = (void*) &scap_evt_buf[0];
+	scap_evt.size = (size_t) sizeof(scap_evt_buf);
+	ASSERT_EQ(scap_event_encode_params(
+		scap_evt, &evt_size, scap_evt_err, PPME_SYSCALL_READ_X, 3, 0,
+		scap_const_sized_buffer{&read_buf[0],sizeof(read_buf)}), SCAP_SUCCESS);
+	sinsp_evt evt;
+	evt.init((uint8_t*) scap_evt.buf, 0);
+
+	std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(NULL));
+	sinsp_filter_compiler compiler(factory, "evt.cpu = 1 or (evt.cpu = 0 and not evt.category = file)");
+	compiler.set_optimize(false);
+	compiler.set_profiling(true);
+	std::unique_ptr<sinsp_filter> filter(compiler.compile());
+
+	for(uint32_t j = 0; j < 10; j++)
+	{
+		EXPECT_TRUE(filter->run(&evt));
+	}
+
+	auto p = filter->get_profile();
+	EXPECT_EQ(p.m_name, "or");
+	EXPECT_EQ(p.m_counters.m_num_evals, 10);
+	EXPECT_EQ(p.m_counters.m_num_true, 10);
+	EXPECT_EQ(p.m_num_short_circuits, 0);
+	ASSERT_EQ(p.m_children.size(), 2);
+
+	auto& cpu1 = p.m_children[0];
+	EXPECT_EQ(cpu1.m_name, "evt.cpu = 1");
+	EXPECT_EQ(cpu1.m_counters.m_num_evals, 10);
+	EXPECT_EQ(cpu1.m_counters.m_num_true, 0);
+	EXPECT_TRUE(cpu1.m_children.empty());
+
+	auto& a = p.m_children[1];
+	EXPECT_EQ(a.m_name, "and");
+	EXPECT_EQ(a.m_counters.m_num_evals, 10);
+	EXPECT_EQ(a.m_counters.m_num_true, 10);
+	ASSERT_EQ(a.m_children.size(), 2);
+	EXPECT_EQ(a.m_children[0].m_name, "evt.cpu = 0");
+	EXPECT_EQ(a.m_children[0].m_counters.m_num_true, 10);
+
+	auto& n = a.m_children[1];
+	EXPECT_EQ(n.m_name, "not");
+	EXPECT_EQ(n.m_counters.m_num_evals, 10);
+	EXPECT_EQ(n.m_counters.m_num_true, 10);
+	ASSERT_EQ(n.m_children.size(), 1);
+	EXPECT_EQ(n.m_children[0].m_name, "evt.category = file");
+	EXPECT_EQ(n.m_children[0].m_counters.m_num_true, 0);
+
+	// The counters are inclusive
+	EXPECT_GE(p.m_counters.m_ticks, cpu1.m_counters.m_ticks + a.m_counters.m_ticks);
+	EXPECT_GE(a.m_counters.m_ticks, n.m_counters.m_ticks);
+
+	EXPECT_EQ(p.to_string().find("or: 10 evals, 100.0% true, 0.0% short-circuited, "), 0);
+}
+
+TEST(filter_profile, short_circuits)
+{
+	char scap_evt_err[2048];
+	uint8_t read_buf[] = {'h', 'e', 'l', 'l', 'o'};
+	uint8_t scap_evt_buf[2048];
+	size_t evt_size;
+	scap_sized_buffer scap_evt;
+	scap_evt.buf = (void*) &scap_evt_buf[0];
+	scap_evt.size = (size_t) sizeof(scap_evt_buf);
+	ASSERT_EQ(scap_event_encode_params(
+		scap_evt, &evt_size, scap_evt_err, PPME_SYSCALL_READ_X, 3, 0,
+		scap_const_sized_buffer{&read_buf[0],sizeof(read_buf)}), SCAP_SUCCESS);
+	sinsp_evt evt;
+	evt.init((uint8_t*) scap_evt.buf, 0);
+
+	std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(NULL));
+	sinsp_filter_compiler compiler(factory, "evt.cpu = 1 and evt.category = unknown");
+	compiler.set_optimize(false);
+	compiler.set_program(true);
+	std::unique_ptr<sinsp_filter> filter(compiler.compile());
+
+	// Disabled by default
+	EXPECT_TRUE(filter->get_profile().m_children.empty());
+
+	filter->set_profiling(true);
+	for(uint32_t j = 0; j < 4; j++)
+	{
+		EXPECT_FALSE(filter->run(&evt));
+	}
+
+	auto p = filter->get_profile();
+	EXPECT_EQ(p.m_name, "and");
+	EXPECT_EQ(p.m_counters.m_num_evals, 4);
+	EXPECT_EQ(p.m_counters.m_num_true, 0);
+	EXPECT_EQ(p.m_num_short_circuits, 4);
+	ASSERT_EQ(p.m_children.size(), 2);
+	EXPECT_EQ(p.m_children[0].m_name, "check");
+	EXPECT_EQ(p.m_children[0].m_counters.m_num_evals, 4);
+	EXPECT_EQ(p.m_children[1].m_counters.m_num_evals, 0);
+
+	filter->set_profiling(false);
+	EXPECT_FALSE(filter->run(&evt));
+	EXPECT_TRUE(filter->get_profile().m_children.empty());
+}
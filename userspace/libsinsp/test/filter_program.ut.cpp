@@ -0,0 +1,130 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <random>
+
+#include <sinsp.h>
+#include <filter.h>
+#include <gtest/gtest.h>
+
+class filter_program : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		char scap_evt_err[2048];
+		size_t evt_size;
+		scap_sized_buffer scap_evt;
+		scap_evt.buf = (void*) &m_scap_evt_buf[0];
+		scap_evt.size = (size_t) sizeof(m_scap_evt_buf);
+		ASSERT_EQ(scap_event_encode_params(
+			scap_evt, &evt_size, scap_evt_err, PPME_SYSCALL_READ_X, 3, 0,
+			scap_const_sized_buffer{&m_read_buf[0],sizeof(m_read_buf)}), SCAP_SUCCESS);
+		m_evt.init((uint8_t*) scap_evt.buf, 0);
+	}
+
+	std::unique_ptr<sinsp_filter> compile(const std::string& str, bool optimize, bool program)
+	{
+		std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(NULL));
+		sinsp_filter_compiler compiler(factory, str);
+		compiler.set_optimize(optimize);
+		compiler.set_program(program);
+		return std::unique_ptr<sinsp_filter>(compiler.compile());
+	}
+
+	// A random expression of the checks below, with its expected result
+	std::string random_expr(std::mt19937& rng, uint32_t depth, bool& res)
+	{
+		static const char* checks[] = {"evt.cpu = 0", "evt.category = unknown", "evt.cpu = 1", "evt.category = file"};
+		static const bool results[] = {true, true, false, false};
+
+		uint32_t kind = depth == 0 ? 0 : rng() % 4;
+		if(kind == 0)
+		{
+			uint32_t j = rng() % 4;
+			res = results[j];
+			return checks[j];
+		}
+		if(kind == 1)
+		{
+			std::string e = "not (" + random_expr(rng, depth - 1, res) + ")";
+			res = !res;
+			return e;
+		}
+
+		bool is_and = (kind == 2);
+		uint32_t n = 2 + rng() % 3;
+		std::string e = "(";
+		res = is_and;
+		for(uint32_t j = 0; j < n; j++)
+		{
+			bool r;
+			e += (j > 0 ? (is_and ? " and " : " or ") : "") + random_expr(rng, depth - 1, r);
+			res = is_and ? (res && r) : (res || r);
+		}
+		return e + ")";
+	}
+
+	uint8_t m_read_buf[5] = {'h', 'e', 'l', 'l', 'o'};
+	uint8_t m_scap_evt_buf[2048];
+	sinsp_evt m_evt;
+};
+
+TEST_F(filter_program, same_as_tree)
+{
+	std::mt19937 rng(42);
+
+	for(uint32_t j = 0; j < 500; j++)
+	{
+		bool expected;
+		std::string str = random_expr(rng, 4, expected);
+
+		for(bool optimize : {false, true})
+		{
+			auto tree = compile(str, optimize, false);
+			auto flat = compile(str, optimize, true);
+			ASSERT_EQ(tree->get_program(), nullptr);
+			ASSERT_NE(flat->get_program(), nullptr);
+			EXPECT_EQ(tree->run(&m_evt), expected) << str;
+			EXPECT_EQ(flat->run(&m_evt), expected) << str << std::endl << flat->get_program()->to_string();
+		}
+	}
+}
+
+TEST_F(filter_program, jumps)
+{
+	// The jumps are merged into the checks, and a jump to the end of
+	// "a or b" goes past the test of its result
+	auto f = compile("(evt.cpu = 1 or evt.cpu = 0) and not evt.cpu = 2", false, true);
+	EXPECT_EQ(f->get_program()->to_string(),
+		"0: check, if true jump to 2\n"
+		"1: check, if false jump to 3\n"
+		"2: not check\n");
+	EXPECT_TRUE(f->run(&m_evt));
+
+	f = compile("not (evt.cpu = 0 and evt.cpu = 1) or evt.cpu = 2", false, true);
+	EXPECT_EQ(f->get_program()->to_string(),
+		"0: check, if false jump to 2\n"
+		"1: check\n"
+		"2: not, if true jump to 4\n"
+		"3: check\n");
+	EXPECT_TRUE(f->run(&m_evt));
+
+	f->set_program(false);
+	EXPECT_EQ(f->get_program(), nullptr);
+	EXPECT_TRUE(f->run(&m_evt));
+}
@@ -0,0 +1,130 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <sinsp.h>
+#include <filter_evttype_resolver.h>
+#include <filter_ruleset.h>
+#include <gtest/gtest.h>
+
+using namespace libsinsp::filter;
+
+static std::set<uint16_t> filter_evttypes(const std::string& filter)
+{
+	std::set<uint16_t> res;
+	parser p(filter);
+	auto e = p.parse();
+	sinsp_filter_evttype_resolver().evttypes(e.get(), res);
+	return res;
+}
+
+static std::set<uint16_t> all_evttypes_but(const std::set<uint16_t>& excluded)
+{
+	std::set<uint16_t> res;
+	for(uint16_t j = 0; j < PPM_EVENT_MAX; j++)
+	{
+		if(excluded.find(j) == excluded.end())
+		{
+			res.insert(j);
+		}
+	}
+	return res;
+}
+
+static sinsp_filter* compile(const std::string& filter)
+{
+	std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(NULL));
+	sinsp_filter_compiler compiler(factory, filter);
+	return compiler.compile();
+}
+
+TEST(sinsp_filter_evttype_resolver, evttypes)
+{
+	std::set<uint16_t> open = {PPME_SYSCALL_OPEN_E, PPME_SYSCALL_OPEN_X, PPME_GENERIC_E, PPME_GENERIC_X};
+	std::set<uint16_t> openat = filter_evttypes("evt.type = openat");
+	std::set<uint16_t> open_openat = open;
+	open_openat.insert(openat.begin(), openat.end());
+
+	ASSERT_TRUE(openat.find(PPME_SYSCALL_OPENAT_2_X) != openat.end());
+	EXPECT_EQ(filter_evttypes("evt.type = open"), open);
+	EXPECT_EQ(filter_evttypes("evt.type in (open, openat)"), open_openat);
+	EXPECT_EQ(filter_evttypes("evt.type = open or evt.type = openat"), open_openat);
+	EXPECT_EQ(filter_evttypes("evt.type = open and proc.name = cat"), open);
+	EXPECT_EQ(filter_evttypes("evt.type in (open, openat) and evt.type = open"), open);
+	EXPECT_EQ(filter_evttypes("proc.name = cat"), all_evttypes_but({}));
+	EXPECT_EQ(filter_evttypes("evt.type = open or proc.name = cat"), all_evttypes_but({}));
+	EXPECT_EQ(filter_evttypes("evt.type contains open"), all_evttypes_but({}));
+
+	// syscalls without a dedicated event only show up as generic events
+	EXPECT_EQ(filter_evttypes("evt.type = syncfs"),
+		std::set<uint16_t>({PPME_GENERIC_E, PPME_GENERIC_X}));
+	EXPECT_EQ(filter_evttypes("evt.type = nonexistent"), std::set<uint16_t>());
+
+	// negations never exclude the generic events
+	std::set<uint16_t> not_open = all_evttypes_but({PPME_SYSCALL_OPEN_E, PPME_SYSCALL_OPEN_X});
+	EXPECT_EQ(filter_evttypes("evt.type != open"), not_open);
+	EXPECT_EQ(filter_evttypes("not evt.type = open"), not_open);
+	EXPECT_EQ(filter_evttypes("not not evt.type = open"), open);
+	EXPECT_EQ(filter_evttypes("not evt.type != open"), open);
+	EXPECT_EQ(filter_evttypes("not (evt.type = open and proc.name = cat)"), all_evttypes_but({}));
+	EXPECT_EQ(filter_evttypes("not (evt.type = open or proc.name = cat)"), not_open);
+	EXPECT_EQ(filter_evttypes("not (evt.type != open or proc.name = cat)"), open);
+}
+
+TEST(sinsp_filter_evttype_resolver, compiler)
+{
+	std::unique_ptr<sinsp_filter> f(compile("evt.type = open and proc.name = cat"));
+	EXPECT_EQ(f->evttypes(), filter_evttypes("evt.type = open"));
+
+	// the filters not built by the compiler don't know their evt types
+	EXPECT_EQ(gen_event_filter().evttypes(), std::set<uint16_t>());
+}
+
+TEST(sinsp_filter_ruleset, run)
+{
+	char scap_evt_err[2048];
+	uint8_t read_buf[] = {'h', 'e', 'l', 'l', 'o'};
+	uint8_t scap_evt_buf[2048];
+	size_t evt_size;
+	scap_sized_buffer scap_evt;
+	scap_evt.buf = (void*) &scap_evt_buf[0];
+	scap_evt.size = (size_t) sizeof(scap_evt_buf);
+	ASSERT_EQ(scap_event_encode_params(
+		scap_evt, &evt_size, scap_evt_err, PPME_SYSCALL_READ_X, 3, 0,
+		scap_const_sized_buffer{&read_buf[0],sizeof(read_buf)}), SCAP_SUCCESS);
+	sinsp_evt evt;
+	evt.init((uint8_t*) scap_evt.buf, 0);
+
+	sinsp_filter_ruleset ruleset;
+	EXPECT_EQ(ruleset.add(compile("evt.type = open")), 0);
+	EXPECT_EQ(ruleset.add(compile("evt.type in (read, write)")), 1);
+	EXPECT_EQ(ruleset.add(compile("evt.buffer contains ell")), 2);
+	EXPECT_EQ(ruleset.add(compile("evt.type = write and evt.buffer contains ell")), 3);
+	EXPECT_EQ(ruleset.add(compile("evt.type != open and evt.buffer contains xyz")), 4);
+	EXPECT_EQ(ruleset.size(), 5);
+
+	std::vector<uint32_t> matches;
+	EXPECT_EQ(ruleset.run(&evt, matches), 2);
+	EXPECT_EQ(matches, std::vector<uint32_t>({1, 2}));
+
+	matches.clear();
+	EXPECT_EQ(ruleset.run(&evt, matches), 2);
+	EXPECT_EQ(matches, std::vector<uint32_t>({1, 2}));
+
+	EXPECT_EQ(ruleset.get_stats().m_num_events, 2);
+	EXPECT_EQ(ruleset.get_stats().m_num_evaluated, 6);
+	EXPECT_EQ(ruleset.get_stats().m_num_skipped, 4);
+}
@@ -0,0 +1,120 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <sinsp.h>
+#include <filterchecks.h>
+#include <gtest/gtest.h>
+
+TEST(flt_typed_compare, same_as_flt_compare)
+{
+	ppm_param_type types[] = {
+		PT_INT8, PT_INT16, PT_INT32, PT_INT64, PT_FD, PT_PID, PT_ERRNO,
+		PT_UINT8, PT_FLAGS8, PT_ENUMFLAGS8, PT_SIGTYPE,
+		PT_UINT16, PT_FLAGS16, PT_ENUMFLAGS16, PT_PORT, PT_SYSCALLID,
+		PT_UINT32, PT_FLAGS32, PT_ENUMFLAGS32, PT_MODE, PT_BOOL, PT_IPV4ADDR,
+		PT_UINT64, PT_RELTIME, PT_ABSTIME};
+	cmpop ops[] = {CO_EQ, CO_NE, CO_LT, CO_LE, CO_GT, CO_GE};
+	// the edges of the signed and unsigned ranges of each width
+	uint64_t values[] = {
+		0, 1, 0x7f, 0x80, 0xff, 0x7fff, 0x8000, 0xffff,
+		0x7fffffff, 0x80000000, 0xffffffff,
+		0x7fffffffffffffffULL, 0x8000000000000000ULL, 0xffffffffffffffffULL};
+
+	for(auto type : types)
+	{
+		for(auto op : ops)
+		{
+			flt_typed_compare_t cmp = flt_typed_compare(op, type);
+			ASSERT_NE(cmp, nullptr);
+			for(uint64_t v1 : values)
+			{
+				for(uint64_t v2 : values)
+				{
+					EXPECT_EQ(cmp((uint8_t*)&v1, sizeof(v1), (uint8_t*)&v2, sizeof(v2)),
+						  flt_compare(op, type, &v1, &v2, sizeof(v1), sizeof(v2)))
+						<< "type " << type << ", op " << op << ", " << v1 << ", " << v2;
+				}
+			}
+		}
+	}
+
+	const char* strings[] = {"", "a", "ab", "abc", "b", "bc"};
+	cmpop string_ops[] = {CO_EQ, CO_NE, CO_STARTSWITH, CO_ENDSWITH};
+	for(auto op : string_ops)
+	{
+		flt_typed_compare_t cmp = flt_typed_compare(op, PT_CHARBUF);
+		ASSERT_NE(cmp, nullptr);
+		for(auto s1 : strings)
+		{
+			for(auto s2 : strings)
+			{
+				// the length of the first operand is only a hint, the
+				// one of the second is exact
+				for(uint32_t len1 : {(uint32_t)0, (uint32_t)strlen(s1), (uint32_t)strlen(s1) + 1})
+				{
+					EXPECT_EQ(cmp((uint8_t*)s1, len1, (uint8_t*)s2, strlen(s2)),
+						  flt_compare(op, PT_CHARBUF, (void*)s1, (void*)s2, len1, strlen(s2)))
+						<< "op " << op << ", " << s1 << ", " << s2 << ", " << len1;
+				}
+			}
+		}
+	}
+
+	EXPECT_EQ(flt_typed_compare(CO_IN, PT_UINT64), nullptr);
+	EXPECT_EQ(flt_typed_compare(CO_CONTAINS, PT_CHARBUF), nullptr);
+	EXPECT_EQ(flt_typed_compare(CO_EQ, PT_IPV6ADDR), nullptr);
+	EXPECT_EQ(flt_typed_compare(CO_EQ, PT_DOUBLE), nullptr);
+}
+
+TEST(flt_typed_compare, filter)
+{
+	char scap_evt_err[2048];
+	uint8_t read_buf[] = {'h', 'e', 'l', 'l', 'o'};
+	uint8_t scap_evt_buf[2048];
+	size_t evt_size;
+	scap_sized_buffer scap_evt;
+	scap_evt.buf = (void*) &scap_evt_buf[0];
+	scap_evt.size = (size_t) sizeof(scap_evt_buf);
+	ASSERT_EQ(scap_event_encode_params(
+		scap_evt, &evt_size, scap_evt_err, PPME_SYSCALL_READ_X, 3, 0,
+		scap_const_sized_buffer{&read_buf[0],sizeof(read_buf)}), SCAP_SUCCESS);
+	sinsp_evt evt;
+	evt.init((uint8_t*) scap_evt.buf, 0);
+
+	std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(NULL));
+	auto run = [&](const std::string& str)
+	{
+		sinsp_filter_compiler compiler(factory, str);
+		std::unique_ptr<sinsp_filter> filter(compiler.compile());
+		return filter->run(&evt);
+	};
+
+	EXPECT_TRUE(run("evt.cpu = 0"));
+	EXPECT_FALSE(run("evt.cpu != 0"));
+	EXPECT_TRUE(run("evt.cpu < 1"));
+	EXPECT_TRUE(run("evt.cpu <= 0"));
+	EXPECT_FALSE(run("evt.cpu > 0"));
+	EXPECT_TRUE(run("evt.cpu >= 0"));
+	EXPECT_TRUE(run("evt.category = unknown"));
+	EXPECT_FALSE(run("evt.category = unknow"));
+	EXPECT_TRUE(run("evt.category != unknow"));
+	EXPECT_TRUE(run("evt.category startswith unk"));
+	EXPECT_TRUE(run("evt.category endswith own"));
+	EXPECT_FALSE(run("evt.category endswith unknown_"));
+	EXPECT_TRUE(run("evt.cpu = 0 and evt.category = unknown"));
+	EXPECT_TRUE(run("not evt.cpu > 0 and evt.category != file"));
+}
@@ -0,0 +1,190 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <set>
+
+#include <sinsp.h>
+#include <filter_value_set.h>
+#include <gtest/gtest.h>
+
+static void insert(filter_value_set& s, const std::string& v)
+{
+	s.insert((const uint8_t*)v.data(), (uint32_t)v.size());
+}
+
+static bool contains(filter_value_set& s, const std::string& v)
+{
+	return s.contains((const uint8_t*)v.data(), (uint32_t)v.size());
+}
+
+template<typename T>
+static void insert_int(filter_value_set& s, T v)
+{
+	s.insert((const uint8_t*)&v, sizeof(v));
+}
+
+template<typename T>
+static bool contains_int(filter_value_set& s, T v)
+{
+	return s.contains((const uint8_t*)&v, sizeof(v));
+}
+
+TEST(filter_value_set, empty)
+{
+	filter_value_set s;
+	EXPECT_EQ(s.get_layout(), filter_value_set::EMPTY);
+	EXPECT_EQ(s.size(), 0);
+	EXPECT_FALSE(contains(s, ""));
+	EXPECT_FALSE(contains(s, "a"));
+}
+
+TEST(filter_value_set, small)
+{
+	filter_value_set s;
+	insert(s, "sh");
+	insert(s, "");
+	insert(s, "a_long_process_name");
+	insert(s, "a_long_process_other");
+	insert(s, "sh");
+	EXPECT_EQ(s.get_layout(), filter_value_set::SMALL);
+	EXPECT_EQ(s.size(), 4);
+
+	EXPECT_TRUE(contains(s, "sh"));
+	EXPECT_TRUE(contains(s, ""));
+	EXPECT_TRUE(contains(s, "a_long_process_name"));
+	EXPECT_TRUE(contains(s, "a_long_process_other"));
+	EXPECT_FALSE(contains(s, "s"));
+	EXPECT_FALSE(contains(s, "shh"));
+	EXPECT_FALSE(contains(s, "a_long_process_nam"));
+	EXPECT_FALSE(contains(s, "a_long_process_namf"));
+	EXPECT_FALSE(contains(s, std::string("sh\0", 3)));
+}
+
+TEST(filter_value_set, hash)
+{
+	filter_value_set s;
+	std::set<std::string> values;
+	for(uint32_t j = 0; j < 5000; j++)
+	{
+		std::string v = "/usr/bin/proc" + std::to_string(j * 7);
+		values.insert(v);
+		insert(s, v);
+	}
+	EXPECT_EQ(s.get_layout(), filter_value_set::HASH);
+	EXPECT_EQ(s.size(), values.size());
+
+	for(uint32_t j = 0; j < 5000 * 7; j++)
+	{
+		std::string v = "/usr/bin/proc" + std::to_string(j);
+		EXPECT_EQ(contains(s, v), values.find(v) != values.end()) << v;
+	}
+	EXPECT_FALSE(contains(s, ""));
+	EXPECT_FALSE(contains(s, "/usr/bin/proc"));
+}
+
+TEST(filter_value_set, integers)
+{
+	// a few: scanned
+	filter_value_set few;
+	insert_int<uint16_t>(few, 22);
+	insert_int<uint16_t>(few, 443);
+	insert_int<uint16_t>(few, 65535);
+	EXPECT_EQ(few.get_layout(), filter_value_set::INTEGERS);
+	EXPECT_TRUE(contains_int<uint16_t>(few, 22));
+	EXPECT_TRUE(contains_int<uint16_t>(few, 65535));
+	EXPECT_FALSE(contains_int<uint16_t>(few, 80));
+	EXPECT_FALSE(contains_int<uint32_t>(few, 22));
+
+	// small ones: bitset
+	filter_value_set bits;
+	for(uint32_t uid = 0; uid < 1000; uid += 3)
+	{
+		insert_int<uint32_t>(bits, uid);
+	}
+	EXPECT_EQ(bits.get_layout(), filter_value_set::INTEGERS);
+	for(uint32_t uid = 0; uid < 70000; uid++)
+	{
+		EXPECT_EQ(contains_int<uint32_t>(bits, uid), uid < 1000 && uid % 3 == 0) << uid;
+	}
+	EXPECT_FALSE(contains_int<uint32_t>(bits, 0xffffffff));
+
+	// large ones: binary search
+	filter_value_set large;
+	for(int64_t v = -50; v < 50; v++)
+	{
+		insert_int<int64_t>(large, v * 1000000007);
+	}
+	EXPECT_EQ(large.get_layout(), filter_value_set::INTEGERS);
+	EXPECT_EQ(large.size(), 100);
+	for(int64_t v = -60; v < 60; v++)
+	{
+		EXPECT_EQ(contains_int<int64_t>(large, v * 1000000007), v >= -50 && v < 50) << v;
+		EXPECT_FALSE(contains_int<int64_t>(large, v * 1000000007 + 1)) << v;
+	}
+}
+
+TEST(filter_value_set, insert_after_lookup)
+{
+	filter_value_set s;
+	insert(s, "a");
+	EXPECT_TRUE(contains(s, "a"));
+	EXPECT_FALSE(contains(s, "bb"));
+	insert(s, "bb");
+	EXPECT_TRUE(contains(s, "a"));
+	EXPECT_TRUE(contains(s, "bb"));
+	EXPECT_EQ(s.size(), 2);
+}
+
+TEST(filter_value_set, filter)
+{
+	char scap_evt_err[2048];
+	uint8_t read_buf[] = {'h', 'e', 'l', 'l', 'o'};
+	uint8_t scap_evt_buf[2048];
+	size_t evt_size;
+	scap_sized_buffer scap_evt;
+	scap_evt.buf = (void*) &scap_evt_buf[0];
+	scap_evt.size = (size_t) sizeof(scap_evt_buf);
+	ASSERT_EQ(scap_event_encode_params(
+		scap_evt, &evt_size, scap_evt_err, PPME_SYSCALL_READ_X, 3, 0,
+		scap_const_sized_buffer{&read_buf[0],sizeof(read_buf)}), SCAP_SUCCESS);
+	sinsp_evt evt;
+	evt.init((uint8_t*) scap_evt.buf, 0);
+
+	std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(NULL));
+	auto run = [&](const std::string& str)
+	{
+		sinsp_filter_compiler compiler(factory, str);
+		std::unique_ptr<sinsp_filter> filter(compiler.compile());
+		return filter->run(&evt);
+	};
+
+	std::string many;
+	for(uint32_t j = 0; j < 100; j++)
+	{
+		many += "x" + std::to_string(j) + ", ";
+	}
+
+	EXPECT_TRUE(run("evt.category in (unknown)"));
+	EXPECT_TRUE(run("evt.category in (a, b, unknown)"));
+	EXPECT_FALSE(run("evt.category in (a, b, unknow)"));
+	EXPECT_TRUE(run("evt.category in (" + many + "unknown)"));
+	EXPECT_FALSE(run("evt.category in (" + many + "unknow)"));
+	EXPECT_TRUE(run("evt.cpu in (0, 1, 2)"));
+	EXPECT_FALSE(run("evt.cpu in (1, 2, 3)"));
+	EXPECT_TRUE(run("evt.cpu in (1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 0)"));
+	EXPECT_FALSE(run("evt.cpu in (1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11)"));
+}
@@ -0,0 +1,189 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+
+#include "sinsp_with_test_input.h"
+#include "eventformatter.h"
+#include "filter_workers.h"
+#include "state_access.h"
+
+class filter_workers : public sinsp_with_test_input
+{
+protected:
+	// init, and cat, its child, each open and close nfiles files
+	void add_events(uint32_t nfiles)
+	{
+		add_default_init_thread();
+		add_thread(create_threadinfo(10, 10, 1, 10, 10, 10, "cat", "/bin/cat", "/bin/cat", increasing_ts(), 0, 0), {});
+
+		for(uint32_t j = 0; j < nfiles; j++)
+		{
+			std::string name = "/tmp/file_" + std::to_string(j);
+			uint64_t tid = (j % 2) ? 10 : 1;
+			int64_t fd = 3 + (j % 5);
+
+			add_event(increasing_ts(), tid, PPME_SYSCALL_OPEN_E, 3, name.c_str(), PPM_O_RDWR, 0);
+			add_event(increasing_ts(), tid, PPME_SYSCALL_OPEN_X, 6, fd, name.c_str(), PPM_O_RDWR, 0, 5, 123);
+			add_event(increasing_ts(), tid, PPME_SYSCALL_CLOSE_E, 1, fd);
+			add_event(increasing_ts(), tid, PPME_SYSCALL_CLOSE_X, 1, 0);
+		}
+	}
+
+	// Rules reading the event, its thread, the parent and the fd
+	std::vector<std::pair<std::string, std::string>> make_rules()
+	{
+		std::vector<std::pair<std::string, std::string>> rules;
+
+		for(uint32_t j = 0; j < 5; j++)
+		{
+			std::string n = std::to_string(j);
+			rules.emplace_back("evt.type = open and evt.dir = < and fd.name endswith " + n, "%proc.name opened %fd.name (%evt.arg.flags)");
+			rules.emplace_back("proc.name = cat and fd.num = " + std::to_string(3 + j), "%proc.pname %proc.name %fd.num %fd.directory");
+			rules.emplace_back("proc.pname = init and evt.type in (close, open) and fd.name contains _" + n, "");
+			rules.emplace_back("not proc.name = cat and evt.dir = >", "%evt.type %evt.args");
+		}
+
+		return rules;
+	}
+};
+
+TEST_F(filter_workers, same_as_inline)
+{
+	const uint32_t nfiles = 50;
+	auto rules = make_rules();
+
+	add_events(nfiles);
+
+	sinsp_filter_workers one(&m_inspector, 1);
+	sinsp_filter_workers four(&m_inspector, 4);
+	std::vector<std::unique_ptr<sinsp_filter>> filters;
+	std::vector<std::unique_ptr<sinsp_evt_formatter>> formatters;
+
+	for(uint32_t j = 0; j < rules.size(); j++)
+	{
+		EXPECT_EQ(one.add(rules[j].first, rules[j].second), j);
+		EXPECT_EQ(four.add(rules[j].first, rules[j].second), j);
+
+		sinsp_filter_compiler compiler(&m_inspector, rules[j].first);
+		filters.emplace_back(compiler.compile());
+		formatters.emplace_back(rules[j].second.empty() ? nullptr : new sinsp_evt_formatter(&m_inspector, rules[j].second));
+	}
+	ASSERT_EQ(four.size(), rules.size());
+	ASSERT_EQ(four.get_nthreads(), 4);
+
+	open_inspector();
+
+	std::vector<sinsp_filter_workers::match> one_matches;
+	std::vector<sinsp_filter_workers::match> four_matches;
+	uint32_t nmatches = 0;
+	sinsp_evt* evt;
+
+	while((evt = next_event()) != nullptr)
+	{
+		std::vector<sinsp_filter_workers::match> expected;
+		for(uint32_t j = 0; j < rules.size(); j++)
+		{
+			if(filters[j]->run(evt))
+			{
+				expected.emplace_back();
+				expected.back().m_id = j;
+				if(formatters[j])
+				{
+					formatters[j]->tostring(evt, &expected.back().m_output);
+				}
+			}
+		}
+
+		one.run(evt, one_matches);
+		four.run(evt, four_matches);
+
+		ASSERT_EQ(one_matches.size(), expected.size());
+		ASSERT_EQ(four_matches.size(), expected.size());
+		for(uint32_t j = 0; j < expected.size(); j++)
+		{
+			EXPECT_EQ(one_matches[j].m_id, expected[j].m_id);
+			EXPECT_EQ(one_matches[j].m_output, expected[j].m_output);
+			EXPECT_EQ(four_matches[j].m_id, expected[j].m_id);
+			EXPECT_EQ(four_matches[j].m_output, expected[j].m_output);
+		}
+		nmatches += expected.size();
+	}
+
+	EXPECT_GT(nmatches, nfiles);
+}
+
+TEST_F(filter_workers, outputs)
+{
+	add_events(2);
+
+	sinsp_filter_workers workers(&m_inspector, 3);
+	workers.add("evt.type = open and evt.dir = < and proc.name = cat", "%proc.pname %proc.name opened %fd.name");
+	workers.add("evt.type = close and evt.dir = >", "");
+	workers.add("evt.type = open and evt.dir = < and fd.name = /tmp/file_0", "%proc.name %fd.num");
+
+	open_inspector();
+
+	std::vector<sinsp_filter_workers::match> matches;
+	std::vector<std::string> outputs;
+	sinsp_evt* evt;
+
+	while((evt = next_event()) != nullptr)
+	{
+		workers.run(evt, matches);
+		for(auto& m : matches)
+		{
+			outputs.push_back(std::to_string(m.m_id) + ":" + m.m_output);
+		}
+	}
+
+	std::vector<std::string> expected = {
+		"2:init 3",
+		"1:",
+		"0:init cat opened /tmp/file_1",
+		"1:",
+	};
+	EXPECT_EQ(outputs, expected);
+}
+
+TEST_F(filter_workers, invalid_rules)
+{
+	sinsp_filter_workers workers(&m_inspector, 2);
+
+	EXPECT_THROW(workers.add("proc.nme = cat", ""), sinsp_exception);
+	EXPECT_THROW(workers.add("proc.name = cat", "%proc.nme"), sinsp_exception);
+	EXPECT_EQ(workers.size(), 0);
+
+	EXPECT_EQ(workers.add("proc.name = cat", "%proc.name"), 0);
+	EXPECT_EQ(workers.add("proc.name = ls", ""), 1);
+	EXPECT_EQ(workers.size(), 2);
+}
+
+TEST_F(filter_workers, read_only_lookups)
+{
+	add_events(1);
+	open_inspector();
+
+	uint32_t nthreads = m_inspector.m_thread_manager->get_thread_count();
+
+	g_state_read_only = true;
+	EXPECT_EQ(m_inspector.get_thread_ref(12345, true, false), nullptr);
+	EXPECT_NE(m_inspector.get_thread_ref(10, true, false), nullptr);
+	g_state_read_only = false;
+
+	EXPECT_EQ(m_inspector.m_thread_manager->get_thread_count(), nthreads);
+}
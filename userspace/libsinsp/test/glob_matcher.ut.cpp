@@ -0,0 +1,124 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string.h>
+#include <sinsp.h>
+#include <glob_matcher.h>
+#include <gtest/gtest.h>
+
+static bool glob(const std::string& pattern, const std::string& str)
+{
+	glob_matcher g;
+	g.compile(pattern);
+	return g.match(str.c_str(), str.size());
+}
+
+TEST(glob_matcher, match)
+{
+	EXPECT_TRUE(glob("/etc/*", "/etc/passwd"));
+	EXPECT_TRUE(glob("/etc/*", "/etc/"));
+	EXPECT_TRUE(glob("/etc/*", "/etc/ssh/sshd_config"));
+	EXPECT_FALSE(glob("/etc/*", "/etc"));
+	EXPECT_TRUE(glob("*.log", "/var/log/syslog.log"));
+	EXPECT_FALSE(glob("*.log", "/var/log/syslog.log.1"));
+	EXPECT_TRUE(glob("/var/log/*.log*", "/var/log/syslog.log.1"));
+	EXPECT_TRUE(glob("/home/*/.ssh/*", "/home/user/.ssh/id_rsa"));
+	EXPECT_FALSE(glob("/home/*/.ssh/*", "/home/user/ssh/id_rsa"));
+	EXPECT_TRUE(glob("*ab*ab*", "xxabab"));
+	EXPECT_FALSE(glob("*aba*aba*", "xxababa"));
+	EXPECT_TRUE(glob("/dev/tty?", "/dev/tty1"));
+	EXPECT_FALSE(glob("/dev/tty?", "/dev/tty10"));
+	EXPECT_TRUE(glob("/dev/tty[0-9]", "/dev/tty7"));
+	EXPECT_FALSE(glob("/dev/tty[!0-9]", "/dev/tty7"));
+	EXPECT_TRUE(glob("[]]x", "]x"));
+	EXPECT_TRUE(glob("a\\*b", "a*b"));
+	EXPECT_FALSE(glob("a\\*b", "axb"));
+	EXPECT_TRUE(glob("", ""));
+	EXPECT_FALSE(glob("", "a"));
+	EXPECT_TRUE(glob("**", ""));
+
+	// not compiled, but same results
+	glob_matcher g;
+	g.compile("[[:digit:]]*");
+	EXPECT_FALSE(g.compiled());
+	EXPECT_TRUE(g.match("1abc", 4));
+	EXPECT_FALSE(g.match("abc", 3));
+}
+
+TEST(glob_matcher, same_as_fnmatch)
+{
+	const char* patterns[] = {
+		"*", "?", "a*", "*a", "*a*", "a*b", "*ab*ba*", "a?b*", "?*?", "a**b",
+		"[ab]*", "*[!a]", "[a-c]?[^b]*", "[]a]*", "[!]]*", "[a-]*", "\\\\*",
+		"a\\?*", "*[b-a]*", "[a", "a[", "*\\", "[[:alpha:]]*", "[\\]]*",
+	};
+	const char alphabet[] = "ab]-\\?";
+	uint32_t seed = 1;
+	auto rnd = [&seed]()
+	{
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) & 0x7fff;
+	};
+
+	for(auto p : patterns)
+	{
+		glob_matcher g;
+		g.compile(p);
+		for(uint32_t iter = 0; iter < 2000; iter++)
+		{
+			std::string s(rnd() % 8, 0);
+			for(auto& c : s)
+			{
+				c = alphabet[rnd() % (sizeof(alphabet) - 1)];
+			}
+			EXPECT_EQ(g.match(s.c_str(), s.size()), sinsp_utils::glob_match(p, s.c_str()))
+				<< "'" << p << "' on '" << s << "'";
+		}
+	}
+}
+
+TEST(glob_matcher, filter)
+{
+	char scap_evt_err[2048];
+	uint8_t read_buf[] = {'h', 'e', 'l', 'l', 'o'};
+	uint8_t scap_evt_buf[2048];
+	size_t evt_size;
+	scap_sized_buffer scap_evt;
+	scap_evt.buf = (void*) &scap_evt_buf[0];
+	scap_evt.size = (size_t) sizeof(scap_evt_buf);
+	ASSERT_EQ(scap_event_encode_params(
+		scap_evt, &evt_size, scap_evt_err, PPME_SYSCALL_READ_X, 3, 0,
+		scap_const_sized_buffer{&read_buf[0],sizeof(read_buf)}), SCAP_SUCCESS);
+	sinsp_evt evt;
+	evt.init((uint8_t*) scap_evt.buf, 0);
+
+	std::shared_ptr<gen_event_filter_factory> factory(new sinsp_filter_factory(NULL));
+	std::string category = "unknown";
+	{
+		sinsp_filter_compiler compiler(factory, "evt.category = " + category);
+		std::unique_ptr<sinsp_filter> filter(compiler.compile());
+		ASSERT_TRUE(filter->run(&evt));
+	}
+
+	const char* patterns[] = {"*", "?*", "*?", "[a-z]*", "[!a-z]*", "x*", "*x", "*[!x]", "u*n", "u[m-o]?no*", "*kno*"};
+	for(auto p : patterns)
+	{
+		sinsp_filter_compiler compiler(factory, std::string("evt.category glob ") + p);
+		std::unique_ptr<sinsp_filter> filter(compiler.compile());
+		EXPECT_EQ(filter->run(&evt), sinsp_utils::glob_match(p, category.c_str())) << p;
+	}
+}
@@ -0,0 +1,206 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sinsp.h>
+#include <gtest/gtest.h>
+
+#include "container_info.h"
+#include "interned.h"
+
+static const std::string long_string(100, 'x');
+
+TEST(interned, table)
+{
+	interned_table<std::string> table;
+
+	auto a = table.intern(long_string);
+	auto b = table.intern(std::string(long_string));
+	auto c = table.intern("other");
+	EXPECT_EQ(&a.get(), &b.get());
+	EXPECT_NE(&a.get(), &c.get());
+	EXPECT_EQ(a.use_count(), 2);
+	EXPECT_EQ(*a, long_string);
+	EXPECT_EQ(table.size(), 2);
+
+	// The empty values are not in the table
+	EXPECT_EQ(&table.intern("").get(), &interned<std::string>().get());
+	EXPECT_EQ(table.size(), 2);
+
+	// A value leaves the table with its last holder
+	c = interned<std::string>();
+	EXPECT_EQ(table.size(), 1);
+	a = b;
+	b = interned<std::string>();
+	EXPECT_EQ(table.size(), 1);
+	EXPECT_EQ(a.use_count(), 1);
+
+	// A value interned again after it left the table is a new one
+	c = table.intern("other");
+	EXPECT_EQ(*c, "other");
+	EXPECT_EQ(table.size(), 2);
+}
+
+TEST(interned, outlives_table)
+{
+	interned<std::vector<std::string>> v;
+	{
+		interned_table<std::vector<std::string>> table;
+		v = table.intern({long_string, "b"});
+	}
+
+	EXPECT_EQ(v->size(), 2);
+	EXPECT_EQ(v->at(0), long_string);
+	v = interned<std::vector<std::string>>();
+}
+
+TEST(interned, threads)
+{
+	sinsp inspector;
+	sinsp_thread_manager* manager = inspector.m_thread_manager;
+	size_t count = manager->get_interned_count();
+
+	auto a = inspector.build_threadinfo();
+	auto b = inspector.build_threadinfo();
+	a->set_comm("java");
+	a->set_exe(long_string);
+	a->set_args({long_string, "-jar"});
+	b->set_comm("java");
+	b->set_exe(long_string);
+	b->set_args({long_string, "-jar"});
+	EXPECT_EQ(&a->get_comm(), &b->get_comm());
+	EXPECT_EQ(&a->get_exe(), &b->get_exe());
+	EXPECT_EQ(&a->get_args(), &b->get_args());
+	EXPECT_EQ(manager->get_interned_count(), count + 3);
+
+	// Changing the value of a thread doesn't change the others
+	b->set_args({"-version"});
+	EXPECT_EQ(a->get_args().size(), 2);
+	EXPECT_EQ(b->get_args().size(), 1);
+	EXPECT_EQ(manager->get_interned_count(), count + 4);
+
+	// The values leave the table with the threads that have them
+	a.reset();
+	b.reset();
+	EXPECT_EQ(manager->get_interned_count(), count);
+
+	// The threads without an inspector have their own values
+	sinsp_threadinfo c;
+	c.set_comm("java");
+	EXPECT_EQ(c.get_comm(), "java");
+	EXPECT_EQ(manager->get_interned_count(), count);
+}
+
+//
+// The container lookup threads build the container threads while the
+// inspector keeps interning the strings of the other threads, growing its
+// tables: the container threads have their own strings
+//
+TEST(interned, container_tinfo_thread)
+{
+	const uint32_t iterations = 20000;
+
+	sinsp inspector;
+	sinsp_thread_manager* manager = inspector.m_thread_manager;
+	size_t count = manager->get_interned_count();
+
+	sinsp_container_info container;
+	container.m_id = "0123456789ab";
+
+	std::thread lookup([&]()
+	{
+		for(uint32_t j = 0; j < iterations; j++)
+		{
+			auto tinfo = container.get_tinfo(&inspector);
+			ASSERT_EQ(tinfo->get_comm(), "container:0123456789ab");
+			ASSERT_EQ(tinfo->get_exe(), "container:0123456789ab");
+			ASSERT_EQ(tinfo->m_container_id, container.m_id);
+		}
+	});
+
+	std::vector<interned<std::string>> comms;
+	auto tinfo = inspector.build_threadinfo();
+	for(uint32_t j = 0; j < iterations; j++)
+	{
+		tinfo->set_comm("comm-" + std::to_string(j));
+		comms.push_back(tinfo->m_comm);
+	}
+	lookup.join();
+
+	EXPECT_EQ(manager->get_interned_count(), count + iterations);
+	comms.clear();
+	tinfo.reset();
+	EXPECT_EQ(manager->get_interned_count(), count);
+
+	auto ctinfo = container.get_tinfo(&inspector);
+	auto comm = manager->intern(std::string("container:0123456789ab"));
+	EXPECT_EQ(ctinfo->get_comm(), *comm);
+	EXPECT_NE(&ctinfo->get_comm(), &comm.get());
+	EXPECT_EQ(manager->get_interned_count(), count + 1);
+}
+
+//
+// The threads of the same process share its strings: the table holds one
+// copy of each, whatever the number of threads. The memory this saves is
+// measured by examples/interned_rss_bench.cpp.
+//
+TEST(interned, thread_table)
+{
+	const uint32_t nprocs = 4;
+	const uint32_t nthreads = 8;
+
+	sinsp inspector;
+	sinsp_thread_manager* manager = inspector.m_thread_manager;
+	size_t count = manager->get_interned_count();
+
+	for(uint32_t p = 0; p < nprocs; p++)
+	{
+		std::string id = std::to_string(p);
+		std::vector<std::string> args = {"-Dservice.instance=" + id, "-jar", long_string};
+		std::vector<std::string> env = {"HOSTNAME=app-" + id, long_string};
+		sinsp_threadinfo::cgroups_t cgroups = {{"cpu", "/pod" + id}, {"memory", "/pod" + id}};
+
+		for(uint32_t t = 0; t < nthreads; t++)
+		{
+			auto tinfo = inspector.build_threadinfo();
+			tinfo->m_tid = 1000000 + p * nthreads + t;
+			tinfo->m_pid = 1000000 + p * nthreads;
+			tinfo->set_comm("java");
+			tinfo->set_exe(long_string);
+			tinfo->set_args(args);
+			tinfo->m_env = manager->intern(env);
+			tinfo->m_cgroups = manager->intern(cgroups);
+			inspector.add_thread(tinfo);
+		}
+	}
+
+	EXPECT_EQ(manager->get_thread_count(), nprocs * nthreads);
+
+	// comm and exe for all, args, env and cgroups per process
+	EXPECT_EQ(manager->get_interned_count(), count + 2 + 3 * nprocs);
+
+	// the values of a process leave the table with its last thread
+	for(uint32_t t = 0; t < nthreads; t++)
+	{
+		manager->remove_thread(1000000 + t, true);
+	}
+	EXPECT_EQ(manager->get_thread_count(), (nprocs - 1) * nthreads);
+	EXPECT_EQ(manager->get_interned_count(), count + 2 + 3 * (nprocs - 1));
+}
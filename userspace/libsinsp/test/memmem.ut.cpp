@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <sinsp.h>
+#include <filterchecks.h>
+#include <memmem.h>
+#include <gtest/gtest.h>
+
+static const char* naive_memmem(const char* h, size_t hlen, const char* n, size_t nlen, bool icase)
+{
+	for(size_t j = 0; j + nlen <= hlen; j++)
+	{
+		size_t k = 0;
+		while(k < nlen && (icase ? tolower(h[j + k]) == tolower(n[k]) : h[j + k] == n[k]))
+		{
+			k++;
+		}
+		if(k == nlen)
+		{
+			return h + j;
+		}
+	}
+	return NULL;
+}
+
+TEST(memmem, same_as_naive)
+{
+	// a small alphabet to have many partial matches, and haystacks long
+	// enough to go through the vector and the scalar code
+	const char alphabet[] = "aAbB\0";
+	uint32_t seed = 1;
+	auto rnd = [&seed]()
+	{
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) & 0x7fff;
+	};
+
+	ASSERT_NE(std::string(sinsp_memmem_impl()), "");
+	for(uint32_t iter = 0; iter < 20000; iter++)
+	{
+		std::string h(rnd() % 100, 0);
+		std::string n(rnd() % 6, 0);
+		for(auto& c : h)
+		{
+			c = alphabet[rnd() % 5];
+		}
+		for(auto& c : n)
+		{
+			c = alphabet[rnd() % 5];
+		}
+
+		EXPECT_EQ(sinsp_memmem(h.data(), h.size(), n.data(), n.size()),
+			naive_memmem(h.data(), h.size(), n.data(), n.size(), false));
+		EXPECT_EQ(sinsp_memimem(h.data(), h.size(), n.data(), n.size()),
+			naive_memmem(h.data(), h.size(), n.data(), n.size(), true));
+	}
+}
+
+TEST(memmem, matches_at_the_edges)
+{
+	std::string h(200, 'x');
+	h.replace(0, 3, "abc");
+	h.replace(h.size() - 3, 3, "def");
+
+	EXPECT_EQ(sinsp_memmem(h.data(), h.size(), "abc", 3), h.data());
+	EXPECT_EQ(sinsp_memmem(h.data(), h.size(), "def", 3), h.data() + h.size() - 3);
+	EXPECT_EQ(sinsp_memimem(h.data(), h.size(), "DeF", 3), h.data() + h.size() - 3);
+	EXPECT_EQ(sinsp_memmem(h.data(), h.size() - 1, "def", 3), nullptr);
+	EXPECT_EQ(sinsp_memmem(h.data(), h.size(), "", 0), h.data());
+	EXPECT_EQ(sinsp_memmem(h.data(), 2, "abc", 3), nullptr);
+}
+
+TEST(memmem, flt_compare_string_lengths)
+{
+	char str[] = "/usr/bin/bash";
+	char value[] = "bash";
+	uint32_t len = (uint32_t)strlen(str);
+
+	// the extracted length can be unset, exact, or count the terminator
+	for(uint32_t l : {0u, len, len + 1})
+	{
+		EXPECT_TRUE(flt_compare(CO_CONTAINS, PT_CHARBUF, str, value, l, 4));
+		EXPECT_TRUE(flt_compare(CO_ICONTAINS, PT_CHARBUF, str, (void*)"BASH", l, 0));
+		EXPECT_TRUE(flt_compare(CO_ENDSWITH, PT_CHARBUF, str, value, l, 0));
+		EXPECT_FALSE(flt_compare(CO_STARTSWITH, PT_CHARBUF, str, value, l, 4));
+		EXPECT_TRUE(flt_compare(CO_STARTSWITH, PT_CHARBUF, str, (void*)"/usr", l, 0));
+		EXPECT_TRUE(flt_compare(CO_EQ, PT_FSPATH, str, (void*)"/usr/bin/bash", l, 0));
+		EXPECT_FALSE(flt_compare(CO_EQ, PT_CHARBUF, str, (void*)"/usr/bin/bas", l, 0));
+		EXPECT_TRUE(flt_compare(CO_NE, PT_CHARBUF, str, (void*)"/usr/bin/bashh", l, 0));
+	}
+}
@@ -0,0 +1,127 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <string>
+
+#include <sinsp.h>
+#include <gtest/gtest.h>
+
+#include "object_pool.h"
+
+static const std::string long_string(100, 'x');
+
+TEST(object_pool, reuse)
+{
+	uint32_t nresets = 0;
+	object_pool<std::string> pool(2, [&](std::string& s) { s.clear(); nresets++; });
+	auto build = []() { return new std::string(); };
+
+	auto a = pool.get(build);
+	auto b = pool.get(build);
+	auto c = pool.get(build);
+	*a = long_string;
+	std::string* ptr = a.get();
+	EXPECT_EQ(pool.get_stats().m_n_allocs, 3);
+	EXPECT_EQ(pool.get_stats().m_n_free, 0);
+
+	a.reset();
+	EXPECT_EQ(nresets, 1);
+	EXPECT_EQ(pool.get_stats().m_n_free, 1);
+
+	// The object comes back reset, with the capacity of its string
+	a = pool.get(build);
+	EXPECT_EQ(a.get(), ptr);
+	EXPECT_TRUE(a->empty());
+	EXPECT_GE(a->capacity(), long_string.size());
+	EXPECT_EQ(pool.get_stats().m_n_reuses, 1);
+
+	// Only 2 objects are kept
+	a.reset();
+	b.reset();
+	c.reset();
+	EXPECT_EQ(nresets, 3);
+	EXPECT_EQ(pool.get_stats().m_n_free, 2);
+	EXPECT_EQ(pool.get_stats().m_n_frees, 1);
+}
+
+TEST(object_pool, outlives_pool)
+{
+	object_pool<std::string>::ptr_t s;
+	std::weak_ptr<std::string> w;
+	{
+		object_pool<std::string> pool(16, [](std::string& s) { s.clear(); });
+		s = pool.get([]() { return new std::string(long_string); });
+		w = s;
+	}
+
+	EXPECT_EQ(*s, long_string);
+	s.reset();
+	EXPECT_TRUE(w.expired());
+}
+
+TEST(object_pool, fdinfo)
+{
+	sinsp inspector;
+	sinsp_thread_manager* manager = inspector.m_thread_manager;
+	sinsp_fdtable table(&inspector);
+
+	// The fds past the ones stored by number in the table
+	sinsp_fdinfo_t fdinfo;
+	fdinfo.m_name = long_string;
+	table.add(5000, &fdinfo);
+	table.add(6000, &fdinfo);
+	table.erase(5000);
+	EXPECT_EQ(manager->get_fdinfo_pool_stats().m_n_allocs, 2);
+	EXPECT_EQ(manager->get_fdinfo_pool_stats().m_n_free, 1);
+
+	// A fd added after the close reuses its fdinfo
+	fdinfo.m_name = "/tmp/other";
+	table.add(7000, &fdinfo);
+	EXPECT_EQ(manager->get_fdinfo_pool_stats().m_n_reuses, 1);
+	EXPECT_EQ(manager->get_fdinfo_pool_stats().m_n_free, 0);
+	EXPECT_EQ(table.find(7000)->m_name, "/tmp/other");
+	EXPECT_EQ(table.find(6000)->m_name, long_string);
+	EXPECT_EQ(table.find(5000), nullptr);
+
+	table.clear();
+	EXPECT_EQ(manager->get_fdinfo_pool_stats().m_n_free, 2);
+}
+
+TEST(object_pool, threadinfo)
+{
+	sinsp inspector;
+	sinsp_thread_manager* manager = inspector.m_thread_manager;
+	object_pool_stats before = manager->get_threadinfo_pool_stats();
+
+	auto tinfo = inspector.build_threadinfo();
+	sinsp_threadinfo* ptr = tinfo.get();
+	tinfo->m_tid = 1;
+	tinfo->m_pid = 1;
+	tinfo->set_comm(long_string);
+	tinfo->set_args({long_string});
+
+	tinfo.reset();
+	EXPECT_EQ(manager->get_threadinfo_pool_stats().m_n_free, before.m_n_free + 1);
+
+	// The thread comes back as a new one
+	tinfo = inspector.build_threadinfo();
+	EXPECT_EQ(tinfo.get(), ptr);
+	EXPECT_EQ(manager->get_threadinfo_pool_stats().m_n_reuses, before.m_n_reuses + 1);
+	EXPECT_TRUE(tinfo->get_comm().empty());
+	EXPECT_TRUE(tinfo->get_args().empty());
+	EXPECT_EQ(tinfo->m_pid, -1);
+}
@@ -0,0 +1,88 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "pending_queue.h"
+
+using namespace libsinsp;
+
+TEST(pending_queue, fifo)
+{
+	pending_queue<int> q;
+	int v;
+
+	EXPECT_TRUE(q.empty());
+	EXPECT_FALSE(q.try_pop(v));
+
+	q.push(1);
+	q.push(2);
+	EXPECT_FALSE(q.empty());
+
+	ASSERT_TRUE(q.try_pop(v));
+	EXPECT_EQ(v, 1);
+	ASSERT_TRUE(q.try_pop(v));
+	EXPECT_EQ(v, 2);
+
+	EXPECT_TRUE(q.empty());
+	EXPECT_FALSE(q.try_pop(v));
+}
+
+TEST(pending_queue, multiple_producers)
+{
+	const int nproducers = 4;
+	const int per_producer = 10000;
+	pending_queue<int> q;
+	std::vector<std::thread> producers;
+
+	for(int p = 0; p < nproducers; p++)
+	{
+		producers.emplace_back([&q, p, per_producer]() {
+			for(int j = 0; j < per_producer; j++)
+			{
+				q.push(p * per_producer + j);
+			}
+		});
+	}
+
+	// every element is popped exactly once, and the elements of each
+	// producer come out in the order they were pushed
+	std::vector<int> last(nproducers, -1);
+	int npopped = 0;
+	while(npopped < nproducers * per_producer)
+	{
+		int v;
+		if(q.try_pop(v))
+		{
+			int p = v / per_producer;
+			EXPECT_GT(v, last[p]);
+			last[p] = v;
+			npopped++;
+		}
+	}
+
+	for(auto& t : producers)
+	{
+		t.join();
+	}
+
+	int v;
+	EXPECT_FALSE(q.try_pop(v));
+	EXPECT_TRUE(q.empty());
+}
@@ -0,0 +1,122 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "sinsp_with_test_input.h"
+
+TEST_F(sinsp_with_test_input, thread_purge_incremental)
+{
+	const uint32_t nthreads = 1000;
+	const uint32_t max_checks = 10;
+
+	add_default_init_thread();
+	m_inspector.set_thread_timeout_s(1);
+	m_inspector.set_thread_purge_interval_s(1);
+	m_inspector.m_thread_manager->set_max_inactive_thread_checks(max_checks);
+	open_inspector();
+	sinsp_thread_manager* manager = m_inspector.m_thread_manager;
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+
+	// Threads that exit without the inspector seeing it
+	uint64_t start_ts = m_test_timestamp;
+	for(uint32_t j = 0; j < nthreads; j++)
+	{
+		auto tinfo = m_inspector.build_threadinfo();
+		tinfo->m_tid = 1000000 + j;
+		tinfo->m_pid = tinfo->m_tid;
+		tinfo->set_comm("sleeper");
+		tinfo->m_lastaccess_ts = start_ts;
+		m_inspector.add_thread(tinfo);
+	}
+	ASSERT_EQ(manager->get_thread_count(), nthreads + 1);
+
+	// Nothing is removed before the threads time out
+	while(m_test_timestamp < start_ts + ONE_SECOND_IN_NS)
+	{
+		add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	}
+	ASSERT_EQ(manager->get_thread_count(), nthreads + 1);
+
+	// Then they are removed a few per event, except the one running
+	uint32_t nevents = 0;
+	uint32_t count = manager->get_thread_count();
+	while(count > 1 && nevents < 10000)
+	{
+		add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+		uint32_t new_count = manager->get_thread_count();
+		ASSERT_LE(count - new_count, max_checks);
+		count = new_count;
+		nevents++;
+	}
+
+	EXPECT_EQ(count, 1);
+	EXPECT_GE(nevents, nthreads / max_checks);
+	EXPECT_NE(m_inspector.get_thread_ref(1, false, true), nullptr);
+}
+
+TEST_F(sinsp_with_test_input, thread_purge_alive_and_closed)
+{
+	add_default_init_thread();
+	m_inspector.set_thread_timeout_s(1);
+	m_inspector.set_thread_purge_interval_s(1);
+	open_inspector();
+	add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+
+	// This process, that doesn't generate events but is alive
+	std::ifstream comm_file("/proc/self/comm");
+	std::string comm;
+	std::getline(comm_file, comm);
+	auto tinfo = m_inspector.build_threadinfo();
+	tinfo->m_tid = getpid();
+	tinfo->m_pid = getpid();
+	tinfo->set_comm(comm);
+	tinfo->m_lastaccess_ts = m_test_timestamp;
+	m_inspector.add_thread(tinfo);
+
+	uint64_t start_ts = m_test_timestamp;
+	while(m_test_timestamp < start_ts + 4 * ONE_SECOND_IN_NS)
+	{
+		add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	}
+	EXPECT_EQ(m_inspector.get_thread_ref(getpid(), false, true).get(), tinfo.get());
+
+	// Once closed, it is removed at its next check
+	tinfo->m_flags |= PPM_CL_CLOSED;
+	while(m_test_timestamp < start_ts + 8 * ONE_SECOND_IN_NS)
+	{
+		add_event_advance_ts(increasing_ts(), 1, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	}
+	EXPECT_EQ(m_inspector.get_thread_ref(getpid(), false, true), nullptr);
+}
+
+TEST_F(sinsp_with_test_input, thread_purge_not_at_first_event)
+{
+	// A thread imported before the capture, that doesn't exist
+	add_default_init_thread();
+	add_thread(create_threadinfo(1000000, 1000000, 1, 1000000, 10, 10, "sleeper", "/bin/sleeper", "/bin/sleeper", 0, 0, 0), {});
+	open_inspector();
+
+	add_event_advance_ts(increasing_ts(), 1000000, PPME_SYSCALL_OPEN_E, 3, "/tmp/the_file", PPM_O_RDWR, 0);
+	auto tinfo = m_inspector.get_thread_ref(1000000, false, true);
+	ASSERT_NE(tinfo, nullptr);
+	EXPECT_EQ(tinfo->get_comm(), "sleeper");
+}
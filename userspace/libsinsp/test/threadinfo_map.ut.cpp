@@ -0,0 +1,125 @@
+/*
+Copyright (C) 2022 The Falco Authors.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+*/
+
+#include <map>
+#include <random>
+
+#include <sinsp.h>
+#include <gtest/gtest.h>
+
+static threadinfo_map_t::ptr_t new_thread(int64_t tid)
+{
+	auto tinfo = std::make_shared<sinsp_threadinfo>(nullptr);
+	tinfo->m_tid = tid;
+	return tinfo;
+}
+
+TEST(threadinfo_map, put_get_erase)
+{
+	threadinfo_map_t m;
+
+	EXPECT_EQ(m.size(), 0);
+	EXPECT_EQ(m.get(1), nullptr);
+	m.erase(1);
+
+	auto t1 = new_thread(1);
+	m.put(t1);
+	EXPECT_EQ(m.size(), 1);
+	EXPECT_EQ(m.get(1), t1.get());
+	EXPECT_EQ(m.get_ref(1), t1);
+	EXPECT_EQ(m.get(2), nullptr);
+	EXPECT_EQ(m.get_ref(2), nullptr);
+
+	// A thread with the same tid replaces the previous one
+	auto t1b = new_thread(1);
+	m.put(t1b);
+	EXPECT_EQ(m.size(), 1);
+	EXPECT_EQ(m.get(1), t1b.get());
+
+	// The tid is the one of the thread when it's added
+	t1b->m_tid = 5;
+	EXPECT_EQ(m.get(1), t1b.get());
+	EXPECT_EQ(m.get(5), nullptr);
+
+	m.put(new_thread(-1));
+	EXPECT_NE(m.get(-1), nullptr);
+	EXPECT_EQ(m.size(), 2);
+
+	m.erase(1);
+	EXPECT_EQ(m.get(1), nullptr);
+	EXPECT_EQ(m.size(), 1);
+
+	m.clear();
+	EXPECT_EQ(m.size(), 0);
+	EXPECT_EQ(m.get(-1), nullptr);
+	m.put(new_thread(3));
+	EXPECT_EQ(m.get(3)->m_tid, 3);
+}
+
+TEST(threadinfo_map, same_as_map)
+{
+	std::mt19937 rng(42);
+	threadinfo_map_t m;
+	std::map<int64_t, threadinfo_map_t::ptr_t> ref;
+
+	// Consecutive tids, as the kernel allocates them, and random ones
+	for(uint32_t j = 0; j < 200000; j++)
+	{
+		int64_t tid = (rng() % 2) ? (int64_t)(rng() % 5000) : (int64_t)rng();
+		switch(rng() % 4)
+		{
+		case 0:
+		case 1:
+		{
+			auto tinfo = new_thread(tid);
+			m.put(tinfo);
+			ref[tid] = tinfo;
+			break;
+		}
+		case 2:
+			m.erase(tid);
+			ref.erase(tid);
+			break;
+		default:
+		{
+			auto it = ref.find(tid);
+			ASSERT_EQ(m.get(tid), it == ref.end() ? nullptr : it->second.get());
+			break;
+		}
+		}
+		ASSERT_EQ(m.size(), ref.size());
+	}
+
+	for(auto& it : ref)
+	{
+		ASSERT_EQ(m.get(it.first), it.second.get());
+	}
+
+	size_t n = 0;
+	EXPECT_TRUE(m.loop([&](sinsp_threadinfo& tinfo) {
+		EXPECT_EQ(ref[tinfo.m_tid].get(), &tinfo);
+		n++;
+		return true;
+	}));
+	EXPECT_EQ(n, ref.size());
+
+	n = 0;
+	EXPECT_FALSE(m.loop([&](sinsp_threadinfo& tinfo) {
+		return ++n < 3;
+	}));
+	EXPECT_EQ(n, 3);
+}
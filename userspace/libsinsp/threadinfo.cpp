@@ -32,6 +32,8 @@ limitations under the License.
 
 extern sinsp_evttables g_infotables;
 
+thread_local bool g_state_read_only = false;
+
 static void copy_ipv6_address(uint32_t* dest, uint32_t* src)
 {
 	dest[0] = src[0];
@@ -40,11 +42,24 @@ static void copy_ipv6_address(uint32_t* dest, uint32_t* src)
 	dest[3] = src[3];
 }
 
+//
+// Share the value with the other threads of the inspector, or keep a copy
+// of it for the threads built without one
+//
+template<typename T>
+static inline interned<T> intern_value(sinsp* inspector, T value)
+{
+	if(inspector == NULL || inspector->m_thread_manager == NULL)
+	{
+		return interned<T>(std::move(value));
+	}
+	return inspector->m_thread_manager->intern(std::move(value));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // sinsp_threadinfo implementation
 ///////////////////////////////////////////////////////////////////////////////
 sinsp_threadinfo::sinsp_threadinfo(sinsp* inspector) :
-	m_cgroups(new cgroups_t),
 	m_tracer_parser(NULL),
 	m_inspector(inspector),
 	m_fdtable(inspector)
@@ -63,6 +78,7 @@ void sinsp_threadinfo::init()
 	m_lastevent_ts = 0;
 	m_prevevent_ts = 0;
 	m_lastaccess_ts = 0;
+	m_inactive_check_ts = 0;
 	m_clone_ts = 0;
 	m_lastevent_category.m_category = EC_UNKNOWN;
 	m_flags = PPM_CL_NAME_CHANGED;
@@ -95,6 +111,39 @@ void sinsp_threadinfo::init()
 	memset(&m_loginuser, 0, sizeof(scap_userinfo));
 }
 
+void sinsp_threadinfo::reset()
+{
+	for(void* state : m_private_state)
+	{
+		free(state);
+	}
+	m_private_state.clear();
+
+	free(m_lastevent_data);
+	delete m_tracer_parser;
+	m_tracer_parser = NULL;
+	m_exec_enter_tid.reset();
+
+	//
+	// Clearing the strings keeps their capacity, for the next thread built
+	// from this one, and the interned ones are released to the table
+	//
+	m_comm = interned<std::string>();
+	m_exe = interned<std::string>();
+	m_exepath = interned<std::string>();
+	m_exe_writable = false;
+	m_args = interned<std::vector<std::string>>();
+	m_env = interned<std::vector<std::string>>();
+	m_cgroups = interned<cgroups_t>();
+	m_container_id.clear();
+	m_root.clear();
+	m_cwd.clear();
+	m_fdtable.clear();
+	m_fdtable.reset_cache();
+
+	init();
+}
+
 sinsp_threadinfo::~sinsp_threadinfo()
 {
 	uint32_t j;
@@ -118,36 +167,34 @@ sinsp_threadinfo::~sinsp_threadinfo()
 
 void sinsp_threadinfo::fix_sockets_coming_from_proc()
 {
-	unordered_map<int64_t, sinsp_fdinfo_t>::iterator it;
-
-	for(it = m_fdtable.m_table.begin(); it != m_fdtable.m_table.end(); it++)
-	{
-		if(it->second.m_type == SCAP_FD_IPV4_SOCK)
+	m_fdtable.loop([&] (int64_t fd, sinsp_fdinfo_t& fdinfo) {
+		if(fdinfo.m_type == SCAP_FD_IPV4_SOCK)
 		{
-			if(m_inspector->m_thread_manager->m_server_ports.find(it->second.m_sockinfo.m_ipv4info.m_fields.m_sport) !=
+			if(m_inspector->m_thread_manager->m_server_ports.find(fdinfo.m_sockinfo.m_ipv4info.m_fields.m_sport) !=
 				m_inspector->m_thread_manager->m_server_ports.end())
 			{
 				uint32_t tip;
 				uint16_t tport;
 
-				tip = it->second.m_sockinfo.m_ipv4info.m_fields.m_sip;
-				tport = it->second.m_sockinfo.m_ipv4info.m_fields.m_sport;
+				tip = fdinfo.m_sockinfo.m_ipv4info.m_fields.m_sip;
+				tport = fdinfo.m_sockinfo.m_ipv4info.m_fields.m_sport;
 
-				it->second.m_sockinfo.m_ipv4info.m_fields.m_sip = it->second.m_sockinfo.m_ipv4info.m_fields.m_dip;
-				it->second.m_sockinfo.m_ipv4info.m_fields.m_dip = tip;
-				it->second.m_sockinfo.m_ipv4info.m_fields.m_sport = it->second.m_sockinfo.m_ipv4info.m_fields.m_dport;
-				it->second.m_sockinfo.m_ipv4info.m_fields.m_dport = tport;
+				fdinfo.m_sockinfo.m_ipv4info.m_fields.m_sip = fdinfo.m_sockinfo.m_ipv4info.m_fields.m_dip;
+				fdinfo.m_sockinfo.m_ipv4info.m_fields.m_dip = tip;
+				fdinfo.m_sockinfo.m_ipv4info.m_fields.m_sport = fdinfo.m_sockinfo.m_ipv4info.m_fields.m_dport;
+				fdinfo.m_sockinfo.m_ipv4info.m_fields.m_dport = tport;
 
-				it->second.m_name = ipv4tuple_to_string(&it->second.m_sockinfo.m_ipv4info, m_inspector->m_hostname_and_port_resolution_enabled);
+				fdinfo.m_name = ipv4tuple_to_string(&fdinfo.m_sockinfo.m_ipv4info, m_inspector->m_hostname_and_port_resolution_enabled);
 
-				it->second.set_role_server();
+				fdinfo.set_role_server();
 			}
 			else
 			{
-				it->second.set_role_client();
+				fdinfo.set_role_client();
 			}
 		}
-	}
+		return true;
+	});
 }
 
 #define STR_AS_NUM_JAVA 0x6176616a
@@ -159,9 +206,10 @@ void sinsp_threadinfo::fix_sockets_coming_from_proc()
 
 void sinsp_threadinfo::compute_program_hash()
 {
-	auto curr_hash = std::hash<std::string>()(m_exe);
+	const string& exe = m_exe.get();
+	auto curr_hash = std::hash<std::string>()(exe);
 	hash_combine(curr_hash, m_container_id);
-	auto rem_len = MAX_PROG_HASH_LEN - (m_exe.size() + m_container_id.size());
+	auto rem_len = MAX_PROG_HASH_LEN - (exe.size() + m_container_id.size());
 
 	//
 	// By default, the scripts hash is just exe+container
@@ -171,7 +219,7 @@ void sinsp_threadinfo::compute_program_hash()
 	//
 	// The program hash includes the arguments as well
 	//
-	for (auto arg = m_args.begin(); arg != m_args.end() && rem_len > 0; ++arg)
+	for (auto arg = m_args->begin(); arg != m_args->end() && rem_len > 0; ++arg)
 	{
 		if (arg->size() >= rem_len)
 		{
@@ -189,9 +237,10 @@ void sinsp_threadinfo::compute_program_hash()
 	// For some specific processes (essentially the scripting languages)
 	// we include the arguments in the scripts hash as well
 	//
-	if(m_comm.size() == 4)
+	const string& comm = m_comm.get();
+	if(comm.size() == 4)
 	{
-		uint32_t ncomm = *(uint32_t*)m_comm.c_str();
+		uint32_t ncomm = *(uint32_t*)comm.c_str();
 
 		if(ncomm == STR_AS_NUM_JAVA || ncomm == STR_AS_NUM_RUBY ||
 			ncomm == STR_AS_NUM_PERL || ncomm == STR_AS_NUM_NODE)
@@ -199,9 +248,9 @@ void sinsp_threadinfo::compute_program_hash()
 			m_program_hash_scripts = m_program_hash;
 		}
 	}
-	else if(m_comm.size() >= 6)
+	else if(comm.size() >= 6)
 	{
-		if(m_comm.substr(0, 6) == "python")
+		if(comm.compare(0, 6, "python") == 0)
 		{
 			m_program_hash_scripts = m_program_hash;
 		}
@@ -393,9 +442,9 @@ void sinsp_threadinfo::init(scap_threadinfo* pi)
 	m_sid = pi->sid;
 	m_vpgid = pi->vpgid;
 
-	m_comm = pi->comm;
-	m_exe = pi->exe;
-	m_exepath = pi->exepath;
+	set_comm(pi->comm);
+	set_exe(pi->exe);
+	set_exepath(pi->exepath);
 	m_exe_writable = pi->exe_writable;
 
 	set_args(pi->args, pi->args_len);
@@ -565,27 +614,43 @@ void sinsp_threadinfo::set_loginuser(uint32_t loginuid)
 	}
 }
 
-sinsp_threadinfo::cgroups_t& sinsp_threadinfo::cgroups() const
+const sinsp_threadinfo::cgroups_t& sinsp_threadinfo::cgroups() const
 {
-	if(m_cgroups)
-	{
-		return *m_cgroups;
-	}
+	return m_cgroups.get();
+}
 
-	static cgroups_t empty;
-	return empty;
+void sinsp_threadinfo::set_comm(string comm)
+{
+	m_comm = intern_value(m_inspector, std::move(comm));
+}
+
+void sinsp_threadinfo::set_exe(string exe)
+{
+	m_exe = intern_value(m_inspector, std::move(exe));
+}
+
+void sinsp_threadinfo::set_exepath(string exepath)
+{
+	m_exepath = intern_value(m_inspector, std::move(exepath));
 }
 
 void sinsp_threadinfo::set_args(const char* args, size_t len)
 {
-	m_args.clear();
+	vector<string> tmp_args;
 
 	size_t offset = 0;
 	while(offset < len)
 	{
-		m_args.push_back(args + offset);
-		offset += m_args.back().length() + 1;
+		tmp_args.push_back(args + offset);
+		offset += tmp_args.back().length() + 1;
 	}
+
+	set_args(std::move(tmp_args));
+}
+
+void sinsp_threadinfo::set_args(vector<string> args)
+{
+	m_args = intern_value(m_inspector, std::move(args));
 }
 
 void sinsp_threadinfo::set_env(const char* env, size_t len)
@@ -596,14 +661,14 @@ void sinsp_threadinfo::set_env(const char* env, size_t len)
 		// this may fail for short-lived processes
 		if (set_env_from_proc())
 		{
-			g_logger.format(sinsp_logger::SEV_DEBUG, "Large environment for process %lu [%s], loaded from /proc", m_pid, m_comm.c_str());
+			g_logger.format(sinsp_logger::SEV_DEBUG, "Large environment for process %lu [%s], loaded from /proc", m_pid, m_comm->c_str());
 			return;
 		} else {
-			g_logger.format(sinsp_logger::SEV_INFO, "Failed to load environment for process %lu [%s] from /proc, using first %d bytes", m_pid, m_comm.c_str(), SCAP_MAX_ENV_SIZE);
+			g_logger.format(sinsp_logger::SEV_INFO, "Failed to load environment for process %lu [%s] from /proc, using first %d bytes", m_pid, m_comm->c_str(), SCAP_MAX_ENV_SIZE);
 		}
 	}
 
-	m_env.clear();
+	vector<string> tmp_env;
 	size_t offset = 0;
 	while(offset < len)
 	{
@@ -617,14 +682,16 @@ void sinsp_threadinfo::set_env(const char* env, size_t len)
 			if(!memcmp(left, zero, sz))
 			{
 				free(zero);
-				return;
+				break;
 			}
 			free(zero);
 		}
-		m_env.push_back(left);
+		tmp_env.push_back(left);
 
-		offset += m_env.back().length() + 1;
+		offset += tmp_env.back().length() + 1;
 	}
+
+	m_env = intern_value(m_inspector, std::move(tmp_env));
 }
 
 bool sinsp_threadinfo::set_env_from_proc() {
@@ -637,16 +704,17 @@ bool sinsp_threadinfo::set_env_from_proc() {
 		return false;
 	}
 
-	m_env.clear();
+	vector<string> tmp_env;
 	while (environment) {
 		string env;
 		getline(environment, env, '\0');
 		if (!env.empty())
 		{
-			m_env.emplace_back(env);
+			tmp_env.emplace_back(env);
 		}
 	}
 
+	m_env = intern_value(m_inspector, std::move(tmp_env));
 	return true;
 }
 
@@ -654,7 +722,7 @@ const vector<string>& sinsp_threadinfo::get_env()
 {
 	if(is_main_thread())
 	{
-		return m_env;
+		return m_env.get();
 	}
 	else
 	{
@@ -668,7 +736,7 @@ const vector<string>& sinsp_threadinfo::get_env()
 			// it should never happen but provide a safe fallback just in case
 			// except during sinsp::scap_open() (see sinsp::get_thread()).
 			ASSERT(false);
-			return m_env;
+			return m_env.get();
 		}
 	}
 }
@@ -697,7 +765,7 @@ string sinsp_threadinfo::get_env(const string& name)
 
 void sinsp_threadinfo::set_cgroups(const char* cgroups, size_t len)
 {
-	decltype(m_cgroups) tmp_cgroups(new cgroups_t);
+	cgroups_t tmp_cgroups;
 
 	size_t offset = 0;
 	while(offset < len)
@@ -738,11 +806,11 @@ void sinsp_threadinfo::set_cgroups(const char* cgroups, size_t len)
 
 		offset += subsys_length + 1 + cgroup.length() + 1;
 		if (subsys == "perf_event" || subsys == "cpu" || subsys == "cpuset" || subsys == "memory") {
-			tmp_cgroups->emplace_back(std::move(subsys), std::move(cgroup));
+			tmp_cgroups.emplace_back(std::move(subsys), std::move(cgroup));
 		}
 	}
 
-	m_cgroups.swap(tmp_cgroups);
+	m_cgroups = intern_value(m_inspector, std::move(tmp_cgroups));
 }
 
 sinsp_threadinfo* sinsp_threadinfo::get_parent_thread()
@@ -769,50 +837,43 @@ void sinsp_threadinfo::remove_fd(int64_t fd)
 
 bool sinsp_threadinfo::is_bound_to_port(uint16_t number)
 {
-	unordered_map<int64_t, sinsp_fdinfo_t>::iterator it;
-
 	sinsp_fdtable* fdt = get_fd_table();
 
-	for(it = fdt->m_table.begin(); it != fdt->m_table.end(); ++it)
-	{
-		if(it->second.m_type == SCAP_FD_IPV4_SOCK)
+	// The loop stops at the first fd using the port
+	return !fdt->loop([&] (int64_t fd, sinsp_fdinfo_t& fdinfo) {
+		if(fdinfo.m_type == SCAP_FD_IPV4_SOCK)
 		{
-			if(it->second.m_sockinfo.m_ipv4info.m_fields.m_dport == number)
+			if(fdinfo.m_sockinfo.m_ipv4info.m_fields.m_dport == number)
 			{
-				return true;
+				return false;
 			}
 		}
-		else if(it->second.m_type == SCAP_FD_IPV4_SERVSOCK)
+		else if(fdinfo.m_type == SCAP_FD_IPV4_SERVSOCK)
 		{
-			if(it->second.m_sockinfo.m_ipv4serverinfo.m_port == number)
+			if(fdinfo.m_sockinfo.m_ipv4serverinfo.m_port == number)
 			{
-				return true;
+				return false;
 			}
 		}
-	}
-
-	return false;
+		return true;
+	});
 }
 
 bool sinsp_threadinfo::uses_client_port(uint16_t number)
 {
-	unordered_map<int64_t, sinsp_fdinfo_t>::iterator it;
-
 	sinsp_fdtable* fdt = get_fd_table();
 
-	for(it = fdt->m_table.begin();
-		it != fdt->m_table.end(); ++it)
-	{
-		if(it->second.m_type == SCAP_FD_IPV4_SOCK)
+	// The loop stops at the first fd using the port
+	return !fdt->loop([&] (int64_t fd, sinsp_fdinfo_t& fdinfo) {
+		if(fdinfo.m_type == SCAP_FD_IPV4_SOCK)
 		{
-			if(it->second.m_sockinfo.m_ipv4info.m_fields.m_sport == number)
+			if(fdinfo.m_sockinfo.m_ipv4info.m_fields.m_sport == number)
 			{
-				return true;
+				return false;
 			}
 		}
-	}
-
-	return false;
+		return true;
+	});
 }
 
 bool sinsp_threadinfo::is_lastevent_data_valid()
@@ -1056,7 +1117,7 @@ void sinsp_threadinfo::populate_cmdline(string &cmdline, const sinsp_threadinfo
 {
 	cmdline = tinfo->get_comm();
 
-	for (const auto& arg : tinfo->m_args)
+	for (const auto& arg : tinfo->get_args())
 	{
 		cmdline += " ";
 		cmdline += arg;
@@ -1124,12 +1185,12 @@ shared_ptr<sinsp_threadinfo> sinsp_threadinfo::lookup_thread() const
 
 size_t sinsp_threadinfo::args_len() const
 {
-	return strvec_len(m_args);
+	return strvec_len(m_args.get());
 }
 
 size_t sinsp_threadinfo::env_len() const
 {
-	return strvec_len(m_env);
+	return strvec_len(m_env.get());
 }
 
 size_t sinsp_threadinfo::cgroups_len() const
@@ -1148,7 +1209,7 @@ size_t sinsp_threadinfo::cgroups_len() const
 void sinsp_threadinfo::args_to_iovec(struct iovec **iov, int *iovcnt,
 				     std::string &rem) const
 {
-	return strvec_to_iovec(m_args,
+	return strvec_to_iovec(m_args.get(),
 			       iov, iovcnt,
 			       rem);
 }
@@ -1156,7 +1217,7 @@ void sinsp_threadinfo::args_to_iovec(struct iovec **iov, int *iovcnt,
 void sinsp_threadinfo::env_to_iovec(struct iovec **iov, int *iovcnt,
 				    std::string &rem) const
 {
-	return strvec_to_iovec(m_env,
+	return strvec_to_iovec(m_env.get(),
 			       iov, iovcnt,
 			       rem);
 }
@@ -1196,7 +1257,7 @@ void sinsp_threadinfo::cgroups_to_iovec(struct iovec **iov, int *iovcnt,
 {
 	uint32_t alen = SCAP_MAX_ARGS_SIZE;
 	static const string eq = "=";
-	auto cgroups = this->cgroups();
+	const cgroups_t& cgroups = this->cgroups();
 
 	// We allocate an iovec big enough to hold all the cgroups and
 	// intermediate '=' signs. Based on alen, we might not use all
@@ -1318,18 +1379,31 @@ void sinsp_threadinfo::fd_to_scap(scap_fdinfo *dst, sinsp_fdinfo_t* src)
 // sinsp_thread_manager implementation
 ///////////////////////////////////////////////////////////////////////////////
 sinsp_thread_manager::sinsp_thread_manager(sinsp* inspector)
-	: m_max_thread_table_size(m_thread_table_absolute_max_size)
+	: m_max_thread_table_size(m_thread_table_absolute_max_size),
+	  m_inactive_wheel(s_inactive_wheel_size),
+	  m_threadinfo_pool(m_threadinfo_pool_max_size, [](sinsp_threadinfo& tinfo) { tinfo.reset(); }),
+	  m_fdinfo_pool(m_fdinfo_pool_max_size)
 {
 	m_inspector = inspector;
 	clear();
 }
 
+threadinfo_map_t::ptr_t sinsp_thread_manager::new_threadinfo()
+{
+	return m_threadinfo_pool.get([this]() { return new sinsp_threadinfo(m_inspector); });
+}
+
 void sinsp_thread_manager::clear()
 {
 	m_threadtable.clear();
 	m_last_tid = 0;
 	m_last_tinfo.reset();
-	m_last_flush_time_ns = 0;
+	for(auto& slot : m_inactive_wheel)
+	{
+		slot.clear();
+	}
+	m_inactive_expired.clear();
+	m_inactive_wheel_ts = 0;
 	m_n_drops = 0;
 
 #ifdef GATHER_INTERNAL_STATS
@@ -1396,7 +1470,7 @@ bool sinsp_thread_manager::add_thread(std::shared_ptr<sinsp_threadinfo> threadin
 		if (m_n_drops % m_max_thread_table_size == 0)
 		{
 			g_logger.format(sinsp_logger::SEV_INFO, "Thread table full, dropping tid %lu (pid %lu, comm \"%s\")",
-				threadinfo->m_tid, threadinfo->m_pid, threadinfo->m_comm.c_str());
+				threadinfo->m_tid, threadinfo->m_pid, threadinfo->m_comm->c_str());
 		}
 		m_n_drops++;
 		return false;
@@ -1409,6 +1483,10 @@ bool sinsp_thread_manager::add_thread(std::shared_ptr<sinsp_threadinfo> threadin
 
 	threadinfo->compute_program_hash();
 	threadinfo->allocate_private_state();
+	if(m_inspector->m_automatic_threadtable_purging && !m_inspector->is_capture())
+	{
+		schedule_inactive_check(threadinfo, m_inspector->m_lastevent_ts + m_inspector->m_thread_timeout_ns);
+	}
 	m_threadtable.put(std::move(threadinfo_ref));
 
 	return true;
@@ -1473,27 +1551,24 @@ void sinsp_thread_manager::remove_thread(int64_t tid, bool force)
 		//
 		if((tinfo->m_pid == tinfo->m_tid) || tinfo->m_flags & PPM_CL_IS_MAIN_THREAD)
 		{
-			unordered_map<int64_t, sinsp_fdinfo_t>* fdtable = &(tinfo->get_fd_table()->m_table);
-			unordered_map<int64_t, sinsp_fdinfo_t>::iterator fdit;
-
 			erase_fd_params eparams;
 			eparams.m_remove_from_table = false;
 			eparams.m_tinfo = tinfo;
 			eparams.m_ts = m_inspector->m_lastevent_ts;
 
-			for(fdit = fdtable->begin(); fdit != fdtable->end(); ++fdit)
-			{
-				eparams.m_fd = fdit->first;
+			tinfo->get_fd_table()->loop([&] (int64_t fd, sinsp_fdinfo_t& fdinfo) {
+				eparams.m_fd = fd;
 
 				//
 				// The canceled fd should always be deleted immediately, so if it appears
 				// here it means we have a problem.
 				//
 				ASSERT(eparams.m_fd != CANCELED_FD_NUMBER);
-				eparams.m_fdinfo = &(fdit->second);
+				eparams.m_fdinfo = &fdinfo;
 
 				m_inspector->m_parser->erase_fd(&eparams);
-			}
+				return true;
+			});
 		}
 
 		//
@@ -1521,6 +1596,17 @@ void sinsp_thread_manager::remove_thread(int64_t tid, bool force)
 	}
 }
 
+void sinsp_thread_manager::schedule_inactive_check(sinsp_threadinfo* tinfo, uint64_t ts)
+{
+	//
+	// The checks that are already due go in the next slot to process
+	//
+	uint64_t slot_ts = std::max(ts, m_inactive_wheel_ts);
+
+	tinfo->m_inactive_check_ts = ts;
+	m_inactive_wheel[(slot_ts / ONE_SECOND_IN_NS) % s_inactive_wheel_size].push_back({tinfo->m_tid, ts});
+}
+
 void sinsp_thread_manager::fix_sockets_coming_from_proc()
 {
 	m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
@@ -1591,10 +1677,18 @@ void sinsp_thread_manager::update_statistics()
 	m_inspector->m_stats.m_n_threads = get_thread_count();
 
 	m_inspector->m_stats.m_n_fds = 0;
-	for(threadinfo_map_iterator_t it = m_threadtable.begin(); it != m_threadtable.end(); it++)
-	{
-		m_inspector->m_stats.m_n_fds += it->second.get_fd_table()->size();
-	}
+	m_threadtable.loop([&] (sinsp_threadinfo& tinfo) {
+		m_inspector->m_stats.m_n_fds += tinfo.get_fd_table()->size();
+		return true;
+	});
+
+	object_pool_stats threadinfo_stats = m_threadinfo_pool.get_stats();
+	m_inspector->m_stats.m_n_threadinfo_allocs = threadinfo_stats.m_n_allocs;
+	m_inspector->m_stats.m_n_threadinfo_reuses = threadinfo_stats.m_n_reuses;
+
+	object_pool_stats fdinfo_stats = m_fdinfo_pool.get_stats();
+	m_inspector->m_stats.m_n_fdinfo_allocs = fdinfo_stats.m_n_allocs;
+	m_inspector->m_stats.m_n_fdinfo_reuses = fdinfo_stats.m_n_reuses;
 #endif
 }
 
@@ -1670,9 +1764,9 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 		tinfo.cgroups_to_iovec(&cgroups_iov, &cgroupscnt, cgroupsrem);
 
 		if(scap_write_proclist_entry_bufs(m_inspector->m_h, proclist_dumper, sctinfo, &entrylen,
-						  tinfo.m_comm.c_str(),
-						  tinfo.m_exe.c_str(),
-						  tinfo.m_exepath.c_str(),
+						  tinfo.m_comm->c_str(),
+						  tinfo.m_exe->c_str(),
+						  tinfo.m_exepath->c_str(),
 						  args_iov, argscnt,
 						  envs_iov, envscnt,
 						  (tinfo.m_cwd == "" ? "/" : tinfo.m_cwd.c_str()),
@@ -1720,9 +1814,7 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 			//
 			// Add the FDs
 			//
-			unordered_map<int64_t, sinsp_fdinfo_t>& fdtable = tinfo.get_fd_table()->m_table;
-			for(auto it = fdtable.begin(); it != fdtable.end(); ++it)
-			{
+			tinfo.get_fd_table()->loop([&] (int64_t fd, sinsp_fdinfo_t& fdinfo) {
 				//
 				// Allocate the scap fd info
 				//
@@ -1736,18 +1828,19 @@ void sinsp_thread_manager::dump_threads_to_file(scap_dumper_t* dumper)
 				//
 				// Populate the fd info
 				//
-				scfdinfo->fd = it->first;
-				tinfo.fd_to_scap(scfdinfo, &it->second);
+				scfdinfo->fd = fd;
+				tinfo.fd_to_scap(scfdinfo, &fdinfo);
 
 				//
 				// Add the new fd to the scap table.
 				//
-				if(scap_fd_add(m_inspector->m_h, sctinfo, it->first, scfdinfo) != SCAP_SUCCESS)
+				if(scap_fd_add(m_inspector->m_h, sctinfo, fd, scfdinfo) != SCAP_SUCCESS)
 				{
 					scap_proc_free(m_inspector->m_h, sctinfo);
 					throw sinsp_exception("error calling scap_fd_add in sinsp_thread_manager::to_scap (" + string(scap_getlasterr(m_inspector->m_h)) + ")");
 				}
-			}
+				return true;
+			});
 		}
 
 		//
@@ -1768,7 +1861,7 @@ threadinfo_map_t::ptr_t sinsp_thread_manager::get_thread_ref(int64_t tid, bool q
 {
     auto sinsp_proc = find_thread(tid, lookup_only);
 
-    if(!sinsp_proc && query_os_if_not_found &&
+    if(!sinsp_proc && query_os_if_not_found && !g_state_read_only &&
        (m_threadtable.size() < m_max_thread_table_size
 #if defined(HAS_CAPTURE)
 	|| tid == m_inspector->m_self_pid
@@ -1846,8 +1939,8 @@ threadinfo_map_t::ptr_t sinsp_thread_manager::get_thread_ref(int64_t tid, bool q
             newti->m_tid = tid;
             newti->m_pid = tid;
             newti->m_ptid = -1;
-            newti->m_comm = "<NA>";
-            newti->m_exe = "<NA>";
+            newti->set_comm("<NA>");
+            newti->set_exe("<NA>");
             newti->m_user.uid = 0xffffffff;
             newti->m_group.gid = 0xffffffff;
             newti->m_nchilds = 0;
@@ -1891,7 +1984,10 @@ threadinfo_map_t::ptr_t sinsp_thread_manager::find_thread(int64_t tid, bool look
 #endif
 			// This allows us to avoid performing an actual timestamp lookup
 			// for something that may not need to be precise
-			thr->m_lastaccess_ts = m_inspector->get_lastevent_ts();
+			if(!g_state_read_only)
+			{
+				thr->m_lastaccess_ts = m_inspector->get_lastevent_ts();
+			}
 			return thr;
 		}                                                                                        }
 
@@ -1905,7 +2001,7 @@ threadinfo_map_t::ptr_t sinsp_thread_manager::find_thread(int64_t tid, bool look
 #ifdef GATHER_INTERNAL_STATS
 		m_non_cached_lookups->increment();
 #endif
-		if(!lookup_only)
+		if(!lookup_only && !g_state_read_only)
 		{
 			m_last_tid = tid;
 			m_last_tinfo = thr;
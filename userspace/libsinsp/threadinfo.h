@@ -33,7 +33,10 @@ struct iovec {
 #include <functional>
 #include <memory>
 #include <set>
+#include <vector>
 #include "fdinfo.h"
+#include "interned.h"
+#include "state_access.h"
 #include "internal_metrics.h"
 
 class sinsp_delays_info;
@@ -73,23 +76,37 @@ public:
 	/*!
 	  \brief Return the name of the process containing this thread, e.g. "top".
 	*/
-	inline const std::string& get_comm() const { return m_comm; }
+	inline const std::string& get_comm() const { return m_comm.get(); }
 
 	/*!
 	  \brief Return the name of the process containing this thread from argv[0], e.g. "/bin/top".
 	*/
-	inline const std::string& get_exe() const { return m_exe; }
+	inline const std::string& get_exe() const { return m_exe.get(); }
 
 	/*!
 	  \brief Return the full executable path of the process containing this thread, e.g. "/bin/top".
 	*/
-	inline const std::string& get_exepath() const { return m_exepath; }
+	inline const std::string& get_exepath() const { return m_exepath.get(); }
 
 	/*!
 	  \brief Return the working directory of the process containing this thread.
 	*/
 	std::string get_cwd();
 
+	/*!
+	  \brief Return the command line arguments of the process containing this thread.
+	*/
+	inline const std::vector<std::string>& get_args() const { return m_args.get(); }
+
+	/*!
+	  \brief Set the process strings of this thread, sharing them with the
+	   other threads that have the same ones.
+	*/
+	void set_comm(std::string comm);
+	void set_exe(std::string exe);
+	void set_exepath(std::string exepath);
+	void set_args(std::vector<std::string> args);
+
 	/*!
 	  \brief Return the values of all environment variables for the process
 	  containing this thread.
@@ -147,7 +164,10 @@ public:
 				{
 					return NULL;
 				}
-				m_main_thread = ptinfo;
+				if(!g_state_read_only)
+				{
+					m_main_thread = ptinfo;
+				}
 				return &*ptinfo;
 			}
 		}
@@ -185,7 +205,10 @@ public:
 				// Its current name is now its old
 				// name. The name might change as a
 				// result of parsing.
-				fdinfo->m_oldname = fdinfo->m_name;
+				if(!g_state_read_only)
+				{
+					fdinfo->m_oldname = fdinfo->m_name;
+				}
 				return fdinfo;
 			}
 		}
@@ -266,7 +289,7 @@ public:
 	void set_loginuser(uint32_t loginuid);
 
 	using cgroups_t = std::vector<std::pair<std::string, std::string>>;
-	cgroups_t& cgroups() const;
+	const cgroups_t& cgroups() const;
 
 	// In rare cases, a thread may do an exec, which results in
 	// the thread having its tid reset to be the main thread of
@@ -285,13 +308,18 @@ public:
 	int64_t m_pid; ///< The id of the process containing this thread. In single thread threads, this is equal to tid.
 	int64_t m_ptid; ///< The id of the process that started this thread.
 	int64_t m_sid; ///< The session id of the process containing this thread.
-	std::string m_comm; ///< Command name (e.g. "top")
-	std::string m_exe; ///< argv[0] (e.g. "sshd: user@pts/4")
-	std::string m_exepath; ///< full executable path
+	//
+	// The process strings are interned in the thread manager, and shared
+	// by the threads that have the same ones, e.g. the threads of a
+	// process and its forked children. Use the setters to change them.
+	//
+	interned<std::string> m_comm; ///< Command name (e.g. "top")
+	interned<std::string> m_exe; ///< argv[0] (e.g. "sshd: user@pts/4")
+	interned<std::string> m_exepath; ///< full executable path
 	bool m_exe_writable;
-	std::vector<std::string> m_args; ///< Command line arguments (e.g. "-d1")
-	std::vector<std::string> m_env; ///< Environment variables
-	std::unique_ptr<cgroups_t> m_cgroups; ///< subsystem-cgroup pairs
+	interned<std::vector<std::string>> m_args; ///< Command line arguments (e.g. "-d1")
+	interned<std::vector<std::string>> m_env; ///< Environment variables
+	interned<cgroups_t> m_cgroups; ///< subsystem-cgroup pairs
 	std::string m_container_id; ///< heuristic-based container id
 	uint32_t m_flags; ///< The thread flags. See the PPM_CL_* declarations in ppm_events_public.h.
 	int64_t m_fdlimit;  ///< The maximum number of FDs this thread can open
@@ -341,6 +369,7 @@ public:
 	uint64_t m_lastevent_ts; ///< timestamp of the last event for this thread.
 	uint64_t m_prevevent_ts; ///< timestamp of the event before the last for this thread.
 	uint64_t m_lastaccess_ts; ///< The last time this thread was looked up. Used when cleaning up the table.
+	uint64_t m_inactive_check_ts; ///< When the thread manager checks next if this thread is still alive.
 	uint64_t m_clone_ts; ///< When the clone that started this process happened.
 
 	//
@@ -444,6 +473,13 @@ VISIBILITY_PRIVATE
 		}
 	}
 	void allocate_private_state();
+
+	//
+	// Brings the thread back to the state of a new one, so that it can be
+	// reused by the threadinfo pool
+	//
+	void reset();
+
 	void compute_program_hash();
 	std::shared_ptr<sinsp_threadinfo> lookup_thread() const;
 
@@ -494,52 +530,89 @@ VISIBILITY_PRIVATE
 
 /*@}*/
 
+//
+// The thread table, indexed by tid. The threads are kept in a single array
+// of slots, with open addressing and linear probing: a lookup hashes the tid
+// and scans the following slots, which usually share a cache line, instead
+// of walking the nodes of a bucket. The slots are at most 3/4 full, and
+// erase() moves the slots after the erased one back, so that there are no
+// tombstones to skip.
+//
+// The threads are iterated in slot order, and the callbacks of loop() must
+// not add or remove threads.
+//
 class threadinfo_map_t
 {
 public:
 	typedef std::shared_ptr<sinsp_threadinfo> ptr_t;
 
-	inline void put(ptr_t tinfo)
+	threadinfo_map_t():
+		m_size(0),
+		m_shift(64)
 	{
-		m_threads[tinfo->m_tid] = std::move(tinfo);
 	}
 
-	inline sinsp_threadinfo* get(uint64_t tid)
+	inline void put(ptr_t tinfo)
 	{
-		auto it = m_threads.find(tid);
-		if (it == m_threads.end())
+		if((m_size + 1) * 4 > m_slots.size() * 3)
 		{
-			return  nullptr;
+			grow();
 		}
-		return it->second.get();
+
+		int64_t tid = tinfo->m_tid;
+		insert(tid, std::move(tinfo));
+	}
+
+	inline sinsp_threadinfo* get(uint64_t tid)
+	{
+		slot* s = find((int64_t)tid);
+		return s != nullptr ? s->m_tinfo.get() : nullptr;
 	}
 
 	inline ptr_t get_ref(uint64_t tid)
 	{
-		auto it = m_threads.find(tid);
-		if (it == m_threads.end())
-		{
-			return  nullptr;
-		}
-		return it->second;
+		slot* s = find((int64_t)tid);
+		return s != nullptr ? s->m_tinfo : nullptr;
 	}
 
 	inline void erase(uint64_t tid)
 	{
-		m_threads.erase(tid);
+		slot* s = find((int64_t)tid);
+		if(s == nullptr)
+		{
+			return;
+		}
+
+		// Move back the slots that would not be found anymore through
+		// the empty one
+		size_t hole = s - m_slots.data();
+		for(size_t j = next(hole); m_slots[j].m_tinfo; j = next(j))
+		{
+			size_t h = home(m_slots[j].m_tid);
+			if(((j - h) & mask()) >= ((j - hole) & mask()))
+			{
+				m_slots[hole] = std::move(m_slots[j]);
+				hole = j;
+			}
+		}
+
+		m_slots[hole].m_tinfo.reset();
+		m_size--;
 	}
 
 	inline void clear()
 	{
-		m_threads.clear();
+		std::vector<slot>().swap(m_slots);
+		m_size = 0;
+		m_shift = 64;
 	}
 
 	template <typename Visitor>
 	inline bool loop(const Visitor& callback)
 	{
-		for (auto& it : m_threads)
+		for (auto& s : m_slots)
 		{
-			if (!callback(*it.second.get()))
+			if (s.m_tinfo && !callback(*s.m_tinfo.get()))
 			{
 				return false;
 			}
@@ -549,13 +622,102 @@ public:
 
 	inline size_t size() const
 	{
-		return m_threads.size();
+		return m_size;
 	}
 
 protected:
-	std::unordered_map<int64_t, ptr_t> m_threads;
-};
+	struct slot
+	{
+		int64_t m_tid;
+		ptr_t m_tinfo; ///< NULL if the slot is free
+	};
+
+	inline size_t mask() const
+	{
+		return m_slots.size() - 1;
+	}
+
+	inline size_t next(size_t j) const
+	{
+		return (j + 1) & mask();
+	}
+
+	// Fibonacci hashing, so that consecutive tids spread over the table
+	inline size_t home(int64_t tid) const
+	{
+		return (size_t)(((uint64_t)tid * 0x9e3779b97f4a7c15ULL) >> m_shift);
+	}
+
+	inline void insert(int64_t tid, ptr_t tinfo)
+	{
+		for(size_t j = home(tid);; j = next(j))
+		{
+			slot& s = m_slots[j];
+			if(!s.m_tinfo)
+			{
+				s.m_tid = tid;
+				s.m_tinfo = std::move(tinfo);
+				m_size++;
+				return;
+			}
+			if(s.m_tid == tid)
+			{
+				s.m_tinfo = std::move(tinfo);
+				return;
+			}
+		}
+	}
 
+	inline slot* find(int64_t tid)
+	{
+		if(m_size == 0)
+		{
+			return nullptr;
+		}
+
+		for(size_t j = home(tid);; j = next(j))
+		{
+			slot& s = m_slots[j];
+			if(!s.m_tinfo)
+			{
+				return nullptr;
+			}
+			if(s.m_tid == tid)
+			{
+				return &s;
+			}
+		}
+	}
+
+	void grow()
+	{
+		std::vector<slot> old;
+		old.swap(m_slots);
+
+		size_t nslots = old.empty() ? s_min_slots : old.size() * 2;
+		m_slots.resize(nslots);
+		m_shift = 64;
+		for(size_t n = nslots; n > 1; n >>= 1)
+		{
+			m_shift--;
+		}
+
+		m_size = 0;
+		for(auto& s : old)
+		{
+			if(s.m_tinfo)
+			{
+				insert(s.m_tid, std::move(s.m_tinfo));
+			}
+		}
+	}
+
+	static const size_t s_min_slots = 64;
+
+	std::vector<slot> m_slots; ///< A power of 2 of them
+	size_t m_size;
+	uint32_t m_shift; ///< 64 - log2 of the number of slots
+};
 
 ///////////////////////////////////////////////////////////////////////////////
 // Little class that manages the allocation of private state in the thread info class
@@ -592,9 +754,16 @@ public:
 	sinsp_thread_manager(sinsp* inspector);
 	void clear();
 
+	/*!
+	  \brief Return a new thread, reusing the memory of a thread that
+	   was removed from the table if there is one.
+	*/
+	threadinfo_map_t::ptr_t new_threadinfo();
+
 	bool add_thread(std::shared_ptr<sinsp_threadinfo> threadinfo, bool from_scap_proctable);
 	void remove_thread(int64_t tid, bool force);
-	// Returns true if the table is actually scanned
+	// Checks the threads that are due, at most m_max_inactive_thread_checks,
+	// and returns true if some of them were removed
 	// NOTE: this is implemented in sinsp.cpp so we can inline it from there
 	inline bool remove_inactive_threads();
 	void fix_sockets_coming_from_proc();
@@ -658,9 +827,29 @@ public:
 
 	void set_m_max_n_proc_lookups(int32_t val) { m_max_n_proc_lookups = val; }
 	void set_m_max_n_proc_socket_lookups(int32_t val) { m_max_n_proc_socket_lookups = val; }
+	void set_max_inactive_thread_checks(uint32_t val) { m_max_inactive_thread_checks = val; }
+
+	object_pool_stats get_threadinfo_pool_stats() const { return m_threadinfo_pool.get_stats(); }
+	object_pool_stats get_fdinfo_pool_stats() const { return m_fdinfo_pool.get_stats(); }
+	sinsp_fdinfo_pool& get_fdinfo_pool() { return m_fdinfo_pool; }
+
+	/*!
+	  \brief Return the shared copy of a process string of the threads,
+	   adding it to the tables if no thread has it.
+	*/
+	interned<std::string> intern(std::string value) { return m_interned_strings.intern(std::move(value)); }
+	interned<std::vector<std::string>> intern(std::vector<std::string> value) { return m_interned_strvecs.intern(std::move(value)); }
+	interned<sinsp_threadinfo::cgroups_t> intern(sinsp_threadinfo::cgroups_t value) { return m_interned_cgroups.intern(std::move(value)); }
+
+	/*!
+	  \brief Return the number of different process strings, argument and
+	   environment lists, and cgroup lists shared by the threads.
+	*/
+	size_t get_interned_count() const { return m_interned_strings.size() + m_interned_strvecs.size() + m_interned_cgroups.size(); }
 private:
 	void increment_mainthread_childcount(sinsp_threadinfo* threadinfo, bool create_if_needed);
 	inline void clear_thread_pointers(sinsp_threadinfo& threadinfo);
+	void schedule_inactive_check(sinsp_threadinfo* tinfo, uint64_t ts);
 	void free_dump_fdinfos(std::vector<scap_fdinfo*>* fdinfos_to_free);
 	void thread_to_scap(sinsp_threadinfo& tinfo, scap_threadinfo* sctinfo);
 
@@ -668,7 +857,6 @@ private:
 	threadinfo_map_t m_threadtable;
 	int64_t m_last_tid;
 	std::weak_ptr<sinsp_threadinfo> m_last_tinfo;
-	uint64_t m_last_flush_time_ns;
 	uint32_t m_n_drops;
 	const uint32_t m_thread_table_absolute_max_size = 524288;
 	uint32_t m_max_thread_table_size;
@@ -678,6 +866,40 @@ private:
 	int32_t m_max_n_proc_lookups = -1;
 	int32_t m_max_n_proc_socket_lookups = -1;
 
+	//
+	// The timing wheel of the inactive thread checks. Each thread is in
+	// the slot of the second of its next check, and is checked after the
+	// slot is over; the threads checked in a later turn of the wheel are
+	// put back. remove_inactive_threads() processes at most
+	// m_max_inactive_thread_checks threads or slots per event, so that
+	// purging a large table doesn't stop the capture while it's scanned.
+	//
+	struct inactive_check
+	{
+		int64_t m_tid;
+		uint64_t m_ts; ///< The m_inactive_check_ts of the thread, if this check is still valid
+	};
+	enum { s_inactive_wheel_size = 128 };
+	std::vector<std::vector<inactive_check>> m_inactive_wheel;
+	std::vector<inactive_check> m_inactive_expired; ///< The checks of the slot being processed
+	uint64_t m_inactive_wheel_ts; ///< The start of the next slot to process
+	uint32_t m_max_inactive_thread_checks = 32;
+
+	//
+	// The threads and the fds removed from the tables, reused for the
+	// next ones. They are declared after the thread table, so that they
+	// are destroyed before it, and the threads still in the table are
+	// deleted instead of being pooled.
+	//
+	const size_t m_threadinfo_pool_max_size = 1024;
+	const size_t m_fdinfo_pool_max_size = 16384;
+	object_pool<sinsp_threadinfo> m_threadinfo_pool;
+	sinsp_fdinfo_pool m_fdinfo_pool;
+
+	interned_table<std::string> m_interned_strings; ///< comm, exe and exepath
+	interned_table<std::vector<std::string>> m_interned_strvecs; ///< args and env
+	interned_table<sinsp_threadinfo::cgroups_t> m_interned_cgroups;
+
 	INTERNAL_COUNTER(m_failed_lookups);
 	INTERNAL_COUNTER(m_cached_lookups);
 	INTERNAL_COUNTER(m_non_cached_lookups);